@@ -1254,6 +1254,114 @@ public:
     }
 };
 
+/** Read only stream over data it does not own, e.g. a value read from the db.
+ *
+ * Unlike CDataStream the data is neither copied nor zeroed when the stream goes away, so it must only be
+ * used for non-secret data which outlives the stream.
+ */
+class CDataSpanStream
+{
+protected:
+    const char* pcur;
+    const char* pend;
+    int nType;
+    int nVersion;
+
+public:
+    CDataSpanStream(const char* pbeginIn, const char* pendIn, int nTypeIn, int nVersionIn)
+        : pcur(pbeginIn), pend(pendIn), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    const char* begin() const    { return pcur; }
+    const char* end() const      { return pend; }
+    size_t size() const          { return pend - pcur; }
+    bool empty() const           { return pcur == pend; }
+    bool eof() const             { return pcur == pend; }
+
+    int GetType()                { return nType; }
+    int GetVersion()             { return nVersion; }
+
+    CDataSpanStream& read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw ios_base::failure("CDataSpanStream::read() : end of data");
+        memcpy(pch, pcur, nSize);
+        pcur += nSize;
+        return (*this);
+    }
+
+    CDataSpanStream& ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw ios_base::failure("CDataSpanStream::ignore() : end of data");
+        pcur += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CDataSpanStream& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/** Write only stream into an inline buffer of N bytes, which only spills to the heap when the data
+ *  exceeds it. Meant for short lived encodings such as db keys, the data is not zeroed.
+ */
+template<size_t N>
+class CInlineDataStream
+{
+protected:
+    char inlineData[N];
+    string heapData;
+    size_t nSize;
+    bool fHeap;
+    int nType;
+    int nVersion;
+
+public:
+    CInlineDataStream(int nTypeIn, int nVersionIn)
+        : nSize(0), fHeap(false), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    CInlineDataStream(const CInlineDataStream&) = delete;
+    CInlineDataStream& operator=(const CInlineDataStream&) = delete;
+
+    const char* data() const     { return fHeap ? heapData.data() : inlineData; }
+    size_t size() const          { return nSize; }
+    bool empty() const           { return nSize == 0; }
+    string str() const           { return string(data(), nSize); }
+
+    // keeps the heap buffer, if any, for the next use of the stream
+    void clear()                 { nSize = 0; fHeap = false; heapData.clear(); }
+
+    int GetType()                { return nType; }
+    int GetVersion()             { return nVersion; }
+
+    CInlineDataStream& write(const char* pch, size_t nWriteSize)
+    {
+        if (!fHeap && nSize + nWriteSize <= N) {
+            memcpy(inlineData + nSize, pch, nWriteSize);
+        } else {
+            if (!fHeap) {
+                heapData.assign(inlineData, nSize);
+                fHeap = true;
+            }
+            heapData.append(pch, nWriteSize);
+        }
+        nSize += nWriteSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CInlineDataStream& operator<<(const T& obj)
+    {
+        // Serialize to this stream
+        ::Serialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 
 
 /** RAII wrapper for FILE*.
@@ -416,6 +416,7 @@ CBaseParams::CBaseParams() {
     fReindex                = false;
     fBenchmark              = false;
     fTxIndex                = false;
+    fDexOrderBookIndex      = false;
     fLogFailures            = false;
     fServer                 = false;
     nTxCacheHeight          = 500;
@@ -67,10 +67,11 @@ protected:
     mutable bool fReindex;
     mutable bool fBenchmark;
     mutable bool fTxIndex;
+    mutable bool fDexOrderBookIndex;
     mutable bool fLogFailures;
     mutable bool fGenReceipt;
     mutable int64_t nTimeBestReceived;
-    mutable uint32_t nCacheSize;
+    mutable uint64_t nCacheSize;  // bytes of the chain state caches, -dbcache
     mutable int32_t nTxCacheHeight;
     mutable int32_t nMaxForkTime;  // to limit the maximum fork time in seconds.
 
@@ -94,6 +95,7 @@ public:
         te += strprintf("fReindex:%d\n",                            fReindex);
         te += strprintf("fBenchmark:%d\n",                          fBenchmark);
         te += strprintf("fTxIndex:%d\n",                            fTxIndex);
+        te += strprintf("fDexOrderBookIndex:%d\n",                  fDexOrderBookIndex);
         te += strprintf("fLogFailures:%d\n",                        fLogFailures);
         te += strprintf("nTimeBestReceived:%llu\n",                 nTimeBestReceived);
         te += strprintf("nBlockIntervalPreVer2Fork:%u\n",  nBlockIntervalPreVer2Fork);
@@ -156,18 +158,21 @@ public:
     bool IsReindex() const { return fReindex; }
     bool IsBenchmark() const { return fBenchmark; }
     bool IsTxIndex() const { return fTxIndex; }
+    bool IsDexOrderBookIndex() const { return fDexOrderBookIndex; }
     bool IsLogFailures() const { return fLogFailures; };
     bool IsGenReceipt() const { return fGenReceipt; };
     int64_t GetBestRecvTime() const { return nTimeBestReceived; }
-    uint32_t GetCacheSize() const { return nCacheSize; }
+    uint64_t GetCacheSize() const { return nCacheSize; }
     int32_t GetTxCacheHeight() const { return nTxCacheHeight; }
     void SetImporting(bool flag) const { fImporting = flag; }
     void SetReIndex(bool flag) const { fReindex = flag; }
     void SetBenchMark(bool flag) const { fBenchmark = flag; }
     void SetTxIndex(bool flag) const { fTxIndex = flag; }
+    void SetDexOrderBookIndex(bool flag) const { fDexOrderBookIndex = flag; }
     void SetLogFailures(bool flag) const { fLogFailures = flag; }
     void SetGenReceipt(bool flag) const { fGenReceipt = flag; }
     void SetBestRecvTime(int64_t nTime) const { nTimeBestReceived = nTime; }
+    void SetCacheSize(uint64_t size) const { nCacheSize = size; }
     // use for cdp interest
     uint32_t GetOneDayBlocks(const int32_t currBlockHeight) const;
     int32_t GetMaxForkHeight(int32_t currBlockHeight) const;
@@ -5,6 +5,7 @@
 
 #include "contract.h"
 #include "config/const.h"
+#include "crypto/hash.h"
 
 bool CLuaContract::IsValid() {
     if (code.size() > MAX_CONTRACT_CODE_SIZE)
@@ -35,4 +36,11 @@ bool CUniversalContract::IsValid() {
         return false;
 
     return true;
-}
\ No newline at end of file
+}
+uint256 CUniversalContractStore::GetCodeHash() const {
+    return Hash(code.begin(), code.end());
+}
+
+uint256 CUniversalContractStore::GetAbiHash() const {
+    return Hash(abi.begin(), abi.end());
+}
@@ -9,6 +9,7 @@
 
 #include "id.h"
 #include "commons/serialize.h"
+#include "commons/uint256.h"
 #include "config/version.h"
 #include "commons/util/util.h"
 
@@ -169,6 +170,60 @@ public:
                 strprintf("abi=%s", memo) + ", " +
                 strprintf("memo=%d", abi);
     }
+
+    uint256 GetCodeHash() const;
+    uint256 GetAbiHash() const;
+};
+
+/**
+ *  lightweight metadata of a CUniversalContractStore, persisted next to it so that the VMs can
+ *  check a contract and resolve its code without loading the code and abi
+ */
+class CUniversalContractMeta {
+public:
+    VMType vm_type      = VMType::NULL_VM;
+    CRegID maintainer;
+    bool upgradable     = false;
+    uint256 code_hash;          //!< Hash of the contract code
+    uint256 abi_hash;           //!< Hash of the contract abi
+    uint32_t code_size  = 0;
+    uint32_t abi_size   = 0;
+
+public:
+    CUniversalContractMeta() {}
+
+    explicit CUniversalContractMeta(const CUniversalContractStore &contractStore)
+        : vm_type(contractStore.vm_type),
+          maintainer(contractStore.maintainer),
+          upgradable(contractStore.upgradable),
+          code_hash(contractStore.GetCodeHash()),
+          abi_hash(contractStore.GetAbiHash()),
+          code_size(contractStore.code.size()),
+          abi_size(contractStore.abi.size()) {}
+
+    bool IsEmpty() const { return vm_type == VMType::NULL_VM && maintainer.IsEmpty() && code_hash.IsNull(); }
+
+    void SetEmpty() { *this = CUniversalContractMeta(); }
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE((uint8_t &) vm_type);
+        READWRITE(maintainer);
+        READWRITE(upgradable);
+        READWRITE(code_hash);
+        READWRITE(abi_hash);
+        READWRITE(VARINT(code_size));
+        READWRITE(VARINT(abi_size));
+    )
+
+    string ToString() const {
+        return  strprintf("vm_type=%d", vm_type) + ", " +
+                strprintf("maintainer=%s", maintainer.ToString()) + ", " +
+                strprintf("upgradable=%d", upgradable) + ", " +
+                strprintf("code_hash=%s", code_hash.ToString()) + ", " +
+                strprintf("abi_hash=%s", abi_hash.ToString()) + ", " +
+                strprintf("code_size=%u", code_size) + ", " +
+                strprintf("abi_size=%u", abi_size);
+    }
 };
 
 #endif  // ENTITIES_CONTRACT_H
\ No newline at end of file
@@ -77,6 +77,16 @@ namespace dex {
         obj.push_back(Pair("src_id",     order_src.src_id.ToString()));
     }
 
+    ///////////////////////////////////////////////////////////////////////////////
+    // class CDEXPriceLevel
+
+    void CDEXPriceLevel::ToJson(uint64_t price, json_spirit::Object &obj) const {
+        obj.push_back(Pair("price",                     price));
+        obj.push_back(Pair("asset_amount",              asset_amount));
+        obj.push_back(Pair("coin_amount",               coin_amount));
+        obj.push_back(Pair("order_count",               (int64_t)order_count));
+    }
+
 
     ///////////////////////////////////////////////////////////////////////////////
     // class CSysOrder
@@ -8,6 +8,7 @@
 #define ENTITIES_DEX_ORDER_H
 
 #include <string>
+#include <tuple>
 
 #include "id.h"
 #include "asset.h"
@@ -153,6 +154,66 @@ namespace dex {
         void ToJson(json_spirit::Object &obj) const;
     };
 
+    // one side (bids or asks) of the order book of a trading pair
+    struct CDEXOrderBookSide {
+        TokenSymbol asset_symbol = "";              //!< asset symbol
+        TokenSymbol coin_symbol  = "";              //!< coin symbol
+        OrderSide order_side     = ORDER_SIDE_NULL; //!< order side, buy side is the bids
+
+        CDEXOrderBookSide() {}
+
+        CDEXOrderBookSide(const TokenSymbol &assetSymbol, const TokenSymbol &coinSymbol, OrderSide orderSide)
+            : asset_symbol(assetSymbol), coin_symbol(coinSymbol), order_side(orderSide) {}
+
+        IMPLEMENT_SERIALIZE(
+            READWRITE(asset_symbol);
+            READWRITE(coin_symbol);
+            READWRITE((uint8_t&)order_side);
+        )
+
+        friend bool operator<(const CDEXOrderBookSide &a, const CDEXOrderBookSide &b) {
+            return std::tie(a.asset_symbol, a.coin_symbol, a.order_side) <
+                   std::tie(b.asset_symbol, b.coin_symbol, b.order_side);
+        }
+
+        friend bool operator==(const CDEXOrderBookSide &a, const CDEXOrderBookSide &b) {
+            return a.asset_symbol == b.asset_symbol && a.coin_symbol == b.coin_symbol &&
+                   a.order_side == b.order_side;
+        }
+
+        bool IsEmpty() const { return asset_symbol.empty() && coin_symbol.empty() && order_side == ORDER_SIDE_NULL; }
+
+        void SetEmpty() { *this = CDEXOrderBookSide(); }
+
+        string ToString() const {
+            return strprintf("%s-%s-%s", asset_symbol, coin_symbol, kOrderSideHelper.GetName(order_side));
+        }
+    };
+
+    // aggregated remaining amounts of all active limit orders at one price
+    struct CDEXPriceLevel {
+        uint64_t asset_amount = 0;  //!< total remaining asset amount
+        uint64_t coin_amount  = 0;  //!< total remaining coin amount
+        uint32_t order_count  = 0;  //!< count of active orders
+
+        IMPLEMENT_SERIALIZE(
+            READWRITE(VARINT(asset_amount));
+            READWRITE(VARINT(coin_amount));
+            READWRITE(VARINT(order_count));
+        )
+
+        bool IsEmpty() const { return order_count == 0; }
+
+        void SetEmpty() { *this = CDEXPriceLevel(); }
+
+        string ToString() const {
+            return strprintf("asset_amount=%llu, coin_amount=%llu, order_count=%u", asset_amount, coin_amount,
+                             order_count);
+        }
+
+        void ToJson(uint64_t price, json_spirit::Object &obj) const;
+    };
+
     // order txid -> sys order data
     // order txid:
     //   (1) CCDPStakeTx, create sys buy market order for WGRT by WUSD when alter CDP and the interest is WUSD
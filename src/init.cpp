@@ -15,6 +15,7 @@
 
 #include "rpc/core/rpcserver.h"
 #include "vm/luavm/lua/lua.h"
+#include "vm/luavm/luavmprofiler.h"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "main.h"
@@ -25,6 +26,8 @@
 #include "persistence/txdb.h"
 #include "persistence/contractdb.h"
 #include "tx/tx.h"
+#include "tx/txpreexecutor.h"
+#include "tx/txlaneexecutor.h"
 #include "commons/util/util.h"
 #include "commons/util/time.h"
 #ifdef USE_UPNP
@@ -145,6 +148,10 @@ void Shutdown() {
     StopNode();
     UnregisterNodeSignals(GetNodeSignals());
 
+    // the sync thread has stopped with the thread group
+    if (pWalletMain)
+        FlushWalletSync(pWalletMain);
+
     {
         LOCK(cs_main);
 
@@ -216,13 +223,26 @@ string HelpMessage() {
     strUsage += "  -daemon                " + _("Run in the background as a daemon and accept commands") + "\n";
 #endif
     strUsage += "  -datadir=<dir>         " + _("Specify data directory") + "\n";
-    strUsage += "  -dbcache=<n>           " + strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE, MAX_DB_CACHE, DEFAULT_DB_CACHE) + "\n";
+    strUsage += "  -dbcache=<n>           " + strprintf(_("Set the memory budget of the chain state caches in megabytes (%d to %d, default: %d)"), MIN_DB_CACHE, MAX_DB_CACHE, DEFAULT_DB_CACHE) + "\n";
+    strUsage += "  -backgroundflush       " + _("Write the chain state to the databases in a background thread while the next blocks connect (default: 1)") + "\n";
+    strUsage += "  -dbsharedcache=<n>     " + _("Share one LevelDB block cache of <n> megabytes among the databases without a cache size in -dbtune (default: 0, a cache per database)") + "\n";
+    strUsage += "  -dbtune=<db>:<opts>    " + _("Tune the LevelDB of a database, <opts> e.g. contracts:cache=64,writebuffer=16,openfiles=256,bloombits=10,compression=1 (sizes in megabytes)") + "\n";
+    strUsage += "  -forkstateblocks=<n>   " + strprintf(_("Keep the undo data of the latest <n> blocks in memory for evaluating forks (default: %d)"), DEFAULT_FORK_STATE_BLOCKS) + "\n";
     strUsage += "  -loadblock=<file>      " + _("Imports blocks from external blk000??.dat file") + " " + _("on startup") + "\n";
     strUsage += "  -pid=<file>            " + _("Specify pid file (default: coin.pid)") + "\n";
     strUsage += "  -reindex               " + _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup") + "\n";
     strUsage += "  -txindex               " + _("Maintain a full transaction index (default: 0)") + "\n";
+    strUsage += "  -dexorderbookindex     " + _("Maintain a price-sorted order book index of active DEX orders by trading pair (default: 0)") + "\n";
     strUsage += "  -logfailures           " + _("Log failures into level db in detail (default: 0)") + "\n";
     strUsage += "  -genreceipt            " + _("Whether generate receipt(default: 0)") + "\n";
+    strUsage += "  -maxmempool=<n>        " + strprintf(_("Keep the mempool txs within <n> megabytes, evicting the lowest priority and fee rate txs (0 = unlimited, default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE) + "\n";
+    strUsage += "  -mempoolsenderlimit=<n> " + strprintf(_("Accept at most <n> mempool txs of a sender (0 = unlimited, default: %u)"), DEFAULT_MEMPOOL_SENDER_LIMIT) + "\n";
+    strUsage += "  -mempoolpreexecthreads=<n> " + _("Pre-execute contract txs relayed by peers or submitted by RPC on <n> threads before accepting them to the mempool (default: 0, disabled)") + "\n";
+    strUsage += "  -contractlanethreads=<n> " + _("Execute the independent lua contract txs of connected blocks in parallel on <n> threads (default: 0, disabled)") + "\n";
+    strUsage += "  -luavmprofile          " + _("Profile the costs of the lua contract executions, see luavm_getprofile (default: 0)") + "\n";
+#ifdef USE_LZ4
+    strUsage += "  -undocompress          " + _("Compress block undo data with LZ4 (default: 1)") + "\n";
+#endif
 
     strUsage += "\n" + _("Connection options:") + "\n";
     strUsage += "  -addnode=<ip>          " + _("Add a node to connect to and attempt to keep the connection open") + "\n";
@@ -267,6 +287,7 @@ string HelpMessage() {
     strUsage += "  -spendzeroconfchange   " + _("Spend unconfirmed change when sending transactions (default: 1)") + "\n";
     strUsage += "  -upgradewallet         " + _("Upgrade wallet to latest format") + " " + _("on startup") + "\n";
     strUsage += "  -wallet=<file>         " + _("Specify wallet file (within data directory)") + " " + _("(default: wallet.dat)") + "\n";
+    strUsage += "  -walletsyncthread      " + _("Apply the connected blocks to the wallet in a background thread (default: 0)") + "\n";
     strUsage += "  -walletnotify=<cmd>    " + _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)") + "\n";
 #endif
 
@@ -313,6 +334,7 @@ string HelpMessage() {
     strUsage += "  -rpcport=<port>        " + _("Listen for JSON-RPC connections on <port> (default: 8332 or testnet: 18332)") + "\n";
     strUsage += "  -rpcallowip=<ip>       " + _("Allow JSON-RPC connections from specified IP address") + "\n";
     strUsage += "  -rpcthreads=<n>        " + _("Set the number of threads to service RPC calls (default: 4)") + "\n";
+    strUsage += "  -rpcsnapshot           " + _("Serve chain state queries from a snapshot of the last connected block without locking the chain (default: 1)") + "\n";
 
     strUsage += "\n" + _("RPC SSL options: (see the Coin Wiki for SSL setup instructions)") + "\n";
     strUsage += "  -rpcssl                                  " + _("Use OpenSSL (https) for JSON-RPC connections") + "\n";
@@ -533,6 +555,8 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     SysCfg().SetBenchMark(SysCfg().GetBoolArg("-benchmark", false));
     mempool.SetSanityCheck(SysCfg().GetBoolArg("-checkmempool", RegTest()));
+    mempool.SetLimits((uint64_t)max<int64_t>(SysCfg().GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE), 0) << 20,
+                      (uint32_t)max<int64_t>(SysCfg().GetArg("-mempoolsenderlimit", DEFAULT_MEMPOOL_SENDER_LIMIT), 0));
 
     setvbuf(stdout, nullptr, _IOLBF, 0);
 
@@ -687,6 +711,18 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     SysCfg().SetGenReceipt(SysCfg().GetBoolArg("-genreceipt", false));
 
+    int64_t nDbCache = std::max(MIN_DB_CACHE, std::min(MAX_DB_CACHE, SysCfg().GetArg("-dbcache", DEFAULT_DB_CACHE)));
+    SysCfg().SetCacheSize((uint64_t)nDbCache << 20);
+
+    SetDBSharedBlockCache(std::max<int64_t>(0, SysCfg().GetArg("-dbsharedcache", 0)) << 20);
+    for (const auto &strTuning : SysCfg().GetMultiArgs("-dbtune")) {
+        string strError;
+        if (!ParseDBTuning(strTuning, strError))
+            return InitError(strError);
+    }
+
+    forkStateManager.SetMaxBlocks(std::max<int64_t>(0, SysCfg().GetArg("-forkstateblocks", DEFAULT_FORK_STATE_BLOCKS)));
+
     filesystem::path blocksDir = GetDataDir() / "blocks";
     if (!filesystem::exists(blocksDir)) {
         filesystem::create_directories(blocksDir);
@@ -740,6 +776,12 @@ bool AppInit(boost::thread_group &threadGroup) {
                     break;
                 }
 
+                // Check for changed -dexorderbookindex state
+                if (SysCfg().IsDexOrderBookIndex() != SysCfg().GetBoolArg("-dexorderbookindex", false)) {
+                    strLoadError = _("You need to rebuild the database using -reindex to change -dexorderbookindex");
+                    break;
+                }
+
                 if (!VerifyDB(SysCfg().GetArg("-checklevel", 3), SysCfg().GetArg("-checkblocks", 288))) {
                     strLoadError = _("Corrupted block database detected");
                     break;
@@ -855,6 +897,10 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     RandAddSeedPerfmon();
 
+    StartTxPreExecutor(threadGroup, SysCfg().GetArg("-mempoolpreexecthreads", 0));
+    StartContractLaneExecutor(threadGroup, SysCfg().GetArg("-contractlanethreads", 0));
+    CLuaVMProfiler::Instance().SetEnabled(SysCfg().GetBoolArg("-luavmprofile", false));
+
     StartNode(threadGroup);
 
     if (SysCfg().IsServer()) {
@@ -872,6 +918,9 @@ bool AppInit(boost::thread_group &threadGroup) {
         }
         threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pWalletMain->strWalletFile)));
 
+        if (SysCfg().GetBoolArg("-walletsyncthread", false))
+            StartWalletSync(threadGroup, pWalletMain);
+
         //resend unconfirmed tx
         threadGroup.create_thread(boost::bind(&ThreadRelayTx, pWalletMain));
     }
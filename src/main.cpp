@@ -28,6 +28,7 @@
 #include "chain/blockdelegates.h"
 #include "persistence/blockundo.h"
 #include "tx/txserializer.h"
+#include "tx/txlaneexecutor.h"
 
 #include <sstream>
 #include <algorithm>
@@ -56,7 +57,7 @@ CTxMemPool mempool;
 map<uint256, CBlockIndex *> mapBlockIndex;
 int32_t nSyncTipHeight = 0;
 string publicIp;
-map<uint256/* blockhash */, std::shared_ptr<CCacheWrapper>> mapForkCache;
+CForkStateManager forkStateManager;
 CSignatureCache signatureCache;
 CChain chainActive;
 CChain chainMostWork;
@@ -158,22 +159,25 @@ uint32_t nBlockSequenceId = 1;
 // These functions dispatch to one or all registered wallets
 
 void RegisterWallet(CWalletInterface *pWalletIn) {
-    g_signals.SyncTransaction.connect(boost::bind(&CWalletInterface::SyncTransaction, pWalletIn, _1, _2, _3));
+    g_signals.SyncTransaction.connect(boost::bind(&CWalletInterface::SyncTransaction, pWalletIn, _1, _2, _3, _4));
     g_signals.EraseTransaction.connect(boost::bind(&CWalletInterface::EraseTransaction, pWalletIn, _1));
     g_signals.SetBestChain.connect(boost::bind(&CWalletInterface::SetBestChain, pWalletIn, _1));
     // g_signals.Inventory.connect(boost::bind(&CWalletInterface::Inventory, pWalletIn, _1));
     g_signals.Broadcast.connect(boost::bind(&CWalletInterface::ResendWalletTransactions, pWalletIn));
+    g_signals.WaitForSync.connect(boost::bind(&CWalletInterface::WaitForSync, pWalletIn));
 }
 
 void UnregisterWallet(CWalletInterface *pWalletIn) {
+    g_signals.WaitForSync.disconnect(boost::bind(&CWalletInterface::WaitForSync, pWalletIn));
     g_signals.Broadcast.disconnect(boost::bind(&CWalletInterface::ResendWalletTransactions, pWalletIn));
     // g_signals.Inventory.disconnect(boost::bind(&CWalletInterface::Inventory, pWalletIn, _1));
     g_signals.SetBestChain.disconnect(boost::bind(&CWalletInterface::SetBestChain, pWalletIn, _1));
     g_signals.EraseTransaction.disconnect(boost::bind(&CWalletInterface::EraseTransaction, pWalletIn, _1));
-    g_signals.SyncTransaction.disconnect(boost::bind(&CWalletInterface::SyncTransaction, pWalletIn, _1, _2, _3));
+    g_signals.SyncTransaction.disconnect(boost::bind(&CWalletInterface::SyncTransaction, pWalletIn, _1, _2, _3, _4));
 }
 
 void UnregisterAllWallets() {
+    g_signals.WaitForSync.disconnect_all_slots();
     g_signals.Broadcast.disconnect_all_slots();
     // g_signals.Inventory.disconnect_all_slots();
     g_signals.SetBestChain.disconnect_all_slots();
@@ -181,12 +185,14 @@ void UnregisterAllWallets() {
     g_signals.SyncTransaction.disconnect_all_slots();
 }
 
-void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock) {
-    g_signals.SyncTransaction(hash, pBaseTx, pBlock);
+void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock, const set<CKeyID> *pAccountKeyIds) {
+    g_signals.SyncTransaction(hash, pBaseTx, pBlock, pAccountKeyIds);
 }
 
 void EraseTransactionFromWallet(const uint256 &hash) { g_signals.EraseTransaction(hash); }
 
+void WaitForWalletSync() { g_signals.WaitForSync(); }
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Registration of network node signals.
@@ -230,7 +236,7 @@ bool IsStandardTx(CBaseTx *pBaseTx, string &reason) {
     // almost as much to process as they cost the sender in fees, because
     // computing signature hashes is O(ninputs*txsize). Limiting transactions
     // to MAX_STANDARD_TX_SIZE mitigates CPU exhaustion attacks.
-    uint32_t sz = ::GetSerializeSize(pBaseTx->GetNewInstance(), SER_NETWORK, CBaseTx::CURRENT_VERSION);
+    uint32_t sz = pBaseTx->GetTxSize() + 1;
     if (sz >= MAX_STANDARD_TX_SIZE) {
         reason = "tx-size";
         return false;
@@ -255,7 +261,7 @@ bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signatu
 }
 
 bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee) {
+                        bool fLimitFree, bool fRejectInsaneFee, CTxPreExecution *pPreExecution) {
     AssertLockHeld(cs_main);
 
     // is it already in the memory pool?
@@ -317,7 +323,7 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
     if (fRejectInsaneFee && nFees > SysCfg().GetMaxFee())
         return ERRORMSG("AcceptToMemoryPool() : txid: %s pay insane fees, %d > %d", hash.GetHex(), nFees, SysCfg().GetMaxFee());
 
-    return pool.AddUnchecked(hash, entry, state);
+    return pool.AddUnchecked(hash, entry, state, pPreExecution);
 }
 
 int32_t CMerkleTx::GetDepthInMainChainINTERNAL(CBlockIndex *&pindexRet) const {
@@ -686,13 +692,9 @@ void UpdateTime(CBlockHeader &block, const CBlockIndex *pIndexPrev) {
 }
 
 bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool *pfClean) {
-    assert(pIndex->GetBlockHash() == cw.blockCache.GetBestBlockHash());
-
     if (pfClean)
         *pfClean = false;
 
-    bool fClean = true;
-
     CBlockUndo blockUndo;
     CDiskBlockPos pos = pIndex->GetUndoPos();
     if (pos.IsNull())
@@ -701,6 +703,18 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
     if (!blockUndo.ReadFromDisk(pos, pIndex->pprev->GetBlockHash()))
         return ERRORMSG("failure reading undo data");
 
+    return DisconnectBlock(block, blockUndo, cw, pIndex, state, pfClean);
+}
+
+bool DisconnectBlock(CBlock &block, CBlockUndo &blockUndo, CCacheWrapper &cw, CBlockIndex *pIndex,
+                     CValidationState &state, bool *pfClean) {
+    assert(pIndex->GetBlockHash() == cw.blockCache.GetBestBlockHash());
+
+    if (pfClean)
+        *pfClean = false;
+
+    bool fClean = true;
+
     if ((blockUndo.vtxundo.size() != block.vptx.size()) && (blockUndo.vtxundo.size() != (block.vptx.size() + 1)))
         return ERRORMSG("block and undo data inconsistent");
     CBlockUndoExecutor undoExecutor(cw, blockUndo);
@@ -1045,7 +1059,36 @@ static bool ComputeVoteStakingInterestAndRevokeVotes(const uint256& blockHash, c
     return true;
 }
 
-bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck) {
+bool PushBlockToMemCaches(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state) {
+    if (!cw.txCache.AddBlockTx(block)) {
+        return state.Abort(_("PushBlockToMemCaches() : failed add block into transaction memory cache"));
+    }
+
+    if (pIndex->height > SysCfg().GetTxCacheHeight()) {
+        CBlockIndex *pDeleteBlockIndex = pIndex;
+        int32_t nCacheHeight           = SysCfg().GetTxCacheHeight();
+        while (pDeleteBlockIndex && nCacheHeight-- > 0) {
+            pDeleteBlockIndex = pDeleteBlockIndex->pprev;
+        }
+
+        CBlock deleteBlock;
+        if (!ReadBlockFromDisk(pDeleteBlockIndex, deleteBlock)) {
+            return state.Abort(_("PushBlockToMemCaches() : failed to read block"));
+        }
+
+        if (!cw.txCache.RemoveBlockTx(deleteBlock)) {
+            return state.Abort(_("PushBlockToMemCaches() : failed delete block from transaction memory cache"));
+        }
+    }
+
+    if (!cw.ppCache.PushBlock(cw.sysParamCache, pIndex))
+        return state.Abort(_("PushBlockToMemCaches() : push block to price point memory cache failed"));
+
+    return true;
+}
+
+bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck,
+                  CBlockUndo *pBlockUndo) {
     AssertLockHeld(cs_main);
 
     bool isGensisBlock = (block.GetHeight() == 0) && (block.GetHash() == SysCfg().GetGenesisBlockHash());
@@ -1117,6 +1160,10 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         uint32_t fuelRate     = block.GetFuelRate();
         uint64_t totalFuel    = 0;
 
+        // consecutive lua contract txs executed in parallel lanes, see ExecuteContractTxLanes
+        int32_t laneBeginIndex = 0, laneEndIndex = 0, laneScanEndIndex = 0;
+        vector<CTxUndo> laneTxUndos;
+
         for (int32_t index = 1; index < (int32_t)block.vptx.size(); ++index) {
             std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[index];
             if (cw.txCache.HasTx((pBaseTx->GetHash())))
@@ -1127,15 +1174,36 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
                 return state.DoS(100, ERRORMSG("[%d] txid=%s beyond the scope of valid height", curHeight,
                                  pBaseTx->GetHash().GetHex()), REJECT_INVALID, "tx-invalid-height");
 
-            pBaseTx->nFuelRate = fuelRate;
-            CTxUndoOpLogger opLogger(cw, pBaseTx->GetHash(), blockUndo);
+            if (index >= laneScanEndIndex && pBaseTx->nTxType == LCONTRACT_INVOKE_TX && IsContractLaneExecutorStarted()) {
+                // the txs failing these checks are reported by the serial execution
+                int32_t endIndex = index;
+                while (endIndex < (int32_t)block.vptx.size() && block.vptx[endIndex]->nTxType == LCONTRACT_INVOKE_TX &&
+                       !cw.txCache.HasTx(block.vptx[endIndex]->GetHash()) &&
+                       block.vptx[endIndex]->IsValidHeight(curHeight, validHeight)) {
+                    block.vptx[endIndex]->nFuelRate = fuelRate;
+                    ++endIndex;
+                }
 
-            uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
-            CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, &cw, &state);
-            if (!pBaseTx->CheckAndExecuteTx(context)) {
-                pCdMan->pLogCache->SetExecuteFail(pIndex->height, pBaseTx->GetHash(), state.GetRejectCode(), state.GetRejectReason());
-                return state.DoS(100, ERRORMSG("[%d] txid=%s check/execute failed, in detail: %s", pIndex->height,
-                                 pBaseTx->GetHash().GetHex(), pBaseTx->ToString(cw.accountCache)), REJECT_INVALID, "tx-execute-failed");
+                laneBeginIndex   = index;
+                laneScanEndIndex = endIndex;
+                laneEndIndex     = index;
+                if (ExecuteContractTxLanes(block, index, endIndex, pIndex, cw, laneTxUndos))
+                    laneEndIndex = endIndex;
+            }
+
+            pBaseTx->nFuelRate = fuelRate;
+            if (index < laneEndIndex) {
+                blockUndo.vtxundo.push_back(laneTxUndos[index - laneBeginIndex]);
+            } else {
+                CTxUndoOpLogger opLogger(cw, pBaseTx->GetHash(), blockUndo);
+
+                uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
+                CTxExecuteContext context(pIndex->height, index, fuelRate, pIndex->nTime, prevBlockTime, &cw, &state);
+                if (!pBaseTx->CheckAndExecuteTx(context)) {
+                    pCdMan->pLogCache->SetExecuteFail(pIndex->height, pBaseTx->GetHash(), state.GetRejectCode(), state.GetRejectReason());
+                    return state.DoS(100, ERRORMSG("[%d] txid=%s check/execute failed, in detail: %s", pIndex->height,
+                                     pBaseTx->GetHash().GetHex(), pBaseTx->ToString(cw.accountCache)), REJECT_INVALID, "tx-execute-failed");
+                }
             }
 
             pos.tx_cord = CTxCord(pIndex->height, index);
@@ -1157,7 +1225,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
             assert(fees >= fuelFee);
             rewards[fees_symbol] += (fees - fuelFee);
 
-            pos.nTxOffset += ::GetSerializeSize(pBaseTx, SER_DISK, CLIENT_VERSION);
+            pos.nTxOffset += pBaseTx->GetTxSize() + 1;  // tx type prefix
         }
     }
 
@@ -1267,7 +1335,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     if (pIndex->GetUndoPos().IsNull() || (pIndex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) {
         if (pIndex->GetUndoPos().IsNull()) {
             CDiskBlockPos pos;
-            if (!FindUndoPos(state, pIndex->nFile, pos, ::GetSerializeSize(blockUndo, SER_DISK, CLIENT_VERSION) + 40))
+            if (!FindUndoPos(state, pIndex->nFile, pos, blockUndo.GetDiskSize() + 40))
                 return state.Abort(_("ConnectBlock() : failed to find undo data's position"));
 
             // uint256 preHash;
@@ -1298,53 +1366,26 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
             return state.Abort(_("ConnectBlock() : failed to write block index"));
     }
 
-    if (!cw.txCache.AddBlockTx(block)) {
-        return state.Abort(_("ConnectBlock() : failed add block into transaction memory cache"));
-    }
-
-    if (pIndex->height > SysCfg().GetTxCacheHeight()) {
-        CBlockIndex *pDeleteBlockIndex = pIndex;
-        int32_t nCacheHeight           = SysCfg().GetTxCacheHeight();
-        while (pDeleteBlockIndex && nCacheHeight-- > 0) {
-            pDeleteBlockIndex = pDeleteBlockIndex->pprev;
-        }
-
-        CBlock deleteBlock;
-        if (!ReadBlockFromDisk(pDeleteBlockIndex, deleteBlock)) {
-            return state.Abort(_("ConnectBlock() : failed to read block"));
-        }
-
-        if (!cw.txCache.RemoveBlockTx(deleteBlock)) {
-            return state.Abort(_("ConnectBlock() : failed delete block from transaction memory cache"));
-        }
-    }
-
-    if (!cw.ppCache.PushBlock(cw.sysParamCache, pIndex))
-        return state.Abort(_("ConnectBlock() : push block to price point memory cache failed"));
+    if (!PushBlockToMemCaches(block, cw, pIndex, state))
+        return false;
 
     // Set best block to current account cache.
     cw.blockCache.SetBestBlock(pIndex->GetBlockHash());
 
+    if (pBlockUndo)
+        std::swap(*pBlockUndo, blockUndo);
+
     return true;
 }
 
-// Update the on-disk chain state.
-bool static WriteChainState(CValidationState &state) {
+// Update the on-disk chain state, fWritten is set if the caches were flushed.
+bool static WriteChainState(CValidationState &state, bool &fWritten) {
+    fWritten = false;
     static int64_t nLastWrite = 0;
-    uint32_t cacheSize        =
-        pCdMan->pSysParamCache->GetCacheSize() +
-        pCdMan->pAccountCache->GetCacheSize() +
-        pCdMan->pAssetCache->GetCacheSize() +
-        pCdMan->pContractCache->GetCacheSize() +
-        pCdMan->pDelegateCache->GetCacheSize() +
-        pCdMan->pCdpCache->GetCacheSize() +
-        pCdMan->pClosedCdpCache->GetCacheSize() +
-        pCdMan->pDexCache->GetCacheSize() +
-        pCdMan->pBlockCache->GetCacheSize() +
-        pCdMan->pLogCache->GetCacheSize() +
-        pCdMan->pReceiptCache->GetCacheSize();
-
-    if (!IsInitialBlockDownload() || cacheSize > SysCfg().GetCacheSize() ||
+    int64_t cacheSize         = GetDBCacheTotalBytes();
+    uint64_t cacheBudget      = SysCfg().GetCacheSize();
+
+    if (!IsInitialBlockDownload() || (uint64_t)cacheSize > cacheBudget ||
         GetTimeMicros() > nLastWrite + 60 * 1000000) {
         // Typical CCoins structures on disk are around 100 bytes in size.
         // Pushing a new one to the database can cause it to be written
@@ -1356,21 +1397,42 @@ bool static WriteChainState(CValidationState &state) {
 
         FlushBlockFile();
         // pCdMan->pBlockCache->Sync();
-        pCdMan->Flush();
-        mapForkCache.clear();
+
+        // only the dirty entries are written, the clean ones stay resident up to half of the budget
+        // so that the caches are still warm after the flush
+        double keepRatio = cacheSize > 0 ? std::min(1.0, cacheBudget / 2.0 / cacheSize) : 1.0;
+        CDBCacheEvictionScope evictionScope(keepRatio);
+        if (SysCfg().GetBoolArg("-backgroundflush", true)) {
+            string strError;
+            if (!pCdMan->FlushInBackground(strError))
+                return state.Error(strprintf("write chain state failed: %s", strError));
+        } else {
+            pCdMan->Flush();
+        }
         nLastWrite = GetTimeMicros();
+        fWritten   = true;
     }
     return true;
 }
 
 // Update chainActive and related internal data structures.
-void static UpdateTip(CBlockIndex *pIndexNew, const CBlock &block) {
+void static UpdateTip(CBlockIndex *pIndexNew, const CBlock &block, bool fStateWritten,
+                      const set<CKeyID> &accountKeyIds) {
     chainActive.SetTip(pIndexNew);
 
-    SyncTransaction(uint256(), nullptr, &block);
-
     // Update best block in wallet (so we can detect restored wallets)
     bool fIsInitialDownload = IsInitialBlockDownload();
+
+    // Freeze the new tip state for query RPCs, from the dbs once they hold the flushed state. During initial
+    // download the caches are not flushed per block, so RPCs fall back to cs_main there.
+    if (fStateWritten && !fIsInitialDownload && SysCfg().GetBoolArg("-rpcsnapshot", true))
+        pCdMan->RefreshReadSnapshot(pIndexNew);
+    else
+        pCdMan->ResetReadSnapshot();
+
+    // queued to the wallet with the frozen state of the new tip
+    SyncTransaction(uint256(), nullptr, &block, &accountKeyIds);
+
     if ((chainActive.Height() % 20160) == 0 || (!fIsInitialDownload && (chainActive.Height() % 144) == 0))
         g_signals.SetBestChain(chainActive.GetLocator());
 
@@ -1408,15 +1470,23 @@ bool DisconnectTip(CValidationState &state) {
         return state.Abort(_("Failed to read blocks from disk."));
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
+    set<CKeyID> accountKeyIds;
     {
         auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
 
+        // The values replaced by the disconnect are logged for the fork views.
+        CDBOpLogMap redoOpLogMap;
+        spCW->SetDbOpLogMap(&redoOpLogMap);
         if (!DisconnectBlock(block, *spCW, pBlockIndexToDelete, state))
             return ERRORMSG("DisconnectBlock %s failed", pBlockIndexToDelete->GetBlockHash().ToString());
+        spCW->SetDbOpLogMap(nullptr);
+        GetAccountKeyIds(redoOpLogMap, accountKeyIds);
 
         // Need to re-sync all to global cache layer.
         spCW->Flush();
 
+        forkStateManager.PopTip(pBlockIndexToDelete, block, redoOpLogMap);
+
         // Attention: need to reset the lastest block price median
         CBlockIndex *pPreBlockIndex = pBlockIndexToDelete->pprev;
         CBlock preBlock;
@@ -1429,10 +1499,11 @@ bool DisconnectTip(CValidationState &state) {
     if (SysCfg().IsBenchmark())
         LogPrint(BCLog::INFO, "Time elapsed: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
     // Write the chain state to disk, if necessary.
-    if (!WriteChainState(state))
+    bool fStateWritten = false;
+    if (!WriteChainState(state, fStateWritten))
         return false;
     // Update chainActive and related variables.
-    UpdateTip(pBlockIndexToDelete->pprev, block);
+    UpdateTip(pBlockIndexToDelete->pprev, block, fStateWritten, accountKeyIds);
     // Resurrect mempool transactions from the disconnected block.
     for (const auto &pTx : block.vptx) {
         list<std::shared_ptr<CBaseTx> > removed;
@@ -1453,17 +1524,20 @@ bool DisconnectTip(CValidationState &state) {
 bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
     assert(pIndexNew->pprev == chainActive.Tip());
     // Read block from disk.
-    CBlock block;
+    auto spBlock = std::make_shared<CBlock>();
+    CBlock &block = *spBlock;
     if (!ReadBlockFromDisk(pIndexNew, block))
         return state.Abort(strprintf("Failed to read block hash: %s", pIndexNew->GetBlockHash().GetHex()));
 
     // Apply the block automatically to the chain state.
     int64_t nStart = GetTimeMicros();
+    set<CKeyID> accountKeyIds;
     {
         CInv inv(MSG_BLOCK, pIndexNew->GetBlockHash());
 
         auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
-        if (!ConnectBlock(block, *spCW, pIndexNew, state)) {
+        CBlockUndo blockUndo;
+        if (!ConnectBlock(block, *spCW, pIndexNew, state, false, &blockUndo)) {
             if (state.IsInvalid()) {
                 InvalidBlockFound(pIndexNew, state);
             }
@@ -1477,20 +1551,25 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
 
         // Need to re-sync all to global cache layer.
         spCW->Flush();
+        blockUndo.GetAccountKeyIds(accountKeyIds);
+
+        // Keep the undo data in memory for evaluating the fork chains.
+        forkStateManager.PushTip(pIndexNew, spBlock, blockUndo);
     }
 
     if (SysCfg().IsBenchmark())
         LogPrint(BCLog::INFO, "- Connect: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
 
     // Write the chain state to disk, if necessary.
-    if (!WriteChainState(state))
+    bool fStateWritten = false;
+    if (!WriteChainState(state, fStateWritten))
         return false;
 
     // Update chainActive & related variables.
-    UpdateTip(pIndexNew, block);
+    UpdateTip(pIndexNew, block, fStateWritten, accountKeyIds);
 
     for (auto &pTxItem : block.vptx) {
-        mempool.memPoolTxs.erase(pTxItem->GetHash());
+        mempool.RemoveConfirmed(pTxItem->GetHash());
     }
     return true;
 }
@@ -1777,7 +1856,8 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
     // If the block's previous block is not the active chain's tip, find the forked point.
     while (!chainActive.Contains(pPreBlockIndex)) {
         if (!forkChainTipFound) {
-            if (mapForkCache.count(pPreBlockIndex->GetBlockHash())) {
+            spCW = forkStateManager.GetForkView(pPreBlockIndex->GetBlockHash());
+            if (spCW) {
                 forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
                 forkChainTipFound     = true;
                 LogPrint(BCLog::INFO, "ProcessForkedChain() : fork chain's best block [%d]: %s\n",
@@ -1808,41 +1888,26 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
         return state.DoS(100, ERRORMSG("block at fork chain too earlier than tip block hash=%s block height=%d\n",
                 block.GetHash().GetHex(), block.GetHeight()));
 
-    if (forkChainTipFound) {
-        spCW = mapForkCache[forkChainTipBlockHash];
-    } else if (mapForkCache.count(pPreBlockIndex->GetBlockHash())) {
-        forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
-        spCW                  = mapForkCache[forkChainTipBlockHash];
-        forkChainTipFound     = true;
-        LogPrint(BCLog::INFO, "[%d] found block(%s) in cache\n", pPreBlockIndex->height, forkChainTipBlockHash.GetHex());
-    } else {
-        spCW                     = CCacheWrapper::NewCopyFrom(pCdMan);
-        int64_t beginTime        = GetTimeMillis();
-        CBlockIndex *pBlockIndex = chainActive.Tip();
-
-        while (pPreBlockIndex != pBlockIndex) {
-            LogPrint(BCLog::INFO, "disconnect block [%d]: %s\n", pBlockIndex->height,
-                     pBlockIndex->GetBlockHash().GetHex());
-
-            CBlock block;
-            if (!ReadBlockFromDisk(pBlockIndex, block))
-                return state.Abort(_("Failed to read block"));
-
-            bool bfClean = true;
-            if (!DisconnectBlock(block, *spCW, pBlockIndex, state, &bfClean)) {
-                return ERRORMSG("failed to disconnect block [%d]: %s", pBlockIndex->height,
-                                pBlockIndex->GetBlockHash().ToString());
-            }
-
-            pBlockIndex = pBlockIndex->pprev;
-        }  // Rollback the active chain to the forked point.
+    if (!forkChainTipFound) {
+        spCW = forkStateManager.GetForkView(pPreBlockIndex->GetBlockHash());
+        if (spCW) {
+            forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
+            forkChainTipFound     = true;
+            LogPrint(BCLog::INFO, "[%d] found block(%s) in cache\n", pPreBlockIndex->height, forkChainTipBlockHash.GetHex());
+        } else {
+            int64_t beginTime = GetTimeMillis();
+            // Rollback the active chain to the forked point.
+            if (!forkStateManager.MaterializeView(pPreBlockIndex, spCW, state))
+                return ERRORMSG("failed to materialize the chain state at fork point [%d]: %s", pPreBlockIndex->height,
+                                pPreBlockIndex->GetBlockHash().ToString());
 
-        mapForkCache[pPreBlockIndex->GetBlockHash()] = spCW;
-        forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
-        forkChainTipFound     = true;
-        LogPrint(BCLog::INFO, "[%d] add block %s to cache."
-                              "disconnect block elapse: %lld ms\n",
-                              pPreBlockIndex->height, pPreBlockIndex->GetBlockHash().GetHex(), GetTimeMillis() - beginTime);
+            forkStateManager.SetForkView(pPreBlockIndex->GetBlockHash(), spCW);
+            forkChainTipBlockHash = pPreBlockIndex->GetBlockHash();
+            forkChainTipFound     = true;
+            LogPrint(BCLog::INFO, "[%d] add block %s to cache."
+                                  "disconnect block elapse: %lld ms\n",
+                                  pPreBlockIndex->height, pPreBlockIndex->GetBlockHash().GetHex(), GetTimeMillis() - beginTime);
+        }
     }
 
     uint256 forkChainBestBlockHash   = spCW->blockCache.GetBestBlockHash();
@@ -1870,10 +1935,10 @@ bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValid
 
         vector<CBlock>::iterator iterBlock = vPreBlocks.begin();
         if (forkChainTipFound) {
-            mapForkCache.erase(forkChainTipBlockHash);
+            forkStateManager.EraseForkView(forkChainTipBlockHash);
         }
 
-        mapForkCache[iterBlock->GetHash()] = spCW;
+        forkStateManager.SetForkView(iterBlock->GetHash(), spCW);
     }
 
     VoteDelegate curDelegate;
@@ -2337,6 +2402,12 @@ bool static LoadBlockIndexDB() {
     SysCfg().SetTxIndex(bTxIndex);
     LogPrint(BCLog::INFO, "transaction index %s\n", bTxIndex ? "enabled" : "disabled");
 
+    // Check whether we have a dex order book index
+    bool bDexOrderBookIndex = false;
+    pCdMan->pBlockCache->ReadFlag("dexorderbookindex", bDexOrderBookIndex);
+    SysCfg().SetDexOrderBookIndex(bDexOrderBookIndex);
+    LogPrint(BCLog::INFO, "dex order book index %s\n", bDexOrderBookIndex ? "enabled" : "disabled");
+
     // Load pointer to end of best chain
     uint256 bestBlockHash = pCdMan->pBlockCache->GetBestBlockHash();
     const auto &it = mapBlockIndex.find(bestBlockHash);
@@ -2450,6 +2521,7 @@ void UnloadBlockIndex() {
     setBlockIndexValid.clear();
     chainActive.SetTip(nullptr);
     pIndexBestInvalid = nullptr;
+    forkStateManager.Clear();
 }
 
 bool LoadBlockIndex() {
@@ -2469,6 +2541,8 @@ bool InitBlockIndex() {
     // Use the provided setting for -txindex in the new database
     SysCfg().SetTxIndex(SysCfg().GetBoolArg("-txindex", true));
     pCdMan->pBlockCache->WriteFlag("txindex", SysCfg().IsTxIndex());
+    SysCfg().SetDexOrderBookIndex(SysCfg().GetBoolArg("-dexorderbookindex", false));
+    pCdMan->pBlockCache->WriteFlag("dexorderbookindex", SysCfg().IsDexOrderBookIndex());
     LogPrint(BCLog::INFO, "Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -2602,14 +2676,18 @@ bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp) {
 
                 // process block
                 if (nBlockPos >= nStartByte) {
-                    LOCK(cs_main);
-                    if (dbp)
-                        dbp->nPos = nBlockPos;
                     CValidationState state;
-                    if (ProcessBlock(state, nullptr, &block, dbp))
-                        nLoaded++;
+                    {
+                        LOCK(cs_main);
+                        if (dbp)
+                            dbp->nPos = nBlockPos;
+                        if (ProcessBlock(state, nullptr, &block, dbp))
+                            nLoaded++;
+                    }
                     if (state.IsError())
                         break;
+
+                    WaitForWalletSync();
                 }
             } catch (std::exception &e) {
                 LogPrint(BCLog::ERROR, "Deserialize or I/O error - %s\n", e.what());
@@ -30,6 +30,7 @@
 #include "net.h"
 #include "p2p/node.h"
 #include "persistence/cachewrapper.h"
+#include "persistence/forkstate.h"
 #include "sigcache.h"
 #include "tx/tx.h"
 #include "tx/txmempool.h"
@@ -62,8 +63,8 @@ struct CNodeStateStats;
 namespace {
 struct CMainSignals {
     // Notifies listeners of updated transaction data (passing hash, transaction, and optionally the block it is found
-    // in.
-    boost::signals2::signal<void(const uint256 &, CBaseTx *, const CBlock *)> SyncTransaction;
+    // in, and the key ids of the accounts written by the block).
+    boost::signals2::signal<void(const uint256 &, CBaseTx *, const CBlock *, const set<CKeyID> *)> SyncTransaction;
     // Notifies listeners of an erased transaction (currently disabled, requires transaction replacement).
     boost::signals2::signal<void(const uint256 &)> EraseTransaction;
     // Notifies listeners of a new active block chain.
@@ -72,6 +73,8 @@ struct CMainSignals {
     // boost::signals2::signal<void (const uint256 &)> Inventory;
     // Tells listeners to broadcast their data.
     boost::signals2::signal<void()> Broadcast;
+    // Waits for listeners to catch up with the updated transaction data.
+    boost::signals2::signal<void()> WaitForSync;
 } g_signals;
 }  // namespace
 
@@ -82,9 +85,12 @@ void UnregisterWallet(CWalletInterface *pWalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllWallets();
 /** Push an updated transaction to all registered wallets */
-void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock = nullptr);
+void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock = nullptr,
+                     const set<CKeyID> *pAccountKeyIds = nullptr);
 /** Erase Tx from wallets **/
 void EraseTransactionFromWallet(const uint256 &hash);
+/** Wait for all registered wallets to apply the queued blocks, caller must not hold cs_main */
+void WaitForWalletSync();
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals &nodeSignals);
 /** Unregister a network node */
@@ -114,9 +120,9 @@ void Misbehaving(NodeId nodeid, int32_t howmuch);
 
 bool VerifySignature(const uint256 &sigHash, const std::vector<uint8_t> &signature, const CPubKey &pubKey);
 
-/** (try to) add transaction to memory pool **/
+/** (try to) add transaction to memory pool, committing the result of its pre-execution if still valid **/
 bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBaseTx,
-                        bool fLimitFree, bool fRejectInsaneFee = false);
+                        bool fLimitFree, bool fRejectInsaneFee = false, CTxPreExecution *pPreExecution = nullptr);
 
 struct CNodeStateStats {
     int32_t nMisbehavior;
@@ -191,6 +197,7 @@ public:
 /** The currently best known chain of headers (some of which may be invalid). */
 extern CChain chainMostWork;
 extern CCacheDBManager *pCdMan;
+extern CForkStateManager forkStateManager;
 extern int32_t nSyncTipHeight;
 extern std::tuple<bool, boost::thread *> RunCoin(int32_t argc, char *argv[]);
 extern string publicIp;
@@ -199,10 +206,12 @@ bool EraseBlockIndexFromSet(CBlockIndex *pIndex);
 
 class CWalletInterface {
 protected:
-    virtual void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock) = 0;
+    virtual void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock,
+                                 const set<CKeyID> *pAccountKeyIds)                          = 0;
     virtual void EraseTransaction(const uint256 &hash)                                        = 0;
     virtual void SetBestChain(const CBlockLocator &locator)                                   = 0;
     virtual void ResendWalletTransactions()                                                   = 0;
+    virtual void WaitForSync()                                                                = 0;
     friend void ::RegisterWallet(CWalletInterface *);
     friend void ::UnregisterWallet(CWalletInterface *);
     friend void ::UnregisterAllWallets();
@@ -215,8 +224,15 @@ protected:
  *  will be true if no problems were found. Otherwise, the return value will be false in case
  *  of problems. Note that in any case, coins may be modified. */
 bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool *pfClean = nullptr);
-// Apply the effects of this block (with given index) on the UTXO set represented by coins
-bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false);
+// Same as above, with the undo data of the block already in memory
+bool DisconnectBlock(CBlock &block, CBlockUndo &blockUndo, CCacheWrapper &cw, CBlockIndex *pIndex,
+                     CValidationState &state, bool *pfClean = nullptr);
+// Apply the effects of this block (with given index) on the UTXO set represented by coins.
+// If pBlockUndo is provided, the undo data of the block is returned through it.
+bool ConnectBlock   (CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state, bool fJustCheck = false,
+                     CBlockUndo *pBlockUndo = nullptr);
+// Push the block into the sliding windows of the tx and price point memory caches, as ConnectBlock() does
+bool PushBlockToMemCaches(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValidationState &state);
 
 // Add this block to the block index, and if necessary, switch the active block chain to this
 bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos &pos);
@@ -86,26 +86,24 @@ uint32_t GetElementForBurn(CBlockIndex *pIndex) {
     return newFuelRate;
 }
 
-// Sort transactions by priority and fee to decide priority orders to process transactions.
-void GetPriorityTx(CCacheWrapper &cw, int32_t height, set<TxPriority> &txPriorities, const int32_t nFuelRate) {
-    static TokenSymbol feeSymbol;
-    static uint64_t fee    = 0;
-    static uint32_t txSize = 0;
-    static double feePerKb = 0;
-    static double priority = 0;
-
-    for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.memPoolTxs.begin(); mi != mempool.memPoolTxs.end(); ++mi) {
-        CBaseTx *pBaseTx = mi->second.GetTransaction().get();
-        if (!pBaseTx->IsBlockRewardTx() && !pCdMan->pTxCache->HasTx(pBaseTx->GetHash())) {
-            feeSymbol = std::get<0>(mi->second.GetFees());
-            fee       = std::get<1>(mi->second.GetFees());
-            txSize    = mi->second.GetTxSize();
-            feePerKb  = double(fee - pBaseTx->GetFuelFee(cw, height, nFuelRate)) / txSize * 1000.0;
-            priority  = mi->second.GetPriority();
-
-            txPriorities.emplace(TxPriority(priority, feePerKb, mi->second.GetTransaction()));
-        }
+// Txs to pack by rank, the highest first: the mempool txs, which the mempool keeps ranked as they are
+// added, merged with the txs created by the producer. Must hold pool.cs while packing.
+void GetPriorityTx(const CTxMemPool &pool, const set<CTxMemPoolRank> &producerTxs,
+                   vector<std::shared_ptr<CBaseTx>> &txs) {
+    AssertLockHeld(pool.cs);
+    const set<CTxMemPoolRank> &rankIndex = pool.GetRankIndex();
+
+    txs.reserve(rankIndex.size() + producerTxs.size());
+    auto producerItor = producerTxs.rbegin();
+    for (auto itor = rankIndex.rbegin(); itor != rankIndex.rend(); ++itor) {
+        for (; producerItor != producerTxs.rend() && *itor < *producerItor; ++producerItor)
+            txs.push_back(producerItor->baseTx);
+
+        if (!itor->baseTx->IsBlockRewardTx())
+            txs.push_back(itor->baseTx);
     }
+    for (; producerItor != producerTxs.rend(); ++producerItor)
+        txs.push_back(producerItor->baseTx);
 }
 
 
@@ -313,18 +311,17 @@ static bool CreateNewBlockForPreStableCoinRelease(CCacheWrapper &cwIn, std::uniq
         uint64_t totalFuelFee   = 0;
         uint64_t reward         = 0;
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(cwIn, height, txPriorities, fuelRate);
+        // Transactions of the memory pool sorted by priority rules.
+        vector<std::shared_ptr<CBaseTx>> txs;
+        GetPriorityTx(mempool, set<CTxMemPoolRank>(), txs);
 
-        LogPrint(BCLog::MINER, "got %lu transaction(s) sorted by priority rules\n",
-                 txPriorities.size());
+        LogPrint(BCLog::MINER, "got %lu transaction(s) sorted by priority rules\n", txs.size());
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
-            CBaseTx *pBaseTx = itor->baseTx.get();
+        for (const auto &spTx : txs) {
+            CBaseTx *pBaseTx = spTx.get();
 
-            uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+            uint32_t txSize = pBaseTx->GetTxSize();
             if (totalBlockSize + txSize >= nBlockMaxSize) {
                 LogPrint(BCLog::MINER, "exceed max block size, txid: %s\n", pBaseTx->GetHash().GetHex());
 
@@ -374,7 +371,7 @@ static bool CreateNewBlockForPreStableCoinRelease(CCacheWrapper &cwIn, std::uniq
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(spTx);
 
             LogPrint(BCLog::DEBUG, "miner's total fuel fee:%d, tx fuel fee:%d, fuel:%d, fuelRate:%d, txid:%s\n",
                     totalFuelFee, fuelFee, pBaseTx->fuel, fuelRate, pBaseTx->GetHash().GetHex());
@@ -444,12 +441,9 @@ static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, CCacheWrap
         uint64_t totalFuelFee              = 0;
         map<TokenSymbol, uint64_t> rewards = { {SYMB::WICC, 0}, {SYMB::WUSD, 0} };
 
-        // Calculate && sort transactions from memory pool.
-        set<TxPriority> txPriorities;
-        GetPriorityTx(cwIn, height, txPriorities, fuelRate);
-
         // Push block price median transaction into queue.
-        txPriorities.emplace(TxPriority(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height)));
+        set<CTxMemPoolRank> producerTxs;
+        producerTxs.emplace(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, std::make_shared<CBlockPriceMedianTx>(height));
 
         if (GetFeatureForkVersion(height) >= MAJOR_VER_R3) {
             auto spCdpForceSettleInterestTx = std::make_shared<CCDPInterestForceSettleTx>(height);
@@ -457,17 +451,21 @@ static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, CCacheWrap
                 return ERRORMSG("GetSettledInterestCdps error");
             }
             if (!spCdpForceSettleInterestTx->cdp_list.empty()) {
-                txPriorities.emplace(TxPriority(TRANSACTION_PRIORITY_CEILING, 0, spCdpForceSettleInterestTx));
+                producerTxs.emplace(TRANSACTION_PRIORITY_CEILING, 0, spCdpForceSettleInterestTx);
 
                 LogPrint(BCLog::MINER, "create CCDPInterestForceSettleTx to block! tx=%s\n",
                         spCdpForceSettleInterestTx->ToString(cwIn.accountCache));
             }
         }
 
-        LogPrint(BCLog::MINER, "Got %lu trx(s), sorted by priority\n", txPriorities.size());
+        // Merge the transactions of the memory pool, sorted by priority as they were accepted.
+        vector<std::shared_ptr<CBaseTx>> txs;
+        GetPriorityTx(mempool, producerTxs, txs);
+
+        LogPrint(BCLog::MINER, "Got %lu trx(s), sorted by priority\n", txs.size());
 
         // Collect transactions into the block.
-        for (auto itor = txPriorities.rbegin(); itor != txPriorities.rend(); ++itor) {
+        for (const auto &spTx : txs) {
 
             if (!CheckPackBlockTime(startMiningMs, height)) {
                 LogPrint(BCLog::MINER, "[%d] no time left to pack more tx, ignore! start_ms=%lld, tx_count=%u\n",
@@ -475,9 +473,9 @@ static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, CCacheWrap
                 break;
             }
 
-            CBaseTx *pBaseTx = itor->baseTx.get();
+            CBaseTx *pBaseTx = spTx.get();
 
-            uint32_t txSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+            uint32_t txSize = pBaseTx->GetTxSize();
             if (totalBlockSize + txSize >= nBlockMaxSize) {
                 LogPrint(BCLog::MINER, "Exceed max block size, txid: %s\n", pBaseTx->GetHash().GetHex());
 
@@ -493,9 +491,11 @@ static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, CCacheWrap
 
                 // Special case for price median tx,
                 if (pBaseTx->IsPriceMedianTx()) {
-                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)itor->baseTx.get();
+                    CBlockPriceMedianTx *pPriceMedianTx = (CBlockPriceMedianTx *)spTx.get();
                     if (!spCW->ppCache.CalcMedianPrices(*spCW, height, pPriceMedianTx->median_prices))
                         return ERRORMSG("calculate block median prices error");
+                    // the tx is built by the miner, its size is measured again with the prices
+                    txSize = pBaseTx->GetTxSize();
                 }
 
                 LogPrint(BCLog::MINER, "begin to pack trx: %s\n", pBaseTx->ToString(spCW->accountCache));
@@ -538,7 +538,7 @@ static bool CreateNewBlockForStableCoinRelease(int64_t startMiningMs, CCacheWrap
 
             ++index;
 
-            pBlock->vptx.push_back(itor->baseTx);
+            pBlock->vptx.push_back(spTx);
 
             LogPrint(BCLog::DEBUG, "miner total_fuel_fee=%d, tx_fuel_fee=%d, fuel=%d, fuelRate:%d, txid:%s\n",
                     totalFuelFee, fuelFee, pBaseTx->fuel, fuelRate, pBaseTx->GetHash().GetHex());
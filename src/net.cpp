@@ -1472,10 +1472,16 @@ public:
 instance_of_cnetcleanup;
 
 void RelayTransaction(CBaseTx* pBaseTx, const uint256& hash) {
+    // relay the tx as received instead of serializing it again
+    if (pBaseTx->rawTx) {
+        RelayTransaction(pBaseTx, hash, *pBaseTx->rawTx);
+        return;
+    }
+
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(1000);
-    auto pTx = pBaseTx->GetNewInstance();
-    ss << pTx;
+    ss.reserve(pBaseTx->GetTxSize() + 1);
+    // non-owning pointer to the tx, only needed to serialize it
+    ss << std::shared_ptr<CBaseTx>(std::shared_ptr<CBaseTx>(), pBaseTx);
     RelayTransaction(pBaseTx, hash, ss);
 }
 
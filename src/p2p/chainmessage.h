@@ -13,6 +13,8 @@
 #include "net.h"
 #include "miner/pbftcontext.h"
 #include "miner/pbftmanager.h"
+#include "tx/txpreexecutor.h"
+#include "tx/txserializer.h"
 
 #include <string>
 #include <tuple>
@@ -471,31 +473,13 @@ inline bool ProcessAddrMessage(CNode *pFrom, CDataStream &vRecv) {
     return true;
 }
 
-inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
-    std::shared_ptr<CBaseTx> pBaseTx;
-    try {
-        vRecv >> pBaseTx;
-    } catch(runtime_error e) {
-        // TODO: record the misebehaving or ban the peer node.
-        return ERRORMSG("Unknown transaction type from peer %s, ignore! %s", pFrom->addr.ToString(), e.what());
-    }
-
-    if (pBaseTx->IsRelayForbidden()) {
-        return ERRORMSG("Forbid transaction=%s from network from peer %s, txid=%s, raw: %s", pBaseTx->GetTxTypeName(),
-                pFrom->addr.ToString(), pBaseTx->GetHash().ToString(), HexStr(vRecv.begin(), vRecv.end()));
-    }
-
+inline void AcceptTxFromPeer(CNode *pFrom, const string &strCommand, std::shared_ptr<CBaseTx> pBaseTx,
+                             CTxPreExecution *pPreExecution) {
     CInv inv(MSG_TX, pBaseTx->GetHash());
-    pFrom->AddInventoryKnown(inv);
-
-    if(IsInitialBlockDownload()){
-        RelayTransaction(pBaseTx.get(), inv.hash);
-        return true;
-    }
 
     LOCK(cs_main);
     CValidationState state;
-    if (AcceptToMemoryPool(mempool, state, pBaseTx.get(), true)) {
+    if (AcceptToMemoryPool(mempool, state, pBaseTx.get(), true, false, pPreExecution)) {
         RelayTransaction(pBaseTx.get(), inv.hash);
         mapAlreadyAskedFor.erase(inv);
 
@@ -515,7 +499,40 @@ inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv
         //     pBaseTx->GetHash().GetHex(), nDoS); Misbehaving(pFrom->GetId(), nDoS);
         // }
     }
+}
+
+inline bool ProcessTxMessage(CNode *pFrom, string strCommand, CDataStream &vRecv) {
+    std::shared_ptr<CBaseTx> pBaseTx;
+    try {
+        UnserializeReceivedTx(vRecv, pBaseTx);
+    } catch(runtime_error e) {
+        // TODO: record the misebehaving or ban the peer node.
+        return ERRORMSG("Unknown transaction type from peer %s, ignore! %s", pFrom->addr.ToString(), e.what());
+    }
 
+    if (pBaseTx->IsRelayForbidden()) {
+        return ERRORMSG("Forbid transaction=%s from network from peer %s, txid=%s, raw: %s", pBaseTx->GetTxTypeName(),
+                pFrom->addr.ToString(), pBaseTx->GetHash().ToString(), HexStr(vRecv.begin(), vRecv.end()));
+    }
+
+    CInv inv(MSG_TX, pBaseTx->GetHash());
+    pFrom->AddInventoryKnown(inv);
+
+    if(IsInitialBlockDownload()){
+        RelayTransaction(pBaseTx.get(), inv.hash);
+        return true;
+    }
+
+    // contract txs are executed by the pre-execution threads and accepted from there
+    pFrom->AddRef();
+    if (PushTxPreExecution(pBaseTx, [pFrom, strCommand](std::shared_ptr<CBaseTx> pBaseTx, CTxPreExecution *pPreExecution) {
+            AcceptTxFromPeer(pFrom, strCommand, pBaseTx, pPreExecution);
+            pFrom->Release();
+        }))
+        return true;
+    pFrom->Release();
+
+    AcceptTxFromPeer(pFrom, strCommand, pBaseTx, nullptr);
     return true;
 }
 
@@ -721,18 +738,22 @@ inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv) {
         MarkBlockAsReceived(inv.hash, pFrom->GetId());
     }
 
-    LOCK(cs_main);
-    CValidationState state;
+    {
+        LOCK(cs_main);
+        CValidationState state;
 
-    std::pair<int32_t ,uint256> globalfinblock = std::make_pair(0,uint256());
-    pCdMan->pBlockCache->ReadGlobalFinBlock(globalfinblock);
-    if (block.GetHeight() < (uint32_t)globalfinblock.first) {
-        LogPrint(BCLog::NET,"[%d] this inbound block is irrreversible (%d)",
-                            block.GetHeight(), globalfinblock.first);
-    } else {
-        ProcessBlock(state, pFrom, &block);
+        std::pair<int32_t ,uint256> globalfinblock = std::make_pair(0,uint256());
+        pCdMan->pBlockCache->ReadGlobalFinBlock(globalfinblock);
+        if (block.GetHeight() < (uint32_t)globalfinblock.first) {
+            LogPrint(BCLog::NET,"[%d] this inbound block is irrreversible (%d)",
+                                block.GetHeight(), globalfinblock.first);
+        } else {
+            ProcessBlock(state, pFrom, &block);
+        }
     }
 
+    // the blocks are not received faster than the wallet applies them
+    WaitForWalletSync();
 }
 
 inline void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv) {
@@ -3,9 +3,17 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/coin-config.h"
+#endif
+
 #include "blockundo.h"
 #include "main.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+
 /** Open an undo file (rev?????.dat) */
 FILE *OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly) {
     return OpenDiskFile(pos, "rev", fReadOnly);
@@ -39,6 +47,156 @@ string CTxUndo::ToString() const {
 //     return hasher.GetHash();
 // }
 
+// The compact undo record:
+//   marker(0xff) | flags | payload size(uint32) | payload
+// 0xff can not be the first byte of a legacy record, which begins with the compact size of vtxundo.
+// The payload, prefixed with its varint raw size when compressed with LZ4:
+//   prefix table: the key prefixes used by the block, each one is written once
+//   tx table: txid and the (prefix index, oplog count) pairs of each tx
+//   arena: the key and value bytes of all oplogs, in the order of the tx table
+static const uint8_t UNDO_COMPACT_MARKER = 0xff;
+static const uint8_t UNDO_FLAG_LZ4       = 0x01;
+
+static uint256 CalcUndoRecordChecksum(const uint256 &blockHash, const string &record) {
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << blockHash;
+    hasher.write(record.data(), record.size());
+    return hasher.GetHash();
+}
+
+static string MakeUndoRecord(uint8_t flags, const string &payload) {
+    CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+    ssRecord << UNDO_COMPACT_MARKER << flags << (uint32_t)payload.size();
+    ssRecord.write(payload.data(), payload.size());
+    return ssRecord.str();
+}
+
+void CBlockUndo::EncodeCompact(string &record) const {
+    // intern the prefixes used by the block
+    map<dbk::PrefixType, uint32_t> prefixIndexes;
+    vector<dbk::PrefixType> prefixes;
+    for (const auto &txUndo : vtxundo) {
+        for (const auto &item : txUndo.dbOpLogMap.GetMap()) {
+            if (prefixIndexes.emplace(item.first, prefixes.size()).second)
+                prefixes.push_back(item.first);
+        }
+    }
+
+    CDataStream ssTable(SER_DISK, CLIENT_VERSION);
+    CDataStream ssArena(SER_DISK, CLIENT_VERSION);
+    WriteCompactSize(ssTable, prefixes.size());
+    for (auto prefixType : prefixes)
+        ssTable << dbk::GetKeyPrefix(prefixType);
+
+    WriteCompactSize(ssTable, vtxundo.size());
+    for (const auto &txUndo : vtxundo) {
+        const auto &opLogMap = txUndo.dbOpLogMap.GetMap();
+        ssTable << txUndo.txid;
+        WriteCompactSize(ssTable, opLogMap.size());
+        for (const auto &item : opLogMap) {
+            WriteCompactSize(ssTable, prefixIndexes[item.first]);
+            WriteCompactSize(ssTable, item.second.size());
+            for (const auto &opLog : item.second)
+                ssArena << opLog;
+        }
+    }
+    string payload = ssTable.str() + ssArena.str();
+
+    uint8_t flags = 0;
+#ifdef USE_LZ4
+    if (SysCfg().GetBoolArg("-undocompress", true) && !payload.empty()) {
+        vector<char> compressed(LZ4_compressBound(payload.size()));
+        int compressedSize = LZ4_compress_default(payload.data(), compressed.data(), payload.size(), compressed.size());
+        if (compressedSize > 0 && (size_t)compressedSize < payload.size()) {
+            uint32_t rawSize = payload.size();
+            CDataStream ssPayload(SER_DISK, CLIENT_VERSION);
+            ssPayload << VARINT(rawSize);
+            ssPayload.write(compressed.data(), compressedSize);
+            payload = ssPayload.str();
+            flags |= UNDO_FLAG_LZ4;
+        }
+    }
+#endif
+
+    record = MakeUndoRecord(flags, payload);
+}
+
+bool CBlockUndo::DecodeCompact(const string &record) {
+    CDataStream ssRecord(record.data(), record.data() + record.size(), SER_DISK, CLIENT_VERSION);
+    uint8_t marker, flags;
+    uint32_t payloadSize;
+    ssRecord >> marker >> flags >> payloadSize;
+    if (marker != UNDO_COMPACT_MARKER || payloadSize != ssRecord.size())
+        return ERRORMSG("CBlockUndo::DecodeCompact : invalid undo record header");
+
+    return DecodePayload(flags, ssRecord.str());
+}
+
+bool CBlockUndo::DecodePayload(uint8_t flags, const string &payload) {
+    string raw;
+    if (flags & UNDO_FLAG_LZ4) {
+#ifdef USE_LZ4
+        CDataStream ssPayload(payload.data(), payload.data() + payload.size(), SER_DISK, CLIENT_VERSION);
+        uint32_t rawSize = 0;
+        ssPayload >> VARINT(rawSize);
+        if (rawSize > MAX_SIZE)
+            return ERRORMSG("CBlockUndo::DecodePayload : raw size of undo data too large, size=%u", rawSize);
+
+        raw.resize(rawSize);
+        int decompressedSize = LZ4_decompress_safe(ssPayload.size() > 0 ? &ssPayload[0] : nullptr, &raw[0],
+                                                   ssPayload.size(), rawSize);
+        if (decompressedSize < 0 || (uint32_t)decompressedSize != rawSize)
+            return ERRORMSG("CBlockUndo::DecodePayload : decompress undo data failed");
+#else
+        return ERRORMSG("CBlockUndo::DecodePayload : undo data is compressed with LZ4, but LZ4 support not compiled");
+#endif
+    } else {
+        raw = payload;
+    }
+
+    CDataStream ss(raw.data(), raw.data() + raw.size(), SER_DISK, CLIENT_VERSION);
+    vector<dbk::PrefixType> prefixes(ReadCompactSize(ss));
+    for (auto &prefixType : prefixes) {
+        string prefix;
+        ss >> prefix;
+        prefixType = dbk::ParseKeyPrefixType(prefix);
+        if (prefixType == dbk::EMPTY)
+            return ERRORMSG("CBlockUndo::DecodePayload : unknown prefix=%s", prefix);
+    }
+
+    // the oplogs of each group are read from the arena after the whole tx table
+    vector<pair<CDbOpLogs *, uint64_t>> groups;
+    vtxundo.clear();
+    vtxundo.resize(ReadCompactSize(ss));
+    for (auto &txUndo : vtxundo) {
+        ss >> txUndo.txid;
+        uint64_t groupCount = ReadCompactSize(ss);
+        for (uint64_t i = 0; i < groupCount; i++) {
+            uint64_t prefixIndex = ReadCompactSize(ss);
+            uint64_t logCount    = ReadCompactSize(ss);
+            if (prefixIndex >= prefixes.size())
+                return ERRORMSG("CBlockUndo::DecodePayload : invalid prefix index=%llu", prefixIndex);
+            if (logCount > ss.size())
+                return ERRORMSG("CBlockUndo::DecodePayload : invalid oplog count=%llu", logCount);
+
+            groups.emplace_back(&txUndo.dbOpLogMap.GetMap()[prefixes[prefixIndex]], logCount);
+        }
+    }
+
+    for (auto &group : groups) {
+        group.first->resize(group.second);
+        for (auto &opLog : *group.first)
+            ss >> opLog;
+    }
+    return true;
+}
+
+uint32_t CBlockUndo::GetDiskSize() {
+    if (disk_record.empty())
+        EncodeCompact(disk_record);
+    return disk_record.size();
+}
+
 bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
     // Open history file to append
     CAutoFile fileout = CAutoFile(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
@@ -46,7 +204,7 @@ bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
         return ERRORMSG("CBlockUndo::WriteToDisk : OpenUndoFile failed");
 
     // Write index header
-    uint32_t nSize = fileout.GetSerializeSize(*this);
+    uint32_t nSize = GetDiskSize();
     fileout << FLATDATA(SysCfg().MessageStart()) << nSize;
 
     // Write undo data
@@ -54,14 +212,11 @@ bool CBlockUndo::WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
     if (fileOutPos < 0)
         return ERRORMSG("CBlockUndo::WriteToDisk : ftell failed");
     pos.nPos = (uint32_t)fileOutPos;
-    fileout << *this;
+    fileout.write(disk_record.data(), disk_record.size());
 
     // calculate & write checksum
-    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
-    hasher << blockHash;
-    hasher << *this;
-
-    fileout << hasher.GetHash();
+    fileout << CalcUndoRecordChecksum(blockHash, disk_record);
+    string().swap(disk_record);
 
     // Flush stdio buffers and commit to disk before returning
     fflush(fileout);
@@ -77,23 +232,50 @@ bool CBlockUndo::ReadFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash
     if (!filein)
         return ERRORMSG("CBlockUndo::ReadFromDisk : OpenBlockFile failed");
 
-    // Read block
-    uint256 hashChecksum;
+    int firstByte = fgetc(filein);
+    if (firstByte == EOF || ungetc(firstByte, filein) == EOF)
+        return ERRORMSG("CBlockUndo::ReadFromDisk : read undo data failed");
+
+    if (firstByte != UNDO_COMPACT_MARKER) {
+        // legacy record, serialized CBlockUndo
+        uint256 hashChecksum;
+        try {
+            filein >> *this;
+            filein >> hashChecksum;
+        } catch (std::exception &e) {
+            return ERRORMSG("Deserialize or I/O error - %s", e.what());
+        }
+
+        // Verify checksum
+        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+        hasher << blockHash;
+        hasher << *this;
+
+        if (hashChecksum != hasher.GetHash())
+            return ERRORMSG("CBlockUndo::ReadFromDisk : Checksum mismatch");
+        return true;
+    }
+
     try {
-        filein >> *this;
+        uint8_t marker, flags;
+        uint32_t payloadSize;
+        filein >> marker >> flags >> payloadSize;
+        string payload(payloadSize, '\0');
+        if (payloadSize > 0)
+            filein.read(&payload[0], payloadSize);
+
+        uint256 hashChecksum;
         filein >> hashChecksum;
+
+        // Verify checksum
+        string record = MakeUndoRecord(flags, payload);
+        if (hashChecksum != CalcUndoRecordChecksum(blockHash, record))
+            return ERRORMSG("CBlockUndo::ReadFromDisk : Checksum mismatch");
+
+        return DecodeCompact(record);
     } catch (std::exception &e) {
         return ERRORMSG("Deserialize or I/O error - %s", e.what());
     }
-
-    // Verify checksum
-    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
-    hasher << blockHash;
-    hasher << *this;
-
-    if (hashChecksum != hasher.GetHash())
-        return ERRORMSG("CBlockUndo::ReadFromDisk : Checksum mismatch");
-    return true;
 }
 
 string CBlockUndo::ToString() const {
@@ -105,6 +287,23 @@ string CBlockUndo::ToString() const {
     return str;
 }
 
+void CBlockUndo::GetAccountKeyIds(set<CKeyID> &keyIds) const {
+    for (const auto &txUndo : vtxundo)
+        ::GetAccountKeyIds(txUndo.dbOpLogMap, keyIds);
+}
+
+void GetAccountKeyIds(const CDBOpLogMap &dbOpLogMap, set<CKeyID> &keyIds) {
+    auto it = dbOpLogMap.GetMap().find(dbk::KEYID_ACCOUNT);
+    if (it == dbOpLogMap.GetMap().end())
+        return;
+
+    for (const auto &opLog : it->second) {
+        CKeyID keyId;
+        CDataStream ssKey(opLog.GetKey(), SER_DISK, CLIENT_VERSION);
+        ssKey >> keyId;
+        keyIds.insert(keyId);
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // class CBlockUndoExecutor
@@ -116,16 +315,12 @@ bool CBlockUndoExecutor::Execute() {
 
     for (auto it = block_undo.vtxundo.rbegin(); it != block_undo.vtxundo.rend(); it++) {
         for (const auto &opLogPair : it->dbOpLogMap.GetMap()) {
-            dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(opLogPair.first);
-            if (prefixType == dbk::EMPTY)
-                return ERRORMSG("%s(), unkown prefix! prefix_type=%s", __FUNCTION__,
-                                opLogPair.first);
-            auto funcMapIt = undoDataFuncMap.find(prefixType);
-            if (funcMapIt == undoDataFuncMap.end()) {
+            const auto &undoDataFunc = undoDataFuncMap[opLogPair.first];
+            if (!undoDataFunc) {
                 return ERRORMSG("%s(), unfound prefix in db! prefix_type=%s", __FUNCTION__,
-                                opLogPair.first);
+                                dbk::GetKeyPrefix(opLogPair.first));
             }
-            funcMapIt->second(opLogPair.second);
+            undoDataFunc(opLogPair.second);
         }
     }
     return true;
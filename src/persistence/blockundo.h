@@ -51,13 +51,32 @@ public:
     )
 
     // uint256 CalcStateHash(uint256 preHash);
+    // size of the compact disk record, the record is encoded once and reused by WriteToDisk()
+    uint32_t GetDiskSize();
+
+    // the encoded record is released once written, so the undo data kept in memory does not hold it
     bool WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash);
 
     bool ReadFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash);
 
+    // compact disk record of vtxundo, without the checksum
+    void EncodeCompact(string &record) const;
+    bool DecodeCompact(const string &record);
+
     string ToString() const;
+
+    // key ids of the accounts written by the txs of the block
+    void GetAccountKeyIds(set<CKeyID> &keyIds) const;
+
+private:
+    string disk_record; // encoded compact record, must not be used after vtxundo changed
+
+    bool DecodePayload(uint8_t flags, const string &payload);
 };
 
+// Adds the key ids of the accounts written by the op logs to keyIds
+void GetAccountKeyIds(const CDBOpLogMap &dbOpLogMap, set<CKeyID> &keyIds);
+
 class CTxUndoOpLogger {
 public:
     CCacheWrapper &cw;
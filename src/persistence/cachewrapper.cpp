@@ -19,6 +19,10 @@ std::shared_ptr<CCacheWrapper>CCacheWrapper::NewCopyFrom(CCacheDBManager* pCdMan
 CCacheWrapper::CCacheWrapper() {}
 
 CCacheWrapper::CCacheWrapper(CCacheWrapper *cwIn) {
+    SetBaseViewPtr(cwIn);
+}
+
+void CCacheWrapper::SetBaseViewPtr(CCacheWrapper *cwIn) {
     sysParamCache.SetBaseViewPtr(&cwIn->sysParamCache);
     blockCache.SetBaseViewPtr(&cwIn->blockCache);
     accountCache.SetBaseViewPtr(&cwIn->accountCache);
@@ -36,7 +40,6 @@ CCacheWrapper::CCacheWrapper(CCacheWrapper *cwIn) {
     ppCache.SetBaseViewPtr(&cwIn->ppCache);
     sysGovernCache.SetBaseViewPtr(&cwIn->sysGovernCache);
     priceFeedCache.SetBaseViewPtr(&cwIn->priceFeedCache);
-
 }
 
 CCacheWrapper::CCacheWrapper(CCacheDBManager* pCdMan) {
@@ -79,6 +82,25 @@ void CCacheWrapper::CopyFrom(CCacheDBManager* pCdMan){
     priceFeedCache = *pCdMan->pPriceFeedCache;
 }
 
+void CCacheWrapper::BindDbs(CCacheDBManager* pCdMan) {
+    // a copy of an empty db layer cache is bound to the db without being accounted in the db cache bytes
+    sysParamCache   = CSysParamDBCache(pCdMan->pSysParamDb);
+    blockCache      = CBlockDBCache(pCdMan->pBlockDb);
+    accountCache    = CAccountDBCache(pCdMan->pAccountDb);
+    assetCache      = CAssetDbCache(pCdMan->pAssetDb);
+    contractCache   = CContractDBCache(pCdMan->pContractDb);
+    delegateCache   = CDelegateDBCache(pCdMan->pDelegateDb);
+    cdpCache        = CCdpDBCache(pCdMan->pCdpDb);
+    closedCdpCache  = CClosedCdpDBCache(pCdMan->pClosedCdpDb);
+    dexCache        = CDexDBCache(pCdMan->pDexDb);
+    txReceiptCache  = CTxReceiptDBCache(pCdMan->pReceiptDb);
+    txUtxoCache     = CTxUTXODBCache(pCdMan->pUtxoDb);
+    axcCache        = CAxcDBCache(pCdMan->pAxcDb);
+
+    sysGovernCache  = CSysGovernDBCache(pCdMan->pSysGovernDb);
+    priceFeedCache  = CPriceFeedCache(pCdMan->pPriceFeedDb);
+}
+
 CCacheWrapper& CCacheWrapper::operator=(CCacheWrapper& other) {
     if (this == &other)
         return *this;
@@ -159,6 +181,31 @@ UndoDataFuncMap CCacheWrapper::GetUndoDataFuncMap() {
     return undoDataFuncMap;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// class CCacheSnapshot
+
+CCacheSnapshot::CCacheSnapshot(CCacheDBManager *pCdMan, const CBlockIndex *pTipIndexIn) : pTipIndex(pTipIndexIn) {
+    snapshotSet.Add(pCdMan->pSysParamDb);
+    snapshotSet.Add(pCdMan->pAccountDb);
+    snapshotSet.Add(pCdMan->pAssetDb);
+    snapshotSet.Add(pCdMan->pContractDb);
+    snapshotSet.Add(pCdMan->pDelegateDb);
+    snapshotSet.Add(pCdMan->pCdpDb);
+    snapshotSet.Add(pCdMan->pClosedCdpDb);
+    snapshotSet.Add(pCdMan->pDexDb);
+    snapshotSet.Add(pCdMan->pBlockDb);
+    snapshotSet.Add(pCdMan->pLogDb);
+    snapshotSet.Add(pCdMan->pReceiptDb);
+    snapshotSet.Add(pCdMan->pUtxoDb);
+    snapshotSet.Add(pCdMan->pAxcDb);
+    snapshotSet.Add(pCdMan->pSysGovernDb);
+    snapshotSet.Add(pCdMan->pPriceFeedDb);
+}
+
+int32_t CCacheSnapshot::GetHeight() const { return pTipIndex->height; }
+
+uint256 CCacheSnapshot::GetBlockHash() const { return pTipIndex->GetBlockHash(); }
+
 ////////////////////////////////////////////////////////////////////////////////
 // class CCacheDBManager
 
@@ -219,6 +266,18 @@ CCacheDBManager::CCacheDBManager(bool fReIndex, bool fMemory) {
 }
 
 CCacheDBManager::~CCacheDBManager() {
+    // the writer thread finishes the batches handed to it before it exits
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        fStopWriter = true;
+    }
+    writerCond.notify_all();
+    if (writerThread.joinable())
+        writerThread.join();
+
+    // the snapshots must be released before the dbs are closed
+    ResetReadSnapshot();
+
     delete pSysParamCache;  pSysParamCache = nullptr;
     delete pAccountCache;   pAccountCache = nullptr;
     delete pAssetCache;     pAssetCache = nullptr;
@@ -257,6 +316,87 @@ CCacheDBManager::~CCacheDBManager() {
 }
 
 bool CCacheDBManager::Flush() {
+    string strError;
+    if (!WaitForBackgroundFlush(strError)) {
+        LogPrint(BCLog::ERROR, "background flush failed: %s, writing it again\n", strError);
+        spFailedBatches->Write(pBlockDb);
+        spFailedBatches = nullptr;
+    }
+
+    FlushCaches();
+    return true;
+}
+
+bool CCacheDBManager::FlushInBackground(string &strError) {
+    if (!WaitForBackgroundFlush(strError))
+        return false;
+
+    auto spBatches = std::make_shared<CDBWriteBatches>();
+    {
+        CDBWriteBatchScope writeBatchScope(*spBatches);
+        FlushCaches();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        if (!writerThread.joinable())
+            writerThread = std::thread(&CCacheDBManager::ThreadWriteBatches, this);
+        spWritingBatches = spBatches;
+    }
+    writerCond.notify_all();
+    return true;
+}
+
+bool CCacheDBManager::WaitForBackgroundFlush(string &strError) {
+    std::unique_lock<std::mutex> lock(writerMutex);
+    writerCond.wait(lock, [this]() { return spWritingBatches == nullptr; });
+    if (spFailedBatches) {
+        strError = writerError;
+        return false;
+    }
+    return true;
+}
+
+void CCacheDBManager::ThreadWriteBatches() {
+    RenameThread("coin-dbwriter");
+
+    std::unique_lock<std::mutex> lock(writerMutex);
+    while (true) {
+        writerCond.wait(lock, [this]() { return spWritingBatches != nullptr || fStopWriter; });
+        if (spWritingBatches == nullptr)
+            return;
+
+        auto spBatches = spWritingBatches;
+        string strError;
+        lock.unlock();
+        int64_t beginTime = GetTimeMillis();
+        try {
+            spBatches->Write(pBlockDb);
+        } catch (std::exception &e) {
+            strError = e.what();
+        }
+        LogPrint(BCLog::LDB, "background flush of generation %llu: %d ms\n", spBatches->GetGeneration(),
+                 GetTimeMillis() - beginTime);
+        lock.lock();
+
+        if (!strError.empty()) {
+            LogPrint(BCLog::ERROR, "background flush of generation %llu failed: %s\n", spBatches->GetGeneration(),
+                     strError);
+            spFailedBatches = spBatches;
+            writerError     = strError;
+        } else if (pPendingSnapshotTip != nullptr) {
+            // the next generation is not written before spWritingBatches is reset, so the dbs hold the block
+            auto spSnapshot = std::make_shared<CCacheSnapshot>(this, pPendingSnapshotTip);
+            LOCK(cs_read_snapshot);
+            spReadSnapshot = spSnapshot;
+        }
+        pPendingSnapshotTip = nullptr;
+        spWritingBatches = nullptr;
+        writerCond.notify_all();
+    }
+}
+
+void CCacheDBManager::FlushCaches() {
     if (pSysParamCache) pSysParamCache->Flush();
 
     if (pAccountCache) pAccountCache->Flush();
@@ -294,6 +434,29 @@ bool CCacheDBManager::Flush() {
     //     pTxCache->Flush();
     // if (pPpCache)
     //     pPpCache->Flush();
+}
 
-    return true;
+void CCacheDBManager::RefreshReadSnapshot(const CBlockIndex *pTipIndex) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    if (spWritingBatches != nullptr) {
+        pPendingSnapshotTip = pTipIndex;
+        return;
+    }
+
+    auto spSnapshot = std::make_shared<CCacheSnapshot>(this, pTipIndex);
+    LOCK(cs_read_snapshot);
+    spReadSnapshot = spSnapshot;
+}
+
+void CCacheDBManager::ResetReadSnapshot() {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    pPendingSnapshotTip = nullptr;
+
+    LOCK(cs_read_snapshot);
+    spReadSnapshot = nullptr;
+}
+
+std::shared_ptr<CCacheSnapshot> CCacheDBManager::GetReadSnapshot() {
+    LOCK(cs_read_snapshot);
+    return spReadSnapshot;
 }
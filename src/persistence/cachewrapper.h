@@ -22,7 +22,13 @@
 #include "axcdb.h"
 #include "sysgoverndb.h"
 #include "logdb.h"
+#include "sync.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class CBlockIndex;
 class CCacheDBManager;
 
 class CCacheWrapper {
@@ -58,6 +64,13 @@ public:
 
     void CopyFrom(CCacheDBManager* pCdMan);
 
+    // binds the caches to the dbs of pCdMan instead of its top-level caches, e.g. to read a CCacheSnapshot.
+    // The memory-only txCache and ppCache have no db and are left unbound.
+    void BindDbs(CCacheDBManager* pCdMan);
+
+    // the caches keep their data, which must hold for the new base as well
+    void SetBaseViewPtr(CCacheWrapper* cwIn);
+
     void Flush();
 
     UndoDataFuncMap GetUndoDataFuncMap();
@@ -70,6 +83,28 @@ private:
 
 };
 
+/**
+ * Frozen, read-only chain state at one block: LevelDB snapshots of every database, taken once the dbs hold
+ * all the writes of the block, so nothing is copied. Readers enter a CDBSnapshotScope on snapshotSet and read
+ * through caches of their own bound to the dbs, see CCacheWrapper::BindDbs(), so they need no lock.
+ */
+class CCacheSnapshot {
+public:
+    CCacheSnapshot(CCacheDBManager *pCdMan, const CBlockIndex *pTipIndexIn);
+
+    int32_t GetHeight() const;
+    uint256 GetBlockHash() const;
+    // the block indexes are never freed and the ancestors of a block never change, so readers resolve the
+    // blocks of the snapshot chain by GetAncestor() without cs_main
+    const CBlockIndex* GetTipIndex() const { return pTipIndex; }
+
+public:
+    CDBSnapshotSet snapshotSet;
+
+private:
+    const CBlockIndex *pTipIndex;
+};
+
 class CCacheDBManager {
 public:
     CDBAccess           *pSysParamDb;
@@ -127,7 +162,46 @@ public:
 
     ~CCacheDBManager();
 
+    // flushes all the caches to the dbs, after the background flush in progress if any
     bool Flush();
+
+    /**
+     * Double-buffered flush: the dirty entries of all the caches are frozen into write batches, one per db,
+     * which the writer thread writes while the next blocks connect on the caches. The caches keep the frozen
+     * entries until they are written. The block db holding the best block hash is written last, so that the
+     * best block on disk never runs ahead of the chain state. Waits for the previous background flush first,
+     * returns false if its writes failed. Must be called with cs_main held.
+     */
+    bool FlushInBackground(string &strError);
+
+    // waits for the background flush in progress, returns false if its writes failed
+    bool WaitForBackgroundFlush(string &strError);
+
+    /**
+     * Freeze the chain state of the block as the read snapshot, must be called with cs_main held right after
+     * the caches were flushed. While a background flush is in progress the writer thread takes the snapshot
+     * once the batches are written, and the previous snapshot is served until then.
+     */
+    void RefreshReadSnapshot(const CBlockIndex *pTipIndex);
+    void ResetReadSnapshot();
+    // nullptr if no read snapshot is available
+    std::shared_ptr<CCacheSnapshot> GetReadSnapshot();
+
+private:
+    void FlushCaches();
+    void ThreadWriteBatches();
+
+    CCriticalSection cs_read_snapshot;
+    std::shared_ptr<CCacheSnapshot> spReadSnapshot;
+
+    std::mutex writerMutex;
+    std::condition_variable writerCond;
+    std::thread writerThread;
+    std::shared_ptr<CDBWriteBatches> spWritingBatches;  // batches handed to the writer thread
+    std::shared_ptr<CDBWriteBatches> spFailedBatches;   // batches whose writes failed, written again by Flush()
+    string writerError;
+    bool fStopWriter = false;
+    const CBlockIndex *pPendingSnapshotTip = nullptr;   // read snapshot taken by the writer thread, if any
 };  // CCacheDBManager
 
 #endif //PERSIST_CACHEWRAPPER_H
\ No newline at end of file
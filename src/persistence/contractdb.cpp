@@ -18,6 +18,49 @@
 
 using namespace std;
 
+/************************ contract code cache ******************************/
+// the code blobs still in use are kept when the cache is trimmed
+static const uint64_t MAX_CONTRACT_CODE_CACHE_SIZE = 64 * 1024 * 1024;
+
+CContractCodeCache& CContractCodeCache::Instance() {
+    static CContractCodeCache codeCache;
+    return codeCache;
+}
+
+CContractCodeCache::CodePtr CContractCodeCache::Get(const CRegID &contractRegId, const uint256 &codeHash) {
+    LOCK(cs_code_cache);
+    auto it = codes.find(make_pair(CRegIDKey(contractRegId), codeHash));
+    if (it == codes.end())
+        return nullptr;
+
+    return it->second;
+}
+
+CContractCodeCache::CodePtr CContractCodeCache::Add(const CRegID &contractRegId, const uint256 &codeHash,
+                                                    const string &code) {
+    LOCK(cs_code_cache);
+    auto key = make_pair(CRegIDKey(contractRegId), codeHash);
+    auto it  = codes.find(key);
+    if (it != codes.end())
+        return it->second;
+
+    if (total_size + code.size() > MAX_CONTRACT_CODE_CACHE_SIZE) {
+        for (auto trimIt = codes.begin(); trimIt != codes.end();) {
+            if (trimIt->second.use_count() == 1) {
+                total_size -= trimIt->second->size();
+                trimIt = codes.erase(trimIt);
+            } else {
+                ++trimIt;
+            }
+        }
+    }
+
+    auto spCode = std::make_shared<const string>(code);
+    codes.emplace(key, spCode);
+    total_size += code.size();
+    return spCode;
+}
+
 /************************ contract account ******************************/
 bool CContractDBCache::GetContractAccount(const CRegID &contractRegId, const string &accountKey,
                                           CAppUserAccount &appAccOut) {
@@ -39,17 +82,58 @@ bool CContractDBCache::GetContract(const CRegID &contractRegId, CUniversalContra
 }
 
 bool CContractDBCache::SaveContract(const CRegID &contractRegId, const CUniversalContractStore &contractStore) {
-    return contractCache.SetData(CRegIDKey(contractRegId), contractStore);
+    return contractCache.SetData(CRegIDKey(contractRegId), contractStore) &&
+           contractMetaCache.SetData(CRegIDKey(contractRegId), CUniversalContractMeta(contractStore));
 }
 
 bool CContractDBCache::HasContract(const CRegID &contractRegId) {
-    return contractCache.HasData(CRegIDKey(contractRegId));
+    return contractMetaCache.HasData(CRegIDKey(contractRegId)) || contractCache.HasData(CRegIDKey(contractRegId));
 }
 
 bool CContractDBCache::EraseContract(const CRegID &contractRegId) {
+    contractMetaCache.EraseData(CRegIDKey(contractRegId));
     return contractCache.EraseData(CRegIDKey(contractRegId));
 }
 
+bool CContractDBCache::GetContractMeta(const CRegID &contractRegId, CUniversalContractMeta &contractMeta) const {
+    if (contractMetaCache.GetData(CRegIDKey(contractRegId), contractMeta))
+        return true;
+
+    // the contract was saved before the metadata existed, derive the metadata from the contract store
+    CUniversalContractStore contractStore;
+    if (!contractCache.GetData(CRegIDKey(contractRegId), contractStore))
+        return false;
+
+    contractMeta = CUniversalContractMeta(contractStore);
+    return true;
+}
+
+bool CContractDBCache::BackfillContractMeta(const CRegID &contractRegId, CUniversalContractMeta &contractMeta) {
+    if (contractMetaCache.GetData(CRegIDKey(contractRegId), contractMeta))
+        return true;
+
+    if (!GetContractMeta(contractRegId, contractMeta))
+        return false;
+
+    // save it in this cache layer, so it is undone together with the tx which saved it
+    return contractMetaCache.SetData(CRegIDKey(contractRegId), contractMeta);
+}
+
+bool CContractDBCache::GetContractCode(const CRegID &contractRegId, const CUniversalContractMeta &contractMeta,
+                                       CContractCodeCache::CodePtr &code) {
+    auto &codeCache = CContractCodeCache::Instance();
+    code = codeCache.Get(contractRegId, contractMeta.code_hash);
+    if (code)
+        return true;
+
+    CUniversalContractStore contractStore;
+    if (!contractCache.GetData(CRegIDKey(contractRegId), contractStore))
+        return false;
+
+    code = codeCache.Add(contractRegId, contractMeta.code_hash, contractStore.code);
+    return true;
+}
+
 /************************ contract managed APP data ******************************/
 bool CContractDBCache::GetContractData(const CRegID &contractRegId, const string &contractKey, string &contractData) {
     auto key = std::make_pair(CRegIDKey(contractRegId), contractKey);
@@ -82,6 +166,7 @@ bool CContractDBCache::SetContractTraces(const uint256 &txid, const string &cont
 
 bool CContractDBCache::Flush() {
     contractCache.Flush();
+    contractMetaCache.Flush();
     contractDataCache.Flush();
     contractAccountCache.Flush();
     contractTracesCache.Flush();
@@ -91,6 +176,7 @@ bool CContractDBCache::Flush() {
 
 uint32_t CContractDBCache::GetCacheSize() const {
     return contractCache.GetCacheSize() +
+        contractMetaCache.GetCacheSize() +
         contractDataCache.GetCacheSize() +
         contractTracesCache.GetCacheSize();
 }
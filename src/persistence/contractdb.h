@@ -15,8 +15,10 @@
 #include "dbiterator.h"
 #include "persistence/disk.h"
 #include "vm/luavm/appaccount.h"
+#include "sync.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -59,12 +61,35 @@ public:
     }
 };
 
+/**
+ * Process-wide cache of immutable contract code blobs, keyed by (contract regid, code hash).
+ * Blobs are shared by reference, so executions of the same code neither reload nor copy it.
+ */
+class CContractCodeCache {
+public:
+    typedef std::shared_ptr<const string> CodePtr;
+
+    static CContractCodeCache& Instance();
+
+    // nullptr if not cached
+    CodePtr Get(const CRegID &contractRegId, const uint256 &codeHash);
+    CodePtr Add(const CRegID &contractRegId, const uint256 &codeHash, const string &code);
+
+private:
+    CContractCodeCache() {}
+
+    CCriticalSection cs_code_cache;
+    map<pair<CRegIDKey, uint256>, CodePtr> codes;
+    uint64_t total_size = 0;
+};
+
 class CContractDBCache {
 public:
     CContractDBCache() {}
 
     CContractDBCache(CDBAccess *pDbAccess):
         contractCache(pDbAccess),
+        contractMetaCache(pDbAccess),
         contractDataCache(pDbAccess),
         contractAccountCache(pDbAccess),
         contractTracesCache(pDbAccess) {
@@ -73,6 +98,7 @@ public:
 
     CContractDBCache(CContractDBCache *pBaseIn):
         contractCache(pBaseIn->contractCache),
+        contractMetaCache(pBaseIn->contractMetaCache),
         contractDataCache(pBaseIn->contractDataCache),
         contractAccountCache(pBaseIn->contractAccountCache),
         contractTracesCache(pBaseIn->contractTracesCache) {};
@@ -85,6 +111,16 @@ public:
     bool HasContract(const CRegID &contractRegId);
     bool EraseContract(const CRegID &contractRegId);
 
+    // metadata of the contract, without loading its code and abi unless the contract was saved before
+    // the metadata existed
+    bool GetContractMeta(const CRegID &contractRegId, CUniversalContractMeta &contractMeta) const;
+    // same as GetContractMeta(), and saves the metadata of a contract saved before it existed,
+    // on the write path of the txs executing the contract
+    bool BackfillContractMeta(const CRegID &contractRegId, CUniversalContractMeta &contractMeta);
+    // code of the contract shared from CContractCodeCache
+    bool GetContractCode(const CRegID &contractRegId, const CUniversalContractMeta &contractMeta,
+                         CContractCodeCache::CodePtr &code);
+
     bool GetContractData(const CRegID &contractRegId, const string &contractKey, string &contractData);
     bool SetContractData(const CRegID &contractRegId, const string &contractKey, const string &contractData);
     bool HasContractData(const CRegID &contractRegId, const string &contractKey);
@@ -98,6 +134,7 @@ public:
 
     void SetBaseViewPtr(CContractDBCache *pBaseIn) {
         contractCache.SetBase(&pBaseIn->contractCache);
+        contractMetaCache.SetBase(&pBaseIn->contractMetaCache);
         contractDataCache.SetBase(&pBaseIn->contractDataCache);
         contractAccountCache.SetBase(&pBaseIn->contractAccountCache);
         contractTracesCache.SetBase(&pBaseIn->contractTracesCache);
@@ -105,6 +142,7 @@ public:
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
         contractCache.SetDbOpLogMap(pDbOpLogMapIn);
+        contractMetaCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractDataCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractAccountCache.SetDbOpLogMap(pDbOpLogMapIn);
         contractTracesCache.SetDbOpLogMap(pDbOpLogMapIn);
@@ -112,6 +150,7 @@ public:
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
         contractCache.RegisterUndoFunc(undoDataFuncMap);
+        contractMetaCache.RegisterUndoFunc(undoDataFuncMap);
         contractDataCache.RegisterUndoFunc(undoDataFuncMap);
         contractAccountCache.RegisterUndoFunc(undoDataFuncMap);
         contractTracesCache.RegisterUndoFunc(undoDataFuncMap);
@@ -127,6 +166,9 @@ public:
     // contract $RegIdKey -> CUniversalContractStore
     CCompositeKVCache< dbk::CONTRACT_DEF,         CRegIDKey,                  CUniversalContractStore >   contractCache;
 
+    // contract $RegIdKey -> CUniversalContractMeta
+    CCompositeKVCache< dbk::CONTRACT_META,        CRegIDKey,                  CUniversalContractMeta >    contractMetaCache;
+
     // pair<contractRegId, contractKey> -> contractData
     DBContractDataCache contractDataCache;
 
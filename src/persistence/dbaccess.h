@@ -7,9 +7,12 @@
 #define PERSIST_DB_ACCESS_H
 
 #include "commons/uint256.h"
+#include "dbcachemap.h"
 #include "dbconf.h"
 #include "leveldbwrapper.h"
 
+#include <array>
+#include <atomic>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -262,36 +265,41 @@ namespace db_util {
 };
 
 typedef void(UndoDataFunc)(const CDbOpLogs &pDbOpLogs);
-typedef std::map<dbk::PrefixType, std::function<UndoDataFunc>> UndoDataFuncMap;
+// direct dispatch table of undo functions, indexed by prefix type
+typedef std::array<std::function<UndoDataFunc>, dbk::PREFIX_COUNT + 1> UndoDataFuncMap;
+
+class CDBSnapshotSet;
+class CDBWriteBatches;
 
 class CDBAccess {
 public:
     CDBAccess(const boost::filesystem::path& dir, DBNameType dbNameTypeIn, bool fMemory, bool fWipe) :
               dbNameType(dbNameTypeIn),
-              db( dir / ::GetDbName(dbNameTypeIn), DBCacheSize[dbNameTypeIn], fMemory, fWipe ) {}
+              db( dir / ::GetDbName(dbNameTypeIn), GetDBTuning(dbNameTypeIn), fMemory, fWipe ) {}
 
     int64_t GetDbCount() const { return db.GetDbCount(); }
     template<typename KeyType, typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, const KeyType &key, ValueType &value) const {
-        string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Read(keyStr, value);
+        dbk::CDBKeyStream ssKey(SER_DISK, CLIENT_VERSION);
+        dbk::GenDbKey(prefixType, key, ssKey);
+        return db.Read(leveldb::Slice(ssKey.data(), ssKey.size()), value, GetThreadSnapshot());
     }
 
     template<typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, ValueType &value) const {
         const string prefix = dbk::GetKeyPrefix(prefixType);
-        return db.Read(prefix, value);
+        return db.Read(prefix, value, GetThreadSnapshot());
     }
 
     template<typename KeyType, typename ValueType>
     bool HasData(const dbk::PrefixType prefixType, const KeyType &key) const {
-        string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Exists(keyStr);
+        dbk::CDBKeyStream ssKey(SER_DISK, CLIENT_VERSION);
+        dbk::GenDbKey(prefixType, key, ssKey);
+        return db.Exists(leveldb::Slice(ssKey.data(), ssKey.size()), GetThreadSnapshot());
     }
 
-    inline void WriteBatch(CLevelDBBatch &batch) {
-        db.WriteBatch(batch, true);
-    }
+    // the batch is deferred to the write batches of the current thread, if any, see CDBWriteBatchScope
+    inline void WriteBatch(CLevelDBBatch &batch);
 
     template<typename ValueType>
     void WriteBatch(const dbk::PrefixType prefixType, ValueType &value) {
@@ -303,17 +311,233 @@ public:
         } else {
             batch.Write(prefix, value);
         }
-        db.WriteBatch(batch, true);
+        WriteBatch(batch);
     }
 
     DBNameType GetDbNameType() const { return dbNameType; }
 
     std::shared_ptr<leveldb::Iterator> NewIterator() {
-        return std::shared_ptr<leveldb::Iterator>(db.NewIterator());
+        return std::shared_ptr<leveldb::Iterator>(db.NewIterator(GetThreadSnapshot()));
     }
+
+    const leveldb::Snapshot *GetSnapshot() { return db.GetSnapshot(); }
+
+    void ReleaseSnapshot(const leveldb::Snapshot *pSnapshot) { db.ReleaseSnapshot(pSnapshot); }
+
+    // Reads issued by the calling thread are served from pSnapshotSetIn until reset to nullptr.
+    static void SetThreadSnapshotSet(const CDBSnapshotSet *pSnapshotSetIn) { pThreadSnapshotSet = pSnapshotSetIn; }
+
 private:
+    inline const leveldb::Snapshot *GetThreadSnapshot() const;
+
     DBNameType dbNameType;
     mutable CLevelDBWrapper db; // // TODO: remove the mutable declare
+
+    static inline thread_local const CDBSnapshotSet *pThreadSnapshotSet = nullptr;
+};
+
+// generation of the last write batches which were written to the dbs, see CDBWriteBatches
+inline std::atomic<uint64_t>& GetDBDurableGeneration() {
+    static std::atomic<uint64_t> durableGeneration{0};
+    return durableGeneration;
+}
+
+/**
+ * Batches of the db layer caches flushed within a CDBWriteBatchScope, merged into one batch per db, to be
+ * written later by another thread. The entries flushed in a generation stay in their caches until the
+ * batches of the generation are written, so that the reads falling through to the dbs never miss them.
+ */
+class CDBWriteBatches {
+public:
+    CDBWriteBatches() {
+        static std::atomic<uint64_t> lastGeneration{0};
+        generation = ++lastGeneration;
+    }
+
+    uint64_t GetGeneration() const { return generation; }
+
+    void Add(CDBAccess *pDbAccess, const CLevelDBBatch &batch) {
+        for (auto &item : batches) {
+            if (item.first == pDbAccess) {
+                item.second.Append(batch);
+                return;
+            }
+        }
+        batches.emplace_back(pDbAccess, CLevelDBBatch());
+        batches.back().second.Append(batch);
+    }
+
+    // writes the batches in the order their dbs were first flushed, the batch of pLastDbAccess last
+    void Write(CDBAccess *pLastDbAccess) {
+        for (auto &item : batches) {
+            if (item.first != pLastDbAccess)
+                item.first->WriteBatch(item.second);
+        }
+        for (auto &item : batches) {
+            if (item.first == pLastDbAccess)
+                item.first->WriteBatch(item.second);
+        }
+        GetDBDurableGeneration() = generation;
+    }
+
+private:
+    uint64_t generation;
+    std::vector<std::pair<CDBAccess *, CLevelDBBatch>> batches;
+};
+
+// Make the db layer caches flushed by the current thread within the scope add their batches to writeBatches
+class CDBWriteBatchScope {
+public:
+    CDBWriteBatchScope(CDBWriteBatches &writeBatches) { pThreadWriteBatches = &writeBatches; }
+    ~CDBWriteBatchScope() { pThreadWriteBatches = nullptr; }
+
+    static CDBWriteBatches *GetWriteBatches() { return pThreadWriteBatches; }
+
+    // generation of the flushes of the current thread, 0 if written right away
+    static uint64_t GetGeneration() {
+        return pThreadWriteBatches != nullptr ? pThreadWriteBatches->GetGeneration() : 0;
+    }
+
+private:
+    static inline thread_local CDBWriteBatches *pThreadWriteBatches = nullptr;
+};
+
+inline void CDBAccess::WriteBatch(CLevelDBBatch &batch) {
+    CDBWriteBatches *pWriteBatches = CDBWriteBatchScope::GetWriteBatches();
+    if (pWriteBatches != nullptr) {
+        pWriteBatches->Add(this, batch);
+        return;
+    }
+    db.WriteBatch(batch, true);
+}
+
+/**
+ * Point-in-time LevelDB snapshots of a group of databases, all taken at the same moment.
+ * Snapshots are released when the set is destroyed.
+ */
+class CDBSnapshotSet {
+public:
+    CDBSnapshotSet() {}
+
+    ~CDBSnapshotSet() {
+        for (auto &item : snapshots) {
+            item.first->ReleaseSnapshot(item.second);
+        }
+    }
+
+    void Add(CDBAccess *pDbAccess) {
+        assert(pDbAccess != nullptr);
+        if (snapshots.count(pDbAccess) == 0)
+            snapshots[pDbAccess] = pDbAccess->GetSnapshot();
+    }
+
+    const leveldb::Snapshot *Get(const CDBAccess *pDbAccess) const {
+        auto it = snapshots.find(const_cast<CDBAccess *>(pDbAccess));
+        return it != snapshots.end() ? it->second : nullptr;
+    }
+
+private:
+    CDBSnapshotSet(const CDBSnapshotSet &) = delete;
+    CDBSnapshotSet &operator=(const CDBSnapshotSet &) = delete;
+
+    std::map<CDBAccess *, const leveldb::Snapshot *> snapshots;
+};
+
+// Make all CDBAccess reads of the current thread use the snapshot set within the scope
+class CDBSnapshotScope {
+public:
+    CDBSnapshotScope(const CDBSnapshotSet &snapshotSet) { CDBAccess::SetThreadSnapshotSet(&snapshotSet); }
+    ~CDBSnapshotScope() { CDBAccess::SetThreadSnapshotSet(nullptr); }
+};
+
+inline const leveldb::Snapshot *CDBAccess::GetThreadSnapshot() const {
+    return pThreadSnapshotSet != nullptr ? pThreadSnapshotSet->Get(this) : nullptr;
+}
+
+// Notifies the read observer of an op log map, if any, around a read forwarded to the base layer
+class CDBBaseReadScope {
+public:
+    template<typename KeyType>
+    CDBBaseReadScope(const CDBOpLogMap *pDbOpLogMap, dbk::PrefixType prefixType, const KeyType &key)
+        : pReadObserver(pDbOpLogMap != nullptr ? pDbOpLogMap->GetReadObserver() : nullptr) {
+        if (pReadObserver != nullptr) {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            ssKey << key;
+            pReadObserver->BeginBaseRead(prefixType, ssKey.str());
+        }
+    }
+
+    CDBBaseReadScope(const CDBOpLogMap *pDbOpLogMap, dbk::PrefixType prefixType)
+        : pReadObserver(pDbOpLogMap != nullptr ? pDbOpLogMap->GetReadObserver() : nullptr) {
+        if (pReadObserver != nullptr)
+            pReadObserver->BeginBaseRead(prefixType, "");
+    }
+
+    ~CDBBaseReadScope() {
+        if (pReadObserver != nullptr)
+            pReadObserver->EndBaseRead();
+    }
+
+private:
+    CDBBaseReadScope(const CDBBaseReadScope &) = delete;
+    CDBBaseReadScope &operator=(const CDBBaseReadScope &) = delete;
+
+    CDBReadObserver *pReadObserver;
+};
+
+// max keys known to be absent from the db per cache, the keys are forgotten at once when exceeded
+static const uint32_t MAX_DB_ABSENT_KEYS = 100000;
+
+// lookups of the db layer caches which miss their map and bytes held by their maps, per prefix type
+struct CDBCacheStats {
+    std::atomic<uint64_t> db_reads{0};      // lookups read from the db
+    std::atomic<uint64_t> db_misses{0};     // db reads which found no value
+    std::atomic<uint64_t> absent_hits{0};   // lookups answered by the keys known to be absent
+    std::atomic<int64_t> cache_bytes{0};    // serialized bytes of the cached keys and values
+    std::atomic<uint64_t> evicted{0};       // clean entries evicted to fit the resident budget
+};
+
+inline CDBCacheStats& GetDBCacheStats(dbk::PrefixType prefixType) {
+    static CDBCacheStats stats[dbk::PREFIX_COUNT + 1];
+    return stats[prefixType];
+}
+
+// serialized bytes held by all the db layer caches, checked against -dbcache
+inline std::atomic<int64_t>& GetDBCacheTotalBytes() {
+    static std::atomic<int64_t> totalBytes{0};
+    return totalBytes;
+}
+
+inline void AddDBCacheBytes(dbk::PrefixType prefixType, int64_t bytes) {
+    GetDBCacheStats(prefixType).cache_bytes += bytes;
+    GetDBCacheTotalBytes() += bytes;
+}
+
+/**
+ * Make the db layer caches flushed by the current thread within the scope keep their clean entries
+ * resident, up to keepRatio of their size. Out of a scope, a flush drops all the entries of the cache.
+ */
+class CDBCacheEvictionScope {
+public:
+    CDBCacheEvictionScope(double keepRatioIn) { keepRatio = keepRatioIn; }
+    ~CDBCacheEvictionScope() { keepRatio = 0; }
+
+    static double GetKeepRatio() { return keepRatio; }
+
+private:
+    static inline thread_local double keepRatio = 0;
+};
+
+// state of an entry of a db layer cache, kept apart from the map entries by entry index
+struct CDBCacheEntryState {
+    uint32_t keySize   = 0;         // serialized bytes of the key
+    uint32_t valueSize = 0;         // serialized bytes of the value
+    bool dirty         = false;     // changed since the last flush to the db
+    bool referenced    = false;     // read since the last eviction sweep, the second chance of CLOCK
+    uint64_t flushGen  = 0;         // generation of the last flush, see CDBWriteBatches
+
+    // the db has the value of the entry unless it is dirty
+    bool IsDurable() const { return !dirty && flushGen <= GetDBDurableGeneration(); }
 };
 
 template<int32_t PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType>
@@ -323,9 +547,8 @@ public:
 public:
     typedef __KeyType   KeyType;
     typedef __ValueType ValueType;
-    typedef std::shared_ptr<__ValueType> ValueSPtr;
-    typedef typename std::map<KeyType, ValueSPtr> Map;
-    typedef typename std::map<KeyType, ValueSPtr>::iterator Iterator;
+    typedef CDBCacheMap<KeyType, ValueType> Map;
+    typedef typename Map::Iterator Iterator;
 
 public:
     /**
@@ -339,7 +562,7 @@ public:
     };
 
     CCompositeKVCache(CDBAccess *pDbAccessIn): pBase(nullptr),
-        pDbAccess(pDbAccessIn), is_calc_size(true) {
+        pDbAccess(pDbAccessIn), is_calc_size(true), is_accounted(true) {
         assert(pDbAccessIn != nullptr);
         assert(pDbAccess->GetDbNameType() == GetDbNameEnumByPrefix(PREFIX_TYPE));
     };
@@ -348,24 +571,54 @@ public:
         operator=(other);
     }
 
+    ~CCompositeKVCache() {
+        if (is_accounted)
+            AddDBCacheBytes(PREFIX_TYPE, -(int64_t)size);
+    }
+
+    // a copy of a db layer cache takes only the entries the db does not have yet, the others are read again.
+    // The copy is not accounted in the db cache bytes, unlike the caches constructed on the db.
     CCompositeKVCache& operator=(const CCompositeKVCache& other) {
+        if (this == &other)
+            return *this;
+
         pBase = other.pBase;
         pDbAccess = other.pDbAccess;
-        // deep copy for map
-        mapData.clear();
-        for (auto otherItem : other.mapData) {
-            mapData[otherItem.first] = make_shared<ValueType>(*otherItem.second);
-        }
+        absentKeys = other.absentKeys;
         pDbOpLogMap = other.pDbOpLogMap;
         is_calc_size = other.is_calc_size;
-        size = other.size;
+
+        uint32_t oldSize = size;
+        dirtyIndexes.clear();
+        if (other.is_calc_size) {
+            mapData.clear();
+            states.clear();
+            size = 0;
+            for (auto it = other.mapData.begin(); it != other.mapData.end(); ++it) {
+                const CDBCacheEntryState &state = other.states[it.GetIndex()];
+                if (state.IsDurable())
+                    continue;
+                uint32_t index = mapData.emplace(it->first, it->second).first.GetIndex();
+                states.push_back(state);
+                if (state.dirty)
+                    dirtyIndexes.push_back(index);
+                size += state.keySize + state.valueSize;
+            }
+        } else {
+            mapData = other.mapData;
+            states.clear();
+            size = other.size;
+        }
+        if (is_accounted)
+            AddDBCacheBytes(PREFIX_TYPE, (int64_t)size - oldSize);
 
         return *this;
     }
 
+    // a cache holding data can only be rebased onto a layer that has the same view of the keys it holds,
+    // see CForkStateManager
     void SetBase(CCompositeKVCache *pBaseIn) {
         assert(pDbAccess == nullptr);
-        assert(mapData.empty());
         pBase = pBaseIn;
     };
 
@@ -384,8 +637,8 @@ public:
             return false;
         }
         auto it = GetDataIt(key);
-        if (it != mapData.end() && !db_util::IsEmpty(*it->second)) {
-            value = *it->second;
+        if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
+            value = it->second;
             return true;
         }
         return false;
@@ -399,11 +652,11 @@ public:
         if (it == mapData.end()) {
             auto pEmptyValue = db_util::MakeEmptyValue<ValueType>();
             AddOpLog(key, *pEmptyValue, &value);
-            AddDataToMap(key, value);
+            AddDataToMap(key, value, true);
         } else {
-            AddOpLog(key, *it->second, &value);
-            UpdateDataSize(*it->second, value);
-            *it->second = value;
+            AddOpLog(key, it->second, &value);
+            it->second = value;
+            UpdateDataSize(it);
         }
         return true;
     }
@@ -413,7 +666,7 @@ public:
             return false;
         }
         auto it = GetDataIt(key);
-        return it != mapData.end() && !db_util::IsEmpty(*it->second);
+        return it != mapData.end() && !db_util::IsEmpty(it->second);
     }
 
     bool EraseData(const KeyType &key) {
@@ -421,48 +674,72 @@ public:
             return false;
         }
         Iterator it = GetDataIt(key);
-        if (it != mapData.end() && !db_util::IsEmpty(*it->second)) {
-            DecDataSize(*it->second);
-            AddOpLog(key, *it->second, nullptr);
-            db_util::SetEmpty(*it->second);
-            IncDataSize(*it->second);
+        if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
+            AddOpLog(key, it->second, nullptr);
+            db_util::SetEmpty(it->second);
+            UpdateDataSize(it);
         }
         return true;
     }
 
     void Clear() {
         mapData.clear();
-        size = 0;
+        states.clear();
+        dirtyIndexes.clear();
+        absentKeys.clear();
+        SetSize(0);
     }
 
     void Flush() {
         assert(pBase != nullptr || pDbAccess != nullptr);
         if (pBase != nullptr) {
             assert(pDbAccess == nullptr);
-            for (auto item : mapData) {
-                pBase->SetDataToSelf(item.first, *item.second);
+            for (const auto &item : mapData) {
+                pBase->SetDataToSelf(item.first, item.second);
             }
         } else if (pDbAccess != nullptr) {
             assert(pBase == nullptr);
+            uint64_t flushGen = CDBWriteBatchScope::GetGeneration();
             CLevelDBBatch batch;
-            for (auto item : mapData) {
-                string key = dbk::GenDbKey(PREFIX_TYPE, item.first);
-                if (db_util::IsEmpty(*item.second)) {
-                    batch.Erase(key);
+            for (uint32_t index : dirtyIndexes) {
+                CDBCacheEntryState &state = states[index];
+                const auto &entry = mapData.GetEntry(index);
+                dbk::CDBKeyStream ssKey(SER_DISK, CLIENT_VERSION);
+                dbk::GenDbKey(PREFIX_TYPE, entry.first, ssKey);
+                leveldb::Slice slKey(ssKey.data(), ssKey.size());
+                if (db_util::IsEmpty(entry.second)) {
+                    batch.Erase(slKey);
+                    AddAbsentKey(entry.first);
                 } else {
-                    batch.Write(key, *item.second);
+                    batch.Write(slKey, entry.second);
                 }
+                state.dirty    = false;
+                state.flushGen = flushGen;
             }
             pDbAccess->WriteBatch(batch);
+
+            // every key written to the db went through mapData, the other absent keys are still absent
+            std::vector<uint32_t> flushedIndexes;
+            flushedIndexes.swap(dirtyIndexes);
+            Evict((uint64_t)(size * CDBCacheEvictionScope::GetKeepRatio()), flushedIndexes);
+            return;
         }
 
         Clear();
     }
 
+    // the replaced value is logged if an op log map is set, which makes the logs of an undo its redo data
     void UndoData(const CDbOpLog &dbOpLog) {
         KeyType key;
         ValueType value;
         dbOpLog.Get(key, value);
+        if (pDbOpLogMap != nullptr) {
+            auto it = GetDataIt(key);
+            if (it != mapData.end())
+                AddOpLog(key, it->second, &value);
+            else
+                AddOpLog(key, *db_util::MakeEmptyValue<ValueType>(), &value);
+        }
         SetDataToSelf(key, value);
     }
 
@@ -488,79 +765,192 @@ public:
 
     CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType>* GetBasePtr() { return pBase; }
 
-    map<KeyType, ValueSPtr>& GetMapData() { return mapData; };
+    Map& GetMapData() { return mapData; };
 private:
     Iterator GetDataIt(const KeyType &key) const {
         Iterator it = mapData.find(key);
         if (it != mapData.end()) {
+            if (is_calc_size)
+                states[it.GetIndex()].referenced = true;
             return it;
         } else if (pBase != nullptr) {
+            CDBBaseReadScope readScope(pDbOpLogMap, PREFIX_TYPE, key);
             // find key-value at base cache
             auto baseIt = pBase->GetDataIt(key);
             if (baseIt != pBase->mapData.end()) {
                 // the found key-value add to current mapData
-                return AddDataToMap(key, *baseIt->second);
+                return AddDataToMap(key, baseIt->second, false);
             }
         } else if (pDbAccess != NULL) {
-            // TODO: need to save the empty value to mapData for search performance?
+            // the misses are remembered apart from mapData, which is flushed to the db as it is
+            CDBCacheStats &stats = GetDBCacheStats(PREFIX_TYPE);
+            if (absentKeys.count(key)) {
+                stats.absent_hits++;
+                return mapData.end();
+            }
+
+            stats.db_reads++;
             auto pDbValue = db_util::MakeEmptyValue<ValueType>();
             if (pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue)) {
-                return AddDataToMap(key, pDbValue);
+                return AddDataToMap(key, std::move(*pDbValue), false);
             }
+            stats.db_misses++;
+            AddAbsentKey(key);
         }
 
         return mapData.end();
     }
 
+    inline void AddAbsentKey(const KeyType &key) const {
+        if (absentKeys.size() >= MAX_DB_ABSENT_KEYS)
+            absentKeys.clear();
+        absentKeys.insert(key);
+    }
+
     // set data to self only
     void SetDataToSelf(const KeyType &key, const ValueType &value) {
         auto it = mapData.find(key);
         if (it != mapData.end()) {
-            UpdateDataSize(*it->second, value);
-            *it->second = value;
+            it->second = value;
+            UpdateDataSize(it);
         } else {
-            AddDataToMap(key, value);
+            AddDataToMap(key, value, true);
         }
     }
 
-    inline Iterator AddDataToMap(const KeyType &keyIn, const ValueType &valueIn) const {
-        auto spNewValue = make_shared<ValueType>(valueIn);
-        return AddDataToMap(keyIn, spNewValue);
-    }
-
-    inline Iterator AddDataToMap(const KeyType &keyIn, ValueSPtr &spNewValue) const {
-        auto newRet = mapData.emplace(keyIn, spNewValue);
+    // dirty: the value differs from the db, false for the values read from the db or the base cache
+    template<typename V>
+    inline Iterator AddDataToMap(const KeyType &keyIn, V &&valueIn, bool dirty) const {
+        if (!absentKeys.empty())
+            absentKeys.erase(keyIn);
+        auto newRet = mapData.emplace(keyIn, std::forward<V>(valueIn));
         if (!newRet.second)
             throw runtime_error(strprintf("%s :  %s, alloc new cache item failed", __FUNCTION__, __LINE__));
-        IncDataSize(keyIn, *spNewValue);
+        if (is_calc_size) {
+            CDBCacheEntryState state;
+            state.keySize    = CalcDataSize(keyIn);
+            state.valueSize  = CalcDataSize(newRet.first->second);
+            state.dirty      = dirty;
+            state.referenced = true;
+            states.push_back(state);
+            if (dirty)
+                dirtyIndexes.push_back(newRet.first.GetIndex());
+            SetSize(size + state.keySize + state.valueSize);
+        }
         return newRet.first;
     }
 
-    inline void IncDataSize(const KeyType &keyIn, const ValueType &valueIn) const {
+    // the value of the entry was changed in place, only the new value is measured
+    inline void UpdateDataSize(const Iterator &it) const {
         if (is_calc_size) {
-            size += CalcDataSize(keyIn);
-            size += CalcDataSize(valueIn);
+            CDBCacheEntryState &state = states[it.GetIndex()];
+            uint32_t valueSize = CalcDataSize(it->second);
+            SetSize(size - state.valueSize + valueSize);
+            if (!state.dirty)
+                dirtyIndexes.push_back(it.GetIndex());
+            state.valueSize  = valueSize;
+            state.dirty      = true;
+            state.referenced = true;
         }
     }
 
-    inline void IncDataSize(const ValueType &valueIn) const {
-        if (is_calc_size)
-            size += CalcDataSize(valueIn);
+    inline void SetSize(uint32_t sizeIn) const {
+        if (is_accounted)
+            AddDBCacheBytes(PREFIX_TYPE, (int64_t)sizeIn - size);
+        size = sizeIn;
     }
 
-    inline void DecDataSize(const ValueType &valueIn) const {
-        if (is_calc_size) {
-            uint32_t sz = CalcDataSize(valueIn);
-            size = size > sz ? size - sz : 0;
+    /**
+     * Drops the clean entries which do not fit targetSize after a flush. The sweep runs from the newest
+     * entry like the hand of a CLOCK: the entries read since the previous sweep are kept first and lose
+     * their mark, then the others fill what is left. Erased entries are always dropped, their keys are
+     * known absent. The entries which the dbs do not have yet are always kept. Within the budget only
+     * the erased entries of the flush are dropped, without a sweep.
+     */
+    void Evict(uint64_t targetSize, const std::vector<uint32_t> &flushedIndexes) {
+        if (size <= targetSize) {
+            for (uint32_t i : flushedIndexes) {
+                if (states[i].IsDurable() && db_util::IsEmpty(mapData.GetEntry(i).second))
+                    RemoveEntry(i);
+            }
+            CompactIfSparse();
+            return;
+        }
+
+        const uint32_t count = mapData.GetEntryCount();
+        std::vector<bool> keep(count, false);
+        uint64_t keptSize    = 0;
+        uint32_t keptCount   = 0;
+        uint32_t erasedCount = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (!mapData.IsRemoved(i) && !states[i].IsDurable()) {
+                keep[i]  = true;
+                keptSize += states[i].keySize + states[i].valueSize;
+                keptCount++;
+            }
+        }
+        for (int32_t pass = 0; pass < 2; pass++) {
+            for (uint32_t i = count; i-- > 0;) {
+                CDBCacheEntryState &state = states[i];
+                if (keep[i] || mapData.IsRemoved(i) || (pass == 0 && !state.referenced))
+                    continue;
+                if (db_util::IsEmpty(mapData.GetEntry(i).second)) {
+                    erasedCount += (pass == 1);
+                    continue;
+                }
+
+                uint64_t entrySize = state.keySize + state.valueSize;
+                if (keptSize + entrySize > targetSize)
+                    continue;
+
+                keep[i]  = true;
+                keptSize += entrySize;
+                keptCount++;
+                state.referenced = false;
+            }
+        }
+
+        const uint32_t liveCount = mapData.size();
+        if (keptCount == liveCount)
+            return;
+
+        GetDBCacheStats(PREFIX_TYPE).evicted += liveCount - keptCount - erasedCount;
+        if (keptCount == 0) {
+            mapData.clear();
+            states.clear();
+            SetSize(0);
+            return;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (!keep[i] && !mapData.IsRemoved(i))
+                mapData.erase(typename Map::Iterator(&mapData, i));
         }
+        SetSize(keptSize);
+        CompactIfSparse();
     }
 
-    inline void UpdateDataSize(const ValueType &oldValue, const ValueType &newVvalue) const {
-        if (is_calc_size) {
-            size += CalcDataSize(newVvalue);
-            uint32_t oldSz = CalcDataSize(oldValue);
-            size = size > oldSz ? size - oldSz : 0;
+    // the entry stays in mapData as a tombstone until the next compaction
+    inline void RemoveEntry(uint32_t index) {
+        mapData.erase(typename Map::Iterator(&mapData, index));
+        SetSize(size - states[index].keySize - states[index].valueSize);
+    }
+
+    // moves the live entries into new storage once the removed ones outnumber them, which amortizes the
+    // copy over the removals
+    void CompactIfSparse() {
+        if (mapData.GetRemovedCount() * 2 <= mapData.GetEntryCount())
+            return;
+
+        assert(dirtyIndexes.empty());
+        std::vector<uint32_t> newIndexes;
+        mapData.Compact(newIndexes);
+        std::vector<CDBCacheEntryState> keptStates(mapData.size());
+        for (uint32_t i = 0; i < newIndexes.size(); i++) {
+            if (newIndexes[i] != UINT32_MAX)
+                keptStates[newIndexes[i]] = states[i];
         }
+        states.swap(keptStates);
     }
 
     template <typename Data>
@@ -586,9 +976,13 @@ private:
 private:
     mutable CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> *pBase = nullptr;
     CDBAccess *pDbAccess = nullptr;
-    mutable map<KeyType, ValueSPtr> mapData;
+    mutable Map mapData;
+    mutable std::vector<CDBCacheEntryState> states;    // by entry index of mapData, db layer only
+    mutable std::vector<uint32_t> dirtyIndexes;        // entry indexes turned dirty since the last flush
+    mutable set<KeyType> absentKeys;    // keys known to be absent from the db, db layer only
     CDBOpLogMap *pDbOpLogMap = nullptr;
     bool is_calc_size = false;
+    bool is_accounted = false;          // constructed on the db, its size is added to the db cache bytes
     mutable uint32_t size = 0;
 };
 
@@ -628,12 +1022,13 @@ public:
             ptrData = make_shared<ValueType>(*other.ptrData);
         }
         pDbOpLogMap = other.pDbOpLogMap;
+        dataSize = other.dataSize;
         return *this;
     }
 
+    // a cache holding data can only be rebased onto a layer that has the same view of it, see CCompositeKVCache
     void SetBase(CSimpleKVCache *pBaseIn) {
         assert(pDbAccess == nullptr);
-        assert(!ptrData && "Must SetBase before have any data");
         pBase = pBaseIn;
     }
 
@@ -641,12 +1036,15 @@ public:
         pDbOpLogMap = pDbOpLogMapIn;
     }
 
+    // the value is measured once after each change
     uint32_t GetCacheSize() const {
         if (!ptrData) {
             return 0;
         }
-
-        return ::GetSerializeSize(*ptrData, SER_DISK, CLIENT_VERSION);
+        if (dataSize < 0) {
+            dataSize = ::GetSerializeSize(*ptrData, SER_DISK, CLIENT_VERSION);
+        }
+        return dataSize;
     }
 
     bool GetData(ValueType &value) const {
@@ -664,6 +1062,7 @@ public:
         }
         AddOpLog(*ptrData);
         *ptrData = value;
+        dataSize = -1;
         return true;
     }
 
@@ -677,12 +1076,14 @@ public:
         if (ptr && !db_util::IsEmpty(*ptr)) {
             AddOpLog(*ptr);
             db_util::SetEmpty(*ptr);
+            dataSize = -1;
         }
         return true;
     }
 
     void Clear() {
         ptrData = nullptr;
+        dataSize = -1;
     }
 
     void Flush() {
@@ -691,19 +1092,30 @@ public:
             if (pBase != nullptr) {
                 assert(pDbAccess == nullptr);
                 pBase->ptrData = ptrData;
+                pBase->dataSize = dataSize;
             } else if (pDbAccess != nullptr) {
                 assert(pBase == nullptr);
                 pDbAccess->WriteBatch(PREFIX_TYPE, *ptrData);
+                // a deferred batch is not in the db yet, the value stays until the next flush
+                if (CDBWriteBatchScope::GetWriteBatches() != nullptr)
+                    return;
             }
             ptrData = nullptr;
+            dataSize = -1;
         }
     }
 
+    // the replaced value is logged if an op log map is set, the same as CCompositeKVCache::UndoData()
     void UndoData(const CDbOpLog &dbOpLog) {
+        if (pDbOpLogMap != nullptr) {
+            auto ptr = GetDataPtr();
+            AddOpLog(ptr ? *ptr : *db_util::MakeEmptyValue<ValueType>());
+        }
         if (!ptrData) {
             ptrData = db_util::MakeEmptyValue<ValueType>();
         }
         dbOpLog.Get(*ptrData);
+        dataSize = -1;
     }
 
     void UndoDataList(const CDbOpLogs &dbOpLogs) {
@@ -723,9 +1135,11 @@ public:
         if (ptrData) {
             return ptrData;
         } else if (pBase != nullptr){
+            CDBBaseReadScope readScope(pDbOpLogMap, PREFIX_TYPE);
             auto ptr = pBase->GetDataPtr();
             if (ptr) {
                 ptrData = std::make_shared<ValueType>(*ptr);
+                dataSize = pBase->dataSize;
                 return ptrData;
             }
         } else if (pDbAccess != NULL) {
@@ -734,6 +1148,7 @@ public:
             if (pDbAccess->GetData(PREFIX_TYPE, *ptrDbData)) {
                 assert(!db_util::IsEmpty(*ptrDbData));
                 ptrData = ptrDbData;
+                dataSize = -1;
                 return ptrData;
             }
         }
@@ -754,6 +1169,7 @@ private:
     CDBAccess *pDbAccess;
     mutable std::shared_ptr<ValueType> ptrData = nullptr;
     CDBOpLogMap *pDbOpLogMap                   = nullptr;
+    mutable int64_t dataSize                   = -1;    // serialized size of *ptrData, -1 if not measured
 };
 
 #endif  // PERSIST_DB_ACCESS_H
@@ -0,0 +1,424 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_DBCACHEMAP_H
+#define PERSIST_DBCACHEMAP_H
+
+#include "commons/random.h"
+#include "commons/serialize.h"
+#include "config/version.h"
+#include "crypto/siphash.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// keys of the db cache maps are hashed by their serialized bytes with a key random per process,
+// so that the peers can not choose keys colliding in the maps
+class CDBCacheMapHasher {
+public:
+    template<typename KeyType>
+    static uint64_t Hash(const KeyType &key) {
+        static const std::pair<uint64_t, uint64_t> sipKey = NewSipKey();
+
+        CInlineDataStream<128> ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << key;
+        return CSipHasher(sipKey.first, sipKey.second)
+            .Write((const unsigned char *)ssKey.data(), ssKey.size())
+            .Finalize();
+    }
+
+private:
+    static std::pair<uint64_t, uint64_t> NewSipKey() {
+        uint256 rand = GetRandHash();
+        return std::make_pair(rand.GetUint64(0), rand.GetUint64(1));
+    }
+};
+
+/**
+ * Map of the data of a db cache: open addressing hash index over entries stored inline in chunks,
+ * so an entry costs no tree node nor separately allocated value. erase() leaves a tombstone in the
+ * index and releases the value, the entry keeps its index until Compact() moves the live entries
+ * into new storage, which the owner does once the removed entries outnumber the live ones.
+ *
+ * begin()/end() iterate the live entries in insertion order. The key order, needed by the cache iterators, is kept
+ * incrementally by GetSortedView(): a sorted run of the entries, and a small sorted delta of the
+ * entries inserted since the run was built. The entries inserted since the last view are sorted and
+ * merged into the delta, and the delta is merged into the run once it outgrows 64 entries and the
+ * square root of the run, so no view costs a sort of the whole map. The removed entries stay in the
+ * view and are skipped by SortedCursor.
+ */
+template<typename KeyType, typename ValueType>
+class CDBCacheMap {
+public:
+    struct Entry {
+        KeyType first;
+        ValueType second;
+
+        Entry(const KeyType &keyIn, const ValueType &valueIn) : first(keyIn), second(valueIn) {}
+        Entry(const KeyType &keyIn, ValueType &&valueIn) : first(keyIn), second(std::move(valueIn)) {}
+    };
+
+    typedef std::vector<uint32_t> SortedIndex;
+
+    // entry indexes in key order: the run and the delta are both sorted and hold distinct keys, they are
+    // never changed once built, so a view stays valid while entries are inserted
+    struct SortedView {
+        std::shared_ptr<const SortedIndex> spRun;
+        std::shared_ptr<const SortedIndex> spDelta;
+    };
+
+    // walks the entries of a view in key order, merging its run and delta
+    class SortedCursor {
+    public:
+        SortedCursor() {}
+        // at the first entry
+        SortedCursor(const CDBCacheMap *pMapIn, const SortedView &viewIn) : pMap(pMapIn), view(viewIn) {
+            SkipRemoved();
+        }
+
+        // to the first entry whose key is not less than (upper: greater than) key
+        void Seek(const KeyType &key, bool upper = false) {
+            runPos   = pMap->LowerBound(*view.spRun, key, upper);
+            deltaPos = pMap->LowerBound(*view.spDelta, key, upper);
+            SkipRemoved();
+        }
+        void SeekFirst() {
+            runPos = deltaPos = 0;
+            SkipRemoved();
+        }
+
+        bool IsValid() const {
+            return view.spRun && (runPos < view.spRun->size() || deltaPos < view.spDelta->size());
+        }
+        uint32_t GetIndex() const { return IsRunFirst() ? (*view.spRun)[runPos] : (*view.spDelta)[deltaPos]; }
+        void Next() {
+            Step();
+            SkipRemoved();
+        }
+
+    private:
+        void Step() {
+            if (IsRunFirst())
+                runPos++;
+            else
+                deltaPos++;
+        }
+
+        // a removed key inserted again is in the view twice, only its live entry is visited
+        void SkipRemoved() {
+            while (IsValid() && pMap->IsRemoved(GetIndex()))
+                Step();
+        }
+
+        bool IsRunFirst() const {
+            if (deltaPos >= view.spDelta->size())
+                return true;
+            if (runPos >= view.spRun->size())
+                return false;
+            return pMap->GetEntry((*view.spRun)[runPos]).first < pMap->GetEntry((*view.spDelta)[deltaPos]).first;
+        }
+
+        const CDBCacheMap *pMap = nullptr;
+        SortedView view;
+        size_t runPos   = 0;
+        size_t deltaPos = 0;
+    };
+
+    class Iterator {
+    public:
+        Iterator() : pMap(nullptr), index(0) {}
+        Iterator(const CDBCacheMap *pMapIn, uint32_t indexIn) : pMap(pMapIn), index(indexIn) {}
+
+        Entry& operator*() const { return pMap->GetEntry(index); }
+        Entry* operator->() const { return &pMap->GetEntry(index); }
+        Iterator& operator++() { index = pMap->NextLive(index + 1); return *this; }
+        Iterator operator++(int) { Iterator ret = *this; ++*this; return ret; }
+        bool operator==(const Iterator &other) const { return index == other.index && pMap == other.pMap; }
+        bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+        uint32_t GetIndex() const { return index; }
+
+    private:
+        const CDBCacheMap *pMap;
+        uint32_t index;
+    };
+
+public:
+    CDBCacheMap() {}
+
+    CDBCacheMap(const CDBCacheMap &other) { operator=(other); }
+
+    CDBCacheMap& operator=(const CDBCacheMap &other) {
+        if (this == &other)
+            return *this;
+        clear();
+        Reserve(other.size());
+        for (auto it = other.begin(); it != other.end(); ++it)
+            Insert(it->first, it->second, other.hashes[it.GetIndex()]);
+        return *this;
+    }
+
+    CDBCacheMap(CDBCacheMap &&other) { Swap(other); }
+
+    CDBCacheMap& operator=(CDBCacheMap &&other) {
+        if (this != &other) {
+            clear();
+            Swap(other);
+        }
+        return *this;
+    }
+
+    ~CDBCacheMap() { clear(); }
+
+    Iterator begin() const { return Iterator(this, NextLive(0)); }
+    Iterator end() const { return Iterator(this, count); }
+    size_t size() const { return count - removedCount; }
+    bool empty() const { return size() == 0; }
+
+    // bound of the entry indexes, the removed entries included
+    uint32_t GetEntryCount() const { return count; }
+    uint32_t GetRemovedCount() const { return removedCount; }
+    bool IsRemoved(uint32_t index) const { return removed[index]; }
+
+    Iterator find(const KeyType &key) const {
+        if (count == 0)
+            return end();
+        uint64_t hash = CDBCacheMapHasher::Hash(key);
+        for (size_t pos = hash & slotMask; slots[pos] != 0; pos = (pos + 1) & slotMask) {
+            if (slots[pos] == REMOVED_SLOT)
+                continue;
+            uint32_t index = slots[pos] - 1;
+            if (hashes[index] == hash && IsEqual(GetEntry(index).first, key))
+                return Iterator(this, index);
+        }
+        return end();
+    }
+
+    // returns the entry of the key and whether it was inserted, an existing entry is left unchanged
+    template<typename V>
+    std::pair<Iterator, bool> emplace(const KeyType &key, V &&value) {
+        uint64_t hash = CDBCacheMapHasher::Hash(key);
+        if (count > 0) {
+            for (size_t pos = hash & slotMask; slots[pos] != 0; pos = (pos + 1) & slotMask) {
+                if (slots[pos] == REMOVED_SLOT)
+                    continue;
+                uint32_t index = slots[pos] - 1;
+                if (hashes[index] == hash && IsEqual(GetEntry(index).first, key))
+                    return std::make_pair(Iterator(this, index), false);
+            }
+        }
+        return std::make_pair(Insert(key, std::forward<V>(value), hash), true);
+    }
+
+    // removes the entry in place, the iterators and views on other entries stay valid
+    void erase(const Iterator &it) {
+        uint32_t index = it.GetIndex();
+        assert(index < count && !removed[index]);
+        size_t pos = hashes[index] & slotMask;
+        while (slots[pos] != index + 1)
+            pos = (pos + 1) & slotMask;
+        slots[pos]     = REMOVED_SLOT;
+        removed[index] = true;
+        GetEntry(index).second = ValueType();
+        removedCount++;
+    }
+
+    /**
+     * Moves the live entries into new storage in insertion order, which drops the removed entries and
+     * the tombstones. newIndexes maps each old entry index to its new one, or to UINT32_MAX if it was
+     * removed. The key order is kept, but the views taken before are no longer valid.
+     */
+    void Compact(std::vector<uint32_t> &newIndexes) {
+        CDBCacheMap compacted;
+        compacted.Reserve(size());
+        newIndexes.assign(count, UINT32_MAX);
+        for (auto it = begin(); it != end(); ++it) {
+            newIndexes[it.GetIndex()] =
+                compacted.Insert(it->first, std::move(it->second), hashes[it.GetIndex()]).GetIndex();
+        }
+        compacted.KeepSortedView(*this, newIndexes);
+        *this = std::move(compacted);
+    }
+
+    void clear() {
+        for (uint32_t i = 0; i < count; i++)
+            GetEntry(i).~Entry();
+        chunks.clear();
+        hashes.clear();
+        removed.clear();
+        slots.clear();
+        slotMask     = 0;
+        count        = 0;
+        removedCount = 0;
+        ResetSortedView();
+    }
+
+    Entry& GetEntry(uint32_t index) const {
+        return *reinterpret_cast<Entry *>(&chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]);
+    }
+
+    // the entries in key order, see SortedView
+    SortedView GetSortedView() const {
+        if (!sortedView.spRun || sortedCount < count) {
+            SortedIndex added(count - sortedCount);
+            for (uint32_t i = sortedCount; i < count; i++)
+                added[i - sortedCount] = i;
+            SortByKey(added);
+
+            auto spDelta = std::make_shared<SortedIndex>();
+            if (sortedView.spDelta)
+                MergeByKey(*sortedView.spDelta, added, *spDelta);
+            else
+                spDelta->swap(added);
+
+            if (!sortedView.spRun)
+                sortedView.spRun = std::make_shared<SortedIndex>();
+            if (spDelta->size() > 64 && spDelta->size() * spDelta->size() > sortedView.spRun->size()) {
+                auto spRun = std::make_shared<SortedIndex>();
+                MergeByKey(*sortedView.spRun, *spDelta, *spRun);
+                sortedView.spRun = spRun;
+                spDelta = std::make_shared<SortedIndex>();
+            }
+            sortedView.spDelta = spDelta;
+            sortedCount        = count;
+        }
+        return sortedView;
+    }
+
+    /**
+     * Takes over the key order of the map the entries were copied from, in linear time instead of sorting
+     * them again. newIndexes maps each entry index of from to its index in this map, or to UINT32_MAX if
+     * it was not copied, and this map must hold exactly the copied entries.
+     */
+    void KeepSortedView(const CDBCacheMap &from, const std::vector<uint32_t> &newIndexes) {
+        SortedView fromView = from.GetSortedView();
+        auto spRun = std::make_shared<SortedIndex>();
+        spRun->reserve(count);
+        for (SortedCursor cursor(&from, fromView); cursor.IsValid(); cursor.Next()) {
+            uint32_t newIndex = newIndexes[cursor.GetIndex()];
+            if (newIndex != UINT32_MAX)
+                spRun->push_back(newIndex);
+        }
+        assert(spRun->size() == size());
+        sortedView.spRun   = spRun;
+        sortedView.spDelta = std::make_shared<SortedIndex>();
+        sortedCount        = count;
+    }
+
+    // position of the first entry of the sorted index whose key is not less than (upper: greater than) key
+    size_t LowerBound(const SortedIndex &sortedIndex, const KeyType &key, bool upper = false) const {
+        if (upper) {
+            return std::upper_bound(sortedIndex.begin(), sortedIndex.end(), key,
+                                    [this](const KeyType &k, uint32_t i) { return k < GetEntry(i).first; }) -
+                   sortedIndex.begin();
+        }
+        return std::lower_bound(sortedIndex.begin(), sortedIndex.end(), key,
+                                [this](uint32_t i, const KeyType &k) { return GetEntry(i).first < k; }) -
+               sortedIndex.begin();
+    }
+
+private:
+    enum { CHUNK_SIZE = 64 };
+    static const uint32_t REMOVED_SLOT = UINT32_MAX;    // tombstone of a removed entry in slots
+    typedef typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type EntryStorage;
+
+    // equivalence of std::map, the key types only define operator<
+    static bool IsEqual(const KeyType &a, const KeyType &b) { return !(a < b) && !(b < a); }
+
+    template<typename V>
+    Iterator Insert(const KeyType &key, V &&value, uint64_t hash) {
+        if (count == UINT32_MAX - 1)
+            throw std::runtime_error("CDBCacheMap::Insert(), too many entries");
+
+        if ((count + 1) * 2 > slots.size())
+            Rehash(std::max<size_t>(16, slots.size() * 2));
+
+        if (count % CHUNK_SIZE == 0)
+            chunks.emplace_back(new EntryStorage[CHUNK_SIZE]);
+        new (&chunks[count / CHUNK_SIZE][count % CHUNK_SIZE]) Entry(key, std::forward<V>(value));
+        hashes.push_back(hash);
+        removed.push_back(false);
+
+        size_t pos = hash & slotMask;
+        while (slots[pos] != 0)
+            pos = (pos + 1) & slotMask;
+        slots[pos] = count + 1;
+
+        return Iterator(this, count++);
+    }
+
+    void Swap(CDBCacheMap &other) {
+        chunks.swap(other.chunks);
+        hashes.swap(other.hashes);
+        removed.swap(other.removed);
+        slots.swap(other.slots);
+        std::swap(slotMask, other.slotMask);
+        std::swap(count, other.count);
+        std::swap(removedCount, other.removedCount);
+        std::swap(sortedView, other.sortedView);
+        std::swap(sortedCount, other.sortedCount);
+    }
+
+    uint32_t NextLive(uint32_t index) const {
+        while (index < count && removed[index])
+            index++;
+        return index;
+    }
+
+    void ResetSortedView() {
+        sortedView  = SortedView();
+        sortedCount = 0;
+    }
+
+    void SortByKey(SortedIndex &sortedIndex) const {
+        std::sort(sortedIndex.begin(), sortedIndex.end(),
+                  [this](uint32_t a, uint32_t b) { return GetEntry(a).first < GetEntry(b).first; });
+    }
+
+    void MergeByKey(const SortedIndex &a, const SortedIndex &b, SortedIndex &out) const {
+        out.resize(a.size() + b.size());
+        std::merge(a.begin(), a.end(), b.begin(), b.end(), out.begin(),
+                   [this](uint32_t x, uint32_t y) { return GetEntry(x).first < GetEntry(y).first; });
+    }
+
+    void Rehash(size_t slotCount) {
+        slots.assign(slotCount, 0);
+        slotMask = slotCount - 1;
+        for (uint32_t i = 0; i < count; i++) {
+            if (removed[i])
+                continue;
+            size_t pos = hashes[i] & slotMask;
+            while (slots[pos] != 0)
+                pos = (pos + 1) & slotMask;
+            slots[pos] = i + 1;
+        }
+    }
+
+    void Reserve(size_t entryCount) {
+        size_t slotCount = 16;
+        while (slotCount < entryCount * 2)
+            slotCount *= 2;
+        if (slotCount > slots.size())
+            Rehash(slotCount);
+        hashes.reserve(entryCount);
+    }
+
+private:
+    std::vector<std::unique_ptr<EntryStorage[]>> chunks;    // entries in insertion order
+    std::vector<uint64_t> hashes;                           // hash of the key of each entry
+    std::vector<bool> removed;                              // whether each entry was erased
+    std::vector<uint32_t> slots;                            // entry index + 1, 0 if empty, see REMOVED_SLOT
+    size_t slotMask       = 0;
+    uint32_t count        = 0;                              // entries, the removed ones included
+    uint32_t removedCount = 0;
+    mutable SortedView sortedView;      // key order of the entries before sortedCount
+    mutable uint32_t sortedCount = 0;
+};
+
+#endif  // PERSIST_DBCACHEMAP_H
@@ -97,6 +97,7 @@ namespace dbk {
         DEFINE( KEYID_ACCOUNT,        "idac",   ACCOUNT )       /* idac{$KeyID} --> $CAccount */ \
         /**** contract db                                                                      */ \
         DEFINE( CONTRACT_DEF,         "ucon",   CONTRACT )      /* ucon{$ContractRegId} --> $CUniversalContractStore */ \
+        DEFINE( CONTRACT_META,        "ucmt",   CONTRACT )      /* ucmt{$ContractRegId} --> $CUniversalContractMeta */ \
         DEFINE( CONTRACT_DATA,        "cdat",   CONTRACT )      /* cdat{$RegId}{$DataKey} --> $Data */ \
         DEFINE( CONTRACT_ACCOUNT,     "cacc",   CONTRACT )      /* cacc{$ContractRegId}{$AccUserId} --> appUserAccount */ \
         DEFINE( CONTRACT_TRACES,      "ctrs",   CONTRACT )      /* [prefix]{$txid} --> contract_traces */ \
@@ -124,6 +125,8 @@ namespace dbk {
         DEFINE( DEX_OPERATOR_OWNER_MAP, "doom",     DEX )        /* [prefix]{owner_name} --> dex_operator_id */ \
         DEFINE( DEX_OPERATOR_TRADE_PAIR, "dotp",    DEX )              \
         DEFINE( DEX_QUOTE_COIN_SYMBOL, "dqcs",      DEX)                    \
+        DEFINE( DEX_ORDER_BOOK,       "dobk",       DEX )        /* [prefix]{asset, coin, side}{price_key}{cord}{txid} --> active order */ \
+        DEFINE( DEX_ORDER_BOOK_LEVEL, "dobl",       DEX )        /* [prefix]{asset, coin, side}{price_key} --> price level */ \
         /**** log db                                                                    */ \
         DEFINE( TX_EXECUTE_FAIL,      "txef",       LOG )        /* [prefix]{height}{txid} --> {error code, error message} */ \
         /**** tx receipt db                                                                 */ \
@@ -192,14 +195,23 @@ namespace dbk {
         return EMPTY;
     };
 
+    // the keys of the hot lookups (prefix + regid/keyid/txid) fit the inline buffer
+    static const size_t DB_KEY_INLINE_SIZE = 128;
+    typedef CInlineDataStream<DB_KEY_INLINE_SIZE> CDBKeyStream;
+
     template<typename KeyElement>
-    std::string GenDbKey(PrefixType keyPrefixType, const KeyElement &keyElement) {
-        CDataStream ssKeyTemp(SER_DISK, CLIENT_VERSION);
+    void GenDbKey(PrefixType keyPrefixType, const KeyElement &keyElement, CDBKeyStream &ssKey) {
         assert(keyPrefixType != EMPTY);
         const string &prefix = GetKeyPrefix(keyPrefixType);
-        ssKeyTemp.write(prefix.c_str(), prefix.size()); // write buffer only, exclude size prefix
-        ssKeyTemp << keyElement;
-        return std::string(ssKeyTemp.begin(), ssKeyTemp.end());
+        ssKey.write(prefix.c_str(), prefix.size()); // write buffer only, exclude size prefix
+        ssKey << keyElement;
+    }
+
+    template<typename KeyElement>
+    std::string GenDbKey(PrefixType keyPrefixType, const KeyElement &keyElement) {
+        CDBKeyStream ssKey(SER_DISK, CLIENT_VERSION);
+        GenDbKey(keyPrefixType, keyElement, ssKey);
+        return ssKey.str();
     }
 
     template<typename KeyElement>
@@ -210,7 +222,7 @@ namespace dbk {
             return false;
         }
 
-        CDataStream ssKeyTemp(slice.data(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
+        CDataSpanStream ssKeyTemp(slice.data(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
         ssKeyTemp.ignore(prefix.size());
         ssKeyTemp >> keyElement;
 
@@ -249,11 +261,13 @@ namespace dbk {
             return key.size();
         }
 
-        void Serialize(CDataStream &s, int nType, int nVersion) const {
+        template<typename Stream>
+        void Serialize(Stream &s, int nType, int nVersion) const {
             s.write(key.data(), key.size());
         }
 
-        void Unserialize(CDataStream &s, int nType, int nVersion) {
+        template<typename Stream>
+        void Unserialize(Stream &s, int nType, int nVersion) {
             if (s.size() > MAX_KEY_SIZE) {
                 throw ios_base::failure("CDBTailKey::Unserialize size excceded max size");
             }
@@ -108,7 +108,7 @@ private:
         }
 
         try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CDataSpanStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> *this->sp_value;
         } catch(std::exception &e) {
             throw runtime_error(strprintf("CDBAccessIterator::ProcessData db value error! %s", HexStr(slValue.ToString())));
@@ -126,41 +126,52 @@ public:
     typedef typename CacheType::KeyType KeyType;
     typedef typename CacheType::ValueType ValueType;
 private:
-    typename CacheType::Iterator map_it;
+    typedef typename CacheType::Map::SortedCursor SortedCursor;
+    // the entries of the map in key order when the iteration started, the entries added since are not visited
+    SortedCursor cursor;
 public:
-    CCacheMapIterator(CacheType &dbCache) : Base(dbCache), map_it(dbCache.GetMapData().end()) {}
+    CCacheMapIterator(CacheType &dbCache) : Base(dbCache) {}
 
     virtual bool First() {
-        map_it = this->db_cache.GetMapData().begin();
+        ResetCursor();
+        cursor.SeekFirst();
         return ProcessData();
     }
 
     bool Seek(const KeyType *pKey) {
         if (pKey == nullptr || db_util::IsEmpty(*pKey))
             return First();
-        map_it = this->db_cache.GetMapData().lower_bound(*pKey);
+        ResetCursor();
+        cursor.Seek(*pKey);
         return ProcessData();
     }
 
     bool SeekUpper(const KeyType *pKey) {
         if (pKey == nullptr || db_util::IsEmpty(*pKey))
             return First();
-        map_it = this->db_cache.GetMapData().upper_bound(*pKey);
+        ResetCursor();
+        cursor.Seek(*pKey, true);
         return ProcessData();
     }
 
     bool Next() {
         assert(this->IsValid());
-        map_it++;
+        cursor.Next();
         return ProcessData();
     }
 
 private:
+    inline void ResetCursor() {
+        const auto &mapData = this->db_cache.GetMapData();
+        cursor = SortedCursor(&mapData, mapData.GetSortedView());
+    }
+
     inline bool ProcessData() {
         this->is_valid = false;
-        if (map_it == this->db_cache.GetMapData().end())  return false;
-        *this->sp_key = map_it->first;
-        *this->sp_value = *map_it->second;
+        if (!cursor.IsValid())  return false;
+        const auto &entry = this->db_cache.GetMapData().GetEntry(cursor.GetIndex());
+        *this->sp_key = entry.first;
+        *this->sp_value = entry.second;
         this->is_valid = true;
         return true;
     }
@@ -33,16 +33,17 @@ void DEX_DB::BlockOrdersToJson(const BlockOrders &orders, Object &obj) {
     obj.push_back(Pair("orders", array));
 }
 
-shared_ptr<string> DEX_DB::ParseLastPos(const string &lastPosInfo, DEXBlockOrdersCache::KeyType &lastKey) {
+shared_ptr<string> DEX_DB::ParseLastPos(const CBlockIndex *pTipIndex, const string &lastPosInfo,
+                                        DEXBlockOrdersCache::KeyType &lastKey) {
 
     CDataStream ds(lastPosInfo, SER_DISK, CLIENT_VERSION);
     uint256 lastBlockHash;
     ds >> lastBlockHash >> lastKey;
     uint32_t lastHeight = DEX_DB::GetHeight(lastKey);
-    CBlockIndex *pBlockIndex = chainActive[lastHeight];
+    const CBlockIndex *pBlockIndex = pTipIndex->GetAncestor(lastHeight);
     if (pBlockIndex == nullptr)
         return make_shared<string>(strprintf("The last_pos_info is not contained in active chains,"
-            " last_height=%d, tip_height=%d", lastHeight, chainActive.Height()));
+            " last_height=%d, tip_height=%d", lastHeight, pTipIndex->height));
     if (pBlockIndex->GetBlockHash() != lastBlockHash)
         return make_shared<string>(strprintf("The block of height in last_pos_info does not match with the active block,"
             " height=%d, last_block_hash=%s, cur_height_block_hash=%s",
@@ -50,12 +51,13 @@ shared_ptr<string> DEX_DB::ParseLastPos(const string &lastPosInfo, DEXBlockOrder
     return nullptr;
 }
 
-shared_ptr<string> DEX_DB::MakeLastPos(const DEXBlockOrdersCache::KeyType &lastKey, string &lastPosInfo) {
+shared_ptr<string> DEX_DB::MakeLastPos(const CBlockIndex *pTipIndex, const DEXBlockOrdersCache::KeyType &lastKey,
+                                       string &lastPosInfo) {
     uint32_t lastHeight = DEX_DB::GetHeight(lastKey);
-    CBlockIndex *pBlockIndex = chainActive[lastHeight];
+    const CBlockIndex *pBlockIndex = pTipIndex->GetAncestor(lastHeight);
     if (pBlockIndex == nullptr)
         return make_shared<string>(strprintf("The block of lastKey is not contained in active chains,"
-            " last_height=%d, tip_height=%d", lastHeight, chainActive.Height()));
+            " last_height=%d, tip_height=%d", lastHeight, pTipIndex->height));
 
     CDataStream ds(SER_DISK, CLIENT_VERSION);
     ds << pBlockIndex->GetBlockHash() << lastKey;
@@ -78,20 +80,115 @@ bool CDexDBCache::CreateActiveOrder(const uint256 &orderId, const CDEXOrderDetai
                         activeOrder.ToString());
     }
 
+    if (IsOrderBookIndexEnabled() && !AddOrderBookIndex(orderId, activeOrder))
+        return false;
+
     return activeOrderCache.SetData(orderId, activeOrder)
         && blockOrdersCache.SetData(MakeBlockOrderKey(orderId, activeOrder), activeOrder);
 }
 
 bool CDexDBCache::UpdateActiveOrder(const uint256 &orderId, const CDEXOrderDetail &activeOrder) {
+    if (IsOrderBookIndexEnabled()) {
+        CDEXOrderDetail oldOrder;
+        if (!activeOrderCache.GetData(orderId, oldOrder))
+            return ERRORMSG("UpdateActiveOrder, the order is not existed! order_id=%s\n", orderId.GetHex());
+
+        if (!EraseOrderBookIndex(orderId, oldOrder) || !AddOrderBookIndex(orderId, activeOrder))
+            return false;
+    }
+
     return activeOrderCache.SetData(orderId, activeOrder)
         && blockOrdersCache.SetData(MakeBlockOrderKey(orderId, activeOrder), activeOrder);
 }
 
 bool CDexDBCache::EraseActiveOrder(const uint256 &orderId, const CDEXOrderDetail &activeOrder) {
+    if (IsOrderBookIndexEnabled()) {
+        // the caller may pass the order with the final deal amounts, the index must remove the stored amounts
+        CDEXOrderDetail oldOrder;
+        if (!activeOrderCache.GetData(orderId, oldOrder))
+            return ERRORMSG("EraseActiveOrder, the order is not existed! order_id=%s\n", orderId.GetHex());
+
+        if (!EraseOrderBookIndex(orderId, oldOrder))
+            return false;
+    }
+
     return activeOrderCache.EraseData(orderId)
         && blockOrdersCache.EraseData(MakeBlockOrderKey(orderId, activeOrder));
 }
 
+bool CDexDBCache::IsOrderBookIndexEnabled() {
+    return SysCfg().IsDexOrderBookIndex();
+}
+
+bool CDexDBCache::GetOrderBookLevels(const CDEXOrderBookSide &side, uint32_t maxLevels,
+                                     vector<pair<uint64_t, CDEXPriceLevel>> &levels) {
+    if (!IsOrderBookIndexEnabled())
+        return false;
+
+    auto dbIt = MakeDbPrefixIterator(order_book_level_cache, side);
+    for (dbIt->First(); dbIt->IsValid() && levels.size() < maxLevels; dbIt->Next()) {
+        levels.emplace_back(DEX_DB::GetBookPrice(side, dbIt->GetKey().second), dbIt->GetValue());
+    }
+    return true;
+}
+
+// only limit price orders rest on the order book
+static inline bool IsOrderBookOrder(const CDEXOrderDetail &order) {
+    return order.order_type == ORDER_LIMIT_PRICE &&
+           (order.order_side == ORDER_BUY || order.order_side == ORDER_SELL);
+}
+
+static inline uint64_t GetRemainAmount(uint64_t amount, uint64_t dealAmount) {
+    return amount > dealAmount ? amount - dealAmount : 0;
+}
+
+bool CDexDBCache::AddOrderBookIndex(const uint256 &orderId, const CDEXOrderDetail &activeOrder) {
+    if (!IsOrderBookOrder(activeOrder))
+        return true;
+
+    CDEXOrderBookSide side(activeOrder.asset_symbol, activeOrder.coin_symbol, activeOrder.order_side);
+    CFixedUInt64 priceKey(DEX_DB::MakeBookPriceKey(activeOrder.order_side, activeOrder.price));
+    DEXOrderBookLevelCache::KeyType levelKey(side, priceKey);
+
+    CDEXPriceLevel level;
+    order_book_level_cache.GetData(levelKey, level);
+    level.asset_amount += GetRemainAmount(activeOrder.asset_amount, activeOrder.total_deal_asset_amount);
+    level.coin_amount  += GetRemainAmount(activeOrder.coin_amount, activeOrder.total_deal_coin_amount);
+    level.order_count++;
+
+    return order_book_cache.SetData(make_tuple(side, priceKey, CFixedUInt64(activeOrder.tx_cord.GetIntValue()), orderId),
+                                    activeOrder)
+        && order_book_level_cache.SetData(levelKey, level);
+}
+
+bool CDexDBCache::EraseOrderBookIndex(const uint256 &orderId, const CDEXOrderDetail &activeOrder) {
+    if (!IsOrderBookOrder(activeOrder))
+        return true;
+
+    CDEXOrderBookSide side(activeOrder.asset_symbol, activeOrder.coin_symbol, activeOrder.order_side);
+    CFixedUInt64 priceKey(DEX_DB::MakeBookPriceKey(activeOrder.order_side, activeOrder.price));
+    DEXOrderBookLevelCache::KeyType levelKey(side, priceKey);
+
+    CDEXPriceLevel level;
+    if (!order_book_level_cache.GetData(levelKey, level))
+        return ERRORMSG("EraseOrderBookIndex, the price level is not existed! order_id=%s, order=%s\n",
+                        orderId.GetHex(), activeOrder.ToString());
+
+    level.asset_amount -= std::min(level.asset_amount,
+        GetRemainAmount(activeOrder.asset_amount, activeOrder.total_deal_asset_amount));
+    level.coin_amount  -= std::min(level.coin_amount,
+        GetRemainAmount(activeOrder.coin_amount, activeOrder.total_deal_coin_amount));
+    level.order_count--;
+
+    if (!order_book_cache.EraseData(make_tuple(side, priceKey, CFixedUInt64(activeOrder.tx_cord.GetIntValue()), orderId)))
+        return false;
+
+    if (level.order_count == 0)
+        return order_book_level_cache.EraseData(levelKey);
+
+    return order_book_level_cache.SetData(levelKey, level);
+}
+
 bool CDexDBCache::IncDexID(DexID &id) {
     decltype(operator_last_id_cache)::ValueType idVariant;
     operator_last_id_cache.GetData(idVariant);
@@ -17,6 +17,8 @@
 #include "entities/dexorder.h"
 #include <optional>
 
+class CBlockIndex;
+
 using namespace std;
 
 /*       type               prefixType                   key                            value                type             */
@@ -24,6 +26,14 @@ using namespace std;
     /////////// DexDB
     // block orders: height generate_type txid -> active order
 typedef CCompositeKVCache<dbk::DEX_BLOCK_ORDERS,  tuple<CFixedUInt32, uint8_t, uint256>, dex::CDEXOrderDetail>     DEXBlockOrdersCache;
+    // order book: {asset, coin, side}{price_key}{cord}{txid} -> active order
+    // price_key: price for asks and (UINT64_MAX - price) for bids, so both sides are sorted from best price;
+    // cord: int value of the tx cord, orders of the same price are sorted by time
+typedef CCompositeKVCache<dbk::DEX_ORDER_BOOK, tuple<dex::CDEXOrderBookSide, CFixedUInt64, CFixedUInt64, uint256>,
+                          dex::CDEXOrderDetail>     DEXOrderBookCache;
+    // order book level: {asset, coin, side}{price_key} -> aggregated amounts of the price level
+typedef CCompositeKVCache<dbk::DEX_ORDER_BOOK_LEVEL, pair<dex::CDEXOrderBookSide, CFixedUInt64>,
+                          dex::CDEXPriceLevel>      DEXOrderBookLevelCache;
 
 // DEX_DB
 namespace DEX_DB {
@@ -43,14 +53,25 @@ namespace DEX_DB {
         return std::get<2>(key);
     }
 
-    // return err str if err happens
-    shared_ptr<string> ParseLastPos(const string &lastPosInfo, DEXBlockOrdersCache::KeyType &lastKey);
+    // return err str if err happens, the blocks are resolved on the chain of pTipIndex
+    shared_ptr<string> ParseLastPos(const CBlockIndex *pTipIndex, const string &lastPosInfo,
+                                    DEXBlockOrdersCache::KeyType &lastKey);
 
-    shared_ptr<string> MakeLastPos(const DEXBlockOrdersCache::KeyType &lastKey, string &lastPosInfo);
+    shared_ptr<string> MakeLastPos(const CBlockIndex *pTipIndex, const DEXBlockOrdersCache::KeyType &lastKey,
+                                   string &lastPosInfo);
 
     void OrderToJson(const uint256 &orderId, const dex::CDEXOrderDetail &order, Object &obj);
 
     void BlockOrdersToJson(const BlockOrders &orderList, Object &obj);
+
+    // price <-> price_key of order book index
+    inline uint64_t MakeBookPriceKey(dex::OrderSide side, uint64_t price) {
+        return side == dex::ORDER_BUY ? UINT64_MAX - price : price;
+    }
+
+    inline uint64_t GetBookPrice(const dex::CDEXOrderBookSide &side, const CFixedUInt64 &priceKey) {
+        return side.order_side == dex::ORDER_BUY ? UINT64_MAX - priceKey.value : priceKey.value;
+    }
 };
 
 class CDexDBCache {
@@ -61,7 +82,9 @@ public:
           blockOrdersCache(pDbAccess),
           operator_detail_cache(pDbAccess),
           operator_owner_map_cache(pDbAccess),
-          operator_last_id_cache(pDbAccess) {};
+          operator_last_id_cache(pDbAccess),
+          order_book_cache(pDbAccess),
+          order_book_level_cache(pDbAccess) {};
 
 
 public:
@@ -71,6 +94,12 @@ public:
     bool UpdateActiveOrder(const uint256 &orderTxId, const dex::CDEXOrderDetail& activeOrder);
     bool EraseActiveOrder(const uint256 &orderTxId, const dex::CDEXOrderDetail &activeOrder);
 
+    // the order book index is only maintained when -dexorderbookindex is enabled
+    static bool IsOrderBookIndexEnabled();
+    // get price levels of one side of the order book from the best price, at most maxLevels
+    bool GetOrderBookLevels(const dex::CDEXOrderBookSide &side, uint32_t maxLevels,
+                            vector<pair<uint64_t, dex::CDEXPriceLevel>> &levels);
+
     bool IncDexID(DexID &id);
     bool GetDexOperator(const DexID &id, DexOperatorDetail& detail);
     bool GetDexOperatorByOwner(const CRegID &regid, DexID &id, DexOperatorDetail& detail);
@@ -86,6 +115,8 @@ public:
         operator_detail_cache.Flush(),
         operator_owner_map_cache.Flush();
         operator_last_id_cache.Flush();
+        order_book_cache.Flush();
+        order_book_level_cache.Flush();
         return true;
     }
 
@@ -94,7 +125,9 @@ public:
             blockOrdersCache.GetCacheSize() +
             operator_detail_cache.GetCacheSize() +
             operator_owner_map_cache.GetCacheSize() +
-            operator_last_id_cache.GetCacheSize();
+            operator_last_id_cache.GetCacheSize() +
+            order_book_cache.GetCacheSize() +
+            order_book_level_cache.GetCacheSize();
     }
     void SetBaseViewPtr(CDexDBCache *pBaseIn) {
         activeOrderCache.SetBase(&pBaseIn->activeOrderCache);
@@ -102,6 +135,8 @@ public:
         operator_detail_cache.SetBase(&pBaseIn->operator_detail_cache);
         operator_owner_map_cache.SetBase(&pBaseIn->operator_owner_map_cache);
         operator_last_id_cache.SetBase(&pBaseIn->operator_last_id_cache);
+        order_book_cache.SetBase(&pBaseIn->order_book_cache);
+        order_book_level_cache.SetBase(&pBaseIn->order_book_level_cache);
     };
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
@@ -110,6 +145,8 @@ public:
         operator_detail_cache.SetDbOpLogMap(pDbOpLogMapIn);
         operator_owner_map_cache.SetDbOpLogMap(pDbOpLogMapIn);
         operator_last_id_cache.SetDbOpLogMap(pDbOpLogMapIn);
+        order_book_cache.SetDbOpLogMap(pDbOpLogMapIn);
+        order_book_level_cache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
     void RegisterUndoFunc(UndoDataFuncMap &undoDataFuncMap) {
@@ -118,12 +155,17 @@ public:
         operator_detail_cache.RegisterUndoFunc(undoDataFuncMap);
         operator_owner_map_cache.RegisterUndoFunc(undoDataFuncMap);
         operator_last_id_cache.RegisterUndoFunc(undoDataFuncMap);
+        order_book_cache.RegisterUndoFunc(undoDataFuncMap);
+        order_book_level_cache.RegisterUndoFunc(undoDataFuncMap);
     }
 
 private:
     DEXBlockOrdersCache::KeyType MakeBlockOrderKey(const uint256 &orderid, const dex::CDEXOrderDetail &activeOrder) {
         return make_tuple(CFixedUInt32(activeOrder.tx_cord.GetHeight()), (uint8_t)activeOrder.generate_type, orderid);
     }
+
+    bool AddOrderBookIndex(const uint256 &orderId, const dex::CDEXOrderDetail &activeOrder);
+    bool EraseOrderBookIndex(const uint256 &orderId, const dex::CDEXOrderDetail &activeOrder);
 public:
 /*       type               prefixType                      key                        value                variable             */
 /*  ----------------   -----------------------------  ---------------------------  ------------------   ------------------------ */
@@ -134,6 +176,9 @@ public:
     CCompositeKVCache< dbk::DEX_OPERATOR_DETAIL,       std::optional<CVarIntValue<DexID>> , DexOperatorDetail >   operator_detail_cache;
     CCompositeKVCache< dbk::DEX_OPERATOR_OWNER_MAP,    CRegIDKey,               std::optional<CVarIntValue<DexID>>> operator_owner_map_cache;
     CSimpleKVCache<dbk::DEX_OPERATOR_LAST_ID, CVarIntValue<DexID>> operator_last_id_cache;
+    // order book index of active limit orders, only used when -dexorderbookindex is enabled
+    DEXOrderBookCache           order_book_cache;
+    DEXOrderBookLevelCache      order_book_level_cache;
 
 };
 
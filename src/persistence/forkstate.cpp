@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "forkstate.h"
+#include "main.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// class CForkStateManager
+
+void CForkStateManager::PushTip(CBlockIndex *pIndex, const std::shared_ptr<CBlock> &spBlock, CBlockUndo &blockUndo) {
+    // the views of blocks too far below the new tip can not be forked from any more
+    for (auto it = fork_views.begin(); it != fork_views.end();) {
+        auto blockIt = mapBlockIndex.find(it->first);
+        if (blockIt == mapBlockIndex.end() ||
+            pIndex->height - blockIt->second->height > SysCfg().GetMaxForkHeight(pIndex->height))
+            it = fork_views.erase(it);
+        else
+            ++it;
+    }
+
+    // the values replaced by the block are its undo data
+    RebaseForkViews([&](CCacheWrapper &cw) {
+        CValidationState state;
+        return DisconnectBlock(*spBlock, blockUndo, cw, pIndex, state);
+    });
+
+    if (max_blocks == 0)
+        return;
+
+    // the overlays must be a contiguous segment ending at the active tip
+    if (!overlays.empty() && (pIndex->pprev == nullptr || overlays.back().block_hash != pIndex->pprev->GetBlockHash()))
+        overlays.clear();
+
+    overlays.push_back(CBlockOverlay());
+    CBlockOverlay &overlay = overlays.back();
+    overlay.block_hash     = pIndex->GetBlockHash();
+    overlay.sp_block       = spBlock;
+    std::swap(overlay.block_undo, blockUndo);
+
+    while (overlays.size() > max_blocks)
+        overlays.pop_front();
+}
+
+void CForkStateManager::PopTip(CBlockIndex *pIndex, CBlock &block, const CDBOpLogMap &redoOpLogMap) {
+    // the values replaced by the disconnect redo the block, except in the memory caches
+    RebaseForkViews([&](CCacheWrapper &cw) {
+        const UndoDataFuncMap &undoDataFuncMap = cw.GetUndoDataFuncMap();
+        for (const auto &opLogPair : redoOpLogMap.GetMap()) {
+            const auto &undoDataFunc = undoDataFuncMap[opLogPair.first];
+            if (!undoDataFunc)
+                return ERRORMSG("%s(), unfound prefix in db! prefix_type=%s", __func__,
+                                dbk::GetKeyPrefix(opLogPair.first));
+            undoDataFunc(opLogPair.second);
+        }
+        cw.blockCache.SetBestBlock(pIndex->GetBlockHash());
+
+        CValidationState state;
+        return PushBlockToMemCaches(block, cw, pIndex, state);
+    });
+
+    if (overlays.empty())
+        return;
+
+    if (overlays.back().block_hash == pIndex->GetBlockHash())
+        overlays.pop_back();
+    else
+        overlays.clear();
+}
+
+bool CForkStateManager::MaterializeView(CBlockIndex *pForkIndex, std::shared_ptr<CCacheWrapper> &spCW,
+                                        CValidationState &state) {
+    spCW = NewBaseLayer();
+
+    uint32_t memoryCount = 0, diskCount = 0;
+    auto overlayIt       = overlays.rbegin();
+    for (CBlockIndex *pIndex = chainActive.Tip(); pIndex != pForkIndex; pIndex = pIndex->pprev) {
+        if (pIndex == nullptr)
+            return ERRORMSG("%s(), fork point is not an ancestor of the active tip", __func__);
+
+        bool fClean = true;
+        if (overlayIt != overlays.rend() && overlayIt->block_hash == pIndex->GetBlockHash()) {
+            if (!DisconnectBlock(*overlayIt->sp_block, overlayIt->block_undo, *spCW, pIndex, state, &fClean))
+                return ERRORMSG("%s(), failed to disconnect block [%d]: %s", __func__, pIndex->height,
+                                pIndex->GetBlockHash().ToString());
+
+            ++overlayIt;
+            ++memoryCount;
+        } else {
+            // not covered by the overlays, fall back to the block and undo data on disk
+            overlayIt = overlays.rend();
+
+            CBlock block;
+            if (!ReadBlockFromDisk(pIndex, block))
+                return state.Abort(_("Failed to read block"));
+
+            if (!DisconnectBlock(block, *spCW, pIndex, state, &fClean))
+                return ERRORMSG("%s(), failed to disconnect block [%d]: %s", __func__, pIndex->height,
+                                pIndex->GetBlockHash().ToString());
+
+            ++diskCount;
+        }
+    }
+
+    LogPrint(BCLog::INFO, "%s(), [%d] %s materialized, blocks undone from memory: %u, from disk: %u\n", __func__,
+             pForkIndex->height, pForkIndex->GetBlockHash().GetHex(), memoryCount, diskCount);
+    return true;
+}
+
+std::shared_ptr<CCacheWrapper> CForkStateManager::GetForkView(const uint256 &blockHash) const {
+    auto it = fork_views.find(blockHash);
+    if (it == fork_views.end())
+        return nullptr;
+
+    return it->second;
+}
+
+void CForkStateManager::SetForkView(const uint256 &blockHash, const std::shared_ptr<CCacheWrapper> &spCW) {
+    fork_views[blockHash] = spCW;
+}
+
+void CForkStateManager::RebaseForkViews(const PinFunc &pinFunc) {
+    for (auto it = fork_views.begin(); it != fork_views.end();) {
+        auto spBaseCW = NewBaseLayer();
+        if (!pinFunc(*spBaseCW)) {
+            LogPrint(BCLog::INFO, "%s(), drop the fork view of block %s, failed to pin the tip change\n", __func__,
+                     it->first.GetHex());
+            it = fork_views.erase(it);
+            continue;
+        }
+
+        // the view data is moved onto the new layer, which becomes the view
+        it->second->SetBaseViewPtr(spBaseCW.get());
+        it->second->Flush();
+        it->second = spBaseCW;
+        ++it;
+    }
+}
+
+void CForkStateManager::Clear() {
+    overlays.clear();
+    fork_views.clear();
+}
+
+std::shared_ptr<CCacheWrapper> CForkStateManager::NewBaseLayer() const {
+    if (p_base_cw != nullptr)
+        return std::make_shared<CCacheWrapper>(p_base_cw);
+
+    return std::make_shared<CCacheWrapper>(pCdMan);
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_FORK_STATE_H
+#define PERSIST_FORK_STATE_H
+
+#include "blockundo.h"
+#include "block.h"
+#include "commons/uint256.h"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+
+class CBlockIndex;
+class CValidationState;
+
+static const int64_t DEFAULT_FORK_STATE_BLOCKS = 200;
+
+/**
+ * Reverse delta overlays (block + undo data) of the latest blocks connected to the active chain.
+ * The chain state at any fork point covered by the overlays is materialized as a view layered
+ * over the global caches in O(changes), without reading the tip blocks and undo data from disk.
+ *
+ * The views of fork chains are layered over the global caches too, so they stay valid across
+ * chain state flushes. When the active tip changes, each view is rebased onto a new layer that
+ * holds the values replaced by the change, so the views are kept by block hash across tip changes
+ * until their blocks are too far below the tip to be forked from.
+ * All methods must be called with cs_main held.
+ */
+class CForkStateManager {
+public:
+    // fills a new layer over the global caches with the values replaced by a tip change
+    typedef std::function<bool(CCacheWrapper &cw)> PinFunc;
+
+    CForkStateManager() : max_blocks(DEFAULT_FORK_STATE_BLOCKS), p_base_cw(nullptr) {}
+
+    void SetMaxBlocks(uint32_t maxBlocks) { max_blocks = maxBlocks; }
+    // the views are layered over pBaseCW instead of the global caches, for tests
+    void SetBaseView(CCacheWrapper *pBaseCW) { p_base_cw = pBaseCW; }
+
+    // the block was connected to the active tip and flushed to the global caches,
+    // its undo data is moved into the overlay
+    void PushTip(CBlockIndex *pIndex, const std::shared_ptr<CBlock> &spBlock, CBlockUndo &blockUndo);
+    // the active tip was disconnected and flushed to the global caches,
+    // redoOpLogMap holds the values replaced by the disconnect
+    void PopTip(CBlockIndex *pIndex, CBlock &block, const CDBOpLogMap &redoOpLogMap);
+
+    // materialize the chain state at pForkIndex, which must be an ancestor of the active tip
+    bool MaterializeView(CBlockIndex *pForkIndex, std::shared_ptr<CCacheWrapper> &spCW, CValidationState &state);
+
+    // nullptr if no view of the fork chain whose best block is blockHash
+    std::shared_ptr<CCacheWrapper> GetForkView(const uint256 &blockHash) const;
+    void SetForkView(const uint256 &blockHash, const std::shared_ptr<CCacheWrapper> &spCW);
+    void EraseForkView(const uint256 &blockHash) { fork_views.erase(blockHash); }
+
+    // rebase every view onto a new layer filled by pinFunc, the views failed to be rebased are dropped
+    void RebaseForkViews(const PinFunc &pinFunc);
+
+    void Clear();
+
+private:
+    struct CBlockOverlay {
+        uint256 block_hash;
+        std::shared_ptr<CBlock> sp_block;
+        CBlockUndo block_undo;
+    };
+
+    std::shared_ptr<CCacheWrapper> NewBaseLayer() const;
+
+    uint32_t max_blocks;
+    CCacheWrapper *p_base_cw;
+    std::deque<CBlockOverlay> overlays;  // oldest first, the back one is the active tip
+    std::map<uint256, std::shared_ptr<CCacheWrapper>> fork_views; // best block hash of fork chain -> view
+};
+
+#endif  // PERSIST_FORK_STATE_H
@@ -11,6 +11,7 @@
 #include <leveldb/env.h>
 #include <leveldb/filter_policy.h>
 #include <memenv.h>
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include "commons/json/json_spirit_value.h"
 
@@ -30,7 +31,7 @@ void ThrowError(const leveldb::Status &status) {
 std::string CDBOpLogMap::ToString() const {
     std::string str = "";
     for (auto itemOpLogs : mapDbOpLogs) {
-        str += strprintf("type:%s {", itemOpLogs.first);
+        str += strprintf("type:%s {", dbk::GetKeyPrefix(itemOpLogs.first));
         for (auto iterDbLog : itemOpLogs.second) {
             str += iterDbLog.ToString();
             str += ";";
@@ -40,24 +41,138 @@ std::string CDBOpLogMap::ToString() const {
     return str;
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize) {
+// the buffer is released when a large value, e.g. contract code, left it bigger than this
+static const size_t MAX_THREAD_READ_BUFFER_SIZE = 64 * 1024;
+
+string& CLevelDBWrapper::GetThreadReadBuffer() {
+    static thread_local string buffer;
+    return buffer;
+}
+
+void CLevelDBWrapper::ReleaseThreadReadBuffer(string &buffer) {
+    if (buffer.capacity() > MAX_THREAD_READ_BUFFER_SIZE)
+        string().swap(buffer);
+}
+
+void CLevelDBBatch::Append(const CLevelDBBatch &other) {
+    class CAppendHandler : public leveldb::WriteBatch::Handler {
+    public:
+        CAppendHandler(leveldb::WriteBatch &batchIn) : batch(batchIn) {}
+
+        void Put(const leveldb::Slice &key, const leveldb::Slice &value) override { batch.Put(key, value); }
+        void Delete(const leveldb::Slice &key) override { batch.Delete(key); }
+
+    private:
+        leveldb::WriteBatch &batch;
+    };
+
+    CAppendHandler handler(batch);
+    ThrowError(other.batch.Iterate(&handler));
+}
+
+static leveldb::Cache *pSharedBlockCache = nullptr;
+
+static CDBTuning *GetDBTunings() {
+    static CDBTuning tunings[DBNameType::DB_NAME_COUNT];
+    static bool initialized = false;
+    if (!initialized) {
+        for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++)
+            tunings[i] = CDBTuning(DBCacheSize[i]);
+        initialized = true;
+    }
+    return tunings;
+}
+
+const CDBTuning& GetDBTuning(DBNameType dbNameType) {
+    assert(dbNameType >= 0 && dbNameType < DBNameType::DB_NAME_COUNT);
+    return GetDBTunings()[dbNameType];
+}
+
+void SetDBSharedBlockCache(size_t size) {
+    if (size == 0 || pSharedBlockCache != nullptr)
+        return;
+
+    // shared by the databases until the process exits
+    pSharedBlockCache = leveldb::NewLRUCache(size);
+    for (int32_t i = 0; i < DBNameType::DB_NAME_COUNT; i++)
+        GetDBTunings()[i].sharedBlockCache = true;
+}
+
+void ResetDBTuning(DBNameType dbNameType) {
+    assert(dbNameType >= 0 && dbNameType < DBNameType::DB_NAME_COUNT);
+    CDBTuning &tuning = GetDBTunings()[dbNameType];
+    bool sharedBlockCache = tuning.sharedBlockCache;
+    tuning = CDBTuning(DBCacheSize[dbNameType]);
+    tuning.sharedBlockCache = sharedBlockCache;
+}
+
+bool ParseDBTuning(const string &strTuning, string &strError) {
+    size_t pos = strTuning.find(':');
+    string dbName = strTuning.substr(0, pos);
+    int32_t dbNameType = 0;
+    while (dbNameType < DBNameType::DB_NAME_COUNT && kDbNames[dbNameType] != dbName)
+        dbNameType++;
+    if (pos == string::npos || dbNameType == DBNameType::DB_NAME_COUNT) {
+        strError = strprintf("invalid -dbtune=%s, unknown db name", strTuning);
+        return false;
+    }
+
+    CDBTuning &tuning = GetDBTunings()[dbNameType];
+    string strItems = strTuning.substr(pos + 1);
+    vector<string> items;
+    boost::split(items, strItems, boost::is_any_of(","));
+    for (const auto &item : items) {
+        size_t eqPos    = item.find('=');
+        string key      = item.substr(0, eqPos);
+        string strValue = eqPos != string::npos ? item.substr(eqPos + 1) : "";
+        int64_t value   = atoi64(strValue);
+        if (strValue.empty() || !std::all_of(strValue.begin(), strValue.end(), ::isdigit)) {
+            strError = strprintf("invalid -dbtune=%s, bad value of %s", strTuning, key);
+            return false;
+        }
+
+        if (key == "cache") {
+            tuning.blockCacheSize   = (size_t)value << 20;
+            tuning.sharedBlockCache = false;
+        } else if (key == "writebuffer") {
+            tuning.writeBufferSize = (size_t)value << 20;
+        } else if (key == "openfiles") {
+            tuning.maxOpenFiles = value;
+        } else if (key == "bloombits") {
+            tuning.bloomBits = value;
+        } else if (key == "compression") {
+            tuning.compression = value != 0;
+        } else {
+            strError = strprintf("invalid -dbtune=%s, unknown key %s", strTuning, key);
+            return false;
+        }
+    }
+    return true;
+}
+
+static leveldb::Options GetOptions(const CDBTuning &tuning) {
     leveldb::Options options;
-    options.block_cache       = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4;  // up to two write buffers may be held in memory simultaneously
-    options.filter_policy     = leveldb::NewBloomFilterPolicy(10);
-    options.compression       = leveldb::kNoCompression;
-    options.max_open_files    = 64;
+    options.block_cache       = tuning.sharedBlockCache ? pSharedBlockCache : leveldb::NewLRUCache(tuning.blockCacheSize);
+    options.write_buffer_size = tuning.writeBufferSize;  // up to two write buffers may be held in memory simultaneously
+    options.filter_policy     = tuning.bloomBits > 0 ? leveldb::NewBloomFilterPolicy(tuning.bloomBits) : nullptr;
+    options.compression       = tuning.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files    = tuning.maxOpenFiles;
     return options;
 }
 
-CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory, bool fWipe) {
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory, bool fWipe)
+    : CLevelDBWrapper(path, CDBTuning(nCacheSize), fMemory, fWipe) {}
+
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path &path, const CDBTuning &tuning, bool fMemory,
+                                 bool fWipe) {
     penv                         = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache       = false;
     syncoptions.sync             = true;
-    options                      = GetOptions(nCacheSize);
+    options                      = GetOptions(tuning);
     options.create_if_missing    = true;
+    fSharedBlockCache            = tuning.sharedBlockCache;
     if (fMemory) {
         penv        = leveldb::NewMemEnv(leveldb::Env::Default());
         options.env = penv;
@@ -79,7 +194,8 @@ CLevelDBWrapper::~CLevelDBWrapper() {
     pdb = nullptr;
     delete options.filter_policy;
     options.filter_policy = nullptr;
-    delete options.block_cache;
+    if (!fSharedBlockCache)
+        delete options.block_cache;
     options.block_cache = nullptr;
     delete penv;
     options.env = nullptr;
@@ -84,14 +84,27 @@ public:
 
 typedef vector<CDbOpLog> CDbOpLogs;
 
+/**
+ * Observer of the reads which a cache layer forwards to its base layer, installed on the op log map
+ * of the layer. The key is serialized as in CDbOpLog, empty for single value caches.
+ */
+class CDBReadObserver {
+public:
+    virtual ~CDBReadObserver() {}
+
+    virtual void BeginBaseRead(dbk::PrefixType prefixType, const string &key) = 0;
+    virtual void EndBaseRead() = 0;
+};
+
 class CDBOpLogMap {
+    typedef map<string, CDbOpLogs> LegacyOpLogMap; // prefix string -> dbOpLogs
 public:
-    map<string, CDbOpLogs>& GetMap() { return mapDbOpLogs; }
+    map<dbk::PrefixType, CDbOpLogs>& GetMap() { return mapDbOpLogs; }
+    const map<dbk::PrefixType, CDbOpLogs>& GetMap() const { return mapDbOpLogs; }
 
     const CDbOpLogs* GetDbOpLogsPtr(dbk::PrefixType prefixType) const {
         assert(prefixType != dbk::EMPTY);
-        const string& prefix = dbk::GetKeyPrefix(prefixType);
-        auto it = mapDbOpLogs.find(prefix);
+        auto it = mapDbOpLogs.find(prefixType);
         if (it != mapDbOpLogs.end()) {
             return &it->second;
         }
@@ -100,19 +113,41 @@ public:
 
     void AddOpLog(dbk::PrefixType prefixType, const CDbOpLog& dbOpLogIn) {
         assert(prefixType != dbk::EMPTY);
-        const string& prefix = dbk::GetKeyPrefix(prefixType);
-        mapDbOpLogs[prefix].push_back(dbOpLogIn);
+        mapDbOpLogs[prefixType].push_back(dbOpLogIn);
     }
 
     void Clear() { mapDbOpLogs.clear(); }
 
+    void SetReadObserver(CDBReadObserver *pReadObserverIn) { pReadObserver = pReadObserverIn; }
+    CDBReadObserver* GetReadObserver() const { return pReadObserver; }
+
     std::string ToString() const;
 public:
+    // legacy format: prefix string -> dbOpLogs, sorted by prefix string
     IMPLEMENT_SERIALIZE(
-        READWRITE(mapDbOpLogs);
+        LegacyOpLogMap legacyMap;
+        if (!fRead) {
+            for (const auto &item : mapDbOpLogs)
+                legacyMap.emplace(dbk::GetKeyPrefix(item.first), item.second);
+        }
+        READWRITE(legacyMap);
+        if (fRead) {
+            SetLegacyMap(legacyMap);
+        }
 	)
 private:
-    mutable map<string, CDbOpLogs> mapDbOpLogs; // dbName -> dbOpLogs
+    inline void SetLegacyMap(const LegacyOpLogMap &legacyMap) const {
+        mapDbOpLogs.clear();
+        for (const auto &item : legacyMap) {
+            dbk::PrefixType prefixType = dbk::ParseKeyPrefixType(item.first);
+            if (prefixType == dbk::EMPTY)
+                throw ios_base::failure(strprintf("CDBOpLogMap : unknown prefix=%s", item.first));
+            mapDbOpLogs.emplace(prefixType, item.second);
+        }
+    }
+
+    mutable map<dbk::PrefixType, CDbOpLogs> mapDbOpLogs; // prefixType -> dbOpLogs
+    CDBReadObserver *pReadObserver = nullptr;           // not serialized
 };
 
 class leveldb_error : public runtime_error
@@ -128,25 +163,56 @@ class CLevelDBBatch {
     friend class CLevelDBWrapper;
 
 private:
+    enum { VALUE_INLINE_SIZE = 256 };
+
     leveldb::WriteBatch batch;
 
 public:
     template<typename V>
-    void Write(const std::string &key, const V& value) {
-    	leveldb::Slice slKey(key);
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue.reserve(ssValue.GetSerializeSize(value));
+    void Write(const leveldb::Slice &slKey, const V& value) {
+        // the value is copied into the batch, so the chain data needs no zeroed buffer of its own
+        CInlineDataStream<VALUE_INLINE_SIZE> ssValue(SER_DISK, CLIENT_VERSION);
         ssValue << value;
-        leveldb::Slice slValue(&ssValue[0], ssValue.size());
+        leveldb::Slice slValue(ssValue.data(), ssValue.size());
         batch.Put(slKey, slValue);
     }
 
-    void Erase(const std::string &key) {
-        batch.Delete(key);
+    void Erase(const leveldb::Slice &slKey) {
+        batch.Delete(slKey);
     }
 
+    // appends the puts and deletes of other, in their order
+    void Append(const CLevelDBBatch &other);
+
  };
 
+// LevelDB tuning of a database, the defaults follow the size of the database in DBCacheSize
+struct CDBTuning {
+    size_t blockCacheSize  = 0;
+    size_t writeBufferSize = 0;
+    int32_t maxOpenFiles   = 64;
+    int32_t bloomBits      = 10;
+    bool compression       = false;     // snappy, leveldb stores the blocks as they are if built without it
+    bool sharedBlockCache  = false;     // use the block cache shared by the databases, see -dbsharedcache
+
+    CDBTuning() {}
+    explicit CDBTuning(size_t cacheSize) : blockCacheSize(cacheSize / 2), writeBufferSize(cacheSize / 4) {}
+};
+
+const CDBTuning& GetDBTuning(DBNameType dbNameType);
+
+// Makes the databases without a block cache size in -dbtune share one block cache of size bytes
+void SetDBSharedBlockCache(size_t size);
+
+/**
+ * Parses one -dbtune=<db name>:<key>=<value>[,<key>=<value>...] into the tuning of the database.
+ * Keys: cache and writebuffer in MiB, openfiles, bloombits, compression (0 or 1).
+ */
+bool ParseDBTuning(const string &strTuning, string &strError);
+
+// Restores the default tuning of the database, it still shares the block cache if it did
+void ResetDBTuning(DBNameType dbNameType);
+
 class CLevelDBWrapper {
 private:
     // custom environment this database is using (may be NULL in case of default environment)
@@ -170,29 +236,35 @@ private:
     // the database itself
     leveldb::DB *pdb;
 
+    // options.block_cache is the shared block cache, which is not deleted with the database
+    bool fSharedBlockCache;
+
 public:
     CLevelDBWrapper(const boost::filesystem::path &path, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CLevelDBWrapper(const boost::filesystem::path &path, const CDBTuning &tuning, bool fMemory = false,
+                    bool fWipe = false);
     ~CLevelDBWrapper();
 
     template<typename V>
-    bool Read(std::string key, V &value) {
-    	leveldb::Slice slKey(key);
-
-        string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+    bool Read(const leveldb::Slice &slKey, V &value, const leveldb::Snapshot *pSnapshot = nullptr) {
+        // the value is deserialized in place from the read buffer of the thread
+        string &strValue = GetThreadReadBuffer();
+        leveldb::Status status = pdb->Get(GetReadOptions(readoptions, pSnapshot), slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrint(BCLog::INFO,"LevelDB read failure: %s\n", status.ToString().c_str());
             ThrowError(status);
         }
+        bool ret = true;
         try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            CDataSpanStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> value;
         } catch(std::exception &e) {
-            return false;
+            ret = false;
         }
-        return true;
+        ReleaseThreadReadBuffer(strValue);
+        return ret;
     }
 
     template<typename V>
@@ -202,16 +274,16 @@ public:
         return WriteBatch(batch, fSync);
     }
 
-    bool Exists(const std::string &key) {
-    	leveldb::Slice slKey(key);
-        string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+    bool Exists(const leveldb::Slice &slKey, const leveldb::Snapshot *pSnapshot = nullptr) {
+        string &strValue = GetThreadReadBuffer();
+        leveldb::Status status = pdb->Get(GetReadOptions(readoptions, pSnapshot), slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrint(BCLog::INFO,"LevelDB read failure: %s\n", status.ToString().c_str());
             ThrowError(status);
         }
+        ReleaseThreadReadBuffer(strValue);
         return true;
     }
 
@@ -234,11 +306,27 @@ public:
     }
 
     // not exactly clean encapsulation, but it's easiest for now
-    leveldb::Iterator *NewIterator() {
-        return pdb->NewIterator(iteroptions);
+    leveldb::Iterator *NewIterator(const leveldb::Snapshot *pSnapshot = nullptr) {
+        return pdb->NewIterator(GetReadOptions(iteroptions, pSnapshot));
     }
+
+    // point-in-time view of the whole db, must be released by ReleaseSnapshot()
+    const leveldb::Snapshot *GetSnapshot() { return pdb->GetSnapshot(); }
+
+    void ReleaseSnapshot(const leveldb::Snapshot *pSnapshot) { pdb->ReleaseSnapshot(pSnapshot); }
+
     int64_t GetDbCount();
    // Object ToJsonObj();
+private:
+    // LevelDB copies every value it reads, the copy goes to a buffer reused by the reads of the thread
+    static string& GetThreadReadBuffer();
+    static void ReleaseThreadReadBuffer(string &buffer);
+
+    static leveldb::ReadOptions GetReadOptions(const leveldb::ReadOptions &options, const leveldb::Snapshot *pSnapshot) {
+        leveldb::ReadOptions ret = options;
+        ret.snapshot = pSnapshot;
+        return ret;
+    }
 };
 
 #endif // PERSIST_LEVELDBWRAPPER_H
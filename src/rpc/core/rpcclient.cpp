@@ -201,6 +201,8 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "listdexorders"              && n > 0) ConvertTo<int64_t>(params[0]);
     if (strMethod == "listdexorders"              && n > 1) ConvertTo<int64_t>(params[1]);
     if (strMethod == "listdexorders"              && n > 2) ConvertTo<int64_t>(params[2]);
+    if (strMethod == "getdexorderbook"            && n > 2) ConvertTo<int64_t>(params[2]);
+    if (strMethod == "listdexbookorders"          && n > 3) ConvertTo<int64_t>(params[3]);
     if (strMethod == "getdexoperator"            && n > 0) ConvertTo<int64_t>(params[0]);
 
     if (strMethod == "startcommontpstest"       && n > 0)    ConvertTo<int64_t>(params[0]);
@@ -270,6 +272,9 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
 
     /* vm functions work in vm simulator */
     if (strMethod == "luavm_executescript"          && n > 3) ConvertTo<int64_t>(params[3]);
+    if (strMethod == "luavm_setprofiler"            && n > 0) ConvertTo<bool>(params[0]);
+    if (strMethod == "luavm_setprofiler"            && n > 1) ConvertTo<bool>(params[1]);
+    if (strMethod == "luavm_getprofile"             && n > 0) ConvertTo<int64_t>(params[0]);
 
 
     return params;
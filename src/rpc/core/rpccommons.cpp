@@ -201,6 +201,22 @@ Object SubmitTx(const CKeyID &keyid, CBaseTx &tx) {
     return obj;
 }
 
+CRPCReadView::CRPCReadView() {
+    spSnapshot = pCdMan->GetReadSnapshot();
+    if (spSnapshot) {
+        pSnapshotScope = std::make_unique<CDBSnapshotScope>(spSnapshot->snapshotSet);
+        spCw           = std::make_shared<CCacheWrapper>();
+        spCw->BindDbs(pCdMan);
+        pTipIndex      = spSnapshot->GetTipIndex();
+    } else {
+        pLock     = std::make_unique<CCriticalBlock>(cs_main, "cs_main", __FILE__, __LINE__);
+        spCw      = std::make_shared<CCacheWrapper>(pCdMan);
+        pTipIndex = chainActive.Tip();
+    }
+}
+
+int32_t CRPCReadView::GetHeight() const { return pTipIndex != nullptr ? pTipIndex->height : -1; }
+
 string RegIDToAddress(CUserID &userId) {
     CKeyID keyId;
     if (pCdMan->pAccountCache->GetKeyId(userId, keyId))
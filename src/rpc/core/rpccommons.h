@@ -15,6 +15,7 @@
 #include "entities/account.h"
 #include "entities/cdp.h"
 #include "tx/tx.h"
+#include "persistence/cachewrapper.h"
 #include "persistence/dexdb.h"
 #include "persistence/pricefeeddb.h"
 
@@ -30,6 +31,32 @@ Array GetTxAddressDetail(std::shared_ptr<CBaseTx> pBaseTx);
 
 Object SubmitTx(const CKeyID &keyid, CBaseTx &tx);
 
+/**
+ * Consistent read-only chain state for query RPCs. Served from the last read snapshot when available,
+ * through caches of the view's own, so the callers contend neither with block connection on cs_main nor
+ * with each other; otherwise falls back to the live caches with cs_main held for the lifetime of the view.
+ */
+class CRPCReadView {
+public:
+    CRPCReadView();
+
+    CCacheWrapper& GetCw() { return *spCw; }
+    int32_t GetHeight() const;
+    // tip of the chain state read by the view, resolve its blocks by GetAncestor() instead of chainActive
+    const CBlockIndex* GetTipIndex() const { return pTipIndex; }
+
+private:
+    CRPCReadView(const CRPCReadView &) = delete;
+    CRPCReadView &operator=(const CRPCReadView &) = delete;
+
+    // declaration order matters: the caches are released before the snapshot scope and the lock
+    std::shared_ptr<CCacheSnapshot> spSnapshot;
+    std::unique_ptr<CCriticalBlock> pLock;
+    std::unique_ptr<CDBSnapshotScope> pSnapshotScope;
+    std::shared_ptr<CCacheWrapper> spCw;
+    const CBlockIndex *pTipIndex = nullptr;
+};
+
 namespace JSON {
     const Value& GetObjectFieldValue(const Value &jsonObj, const string &fieldName);
     bool  GetObjectFieldValue(const Value &jsonObj, const string &fieldName,Value& returnValue);
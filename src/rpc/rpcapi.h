@@ -88,6 +88,8 @@ extern Value submitdexsettletx(const Array& params, bool fHelp);
 extern Value getdexorder(const Array& params, bool fHelp);
 extern Value listdexorders(const Array& params, bool fHelp);
 extern Value listdexsysorders(const Array& params, bool fHelp);
+extern Value getdexorderbook(const Array& params, bool fHelp);
+extern Value listdexbookorders(const Array& params, bool fHelp);
 extern Value getdexoperator(const Array& params, bool fHelp);
 extern Value getdexoperatorbyowner(const Array& params, bool fHelp);
 
@@ -146,6 +148,7 @@ extern Value getcontractassets(const  Array& params, bool fHelp);
 extern Value getfcoingenesistxinfo(const Array& params, bool fHelp);
 extern Value getblockcount(const Array& params, bool fHelp);
 extern Value getrawmempool(const Array& params, bool fHelp);
+extern Value getdbcachestats(const Array& params, bool fHelp);
 extern Value getblock(const Array& params, bool fHelp);
 extern Value verifychain(const Array& params, bool fHelp);
 extern Value getcontractregid(const Array& params, bool fHelp);
@@ -158,6 +161,8 @@ extern Value getblockundo(const Array& params, bool fHelp);
 /******************************  Lua VM *********************************/
 extern Value luavm_executescript(const Array& params, bool fHelp);
 extern Value luavm_executecontract(const Array& params, bool fHelp);
+extern Value luavm_setprofiler(const Array& params, bool fHelp);
+extern Value luavm_getprofile(const Array& params, bool fHelp);
 
 
 /******************************  WASM & General Module Access *********************************/
@@ -170,6 +175,7 @@ extern Value wasm_getabi(const Array& params, bool fHelp);
 extern Value wasm_gettxtrace(const Array& params, bool fHelp);
 extern Value wasm_abidefjson2bin(const Array& params, bool fHelp);
 extern Value wasm_getstate(const Array& params, bool fHelp);
+extern Value wasm_getmemorystats(const Array& params, bool fHelp);
 
 /******************************  UTXO *********************************/
 extern Value genutxomultiinputcondhash(const Array& params, bool fHelp);
@@ -37,6 +37,7 @@ static const CRPCCommand vRPCCommands[] =
     { "getblockcount",                  &getblockcount,                     true,      true,        false   },
     { "getblock",                       &getblock,                          true,      false,       false   },
     { "getrawmempool",                  &getrawmempool,                     true,      false,       false   },
+    { "getdbcachestats",                &getdbcachestats,                   true,      true,        false   },
     { "verifychain",                    &verifychain,                       true,      false,       false   },
     { "getblockundo",                   &getblockundo,                      true,      false,       false   },
     { "getswapcoindetail",              &getswapcoindetail,                 true,      false,        false   },
@@ -54,7 +55,7 @@ static const CRPCCommand vRPCCommands[] =
     { "getnewaddr",                     &getnewaddr,                        false,     false,       true    },
     { "gettxdetail",                    &gettxdetail,                       true,      false,       true    },
     { "getclosedcdp",                   &getclosedcdp,                      true,      false,       true    },
-    { "getwalletinfo",                  &getwalletinfo,                     true,      false,       true    },
+    { "getwalletinfo",                  &getwalletinfo,                     true,      true,        true    },
 
     { "dumpprivkey",                    &dumpprivkey,                       false,     false,       true    },
     { "importprivkey",                  &importprivkey,                     false,     false,       true    },
@@ -71,10 +72,10 @@ static const CRPCCommand vRPCCommands[] =
     { "listaddr",                       &listaddr,                          true,      false,       true    },
     { "listtx",                         &listtx,                            true,      false,       true    },
     { "setgenerate",                    &setgenerate,                       true,      true,        false   },
-    { "listcontracts",                  &listcontracts,                     true,      false,       true    },
-    { "getcontractinfo",                &getcontractinfo,                   true,      false,       true    },
+    { "listcontracts",                  &listcontracts,                     true,      true,        true    },
+    { "getcontractinfo",                &getcontractinfo,                   true,      true,        true    },
     { "listtxcache",                    &listtxcache,                       true,      false,       true    },
-    { "getcontractdata",                &getcontractdata,                   true,      false,       true    },
+    { "getcontractdata",                &getcontractdata,                   true,      true,        true    },
     { "signmessage",                    &signmessage,                       false,     false,       true    },
     { "verifymessage",                  &verifymessage,                     true,      false,       false   },
     { "getcoinunitinfo",                &getcoinunitinfo,                   true,      false,       false   },
@@ -127,8 +128,8 @@ static const CRPCCommand vRPCCommands[] =
     { "submitcdpredeemtx",              &submitcdpredeemtx,                 false,      false,      true    },
     { "submitcdpliquidatetx",           &submitcdpliquidatetx,              false,      false,      true    },
     { "getscoininfo",                   &getscoininfo,                      true,       false,      false   },
-    { "getcdpinfo",                     &getcdpinfo,                        true,       false,      false   },
-    { "getusercdp",                     &getusercdp,                        true,       false,      false   },
+    { "getcdpinfo",                     &getcdpinfo,                        true,       true,       false   },
+    { "getusercdp",                     &getusercdp,                        true,       true,       false   },
     { "getsysparam",                    &getsysparam,                       true,       false,      false   },
     { "getcdpparam",                    &getcdpparam,                       true,       false,      false   },
     { "getproposal",                    &getproposal,                       true,       false,      false   },
@@ -145,11 +146,13 @@ static const CRPCCommand vRPCCommands[] =
     { "submitdexcancelordertx",         &submitdexcancelordertx,            false,      false,      false   },
     { "submitdexoperatorregtx",         &submitdexoperatorregtx,            false,      false,      false   },
     { "submitdexopupdatetx",            &submitdexopupdatetx,               false,      false,      false   },
-    { "getdexorder",                    &getdexorder,                       true,       false,      false   },
-    { "listdexsysorders",               &listdexsysorders,                  true,       false,      false   },
-    { "listdexorders",                  &listdexorders,                     true,       false,      false   },
-    { "getdexoperator",                 &getdexoperator,                    true,       false,      false   },
-    { "getdexoperatorbyowner",          &getdexoperatorbyowner,             true,       false,      false   },
+    { "getdexorder",                    &getdexorder,                       true,       true,       false   },
+    { "listdexsysorders",               &listdexsysorders,                  true,       true,       false   },
+    { "listdexorders",                  &listdexorders,                     true,       true,       false   },
+    { "getdexorderbook",                &getdexorderbook,                   true,       true,       false   },
+    { "listdexbookorders",              &listdexbookorders,                 true,       true,       false   },
+    { "getdexoperator",                 &getdexoperator,                    true,       true,       false   },
+    { "getdexoperatorbyowner",          &getdexoperatorbyowner,             true,       true,       false   },
     { "getdexorderfee",                 &getdexorderfee,                    true,       false,      false   },
     { "getdexbaseandquotecoins",        &getdexbaseandquotecoins,           true,       false,      false   },
     { "gettotalbpssize",                &gettotalbpssize,                   true,       false,      false   },
@@ -157,8 +160,8 @@ static const CRPCCommand vRPCCommands[] =
         /* for asset */
     // { "submitassetissuetx",             &submitassetissuetx,                false,      false,      false   },
     // { "submitassetupdatetx",            &submitassetupdatetx,               false,      false,      false   },
-    { "getassetinfo",                   &getassetinfo,                      true,       false,      false   },
-    { "listassets",                     &listassets,                        true,       false,      false   },
+    { "getassetinfo",                   &getassetinfo,                      true,       true,       false   },
+    { "listassets",                     &listassets,                        true,       true,       false   },
 
     /* for wasm-based universal contract deploy & invocation tx submission */
     { "submitsetcodetx",         &submitsetcodetx,            true,       false,      true    },
@@ -173,6 +176,7 @@ static const CRPCCommand vRPCCommands[] =
     { "wasm_gettxtrace",                &wasm_gettxtrace,                    true,       false,      true    },
     { "wasm_abidefjson2bin",            &wasm_abidefjson2bin,                true,       false,      true    },
     { "wasm_getstate",                  &wasm_getstate,                true,       false,      true    },
+    { "wasm_getmemorystats",            &wasm_getmemorystats,                true,       true,       false   },
     /* for test code */
     { "disconnectblock",                &disconnectblock,                   true,       false,      true    },
     { "reloadtxcache",                  &reloadtxcache,                     true,       false,      true    },
@@ -185,6 +189,8 @@ static const CRPCCommand vRPCCommands[] =
     /* vm functions work in vm simulator */
     { "luavm_executescript",            &luavm_executescript,               true,       true,       true    },
     { "luavm_executecontract",          &luavm_executecontract,             true,       true,       true    },
+    { "luavm_setprofiler",              &luavm_setprofiler,                 true,       true,       false   },
+    { "luavm_getprofile",               &luavm_getprofile,                  true,       true,       false   },
 
     /* debug */
     { "dumpdb",                         &dumpdb,                            true,       true,       true    },
@@ -173,6 +173,52 @@ Value getrawmempool(const Array& params, bool fHelp)
     }
 }
 
+Value getdbcachestats(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbcachestats\n"
+            "\nReturns the lookups of the db caches which missed their in-memory data and the bytes held in memory,\n"
+            "per db key prefix.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"prefix\" : \"xxx\",         (string) db key prefix\n"
+            "    \"db_reads\" : n,           (numeric) lookups read from the db\n"
+            "    \"db_misses\" : n,          (numeric) db reads which found no value\n"
+            "    \"absent_hits\" : n,        (numeric) lookups answered by the keys known to be absent\n"
+            "    \"absent_hit_rate\" : n,    (numeric) absent hits of the lookups which found no value\n"
+            "    \"cache_bytes\" : n,        (numeric) serialized bytes of the keys and values held in memory\n"
+            "    \"evicted\" : n             (numeric) clean entries evicted to fit the -dbcache budget\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples\n" +
+            HelpExampleCli("getdbcachestats", "") + "\nAs json rpc\n" + HelpExampleRpc("getdbcachestats", ""));
+
+    Array arr;
+    for (int32_t i = dbk::EMPTY + 1; i < dbk::PREFIX_COUNT; i++) {
+        const CDBCacheStats &stats = GetDBCacheStats((dbk::PrefixType)i);
+        uint64_t dbReads    = stats.db_reads;
+        uint64_t dbMisses   = stats.db_misses;
+        uint64_t absentHits = stats.absent_hits;
+        int64_t cacheBytes  = stats.cache_bytes;
+        if (dbReads == 0 && absentHits == 0 && cacheBytes == 0)
+            continue;
+
+        Object obj;
+        obj.push_back(Pair("prefix",            dbk::GetKeyPrefix((dbk::PrefixType)i)));
+        obj.push_back(Pair("db_reads",          dbReads));
+        obj.push_back(Pair("db_misses",         dbMisses));
+        obj.push_back(Pair("absent_hits",       absentHits));
+        obj.push_back(Pair("absent_hit_rate",   absentHits + dbMisses > 0 ?
+                                                double(absentHits) / (absentHits + dbMisses) : 0.0));
+        obj.push_back(Pair("cache_bytes",       cacheBytes));
+        obj.push_back(Pair("evicted",           (uint64_t)stats.evicted));
+        arr.push_back(obj);
+    }
+    return arr;
+}
+
 Value getblock(const Array& params, bool fHelp) {
     if (fHelp || params.size() < 1 || params.size() > 3) {
         throw runtime_error(
@@ -777,9 +777,9 @@ Value getdexorder(const Array& params, bool fHelp) {
     }
     const uint256 &orderId = RPC_PARAM::GetTxid(params[0], "order_id");
 
-    auto pDexCache = pCdMan->pDexCache;
+    CRPCReadView view;
     CDEXOrderDetail orderDetail;
-    if (!pDexCache->GetActiveOrder(orderId, orderDetail))
+    if (!view.GetCw().dexCache.GetActiveOrder(orderId, orderDetail))
         throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("The order not exists or inactive! order_id=%s", orderId.ToString()));
 
     Object obj;
@@ -804,7 +804,8 @@ extern Value listdexsysorders(const Array& params, bool fHelp) {
         );
     }
 
-    int64_t tipHeight = chainActive.Height();
+    CRPCReadView view;
+    int64_t tipHeight = view.GetHeight();
     int64_t height    = tipHeight;
     if (params.size() > 0)
         height = params[0].get_int64();
@@ -813,7 +814,7 @@ extern Value listdexsysorders(const Array& params, bool fHelp) {
         throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("height=%d must >= 0 and <= tip_height=%d", height, tipHeight));
     }
     Array array;
-    auto dbIt = MakeDbPrefixIterator(pCdMan->pDexCache->blockOrdersCache, make_pair(CFixedUInt32(height), (uint8_t)SYSTEM_GEN_ORDER));
+    auto dbIt = MakeDbPrefixIterator(view.GetCw().dexCache.blockOrdersCache, make_pair(CFixedUInt32(height), (uint8_t)SYSTEM_GEN_ORDER));
     for (dbIt->First(); dbIt->IsValid(); dbIt->Next()) {
         Object objItem;
         DEX_DB::OrderToJson(std::get<2>(dbIt->GetKey()), dbIt->GetValue(), objItem);
@@ -852,7 +853,8 @@ extern Value listdexorders(const Array& params, bool fHelp) {
         );
     }
 
-    int64_t tipHeight = chainActive.Height();
+    CRPCReadView view;
+    int64_t tipHeight = view.GetHeight();
     int64_t beginHeight = 0;
     if (params.size() > 0)
         beginHeight = params[0].get_int64();
@@ -879,7 +881,7 @@ extern Value listdexorders(const Array& params, bool fHelp) {
     DEXBlockOrdersCache::KeyType lastKey;
     if (params.size() > 3) {
         string lastPosInfo = RPC_PARAM::GetBinStrFromHex(params[3], "last_pos_info");
-        auto err = DEX_DB::ParseLastPos(lastPosInfo, lastKey);
+        auto err = DEX_DB::ParseLastPos(view.GetTipIndex(), lastPosInfo, lastKey);
         if (err)
             throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("Invalid last_pos_info! %s", *err));
         uint32_t lastHeight = DEX_DB::GetHeight(lastKey);
@@ -891,7 +893,7 @@ extern Value listdexorders(const Array& params, bool fHelp) {
     }
 
     Array array;
-    auto dbIt = MakeDbIterator(pCdMan->pDexCache->blockOrdersCache);
+    auto dbIt = MakeDbIterator(view.GetCw().dexCache.blockOrdersCache);
     if (db_util::IsEmpty(lastKey)) {
         lastKey = DEXBlockOrdersCache::KeyType(CFixedUInt32(beginHeight), 0, uint256());
     }
@@ -917,7 +919,7 @@ extern Value listdexorders(const Array& params, bool fHelp) {
             dbIt->Next();
             if (dbIt->IsValid()) {
                 hasMore = true;
-                auto err = DEX_DB::MakeLastPos(dbIt->GetKey(), newLastPosInfo);
+                auto err = DEX_DB::MakeLastPos(view.GetTipIndex(), dbIt->GetKey(), newLastPosInfo);
                 if (err)
                     throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("Make new last_pos_info error! %s", *err));
             }
@@ -937,6 +939,118 @@ extern Value listdexorders(const Array& params, bool fHelp) {
 }
 
 
+static void CheckDexOrderBookIndex() {
+    if (!CDexDBCache::IsOrderBookIndexEnabled())
+        throw JSONRPCError(RPC_INVALID_REQUEST, "The dex order book index is disabled, please restart with "
+            "-dexorderbookindex=1 -reindex");
+}
+
+static Array PriceLevelsToJson(const vector<pair<uint64_t, CDEXPriceLevel>> &levels) {
+    Array array;
+    for (const auto &item : levels) {
+        Object objItem;
+        item.second.ToJson(item.first, objItem);
+        array.push_back(objItem);
+    }
+    return array;
+}
+
+extern Value getdexorderbook(const Array& params, bool fHelp) {
+     if (fHelp || params.size() < 2 || params.size() > 3) {
+        throw runtime_error(
+            "getdexorderbook \"asset_symbol\" \"coin_symbol\" [\"depth\"]\n"
+            "\nget the depth of dex order book of the trading pair, aggregated by price level.\n"
+            "\nArguments:\n"
+            "1.\"asset_symbol\":  (string, required) the asset symbol of the trading pair\n"
+            "2.\"coin_symbol\":   (string, required) the coin symbol of the trading pair\n"
+            "3.\"depth\":         (numeric, optional) the max price level count of each side, default is 20\n"
+            "\nResult:\n"
+            "\"height\"           (numeric) the block height of the order book.\n"
+            "\"bids\"             (array) the buy price levels, sorted from the highest price.\n"
+            "\"asks\"             (array) the sell price levels, sorted from the lowest price.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdexorderbook", "WICC WUSD 20")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("getdexorderbook", "\"WICC\", \"WUSD\", 20")
+        );
+    }
+
+    CheckDexOrderBookIndex();
+    const TokenSymbol &assetSymbol = params[0].get_str();
+    const TokenSymbol &coinSymbol  = params[1].get_str();
+    int64_t depth = 20;
+    if (params.size() > 2) {
+        depth = params[2].get_int64();
+        if (depth <= 0)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("depth=%d must > 0", depth));
+    }
+
+    CRPCReadView view;
+    vector<pair<uint64_t, CDEXPriceLevel>> bids, asks;
+    view.GetCw().dexCache.GetOrderBookLevels(CDEXOrderBookSide(assetSymbol, coinSymbol, ORDER_BUY), (uint32_t)depth, bids);
+    view.GetCw().dexCache.GetOrderBookLevels(CDEXOrderBookSide(assetSymbol, coinSymbol, ORDER_SELL), (uint32_t)depth, asks);
+
+    Object obj;
+    obj.push_back(Pair("asset_symbol", assetSymbol));
+    obj.push_back(Pair("coin_symbol", coinSymbol));
+    obj.push_back(Pair("height", view.GetHeight()));
+    obj.push_back(Pair("bids", PriceLevelsToJson(bids)));
+    obj.push_back(Pair("asks", PriceLevelsToJson(asks)));
+
+    return obj;
+}
+
+extern Value listdexbookorders(const Array& params, bool fHelp) {
+     if (fHelp || params.size() < 3 || params.size() > 4) {
+        throw runtime_error(
+            "listdexbookorders \"asset_symbol\" \"coin_symbol\" \"order_side\" [\"max_count\"]\n"
+            "\nget active limit orders of one side of the dex order book, in price-time priority.\n"
+            "\nArguments:\n"
+            "1.\"asset_symbol\":  (string, required) the asset symbol of the trading pair\n"
+            "2.\"coin_symbol\":   (string, required) the coin symbol of the trading pair\n"
+            "3.\"order_side\":    (string, required) the order side, BUY | SELL\n"
+            "4.\"max_count\":     (numeric, optional) the max order count to get, default is 500\n"
+            "\nResult:\n"
+            "\"height\"           (numeric) the block height of the order book.\n"
+            "\"count\"            (numeric) the count of returned orders.\n"
+            "\"orders\"           (array) the active orders, sorted from the best price.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("listdexbookorders", "WICC WUSD BUY 100")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("listdexbookorders", "\"WICC\", \"WUSD\", \"BUY\", 100")
+        );
+    }
+
+    CheckDexOrderBookIndex();
+    const TokenSymbol &assetSymbol = params[0].get_str();
+    const TokenSymbol &coinSymbol  = params[1].get_str();
+    OrderSide orderSide            = RPC_PARAM::GetOrderSide(params[2]);
+    int64_t maxCount = 500;
+    if (params.size() > 3) {
+        maxCount = params[3].get_int64();
+        if (maxCount < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("max_count=%d must >= 0", maxCount));
+    }
+
+    CRPCReadView view;
+    Array array;
+    auto dbIt = MakeDbPrefixIterator(view.GetCw().dexCache.order_book_cache,
+                                     CDEXOrderBookSide(assetSymbol, coinSymbol, orderSide));
+    for (dbIt->First(); dbIt->IsValid() && array.size() < (uint64_t)maxCount; dbIt->Next()) {
+        Object objItem;
+        DEX_DB::OrderToJson(std::get<3>(dbIt->GetKey()), dbIt->GetValue(), objItem);
+        array.push_back(objItem);
+    }
+
+    Object obj;
+    obj.push_back(Pair("height", view.GetHeight()));
+    obj.push_back(Pair("count", (int64_t)array.size()));
+    obj.push_back(Pair("orders", array));
+
+    return obj;
+}
+
+
 void CheckAccountRegId(const CUserID uid , const string fieldName){
 
     if(!uid.is<CRegID>() || !uid.get<CRegID>().IsMature(chainActive.Height())){
@@ -1131,11 +1245,12 @@ extern Value getdexoperator(const Array& params, bool fHelp) {
     }
 
     uint32_t dexOrderId = params[0].get_int();
+    CRPCReadView view;
     DexOperatorDetail dexOperator;
-    if (!pCdMan->pDexCache->GetDexOperator(dexOrderId, dexOperator))
+    if (!view.GetCw().dexCache.GetDexOperator(dexOrderId, dexOperator))
         throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("dex operator does not exist! dex_id=%lu", dexOrderId));
 
-    Object obj = DexOperatorToJson(*pCdMan->pAccountCache, dexOperator);
+    Object obj = DexOperatorToJson(view.GetCw().accountCache, dexOperator);
     obj.insert(obj.begin(), Pair("id", (uint64_t)dexOrderId));
     return obj;
 }
@@ -1155,18 +1270,20 @@ extern Value getdexoperatorbyowner(const Array& params, bool fHelp) {
         );
     }
 
-    const CUserID &userId = RPC_PARAM::GetUserId(params[0]);
+    // resolved by the view, GetUserId() reads the live chain state
+    const CUserID &userId = RPC_PARAM::ParseUserIdByAddr(params[0]);
 
-    CAccount account = RPC_PARAM::GetUserAccount(*pCdMan->pAccountCache, userId);
+    CRPCReadView view;
+    CAccount account = RPC_PARAM::GetUserAccount(view.GetCw().accountCache, userId);
     if (!account.IsRegistered())
         throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("account not registered! uid=%s", userId.ToDebugString()));
 
     DexOperatorDetail dexOperator;
     uint32_t dexOrderId = 0;
-    if (!pCdMan->pDexCache->GetDexOperatorByOwner(account.regid, dexOrderId, dexOperator))
+    if (!view.GetCw().dexCache.GetDexOperatorByOwner(account.regid, dexOrderId, dexOperator))
         throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("the owner account dos not have a dex operator! uid=%s", userId.ToDebugString()));
 
-    Object obj = DexOperatorToJson(*pCdMan->pAccountCache, dexOperator);
+    Object obj = DexOperatorToJson(view.GetCw().accountCache, dexOperator);
     obj.insert(obj.begin(), Pair("id", (uint64_t)dexOrderId));
     return obj;
 }
@@ -214,6 +214,7 @@ Value verifymessage(const Array& params, bool fHelp) {
     DEFINE( KEYID_ACCOUNT,        pAccountCache,  accountCache) \
     /**** contract db                                                                      */ \
     DEFINE( CONTRACT_DEF,         pContractCache,  contractCache ) \
+    DEFINE( CONTRACT_META,        pContractCache,  contractMetaCache ) \
     DEFINE( CONTRACT_DATA,        pContractCache,  contractDataCache) \
     DEFINE( CONTRACT_ACCOUNT,     pContractCache,  contractAccountCache) \
     DEFINE( CONTRACT_TRACES,      pContractCache,  contractTracesCache) \
@@ -239,6 +240,8 @@ Value verifymessage(const Array& params, bool fHelp) {
     DEFINE( DEX_OPERATOR_LAST_ID, pDexCache, operator_last_id_cache) \
     DEFINE( DEX_OPERATOR_DETAIL,  pDexCache, operator_detail_cache) \
     DEFINE( DEX_OPERATOR_OWNER_MAP, pDexCache, operator_owner_map_cache) \
+    DEFINE( DEX_ORDER_BOOK,       pDexCache, order_book_cache) \
+    DEFINE( DEX_ORDER_BOOK_LEVEL, pDexCache, order_book_level_cache) \
     /**** price feed */ \
     DEFINE( MEDIAN_PRICES,        pPriceFeedCache, median_price_cache) \
     DEFINE( PRICE_FEED_COIN_PAIRS,      pPriceFeedCache,price_feed_coin_pairs_cache) \
@@ -475,10 +478,8 @@ Value getblockundo(const Array& params, bool fHelp) {
         txObj.push_back(Pair("index", (int64_t)i));
         txObj.push_back(Pair("tx_hash",  txUndo.txid.ToString()));
         Array categoryArray;
-        for (auto opLogPair : txUndo.dbOpLogMap.GetMap()) {
-            auto prefixType = dbk::ParseKeyPrefixType(opLogPair.first);
-            const CDbOpLogs &opLogs = opLogPair.second;
-            categoryArray.push_back(UndoLogsToJson(prefixType, opLogs));
+        for (const auto &opLogPair : txUndo.dbOpLogMap.GetMap()) {
+            categoryArray.push_back(UndoLogsToJson(opLogPair.first, opLogPair.second));
         }
         txObj.push_back(Pair("category", categoryArray));
         txArray.push_back(txObj);
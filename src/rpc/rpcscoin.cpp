@@ -469,17 +469,18 @@ Value getusercdp(const Array& params, bool fHelp){
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid addr");
     }
 
+    CRPCReadView view;
     CAccount account;
-    if (!pCdMan->pAccountCache->GetAccount(*pUserId, account)) {
+    if (!view.GetCw().accountCache.GetAccount(*pUserId, account)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("The account not exists! userId=%s", pUserId->ToString()));
     }
 
     Object obj;
     Array cdps;
     vector<CUserCDP> userCdps;
-    if (pCdMan->pCdpCache->GetCDPList(account.regid, userCdps)) {
+    if (view.GetCw().cdpCache.GetCDPList(account.regid, userCdps)) {
         for (auto& cdp : userCdps) {
-            uint64_t bcoinMedianPrice = RPC_PARAM::GetPriceByCdp(*pCdMan->pPriceFeedCache, cdp);
+            uint64_t bcoinMedianPrice = RPC_PARAM::GetPriceByCdp(view.GetCw().priceFeedCache, cdp);
             cdps.push_back(cdp.ToJson(bcoinMedianPrice));
         }
 
@@ -506,12 +507,13 @@ Value getcdpinfo(const Array& params, bool fHelp){
 
 
     uint256 cdpTxId(uint256S(params[0].get_str()));
+    CRPCReadView view;
     CUserCDP cdp;
-    if (!pCdMan->pCdpCache->GetCDP(cdpTxId, cdp)) {
+    if (!view.GetCw().cdpCache.GetCDP(cdpTxId, cdp)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("CDP (%s) does not exist!", cdpTxId.GetHex()));
     }
 
-    uint64_t bcoinMedianPrice = RPC_PARAM::GetPriceByCdp(*pCdMan->pPriceFeedCache, cdp);
+    uint64_t bcoinMedianPrice = RPC_PARAM::GetPriceByCdp(view.GetCw().priceFeedCache, cdp);
     Object obj;
     obj.push_back(Pair("cdp", cdp.ToJson(bcoinMedianPrice)));
     return obj;
@@ -756,11 +758,12 @@ extern Value getassetinfo(const Array& params, bool fHelp) {
     }
     const TokenSymbol& assetSymbol = params[0].get_str();
 
+    CRPCReadView view;
     CAsset asset;
-    if (!pCdMan->pAssetCache->GetAsset(assetSymbol, asset))
+    if (!view.GetCw().assetCache.GetAsset(assetSymbol, asset))
         throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("Asset(%s) not exist!", assetSymbol));
 
-    Object obj = AssetToJson(*pCdMan->pAccountCache, asset);
+    Object obj = AssetToJson(view.GetCw().accountCache, asset);
     return obj;
 }
 
@@ -778,14 +781,15 @@ extern Value listassets(const Array& params, bool fHelp) {
         );
     }
 
-    auto pAssetsIt = pCdMan->pAssetCache->CreateUserAssetsIterator();
+    CRPCReadView view;
+    auto pAssetsIt = view.GetCw().assetCache.CreateUserAssetsIterator();
     if (!pAssetsIt) {
         throw JSONRPCError(RPC_INVALID_PARAMS, "List all user-issued assets iterator error!");
     }
 
     Array arrAssets;
     for (pAssetsIt->First(); pAssetsIt->IsValid(); pAssetsIt->Next()) {
-        arrAssets.push_back(AssetToJson(*pCdMan->pAccountCache, pAssetsIt->GetAsset()));
+        arrAssets.push_back(AssetToJson(view.GetCw().accountCache, pAssetsIt->GetAsset()));
     }
 
     Object obj;
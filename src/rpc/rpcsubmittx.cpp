@@ -38,6 +38,7 @@
 #include "wasm/wasm_context.hpp"
 #include "wasm/wasm_rpc_message.hpp"
 #include "wasm/wasm_variant_trace.hpp"
+#include "wasm/wasm_memory_pool.hpp"
 #include "wasm/exception/exceptions.hpp"
 #include "wasm/wasm_control_rpc.hpp"
 
@@ -710,3 +711,18 @@ Value wasm_getstate( const Array &params, bool fHelp ) {
 
 }
 
+Value wasm_getmemorystats( const Array &params, bool fHelp ) {
+
+    RESPONSE_RPC_HELP( fHelp || params.size() != 0 , wasm::rpc::get_memory_stats_wasm_rpc_help_message)
+
+    auto stats = wasm::wasm_memory_pool::get_stats();
+
+    Object obj;
+    obj.push_back(Pair("acquired",          stats.acquired));
+    obj.push_back(Pair("pool_hits",         stats.pool_hits));
+    obj.push_back(Pair("mapped",            stats.mapped));
+    obj.push_back(Pair("unmapped",          stats.unmapped));
+    obj.push_back(Pair("discarded_pages",   stats.discarded_pages));
+    obj.push_back(Pair("page_faults",       stats.page_faults));
+    return obj;
+}
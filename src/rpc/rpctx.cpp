@@ -756,7 +756,8 @@ Value listcontracts(const Array& params, bool fHelp) {
 
     bool showDetail = params[0].get_bool();
 
-    auto dbIt = MakeDbIterator(pCdMan->pContractCache->contractCache);
+    CRPCReadView view;
+    auto dbIt = MakeDbIterator(view.GetCw().contractCache.contractCache);
     Object obj;
     Array contractArray;
     for (dbIt->First(); dbIt->IsValid(); dbIt->Next()) {
@@ -795,12 +796,13 @@ Value getcontractinfo(const Array& params, bool fHelp) {
             HelpExampleRpc("getcontractinfo", "1-1"));
 
     CRegID regid(params[0].get_str());
-    if (regid.IsEmpty() || !pCdMan->pContractCache->HasContract(regid)) {
+    CRPCReadView view;
+    if (regid.IsEmpty() || !view.GetCw().contractCache.HasContract(regid)) {
         throw JSONRPCError(RPC_INVALID_PARAMS, "Invalid contract regid.");
     }
 
     CUniversalContractStore contractStore;
-    if (!pCdMan->pContractCache->GetContract(regid, contractStore)) {
+    if (!view.GetCw().contractCache.GetContract(regid, contractStore)) {
         throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to acquire contract from db.");
     }
 
@@ -890,8 +892,9 @@ Value getcontractdata(const Array& params, bool fHelp) {
     } else {
         key = params[1].get_str();
     }
+    CRPCReadView view;
     string value;
-    if (!pCdMan->pContractCache->GetContractData(regId, key, value)) {
+    if (!view.GetCw().contractCache.GetContractData(regId, key, value)) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Failed to acquire contract data");
     }
 
@@ -1009,6 +1012,8 @@ Value submittxraw(const Array& params, bool fHelp) {
             auto &signatureDest = *it->second.second;
             signatureDest = signature;
         }
+        // the signatures change the size of the tx measured when it was deserialized
+        pBaseTx->ClearTxSize();
     }
 
     string retMsg;
@@ -1145,6 +1150,7 @@ Value signtxraw(const Array& params, bool fHelp) {
         itemObj.push_back(Pair("signature", HexStr(signatureDest)));
         signatureArray.push_back(itemObj);
     }
+    pBaseTx->ClearTxSize();
 
     CDataStream ds(SER_DISK, CLIENT_VERSION);
     ds << pBaseTx;
@@ -17,6 +17,7 @@
 #include "config/configuration.h"
 #include "main.h"
 #include "vm/luavm/luavmrunenv.h"
+#include "vm/luavm/luavmprofiler.h"
 #include <algorithm>
 
 #include "commons/json/json_spirit_utils.h"
@@ -357,4 +358,62 @@ Value luavm_executecontract(const Array& params, bool fHelp) {
     retObj.push_back(Pair("fuel_fee", contractInvokeTx.GetFuelFee(*spCw, height, contractInvokeTx.nFuelRate)));
 
     return retObj;
-}
\ No newline at end of file
+}
+Value luavm_setprofiler(const Array& params, bool fHelp) {
+    if (fHelp || params.size() < 1 || params.size() > 2) {
+        throw runtime_error(
+            "luavm_setprofiler enabled [reset]\n"
+            "\nenable or disable the profiling of the lua contract executions.\n"
+            "\nArguments:\n"
+            "1.\"enabled\":   (bool, required) enable the profiler\n"
+            "2.\"reset\":     (bool, optional) clear the recorded profiles, default false\n"
+            "\nResult:\n"
+            "\"enabled\":     (bool) whether the profiler is enabled\n"
+            "\nExamples:\n"
+            + HelpExampleCli("luavm_setprofiler", "true true")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("luavm_setprofiler", "true, true"));
+    }
+
+    CLuaVMProfiler &profiler = CLuaVMProfiler::Instance();
+    profiler.SetEnabled(params[0].get_bool());
+    if (params.size() > 1 && params[1].get_bool())
+        profiler.Reset();
+
+    Object obj;
+    obj.push_back(Pair("enabled", profiler.IsEnabled()));
+    return obj;
+}
+
+Value luavm_getprofile(const Array& params, bool fHelp) {
+    if (fHelp || params.size() > 2) {
+        throw runtime_error(
+            "luavm_getprofile [count] [\"order_by\"]\n"
+            "\nget the costs of the most expensive lua contracts executed in the last 10 to 20 minutes.\n"
+            "\nArguments:\n"
+            "1.\"count\":     (numeric, optional) max number of contracts to return, default 20\n"
+            "2.\"order_by\":  (string, optional) time|fuel|instructions|executions|readbytes|writebytes,"
+            " default time\n"
+            "\nResult:\n"
+            "\"enabled\":     (bool) whether the profiler is enabled\n"
+            "\"contracts\":   (array) execution costs per contract, including the calls of the mylib functions\n"
+            "\nExamples:\n"
+            + HelpExampleCli("luavm_getprofile", "10 \"fuel\"")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("luavm_getprofile", "10, \"fuel\""));
+    }
+
+    int64_t count = params.size() > 0 ? params[0].get_int64() : 20;
+    if (count <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be positive");
+
+    string orderBy = params.size() > 1 ? params[1].get_str() : "time";
+    if (!CLuaVMProfiler::IsValidOrderBy(orderBy))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("invalid order_by: %s", orderBy));
+
+    CLuaVMProfiler &profiler = CLuaVMProfiler::Instance();
+    Object obj;
+    obj.push_back(Pair("enabled",   profiler.IsEnabled()));
+    obj.push_back(Pair("contracts", profiler.GetTopContracts(count, orderBy)));
+    return obj;
+}
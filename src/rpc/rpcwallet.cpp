@@ -738,8 +738,11 @@ Value getwalletinfo(const Array& params, bool fHelp) {
     obj.push_back(Pair("wallet_encrypted",  pWalletMain->IsEncrypted()));
     obj.push_back(Pair("wallet_locked",     pWalletMain->IsLocked()));
     obj.push_back(Pair("unlocked_until",    nWalletUnlockTime));
-    obj.push_back(Pair("coinfirmed_tx_num", (int32_t)pWalletMain->mapInBlockTx.size()));
-    obj.push_back(Pair("unconfirmed_tx_num",(int32_t)pWalletMain->unconfirmedTx.size()));
+    {
+        LOCK(pWalletMain->cs_wallet);
+        obj.push_back(Pair("coinfirmed_tx_num", (int32_t)pWalletMain->mapInBlockTx.size()));
+        obj.push_back(Pair("unconfirmed_tx_num",(int32_t)pWalletMain->unconfirmedTx.size()));
+    }
 
     return obj;
 }
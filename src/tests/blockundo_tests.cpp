@@ -0,0 +1,107 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "persistence/blockundo.h"
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(blockundo_tests)
+
+static CBlockUndo MakeBlockUndo() {
+    CBlockUndo blockUndo;
+    for (uint32_t i = 0; i < 20; i++) {
+        CTxUndo txUndo(uint256S(strprintf("%x", i + 1)));
+        // the same prefixes are used by many txs, and a tx may have no oplog at all
+        if (i % 5 != 4) {
+            CDbOpLog opLog;
+            opLog.Set(strprintf("regid-%u", i), strprintf("keyid-%u", i));
+            txUndo.dbOpLogMap.AddOpLog(dbk::REGID_KEYID, opLog);
+            opLog.Set(strprintf("regid-%u", i), string());
+            txUndo.dbOpLogMap.AddOpLog(dbk::REGID_KEYID, opLog);
+        }
+        if (i % 2 == 0) {
+            CDbOpLog opLog;
+            opLog.Set(string(64, 'a' + (i % 3)));
+            txUndo.dbOpLogMap.AddOpLog(dbk::DEX_ACTIVE_ORDER, opLog);
+        }
+        blockUndo.vtxundo.push_back(txUndo);
+    }
+    return blockUndo;
+}
+
+static void CheckBlockUndoEqual(const CBlockUndo &blockUndo1, const CBlockUndo &blockUndo2) {
+    // the legacy serialization covers every field of the undo data
+    CDataStream ss1(SER_DISK, CLIENT_VERSION);
+    CDataStream ss2(SER_DISK, CLIENT_VERSION);
+    ss1 << blockUndo1;
+    ss2 << blockUndo2;
+    BOOST_CHECK(ss1.str() == ss2.str());
+    BOOST_CHECK_EQUAL(blockUndo2.vtxundo.size(), blockUndo1.vtxundo.size());
+}
+
+static void CheckCompactRoundTrip(const CBlockUndo &blockUndo) {
+    string record;
+    blockUndo.EncodeCompact(record);
+    BOOST_CHECK(!record.empty());
+
+    CBlockUndo decodedUndo;
+    BOOST_CHECK(decodedUndo.DecodeCompact(record));
+    CheckBlockUndoEqual(blockUndo, decodedUndo);
+
+    // the record is encoded the same again from the decoded undo data
+    string record2;
+    decodedUndo.EncodeCompact(record2);
+    BOOST_CHECK(record2 == record);
+
+    // and a truncated or corrupted header is rejected
+    CBlockUndo badUndo;
+    BOOST_CHECK(!badUndo.DecodeCompact(record.substr(0, record.size() - 1)));
+    string badRecord = record;
+    badRecord[0] = 0;
+    BOOST_CHECK(!badUndo.DecodeCompact(badRecord));
+}
+
+BOOST_AUTO_TEST_CASE(compact_record_round_trip)
+{
+    CBlockUndo blockUndo = MakeBlockUndo();
+
+    SysCfg().SoftSetArgCover("-undocompress", "0");
+    CheckCompactRoundTrip(blockUndo);
+    string rawRecord;
+    blockUndo.EncodeCompact(rawRecord);
+
+    // LZ4 is used when it makes the record smaller, if built with it
+    SysCfg().SoftSetArgCover("-undocompress", "1");
+    CheckCompactRoundTrip(blockUndo);
+    string record;
+    blockUndo.EncodeCompact(record);
+#ifdef USE_LZ4
+    BOOST_CHECK(record.size() < rawRecord.size());
+#else
+    BOOST_CHECK(record == rawRecord);
+#endif
+    SysCfg().EraseArg("-undocompress");
+
+    // the marker can not be the first byte of a legacy record
+    CDataStream ssLegacy(SER_DISK, CLIENT_VERSION);
+    ssLegacy << blockUndo;
+    BOOST_CHECK(ssLegacy.str()[0] != record[0]);
+
+    CheckCompactRoundTrip(CBlockUndo());
+}
+
+BOOST_AUTO_TEST_CASE(compact_record_size)
+{
+    CBlockUndo blockUndo = MakeBlockUndo();
+    string record;
+    blockUndo.EncodeCompact(record);
+    BOOST_CHECK_EQUAL(blockUndo.GetDiskSize(), record.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,224 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "persistence/contractdb.h"
+#include "wasm/abi_serializer_cache.hpp"
+
+using namespace std;
+
+struct FContractDBTests {
+    FContractDBTests() {
+        BOOST_TEST_MESSAGE( "setup FContractDBTests" );
+        root_dir = "/tmp/coind_unit_test";
+        if (boost::filesystem::exists(root_dir))
+            BOOST_CHECK(boost::filesystem::is_directory(root_dir));
+        else
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "contractdb_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+
+        const bool isWipe = true;
+        pContractDb       = make_shared<CDBAccess>(db_dir, DBNameType::CONTRACT, false, isWipe);
+        pContractDbCache  = make_shared<CContractDBCache>(pContractDb.get());
+    }
+    ~FContractDBTests() {
+        BOOST_TEST_MESSAGE( "teardown FContractDBTests" );
+        pContractDbCache.reset();
+        pContractDb.reset();
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    static CUniversalContractStore MakeContract(const string &code, const string &abi) {
+        CUniversalContractStore contract;
+        contract.vm_type    = VMType::WASM_VM;
+        contract.maintainer = CRegID(10, 1);
+        contract.upgradable = true;
+        contract.code       = code;
+        contract.abi        = abi;
+        contract.memo       = "memo";
+        return contract;
+    }
+
+    // packed abi with a transfer action, memoField adds a string field to its struct
+    static string MakeAbi(bool memoField) {
+        wasm::abi_def abi;
+        abi.version = "wasm::abi/1.1";
+        vector<wasm::field_def> fields = {{"amount", "uint64"}};
+        if (memoField)
+            fields.emplace_back("memo", "string");
+        abi.structs.emplace_back("transfer", "", fields);
+        vector<char> packedAbi = wasm::pack(abi);
+        return string(packedAbi.begin(), packedAbi.end());
+    }
+
+    static void ApplyOpLogs(CContractDBCache &contractCache, const CDBOpLogMap &dbOpLogMap) {
+        UndoDataFuncMap undoDataFuncMap;
+        contractCache.RegisterUndoFunc(undoDataFuncMap);
+        for (const auto &opLogPair : dbOpLogMap.GetMap()) {
+            BOOST_REQUIRE(undoDataFuncMap[opLogPair.first]);
+            undoDataFuncMap[opLogPair.first](opLogPair.second);
+        }
+    }
+
+    static size_t GetOpLogCount(const CDBOpLogMap &dbOpLogMap, dbk::PrefixType prefixType) {
+        const CDbOpLogs *pDbOpLogs = dbOpLogMap.GetDbOpLogsPtr(prefixType);
+        return pDbOpLogs != nullptr ? pDbOpLogs->size() : 0;
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+    shared_ptr<CDBAccess> pContractDb;
+    shared_ptr<CContractDBCache> pContractDbCache;
+};
+
+BOOST_FIXTURE_TEST_SUITE(contractdb_tests, FContractDBTests)
+
+BOOST_AUTO_TEST_CASE(backfill_contract_meta_test)
+{
+    // a contract saved before the metadata existed
+    CRegID regid(20, 1);
+    CUniversalContractStore contract = MakeContract("code", "abi");
+    BOOST_CHECK(pContractDbCache->contractCache.SetData(CRegIDKey(regid), contract));
+    BOOST_CHECK(pContractDbCache->Flush());
+    BOOST_CHECK(!pContractDbCache->contractMetaCache.HasData(CRegIDKey(regid)));
+
+    // the cache of the block, and the txs of the block executing the contract
+    CContractDBCache blockCache;
+    blockCache.SetBaseViewPtr(pContractDbCache.get());
+    CDBOpLogMap undoOpLogMap;
+    CUniversalContractMeta contractMeta;
+    {
+        CContractDBCache txCache;
+        txCache.SetBaseViewPtr(&blockCache);
+        txCache.SetDbOpLogMap(&undoOpLogMap);
+        BOOST_CHECK(txCache.BackfillContractMeta(regid, contractMeta));
+        txCache.Flush();
+    }
+    BOOST_CHECK(contractMeta.code_hash == contract.GetCodeHash());
+    BOOST_CHECK(contractMeta.abi_hash == contract.GetAbiHash());
+    BOOST_CHECK_EQUAL(GetOpLogCount(undoOpLogMap, dbk::CONTRACT_META), 1);
+    BOOST_CHECK(blockCache.contractMetaCache.HasData(CRegIDKey(regid)));
+
+    // it is backfilled once, the later txs read the saved metadata
+    {
+        CContractDBCache txCache;
+        txCache.SetBaseViewPtr(&blockCache);
+        txCache.SetDbOpLogMap(&undoOpLogMap);
+        CUniversalContractMeta savedMeta;
+        BOOST_CHECK(txCache.BackfillContractMeta(regid, savedMeta));
+        BOOST_CHECK(savedMeta.code_hash == contractMeta.code_hash);
+        txCache.Flush();
+    }
+    BOOST_CHECK_EQUAL(GetOpLogCount(undoOpLogMap, dbk::CONTRACT_META), 1);
+    BOOST_CHECK_EQUAL(GetOpLogCount(undoOpLogMap, dbk::CONTRACT_DEF), 0);
+
+    // the block is flushed to the db cache, and then undone
+    blockCache.Flush();
+    BOOST_CHECK(pContractDbCache->contractMetaCache.HasData(CRegIDKey(regid)));
+    {
+        CContractDBCache undoCache;
+        undoCache.SetBaseViewPtr(pContractDbCache.get());
+        ApplyOpLogs(undoCache, undoOpLogMap);
+        undoCache.Flush();
+    }
+    BOOST_CHECK(!pContractDbCache->contractMetaCache.HasData(CRegIDKey(regid)));
+
+    // the contract is left as it was saved, with its metadata derived from it
+    CUniversalContractStore savedContract;
+    BOOST_CHECK(pContractDbCache->GetContract(regid, savedContract));
+    BOOST_CHECK(savedContract.code == contract.code);
+    BOOST_CHECK(pContractDbCache->GetContractMeta(regid, contractMeta));
+    BOOST_CHECK(contractMeta.code_hash == contract.GetCodeHash());
+
+    // a missing contract is not backfilled
+    BOOST_CHECK(!pContractDbCache->BackfillContractMeta(CRegID(20, 2), contractMeta));
+    BOOST_CHECK(!pContractDbCache->contractMetaCache.HasData(CRegIDKey(CRegID(20, 2))));
+}
+
+BOOST_AUTO_TEST_CASE(contract_meta_serialize_test)
+{
+    CUniversalContractStore contract = MakeContract("code", MakeAbi(false));
+    CUniversalContractMeta contractMeta(contract);
+    BOOST_CHECK(!contractMeta.abi_hash.IsNull());
+    BOOST_CHECK(contractMeta.abi_hash == contract.GetAbiHash());
+    BOOST_CHECK(contractMeta.abi_hash != contractMeta.code_hash);
+
+    CDataStream ssMeta(SER_DISK, CLIENT_VERSION);
+    ssMeta << contractMeta;
+    CUniversalContractMeta savedMeta;
+    ssMeta >> savedMeta;
+    BOOST_CHECK(ssMeta.empty());
+    BOOST_CHECK_EQUAL(savedMeta.ToString(), contractMeta.ToString());
+    BOOST_CHECK(savedMeta.abi_hash == contractMeta.abi_hash);
+
+    // the meta saved with the contract reads back the same from the db
+    CRegID regid(20, 3);
+    BOOST_CHECK(pContractDbCache->SaveContract(regid, contract));
+    BOOST_CHECK(pContractDbCache->Flush());
+    CContractDBCache readCache(pContractDb.get());
+    BOOST_CHECK(readCache.contractMetaCache.GetData(CRegIDKey(regid), savedMeta));
+    BOOST_CHECK_EQUAL(savedMeta.ToString(), contractMeta.ToString());
+
+    // an empty meta is what an erased contract leaves
+    savedMeta.SetEmpty();
+    BOOST_CHECK(savedMeta.IsEmpty());
+    BOOST_CHECK(savedMeta.abi_hash.IsNull());
+}
+
+BOOST_AUTO_TEST_CASE(abi_serializer_cache_test)
+{
+    CRegID regid(20, 4);
+    BOOST_CHECK(pContractDbCache->SaveContract(regid, MakeContract("code", MakeAbi(false))));
+
+    auto &abiCache    = wasm::abi_serializer_cache::instance();
+    uint32_t loadCount = 0;
+    auto loader = [&](vector<char> &abi) {
+        loadCount++;
+        CUniversalContractStore contract;
+        if (!pContractDbCache->GetContract(regid, contract))
+            return false;
+        abi.assign(contract.abi.begin(), contract.abi.end());
+        return true;
+    };
+    auto getSerializer = [&]() {
+        CUniversalContractMeta contractMeta;
+        BOOST_REQUIRE(pContractDbCache->GetContractMeta(regid, contractMeta));
+        return abiCache.get(regid.GetIntValue(), contractMeta.abi_hash, loader);
+    };
+
+    auto spSerializer = getSerializer();
+    BOOST_REQUIRE(spSerializer != nullptr);
+    BOOST_CHECK_EQUAL(loadCount, 1);
+    BOOST_CHECK(getSerializer() == spSerializer);
+    BOOST_CHECK_EQUAL(loadCount, 1);
+
+    // setcode with a new abi misses the cache
+    BOOST_CHECK(pContractDbCache->SaveContract(regid, MakeContract("code", MakeAbi(true))));
+    auto spNewSerializer = getSerializer();
+    BOOST_REQUIRE(spNewSerializer != nullptr);
+    BOOST_CHECK_EQUAL(loadCount, 2);
+    BOOST_CHECK(spNewSerializer != spSerializer);
+    BOOST_CHECK(getSerializer() == spNewSerializer);
+    BOOST_CHECK_EQUAL(loadCount, 2);
+
+    // setcode with the same abi hits it
+    BOOST_CHECK(pContractDbCache->SaveContract(regid, MakeContract("new code", MakeAbi(true))));
+    BOOST_CHECK(getSerializer() == spNewSerializer);
+    BOOST_CHECK_EQUAL(loadCount, 2);
+
+    // the older version was dropped, switching back loads it again
+    BOOST_CHECK(pContractDbCache->SaveContract(regid, MakeContract("code", MakeAbi(false))));
+    BOOST_CHECK(getSerializer() != spSerializer);
+    BOOST_CHECK_EQUAL(loadCount, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include <map>
 #include <boost/test/unit_test.hpp>
 #include "persistence/dbaccess.h"
+#include "persistence/dbiterator.h"
 
 using namespace std;
 
@@ -140,6 +141,125 @@ BOOST_AUTO_TEST_CASE(dbcache_multi_value_Level3_test)
 }
 
 
+BOOST_AUTO_TEST_CASE(dbcache_absent_key_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache1 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    auto pDBCache2 = make_shared< CCompositeKVCache<prefix, string, string> >(pDBCache1.get());
+    CDBCacheStats &stats = GetDBCacheStats(prefix);
+
+    // the second miss is answered without reading the db
+    string value;
+    uint64_t absentHits = stats.absent_hits;
+    BOOST_CHECK(!pDBCache2->HasData(string("regid-1")));
+    BOOST_CHECK(!pDBCache2->HasData(string("regid-1")));
+    BOOST_CHECK_EQUAL(stats.absent_hits, absentHits + 1);
+
+    // the absent key is found once set by the child cache
+    pDBCache2->SetData("regid-1", "keyid-1");
+    pDBCache2->Flush();
+    BOOST_CHECK(pDBCache1->GetData(string("regid-1"), value));
+    BOOST_CHECK( value == "keyid-1" );
+    pDBCache1->Flush();
+    BOOST_CHECK(pDBCache1->GetData(string("regid-1"), value));
+
+    // and absent again once erased and flushed, without writing the absent keys to the db
+    pDBCache1->EraseData("regid-1");
+    pDBCache1->Flush();
+    BOOST_CHECK(!pDBCache1->GetData(string("regid-1"), value));
+    BOOST_CHECK(!pDBAccess->GetData(prefix, string("regid-1"), value));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_iterator_order_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    typedef CCompositeKVCache<prefix, string, string> CacheType;
+    auto pDBCache1 = make_shared<CacheType>(pDBAccess.get());
+    auto pDBCache2 = make_shared<CacheType>(pDBCache1.get());
+    pDBCache1->SetData("regid-2", "keyid-2");
+    pDBCache1->SetData("regid-4", "keyid-4");
+    pDBCache1->Flush();
+
+    // the keys of the map are iterated in key order, merged with the keys of the db
+    pDBCache2->SetData("regid-5", "keyid-5");
+    pDBCache2->SetData("regid-1", "keyid-1");
+    pDBCache2->SetData("regid-3", "keyid-3");
+    pDBCache2->EraseData("regid-4");
+
+    vector<string> keys;
+    auto pIt = MakeDbIterator(*pDBCache2);
+    for (pIt->First(); pIt->IsValid(); pIt->Next())
+        keys.push_back(pIt->GetKey());
+    BOOST_CHECK(keys == vector<string>({"regid-1", "regid-2", "regid-3", "regid-5"}));
+
+    string start = "regid-2";
+    BOOST_CHECK(pIt->SeekUpper(&start) && pIt->GetKey() == "regid-3");
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_map_sorted_view_test)
+{
+    typedef CDBCacheMap<string, string> Map;
+    auto GetKeys = [](const Map &map, const Map::SortedView &view) {
+        vector<string> keys;
+        for (Map::SortedCursor cursor(&map, view); cursor.IsValid(); cursor.Next())
+            keys.push_back(map.GetEntry(cursor.GetIndex()).first);
+        return keys;
+    };
+
+    // keys inserted in a scrambled order between the views, past the size merging the delta into the run
+    Map map;
+    vector<string> sortedKeys;
+    for (uint32_t i = 0; i < 1000; i++) {
+        string key = strprintf("key-%04u", (i * 7919) % 1000);
+        map.emplace(key, "value");
+        sortedKeys.push_back(key);
+        if (i % 37 != 0)
+            continue;
+
+        Map::SortedView view = map.GetSortedView();
+        std::sort(sortedKeys.begin(), sortedKeys.end());
+        BOOST_CHECK(GetKeys(map, view) == sortedKeys);
+    }
+    std::sort(sortedKeys.begin(), sortedKeys.end());
+    Map::SortedView view = map.GetSortedView();
+    BOOST_CHECK(GetKeys(map, view) == sortedKeys);
+    BOOST_CHECK(view.spRun->size() + view.spDelta->size() == map.size());
+    BOOST_CHECK(!view.spRun->empty() && view.spDelta->size() * view.spDelta->size() <= view.spRun->size() + 64 * 64);
+
+    // a view taken before an insertion does not show the new key
+    map.emplace("key-0500a", "value");
+    BOOST_CHECK(GetKeys(map, view) == sortedKeys);
+    Map::SortedCursor cursor(&map, map.GetSortedView());
+    cursor.Seek("key-0500", true);
+    BOOST_CHECK(cursor.IsValid() && map.GetEntry(cursor.GetIndex()).first == "key-0500a");
+    cursor.Next();
+    BOOST_CHECK(cursor.IsValid() && map.GetEntry(cursor.GetIndex()).first == "key-0501");
+
+    // the entries copied to another map keep their order without sorting them again
+    Map keptMap;
+    vector<uint32_t> newIndexes(map.size(), UINT32_MAX);
+    vector<string> keptKeys;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        if (it->first.back() % 2 == 0) {
+            newIndexes[it.GetIndex()] = keptMap.emplace(it->first, it->second).first.GetIndex();
+            keptKeys.push_back(it->first);
+        }
+    }
+    keptMap.KeepSortedView(map, newIndexes);
+    std::sort(keptKeys.begin(), keptKeys.end());
+    Map::SortedView keptView = keptMap.GetSortedView();
+    BOOST_CHECK(keptView.spDelta->empty());
+    BOOST_CHECK(GetKeys(keptMap, keptView) == keptKeys);
+}
+
 BOOST_AUTO_TEST_CASE(dbcache_scalar_value_Level3_test)
 {
     const bool isWipe = true;
@@ -168,8 +288,8 @@ static uint32_t GetSerSize(const T &t) {
 template <typename CacheType>
 static uint32_t GetCacheSerializeSize(CacheType &cache) {
     uint32_t ret = 0;
-    for (auto item : cache.GetMapData()) {
-        ret += GetSerSize(item.first) + GetSerSize(*item.second);
+    for (const auto &item : cache.GetMapData()) {
+        ret += GetSerSize(item.first) + GetSerSize(item.second);
     }
     return ret;
 }
@@ -198,4 +318,201 @@ BOOST_AUTO_TEST_CASE(dbcache_cache_size_test)
     BOOST_CHECK(!pDBCache2->IsCalcSize() && pDBCache2->GetCacheSize() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(dbcache_resident_flush_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    pDBCache->SetData("regid-1", "keyid-1");
+    pDBCache->SetData("regid-2", "keyid-2");
+    pDBCache->SetData("regid-3", "keyid-3");
+    pDBCache->EraseData("regid-3");
+    {
+        CDBCacheEvictionScope scope(1.0);
+        pDBCache->Flush();
+    }
+    // the written entries stay clean in memory, the erased one is dropped
+    uint32_t entrySize = GetSerSize(make_pair<string, string>("regid-1", "keyid-1"));
+    BOOST_CHECK(pDBCache->GetMapData().size() == 2);
+    BOOST_CHECK(pDBCache->GetCacheSize() == 2 * entrySize);
+    BOOST_CHECK(pDBCache->GetCacheSize() == GetCacheSerializeSize(*pDBCache));
+
+    // a copy takes only the dirty entries
+    pDBCache->SetData("regid-4", "keyid-4");
+    CCompositeKVCache<prefix, string, string> copyCache(*pDBCache);
+    BOOST_CHECK(copyCache.GetMapData().size() == 1);
+    BOOST_CHECK(copyCache.GetCacheSize() == entrySize);
+
+    // over the budget, the entries read since the previous sweep are kept first
+    {
+        CDBCacheEvictionScope scope(1.0);
+        pDBCache->Flush();
+    }
+    {
+        CDBCacheEvictionScope scope(0.5);
+        pDBCache->Flush();
+    }
+    string value;
+    BOOST_CHECK(pDBCache->GetData(string("regid-2"), value));
+    {
+        CDBCacheEvictionScope scope(0.5);
+        pDBCache->Flush();
+    }
+    BOOST_CHECK(pDBCache->GetMapData().size() == 1);
+    BOOST_CHECK(pDBCache->GetMapData().find("regid-2") != pDBCache->GetMapData().end());
+    BOOST_CHECK(pDBCache->GetCacheSize() == entrySize);
+
+    // out of a scope, a flush drops all the entries
+    pDBCache->Flush();
+    BOOST_CHECK(pDBCache->GetCacheSize() == 0);
+    BOOST_CHECK(pDBCache->GetData(string("regid-4"), value) && value == "keyid-4");
+    BOOST_CHECK(!pDBCache->HasData(string("regid-3")));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_in_place_evict_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    typedef CCompositeKVCache<prefix, string, string> CacheType;
+    auto pDBCache = make_shared<CacheType>(pDBAccess.get());
+    for (uint32_t i = 0; i < 8; i++)
+        pDBCache->SetData(strprintf("regid-%u", i), strprintf("keyid-%u", i));
+    {
+        CDBCacheEvictionScope scope(1.0);
+        pDBCache->Flush();
+    }
+    BOOST_CHECK(pDBCache->GetMapData().size() == 8);
+
+    // the erased entries are dropped in place, the others keep their index
+    string value;
+    auto &mapData = pDBCache->GetMapData();
+    uint32_t index5 = mapData.find("regid-5").GetIndex();
+    pDBCache->EraseData("regid-1");
+    pDBCache->EraseData("regid-2");
+    pDBCache->SetData("regid-5", "keyid-55");
+    {
+        CDBCacheEvictionScope scope(1.0);
+        pDBCache->Flush();
+    }
+    BOOST_CHECK(mapData.size() == 6 && mapData.GetEntryCount() == 8 && mapData.GetRemovedCount() == 2);
+    BOOST_CHECK(mapData.find("regid-1") == mapData.end());
+    BOOST_CHECK(mapData.find("regid-5").GetIndex() == index5);
+    BOOST_CHECK(pDBAccess->GetData(prefix, string("regid-5"), value) && value == "keyid-55");
+    BOOST_CHECK(!pDBAccess->GetData(prefix, string("regid-1"), value));
+    BOOST_CHECK(pDBCache->GetCacheSize() == GetCacheSerializeSize(*pDBCache));
+
+    // a removed key inserted again is visited once, in key order
+    pDBCache->SetData("regid-1", "keyid-11");
+    vector<string> keys;
+    auto pIt = MakeDbIterator(*pDBCache);
+    for (pIt->First(); pIt->IsValid(); pIt->Next())
+        keys.push_back(pIt->GetKey());
+    BOOST_CHECK(keys == vector<string>({"regid-0", "regid-1", "regid-3", "regid-4", "regid-5", "regid-6", "regid-7"}));
+
+    // the live entries are moved into new storage once the removed ones outnumber them
+    for (uint32_t i = 3; i < 7; i++)
+        pDBCache->EraseData(strprintf("regid-%u", i));
+    {
+        CDBCacheEvictionScope scope(1.0);
+        pDBCache->Flush();
+    }
+    BOOST_CHECK(mapData.size() == 3 && mapData.GetEntryCount() == 3 && mapData.GetRemovedCount() == 0);
+    BOOST_CHECK(pDBCache->GetCacheSize() == GetCacheSerializeSize(*pDBCache));
+    keys.clear();
+    for (pIt->First(); pIt->IsValid(); pIt->Next())
+        keys.push_back(pIt->GetKey());
+    BOOST_CHECK(keys == vector<string>({"regid-0", "regid-1", "regid-7"}));
+    BOOST_CHECK(pDBCache->GetData(string("regid-1"), value) && value == "keyid-11");
+    BOOST_CHECK(!pDBCache->HasData(string("regid-4")));
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_deferred_write_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    pDBCache->SetData("regid-1", "keyid-1");
+
+    CDBWriteBatches writeBatches;
+    {
+        CDBWriteBatchScope scope(writeBatches);
+        pDBCache->Flush();
+    }
+    // the entry is not in the db yet, so it is neither evicted nor left out of a copy
+    string value;
+    BOOST_CHECK(!pDBAccess->GetData(prefix, string("regid-1"), value));
+    BOOST_CHECK(pDBCache->GetData(string("regid-1"), value) && value == "keyid-1");
+    CCompositeKVCache<prefix, string, string> copyCache(*pDBCache);
+    BOOST_CHECK(copyCache.GetMapData().size() == 1);
+
+    writeBatches.Write(pDBAccess.get());
+    BOOST_CHECK(GetDBDurableGeneration() == writeBatches.GetGeneration());
+    BOOST_CHECK(pDBAccess->GetData(prefix, string("regid-1"), value) && value == "keyid-1");
+
+    pDBCache->Flush();
+    BOOST_CHECK(pDBCache->GetCacheSize() == 0);
+    CCompositeKVCache<prefix, string, string> copyCache2(*pDBCache);
+    BOOST_CHECK(copyCache2.GetData(string("regid-1"), value) && value == "keyid-1");
+}
+
+BOOST_AUTO_TEST_CASE(db_tuning_test)
+{
+    string strError;
+    BOOST_CHECK(GetDBTuning(DBNameType::CONTRACT).blockCacheSize == (size_t)DBCacheSize[DBNameType::CONTRACT] / 2);
+    BOOST_CHECK(ParseDBTuning("contracts:cache=64,writebuffer=16,openfiles=256,compression=1", strError));
+    const CDBTuning &tuning = GetDBTuning(DBNameType::CONTRACT);
+    BOOST_CHECK(tuning.blockCacheSize == (64 << 20) && tuning.writeBufferSize == (16 << 20));
+    BOOST_CHECK(tuning.maxOpenFiles == 256 && tuning.bloomBits == 10 && tuning.compression);
+
+    BOOST_CHECK(!ParseDBTuning("contract:cache=64", strError));
+    BOOST_CHECK(!ParseDBTuning("contracts:cache=-1", strError));
+    BOOST_CHECK(!ParseDBTuning("contracts:cachesize=64", strError));
+
+    // the tuning is global, the dbs of the later tests are opened with the default one
+    ResetDBTuning(DBNameType::CONTRACT);
+    BOOST_CHECK(GetDBTuning(DBNameType::CONTRACT).blockCacheSize == (size_t)DBCacheSize[DBNameType::CONTRACT] / 2);
+    BOOST_CHECK(GetDBTuning(DBNameType::CONTRACT).maxOpenFiles == 64 && !GetDBTuning(DBNameType::CONTRACT).compression);
+}
+
+BOOST_AUTO_TEST_CASE(dbcache_snapshot_test)
+{
+    const bool isWipe = true;
+    const dbk::PrefixType prefix = dbk::REGID_KEYID;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(
+        db_dir, DBNameType::ACCOUNT, false, isWipe);
+
+    auto pDBCache = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+    pDBCache->SetData("regid-1", "keyid-1");
+    pDBCache->Flush();
+
+    auto pSnapshotSet = make_shared<CDBSnapshotSet>();
+    pSnapshotSet->Add(pDBAccess.get());
+
+    pDBCache->SetData("regid-1", "keyid-1-new");
+    pDBCache->SetData("regid-2", "keyid-2");
+    pDBCache->Flush();
+
+    {
+        CDBSnapshotScope scope(*pSnapshotSet);
+        auto pViewCache = make_shared< CCompositeKVCache<prefix, string, string> >(pDBAccess.get());
+        string value1;
+        BOOST_CHECK(pViewCache->GetData(string("regid-1"), value1));
+        BOOST_CHECK( value1 == "keyid-1" );
+        BOOST_CHECK(!pViewCache->HasData(string("regid-2")));
+    }
+
+    string value1;
+    BOOST_CHECK(pDBAccess->GetData(prefix, string("regid-1"), value1));
+    BOOST_CHECK( value1 == "keyid-1-new" );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
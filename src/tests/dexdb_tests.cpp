@@ -0,0 +1,172 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "persistence/dexdb.h"
+
+using namespace std;
+using namespace dex;
+
+struct FDexDBTests {
+    FDexDBTests() {
+        BOOST_TEST_MESSAGE( "setup FDexDBTests" );
+        root_dir = "/tmp/coind_unit_test";
+        if (boost::filesystem::exists(root_dir))
+            BOOST_CHECK(boost::filesystem::is_directory(root_dir));
+        else
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "dexdb_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+        SysCfg().SetDexOrderBookIndex(true);
+    }
+    ~FDexDBTests() {
+        BOOST_TEST_MESSAGE( "teardown FDexDBTests" );
+        SysCfg().SetDexOrderBookIndex(false);
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+};
+
+BOOST_FIXTURE_TEST_SUITE(dexdb_tests, FDexDBTests)
+
+static CDEXOrderDetail MakeSellOrder(uint64_t price, uint64_t assetAmount, const CTxCord &txCord) {
+    CDEXOrderDetail order;
+    order.generate_type = USER_GEN_ORDER;
+    order.order_type    = ORDER_LIMIT_PRICE;
+    order.order_side    = ORDER_SELL;
+    order.coin_symbol   = SYMB::WUSD;
+    order.asset_symbol  = SYMB::WICC;
+    order.asset_amount  = assetAmount;
+    order.price         = price;
+    order.tx_cord       = txCord;
+    return order;
+}
+
+static CDEXPriceLevel GetSellLevel(CDexDBCache &dexCache, uint64_t price) {
+    vector<pair<uint64_t, CDEXPriceLevel>> levels;
+    BOOST_CHECK(dexCache.GetOrderBookLevels(CDEXOrderBookSide(SYMB::WICC, SYMB::WUSD, ORDER_SELL), 10, levels));
+    for (const auto &item : levels) {
+        if (item.first == price)
+            return item.second;
+    }
+    return CDEXPriceLevel();
+}
+
+BOOST_AUTO_TEST_CASE(order_book_index_deal_erase_undo_test)
+{
+    const bool isWipe = true;
+    const uint64_t price = 2 * PRICE_BOOST;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(db_dir, DBNameType::DEX, false, isWipe);
+    CDexDBCache dbCache(pDBAccess.get());
+
+    uint256 orderId1 = uint256S("01");
+    uint256 orderId2 = uint256S("02");
+    CDEXOrderDetail order1 = MakeSellOrder(price, 100, CTxCord(10, 1));
+    CDEXOrderDetail order2 = MakeSellOrder(price, 50, CTxCord(10, 2));
+    BOOST_CHECK(dbCache.CreateActiveOrder(orderId1, order1));
+    BOOST_CHECK(dbCache.CreateActiveOrder(orderId2, order2));
+    dbCache.Flush();
+
+    CDEXPriceLevel level = GetSellLevel(dbCache, price);
+    BOOST_CHECK_EQUAL(level.asset_amount, 150);
+    BOOST_CHECK_EQUAL(level.order_count, 2);
+
+    // the txs of a block, with their op logs
+    CDexDBCache blockCache;
+    blockCache.SetBaseViewPtr(&dbCache);
+    CDBOpLogMap dbOpLogMap;
+    blockCache.SetDbOpLogMap(&dbOpLogMap);
+
+    // a partial deal leaves the remaining amount on the level
+    order1.total_deal_asset_amount = 40;
+    BOOST_CHECK(blockCache.UpdateActiveOrder(orderId1, order1));
+    level = GetSellLevel(blockCache, price);
+    BOOST_CHECK_EQUAL(level.asset_amount, 110);
+    BOOST_CHECK_EQUAL(level.order_count, 2);
+
+    // the order is filled and erased with its final deal amounts, the level loses the stored remaining amount
+    order1.total_deal_asset_amount = 100;
+    BOOST_CHECK(blockCache.EraseActiveOrder(orderId1, order1));
+    level = GetSellLevel(blockCache, price);
+    BOOST_CHECK_EQUAL(level.asset_amount, 50);
+    BOOST_CHECK_EQUAL(level.order_count, 1);
+
+    // erasing the last order removes the level
+    BOOST_CHECK(blockCache.EraseActiveOrder(orderId2, order2));
+    BOOST_CHECK(GetSellLevel(blockCache, price).IsEmpty());
+
+    // the undo of the block restores the index as it was
+    UndoDataFuncMap undoDataFuncMap;
+    blockCache.RegisterUndoFunc(undoDataFuncMap);
+    for (const auto &opLogPair : dbOpLogMap.GetMap()) {
+        BOOST_CHECK(undoDataFuncMap[opLogPair.first]);
+        undoDataFuncMap[opLogPair.first](opLogPair.second);
+    }
+    level = GetSellLevel(blockCache, price);
+    BOOST_CHECK_EQUAL(level.asset_amount, 150);
+    BOOST_CHECK_EQUAL(level.order_count, 2);
+
+    CDEXOrderDetail restoredOrder;
+    BOOST_CHECK(blockCache.GetActiveOrder(orderId1, restoredOrder));
+    BOOST_CHECK_EQUAL(restoredOrder.total_deal_asset_amount, 0);
+
+    // and the restored orders are erased again from the restored amounts
+    BOOST_CHECK(blockCache.EraseActiveOrder(orderId1, restoredOrder));
+    level = GetSellLevel(blockCache, price);
+    BOOST_CHECK_EQUAL(level.asset_amount, 50);
+    BOOST_CHECK_EQUAL(level.order_count, 1);
+}
+
+BOOST_AUTO_TEST_CASE(last_pos_of_snapshot_chain_test)
+{
+    // the chain of a read snapshot, resolved without chainActive
+    vector<uint256> hashes;
+    for (uint32_t height = 0; height <= 10; height++)
+        hashes.push_back(uint256S(strprintf("%x", height + 1)));
+    vector<CBlockIndex> indexes(hashes.size());
+    for (uint32_t height = 0; height < indexes.size(); height++) {
+        indexes[height].pBlockHash = &hashes[height];
+        indexes[height].height     = height;
+        indexes[height].pprev      = height > 0 ? &indexes[height - 1] : nullptr;
+        indexes[height].BuildSkip();
+    }
+    const CBlockIndex *pTipIndex = &indexes.back();
+
+    DEXBlockOrdersCache::KeyType lastKey(CFixedUInt32(5), (uint8_t)USER_GEN_ORDER, uint256S("aa"));
+    string lastPosInfo;
+    BOOST_CHECK(DEX_DB::MakeLastPos(pTipIndex, lastKey, lastPosInfo) == nullptr);
+
+    DEXBlockOrdersCache::KeyType parsedKey;
+    BOOST_CHECK(DEX_DB::ParseLastPos(pTipIndex, lastPosInfo, parsedKey) == nullptr);
+    BOOST_CHECK(parsedKey == lastKey);
+
+    // still valid on a snapshot of a later block of the same chain
+    BOOST_CHECK(DEX_DB::ParseLastPos(&indexes[7], lastPosInfo, parsedKey) == nullptr);
+
+    // but not on a snapshot before the block of the position
+    BOOST_CHECK(DEX_DB::ParseLastPos(&indexes[4], lastPosInfo, parsedKey) != nullptr);
+
+    // nor on a fork chain replacing that block
+    uint256 forkHash = uint256S("f5");
+    CBlockIndex forkIndex;
+    forkIndex.pBlockHash = &forkHash;
+    forkIndex.height     = 5;
+    forkIndex.pprev      = &indexes[4];
+    forkIndex.BuildSkip();
+    BOOST_CHECK(DEX_DB::ParseLastPos(&forkIndex, lastPosInfo, parsedKey) != nullptr);
+
+    DEXBlockOrdersCache::KeyType futureKey(CFixedUInt32(11), (uint8_t)USER_GEN_ORDER, uint256S("aa"));
+    BOOST_CHECK(DEX_DB::MakeLastPos(pTipIndex, futureKey, lastPosInfo) != nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "persistence/cachewrapper.h"
+#include "tx/dextx.h"
+
+using namespace std;
+using namespace dex;
+
+struct FDexTxTests {
+    FDexTxTests() {
+        BOOST_TEST_MESSAGE( "setup FDexTxTests" );
+        root_dir = "/tmp/coind_unit_test";
+        if (boost::filesystem::exists(root_dir))
+            BOOST_CHECK(boost::filesystem::is_directory(root_dir));
+        else
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "dextx_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+        SysCfg().SetDexOrderBookIndex(true);
+    }
+    ~FDexTxTests() {
+        BOOST_TEST_MESSAGE( "teardown FDexTxTests" );
+        SysCfg().SetDexOrderBookIndex(false);
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+};
+
+BOOST_FIXTURE_TEST_SUITE(dextx_tests, FDexTxTests)
+
+static CDEXOrderDetail MakeOrder(OrderSide side, uint64_t assetAmount, const CTxCord &txCord) {
+    CDEXOrderDetail order;
+    order.generate_type = USER_GEN_ORDER;
+    order.order_type    = ORDER_LIMIT_PRICE;
+    order.order_side    = side;
+    order.coin_symbol   = SYMB::WUSD;
+    order.asset_symbol  = SYMB::WICC;
+    order.asset_amount  = assetAmount;
+    order.coin_amount   = assetAmount * 2;
+    order.price         = 2 * PRICE_BOOST;
+    order.tx_cord       = txCord;
+    return order;
+}
+
+BOOST_AUTO_TEST_CASE(deal_order_batch_test)
+{
+    const bool isWipe = true;
+    shared_ptr<CDBAccess> pDBAccess = make_shared<CDBAccess>(db_dir, DBNameType::DEX, false, isWipe);
+    CDexDBCache dbCache(pDBAccess.get());
+
+    uint256 sellOrderId = uint256S("01");
+    uint256 buyOrderId1 = uint256S("02");
+    uint256 buyOrderId2 = uint256S("03");
+    CDEXOrderDetail sellOrder = MakeOrder(ORDER_SELL, 100, CTxCord(10, 1));
+    CDEXOrderDetail buyOrder1 = MakeOrder(ORDER_BUY, 60, CTxCord(10, 2));
+    CDEXOrderDetail buyOrder2 = MakeOrder(ORDER_BUY, 60, CTxCord(10, 3));
+    BOOST_CHECK(dbCache.CreateActiveOrder(sellOrderId, sellOrder));
+    BOOST_CHECK(dbCache.CreateActiveOrder(buyOrderId1, buyOrder1));
+    BOOST_CHECK(dbCache.CreateActiveOrder(buyOrderId2, buyOrder2));
+    DexOperatorDetail dexOperator;
+    dexOperator.owner_regid        = CRegID(5, 1);
+    dexOperator.fee_receiver_regid = CRegID(5, 1);
+    dexOperator.name               = "test-dex";
+    BOOST_CHECK(dbCache.CreateDexOperator(1, dexOperator));
+    dbCache.Flush();
+
+    CCacheWrapper cw;
+    cw.dexCache.SetBaseViewPtr(&dbCache);
+    CValidationState state;
+    CTxExecuteContext context(20, 1, 1, 0, 0, &cw, &state);
+    CDEXSettleTx tx;
+    CDealOrderBatch batch(tx, context);
+
+    // the orders and operators are loaded once
+    auto pSellState = batch.GetOrder(sellOrderId);
+    BOOST_CHECK(pSellState != nullptr && pSellState->order.asset_amount == 100);
+    BOOST_CHECK(batch.GetOrder(sellOrderId) == pSellState);
+    BOOST_CHECK(batch.GetOrder(uint256S("04")) == nullptr);
+    DexOperatorDetail operatorDetail;
+    BOOST_CHECK(batch.GetOperator(1, operatorDetail, "test") && operatorDetail.name == "test-dex");
+    BOOST_CHECK(batch.GetOperator(1, operatorDetail, "test") && operatorDetail.name == "test-dex");
+    BOOST_CHECK_EQUAL(batch.operator_map.size(), 1);
+
+    // deal item 1: buy order 1 is filled by part of the sell order
+    CDEXOrderDetail order = pSellState->order;
+    order.total_deal_asset_amount = 60;
+    batch.SetOrder(sellOrderId, order, false);
+    order = batch.GetOrder(buyOrderId1)->order;
+    order.total_deal_asset_amount = 60;
+    batch.SetOrder(buyOrderId1, order, true);
+
+    // deal item 2: the rest of the sell order fills part of buy order 2
+    BOOST_CHECK(batch.GetOrder(buyOrderId1) == nullptr);
+    order = batch.GetOrder(sellOrderId)->order;
+    BOOST_CHECK_EQUAL(order.total_deal_asset_amount, 60);
+    order.total_deal_asset_amount = 100;
+    batch.SetOrder(sellOrderId, order, true);
+    order = batch.GetOrder(buyOrderId2)->order;
+    order.total_deal_asset_amount = 40;
+    batch.SetOrder(buyOrderId2, order, false);
+    BOOST_CHECK(batch.GetOrder(sellOrderId) == nullptr);
+
+    // nothing is written before the flush, then each modified order is written once
+    CDEXOrderDetail storedOrder;
+    BOOST_CHECK(cw.dexCache.GetActiveOrder(sellOrderId, storedOrder) && storedOrder.total_deal_asset_amount == 0);
+    BOOST_CHECK(batch.modified_order_ids == vector<uint256>({sellOrderId, buyOrderId1, buyOrderId2}));
+    BOOST_CHECK(batch.Flush());
+
+    BOOST_CHECK(!cw.dexCache.HaveActiveOrder(sellOrderId));
+    BOOST_CHECK(!cw.dexCache.HaveActiveOrder(buyOrderId1));
+    BOOST_CHECK(cw.dexCache.GetActiveOrder(buyOrderId2, storedOrder) && storedOrder.total_deal_asset_amount == 40);
+
+    // the order book index holds the remaining amount of buy order 2 only
+    vector<pair<uint64_t, CDEXPriceLevel>> levels;
+    BOOST_CHECK(cw.dexCache.GetOrderBookLevels(CDEXOrderBookSide(SYMB::WICC, SYMB::WUSD, ORDER_SELL), 10, levels));
+    BOOST_CHECK(levels.empty());
+    BOOST_CHECK(cw.dexCache.GetOrderBookLevels(CDEXOrderBookSide(SYMB::WICC, SYMB::WUSD, ORDER_BUY), 10, levels));
+    BOOST_CHECK(levels.size() == 1 && levels[0].second.asset_amount == 20 && levels[0].second.order_count == 1);
+
+    // the base cache is untouched until the tx cache is flushed
+    BOOST_CHECK(dbCache.HaveActiveOrder(sellOrderId));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "persistence/forkstate.h"
+
+using namespace std;
+
+struct FForkStateTests {
+    FForkStateTests() {
+        BOOST_TEST_MESSAGE( "setup FForkStateTests" );
+        root_dir = "/tmp/coind_unit_test";
+        if (boost::filesystem::exists(root_dir))
+            BOOST_CHECK(boost::filesystem::is_directory(root_dir));
+        else
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "forkstate_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+    }
+    ~FForkStateTests() {
+        BOOST_TEST_MESSAGE( "teardown FForkStateTests" );
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+};
+
+BOOST_FIXTURE_TEST_SUITE(forkstate_tests, FForkStateTests)
+
+static CRegIDKey RegIdKey(uint16_t index) { return CRegIDKey(CRegID(10, index)); }
+
+static CKeyID KeyId(uint8_t n) { return CKeyID(uint160(vector<uint8_t>(20, n))); }
+
+static CKeyID GetKeyId(CCacheWrapper &cw, uint16_t index) {
+    CKeyID keyId;
+    cw.accountCache.regId2KeyIdCache.GetData(RegIdKey(index), keyId);
+    return keyId;
+}
+
+static void ApplyOpLogs(CCacheWrapper &cw, const CDBOpLogMap &dbOpLogMap) {
+    const UndoDataFuncMap &undoDataFuncMap = cw.GetUndoDataFuncMap();
+    for (const auto &opLogPair : dbOpLogMap.GetMap()) {
+        BOOST_CHECK(undoDataFuncMap[opLogPair.first]);
+        undoDataFuncMap[opLogPair.first](opLogPair.second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fork_view_across_reorg_test)
+{
+    const bool isWipe = true;
+    shared_ptr<CDBAccess> pAccountDb = make_shared<CDBAccess>(db_dir, DBNameType::ACCOUNT, false, isWipe);
+    shared_ptr<CDBAccess> pBlockDb   = make_shared<CDBAccess>(db_dir, DBNameType::BLOCK, false, isWipe);
+    CAccountDBCache accountDbCache(pAccountDb.get());
+    CBlockDBCache blockDbCache(pBlockDb.get());
+
+    // the chain state at the active tip 1
+    uint256 tipHash1 = uint256S("01");
+    BOOST_CHECK(accountDbCache.regId2KeyIdCache.SetData(RegIdKey(1), KeyId(1)));
+    BOOST_CHECK(accountDbCache.regId2KeyIdCache.SetData(RegIdKey(2), KeyId(2)));
+    BOOST_CHECK(blockDbCache.SetBestBlock(tipHash1));
+
+    CCacheWrapper globalCW;
+    globalCW.accountCache.SetBaseViewPtr(&accountDbCache);
+    globalCW.blockCache.SetBaseViewPtr(&blockDbCache);
+
+    CForkStateManager forkStateManager;
+    forkStateManager.SetBaseView(&globalCW);
+
+    // the view of a fork chain whose best block is forked from tip 1, it has read regid 1 and written regid 3
+    uint256 forkHash = uint256S("f1");
+    auto spForkCW    = make_shared<CCacheWrapper>(&globalCW);
+    BOOST_CHECK(GetKeyId(*spForkCW, 1) == KeyId(1));
+    BOOST_CHECK(spForkCW->accountCache.regId2KeyIdCache.SetData(RegIdKey(3), KeyId(13)));
+    BOOST_CHECK(spForkCW->blockCache.SetBestBlock(forkHash));
+    forkStateManager.SetForkView(forkHash, spForkCW);
+
+    // block 2 is connected to the active tip, changing all of regids 1, 2 and 3
+    uint256 tipHash2 = uint256S("02");
+    CDBOpLogMap undoOpLogMap;
+    {
+        CCacheWrapper tipCW(&globalCW);
+        tipCW.SetDbOpLogMap(&undoOpLogMap);
+        BOOST_CHECK(tipCW.accountCache.regId2KeyIdCache.SetData(RegIdKey(1), KeyId(21)));
+        BOOST_CHECK(tipCW.accountCache.regId2KeyIdCache.EraseData(RegIdKey(2)));
+        BOOST_CHECK(tipCW.accountCache.regId2KeyIdCache.SetData(RegIdKey(3), KeyId(23)));
+        tipCW.SetDbOpLogMap(nullptr);
+        BOOST_CHECK(tipCW.blockCache.SetBestBlock(tipHash2));
+        tipCW.Flush();
+    }
+    BOOST_CHECK(GetKeyId(globalCW, 1) == KeyId(21));
+    BOOST_CHECK(globalCW.blockCache.GetBestBlockHash() == tipHash2);
+
+    forkStateManager.RebaseForkViews([&](CCacheWrapper &cw) {
+        ApplyOpLogs(cw, undoOpLogMap);
+        return cw.blockCache.SetBestBlock(tipHash1);
+    });
+
+    // the view is kept across the tip change, with the chain state it had
+    auto spRebasedCW = forkStateManager.GetForkView(forkHash);
+    BOOST_CHECK(spRebasedCW != nullptr);
+    BOOST_CHECK(GetKeyId(*spRebasedCW, 1) == KeyId(1));
+    BOOST_CHECK(GetKeyId(*spRebasedCW, 2) == KeyId(2));
+    BOOST_CHECK(GetKeyId(*spRebasedCW, 3) == KeyId(13));
+    BOOST_CHECK(spRebasedCW->blockCache.GetBestBlockHash() == forkHash);
+
+    // block 2 is disconnected, the values replaced by its undo are logged as its redo
+    CDBOpLogMap redoOpLogMap;
+    {
+        CCacheWrapper tipCW(&globalCW);
+        tipCW.SetDbOpLogMap(&redoOpLogMap);
+        ApplyOpLogs(tipCW, undoOpLogMap);
+        tipCW.SetDbOpLogMap(nullptr);
+        BOOST_CHECK(tipCW.blockCache.SetBestBlock(tipHash1));
+        tipCW.Flush();
+    }
+    BOOST_CHECK(GetKeyId(globalCW, 1) == KeyId(1));
+    BOOST_CHECK(GetKeyId(globalCW, 2) == KeyId(2));
+    BOOST_CHECK(GetKeyId(globalCW, 3) == CKeyID());
+
+    // a view of the chain state at block 2, which is now the best block of a fork chain
+    auto spTip2CW = make_shared<CCacheWrapper>(&globalCW);
+    ApplyOpLogs(*spTip2CW, redoOpLogMap);
+    BOOST_CHECK(spTip2CW->blockCache.SetBestBlock(tipHash2));
+    forkStateManager.SetForkView(tipHash2, spTip2CW);
+
+    forkStateManager.RebaseForkViews([&](CCacheWrapper &cw) {
+        ApplyOpLogs(cw, redoOpLogMap);
+        return cw.blockCache.SetBestBlock(tipHash2);
+    });
+
+    // both views still hold their chain states over the disconnected tip
+    spRebasedCW = forkStateManager.GetForkView(forkHash);
+    BOOST_CHECK(GetKeyId(*spRebasedCW, 1) == KeyId(1));
+    BOOST_CHECK(GetKeyId(*spRebasedCW, 2) == KeyId(2));
+    BOOST_CHECK(GetKeyId(*spRebasedCW, 3) == KeyId(13));
+    BOOST_CHECK(spRebasedCW->blockCache.GetBestBlockHash() == forkHash);
+
+    spTip2CW = forkStateManager.GetForkView(tipHash2);
+    BOOST_CHECK(GetKeyId(*spTip2CW, 1) == KeyId(21));
+    BOOST_CHECK(GetKeyId(*spTip2CW, 2) == CKeyID());
+    BOOST_CHECK(GetKeyId(*spTip2CW, 3) == KeyId(23));
+    BOOST_CHECK(spTip2CW->blockCache.GetBestBlockHash() == tipHash2);
+
+    // a view failed to be rebased is dropped
+    forkStateManager.RebaseForkViews([&](CCacheWrapper &cw) { return false; });
+    BOOST_CHECK(forkStateManager.GetForkView(forkHash) == nullptr);
+    BOOST_CHECK(forkStateManager.GetForkView(tipHash2) == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,254 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "tx/contracttx.h"
+#include "vm/luavm/luavmrunenv.h"
+
+using namespace std;
+
+static const CRegID CONTRACT_A(20, 1);
+static const CRegID CONTRACT_B(20, 2);
+
+static const vector<string> DATA_KEYS = {"k1", "k2", "k3", "k4", "k5", "k6", "k7"};
+
+// lua table literal of the raw regid, the id argument of mylib.GetContractData()
+static string LuaRegId(const CRegID &regid) {
+    string ret;
+    for (uint8_t b : regid.GetRegIdRaw())
+        ret += (ret.empty() ? "{" : ", ") + std::to_string(b);
+    return ret + "}";
+}
+
+static const string LUA_HELPERS = R"(
+local function Bytes(s)
+    local t = {}
+    for i = 1, #s do t[i] = string.byte(s, i) end
+    return t
+end
+local function Write(k, v)
+    assert(mylib.WriteData({key = k, length = #v, value = Bytes(v)}), "WriteData failed")
+end
+local function Read(k)
+    return string.char(mylib.ReadData(k))
+end
+local function ReadOf(id, k)
+    return string.char(mylib.GetContractData({id = id, key = k}))
+end
+)";
+
+// sets, erases, re-sets and reads its keys, and reads the data of contract B
+static string MakeContractA() {
+    return LUA_HELPERS + R"(
+Write("k1", "v1")
+Write("k2", "v2")
+assert(mylib.DeleteData("k1"), "DeleteData failed")
+Write("k1", "v1v1")
+assert(mylib.DeleteData("k2"), "DeleteData failed")
+Write("k3", Read("k1") .. Read("k2") .. Read("k4"))
+Write("k5", ReadOf()" + LuaRegId(CONTRACT_B) + R"(, "k1"))
+assert(mylib.ModifyData({key = "k1", length = 2, value = Bytes("v3")}), "ModifyData failed")
+)";
+}
+
+// reads the data written by contract A before it, and rewrites its key of the same name
+static string MakeContractB() {
+    return LUA_HELPERS + R"(
+Write("k6", ReadOf()" + LuaRegId(CONTRACT_A) + R"(, "k1") .. ReadOf()" + LuaRegId(CONTRACT_A) + R"(, "k3"))
+Write("k1", "b2")
+assert(mylib.DeleteData("k1"), "DeleteData failed")
+Write("k1", "b3")
+Write("k7", Read("k1"))
+)";
+}
+
+struct FLuaVMTests {
+    FLuaVMTests() {
+        BOOST_TEST_MESSAGE( "setup FLuaVMTests" );
+        root_dir = "/tmp/coind_unit_test";
+        if (boost::filesystem::exists(root_dir))
+            BOOST_CHECK(boost::filesystem::is_directory(root_dir));
+        else
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "luavm_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+
+        const bool isWipe = true;
+        pContractDb       = make_shared<CDBAccess>(db_dir, DBNameType::CONTRACT, false, isWipe);
+        pContractDbCache  = make_shared<CContractDBCache>(pContractDb.get());
+
+        BOOST_CHECK(pContractDbCache->SetContractData(CONTRACT_A, "k1", "old"));
+        BOOST_CHECK(pContractDbCache->SetContractData(CONTRACT_B, "k1", "b"));
+        BOOST_CHECK(pContractDbCache->Flush());
+        initialData = GetData(*pContractDbCache);
+    }
+    ~FLuaVMTests() {
+        BOOST_TEST_MESSAGE( "teardown FLuaVMTests" );
+        pContractDbCache.reset();
+        pContractDb.reset();
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    typedef map<pair<CRegID, string>, string> ContractDataMap;
+
+    static ContractDataMap GetData(CContractDBCache &contractCache) {
+        ContractDataMap ret;
+        for (const CRegID &regid : {CONTRACT_A, CONTRACT_B}) {
+            for (const string &key : DATA_KEYS) {
+                string value;
+                if (contractCache.GetContractData(regid, key, value))
+                    ret[make_pair(regid, key)] = value;
+            }
+        }
+        return ret;
+    }
+
+    // the value of each key before the first change logged for it, by serialized key
+    static map<string, string> GetOldValues(const CDBOpLogMap &dbOpLogMap) {
+        map<string, string> ret;
+        const CDbOpLogs *pDbOpLogs = dbOpLogMap.GetDbOpLogsPtr(dbk::CONTRACT_DATA);
+        if (pDbOpLogs != nullptr) {
+            for (const auto &dbOpLog : *pDbOpLogs)
+                ret.emplace(dbOpLog.GetKey(), dbOpLog.GetValue());
+        }
+        return ret;
+    }
+
+    static size_t GetOpLogCount(const CDBOpLogMap &dbOpLogMap) {
+        const CDbOpLogs *pDbOpLogs = dbOpLogMap.GetDbOpLogsPtr(dbk::CONTRACT_DATA);
+        return pDbOpLogs != nullptr ? pDbOpLogs->size() : 0;
+    }
+
+    // executes contract A and then contract B on a tx cache of the block cache, as the txs of one block
+    bool ExecuteContracts(CContractDBCache &contractCache, bool useDataWorkingSet, CDBOpLogMap &dbOpLogMap,
+                          vector<uint64_t> &fuels) {
+        CCacheWrapper cw;
+        cw.contractCache.SetBaseViewPtr(&contractCache);
+        cw.contractCache.SetDbOpLogMap(&dbOpLogMap);
+
+        CLuaContractInvokeTx tx;
+        tx.txUid        = CRegID(10, 1);
+        tx.app_uid      = CONTRACT_A;
+        tx.valid_height = 100;
+
+        auto spTxAccount   = make_shared<CAccount>(CKeyID(uint160(vector<uint8_t>(20, 1))));
+        spTxAccount->regid = CRegID(10, 1);
+
+        fuels.clear();
+        for (const CRegID &regid : {CONTRACT_A, CONTRACT_B}) {
+            CUniversalContractStore contractStore;
+            contractStore.vm_type = VMType::LUA_VM;
+            contractStore.code    = regid == CONTRACT_A ? MakeContractA() : MakeContractB();
+            string arguments;
+
+            auto spAppAccount   = make_shared<CAccount>(CKeyID(uint160(vector<uint8_t>(20, 2))));
+            spAppAccount->regid = regid;
+
+            CLuaVMContext luaContext;
+            luaContext.p_cw           = &cw;
+            luaContext.height         = SysCfg().GetVer2ForkHeight();
+            luaContext.p_base_tx      = &tx;
+            luaContext.fuel_limit     = 1000000;
+            luaContext.sp_tx_account  = spTxAccount;
+            luaContext.sp_app_account = spAppAccount;
+            luaContext.p_contract     = &contractStore;
+            luaContext.p_arguments    = &arguments;
+
+            CLuaVMRunEnv vmRunEnv;
+            vmRunEnv.SetContractDataWorkingSet(useDataWorkingSet);
+            uint64_t fuel = 0;
+            string errMsg;
+            if (!vmRunEnv.ExecuteContract(&luaContext, fuel, errMsg)) {
+                BOOST_ERROR("execute contract failed: " + errMsg);
+                return false;
+            }
+            fuels.push_back(fuel);
+        }
+
+        cw.contractCache.Flush();
+        return true;
+    }
+
+    static void ApplyOpLogs(CContractDBCache &contractCache, const CDBOpLogMap &dbOpLogMap) {
+        UndoDataFuncMap undoDataFuncMap;
+        contractCache.RegisterUndoFunc(undoDataFuncMap);
+        for (const auto &opLogPair : dbOpLogMap.GetMap()) {
+            BOOST_REQUIRE(undoDataFuncMap[opLogPair.first]);
+            undoDataFuncMap[opLogPair.first](opLogPair.second);
+        }
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+    shared_ptr<CDBAccess> pContractDb;
+    shared_ptr<CContractDBCache> pContractDbCache;
+    ContractDataMap initialData;
+};
+
+BOOST_FIXTURE_TEST_SUITE(luavm_tests, FLuaVMTests)
+
+BOOST_AUTO_TEST_CASE(contract_data_working_set_test)
+{
+    // the block caches of the two runs, with the undo oplogs of their txs
+    CContractDBCache directCache, workingSetCache;
+    directCache.SetBaseViewPtr(pContractDbCache.get());
+    workingSetCache.SetBaseViewPtr(pContractDbCache.get());
+    CDBOpLogMap directOpLogMap, workingSetOpLogMap;
+
+    vector<uint64_t> directFuels, workingSetFuels;
+    BOOST_REQUIRE(ExecuteContracts(directCache, false, directOpLogMap, directFuels));
+    BOOST_REQUIRE(ExecuteContracts(workingSetCache, true, workingSetOpLogMap, workingSetFuels));
+
+    // the same fuel is burned
+    BOOST_CHECK(workingSetFuels == directFuels);
+    BOOST_CHECK(directFuels[0] > 0 && directFuels[1] > 0);
+
+    // the same contract data results
+    ContractDataMap directData = GetData(directCache);
+    BOOST_CHECK(GetData(workingSetCache) == directData);
+    BOOST_CHECK_EQUAL(directData[make_pair(CONTRACT_A, "k1")], "v3");
+    BOOST_CHECK(directData.count(make_pair(CONTRACT_A, "k2")) == 0);
+    BOOST_CHECK_EQUAL(directData[make_pair(CONTRACT_A, "k3")], "v1v1");
+    BOOST_CHECK_EQUAL(directData[make_pair(CONTRACT_A, "k5")], "b");
+    BOOST_CHECK_EQUAL(directData[make_pair(CONTRACT_B, "k1")], "b3");
+    BOOST_CHECK_EQUAL(directData[make_pair(CONTRACT_B, "k6")], "v3v1v1");
+    BOOST_CHECK_EQUAL(directData[make_pair(CONTRACT_B, "k7")], "b3");
+
+    // the same undo oplogs of the net changes: one per key changed by a run, logging the value before the
+    // run, and the keys rewritten by the direct run to the value they had before are not logged
+    map<string, string> directOldValues     = GetOldValues(directOpLogMap);
+    map<string, string> workingSetOldValues = GetOldValues(workingSetOpLogMap);
+    BOOST_CHECK(GetOpLogCount(directOpLogMap) > GetOpLogCount(workingSetOpLogMap));
+    BOOST_CHECK_EQUAL(GetOpLogCount(workingSetOpLogMap), workingSetOldValues.size());
+    for (const auto &item : directOldValues) {
+        auto it = workingSetOldValues.find(item.first);
+        if (it != workingSetOldValues.end()) {
+            BOOST_CHECK(it->second == item.second);
+            continue;
+        }
+
+        // contract A k2, set and erased by the same run
+        CDataStream ssValue(item.second, SER_DISK, CLIENT_VERSION);
+        string oldValue;
+        ssValue >> oldValue;
+        BOOST_CHECK(oldValue.empty());
+    }
+    BOOST_CHECK_EQUAL(workingSetOldValues.size() + 1, directOldValues.size());
+
+    // and the undo restores the data of both
+    ApplyOpLogs(directCache, directOpLogMap);
+    ApplyOpLogs(workingSetCache, workingSetOpLogMap);
+    BOOST_CHECK(GetData(directCache) == initialData);
+    BOOST_CHECK(GetData(workingSetCache) == initialData);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,79 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "miner/miner.h"
+#include "tx/blockpricemediantx.h"
+#include "tx/cdptx.h"
+#include "tx/contracttx.h"
+#include "tx/pricefeedtx.h"
+#include "tx/txmempool.h"
+#include "txmempooltestaccess.h"
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(miner_tests)
+
+static std::shared_ptr<CBaseTx> AddEntry(CTxMemPool &pool, CBaseTx &tx) {
+    CTxMemPoolEntry entry(&tx, 0, 100);
+    CTxMemPoolTestAccess::AddEntry(pool, tx.GetHash(), entry, tx.txUid.ToString());
+    return entry.GetTransaction();
+}
+
+static std::shared_ptr<CBaseTx> AddContractTx(CTxMemPool &pool, uint16_t user, uint64_t fees) {
+    CLuaContractInvokeTx tx;
+    tx.txUid        = CRegID(10, user);
+    tx.app_uid      = CRegID(20, 1);
+    tx.valid_height = 100;
+    tx.llFees       = fees;
+    return AddEntry(pool, tx);
+}
+
+BOOST_AUTO_TEST_CASE(priority_tier_test)
+{
+    // the priorities of the user txs and of the CDP interest settlement tx are of tier 0
+    BOOST_CHECK_EQUAL(CTxMemPoolRank::GetTier(TRANSACTION_PRIORITY_CEILING / 200), 0);
+    BOOST_CHECK_EQUAL(CTxMemPoolRank::GetTier(TRANSACTION_PRIORITY_CEILING), 0);
+    BOOST_CHECK(CTxMemPoolRank::GetTier(PRICE_MEDIAN_TRANSACTION_PRIORITY) > 0);
+    BOOST_CHECK(CTxMemPoolRank::GetTier(PRICE_FEED_TRANSACTION_PRIORITY) >
+                CTxMemPoolRank::GetTier(PRICE_MEDIAN_TRANSACTION_PRIORITY));
+}
+
+BOOST_AUTO_TEST_CASE(packing_order_test)
+{
+    CTxMemPool pool;
+    LOCK(pool.cs);
+
+    auto spLowTx  = AddContractTx(pool, 1, 1000);
+    auto spHighTx = AddContractTx(pool, 2, 3000);
+    CPriceFeedTx priceFeedTx(CRegID(10, 3), 100, SYMB::WICC, 1000, vector<CPricePoint>());
+    auto spPriceFeedTx = AddEntry(pool, priceFeedTx);
+    auto spMidTx  = AddContractTx(pool, 4, 2000);
+
+    // the txs created by the producer, as CreateNewBlockForStableCoinRelease does
+    set<CTxMemPoolRank> producerTxs;
+    auto spPriceMedianTx = std::make_shared<CBlockPriceMedianTx>(100);
+    auto spForceSettleTx = std::make_shared<CCDPInterestForceSettleTx>(100);
+    producerTxs.emplace(PRICE_MEDIAN_TRANSACTION_PRIORITY, 0, spPriceMedianTx);
+    producerTxs.emplace(TRANSACTION_PRIORITY_CEILING, 0, spForceSettleTx);
+
+    // the zero fee interest settlement tx is packed after the user txs, as it was by its fee
+    vector<std::shared_ptr<CBaseTx>> txs;
+    GetPriorityTx(pool, producerTxs, txs);
+    vector<std::shared_ptr<CBaseTx>> expectedTxs = {spPriceFeedTx, spPriceMedianTx, spHighTx, spMidTx, spLowTx,
+                                                    spForceSettleTx};
+    BOOST_CHECK(txs == expectedTxs);
+
+    // and only the mempool txs are packed without the producer txs
+    txs.clear();
+    GetPriorityTx(pool, set<CTxMemPoolRank>(), txs);
+    expectedTxs = {spPriceFeedTx, spHighTx, spMidTx, spLowTx};
+    BOOST_CHECK(txs == expectedTxs);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
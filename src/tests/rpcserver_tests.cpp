@@ -0,0 +1,46 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <set>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "rpc/core/rpcserver.h"
+#include "rpc/rpcapiconf.h"
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(rpcserver_tests)
+
+BOOST_AUTO_TEST_CASE(thread_safe_commands_test)
+{
+    // The thread safe handlers run without cs_main: they read the chain state only through CRPCReadView,
+    // and resolve blocks by its tip index, neither they nor their *ToJson helpers touch chainActive or the
+    // caches of pCdMan. A handler is added here only once it has been checked to do so.
+    const set<string> auditedCommands = {
+        // the thread safe handlers the table had before the read views, which read no snapshot state
+        "help", "stop", "validateaddr", "createmulsig", "addnode", "getaddednodeinfo", "getnettotals",
+        "getfcoingenesistxinfo", "getblockcount", "getdbcachestats", "invalidateblock", "reconsiderblock",
+        "getminedblocks", "getminerbyblocktime", "getwalletinfo", "setgenerate", "wasm_getmemorystats",
+        "startcommontpstest", "startcontracttpstest", "luavm_executescript", "luavm_executecontract",
+        "luavm_setprofiler", "luavm_getprofile", "dumpdb", "genutxomultiinputcondhash", "genutxomultisignaddr",
+        "genutxomultisignature",
+        // read through CRPCReadView
+        "listcontracts", "getcontractinfo", "getcontractdata", "getcdpinfo", "getusercdp", "getdexorder",
+        "listdexsysorders", "listdexorders", "getdexorderbook", "listdexbookorders", "getdexoperator",
+        "getdexoperatorbyowner", "getassetinfo", "listassets",
+    };
+
+    set<string> threadSafeCommands;
+    for (const auto &command : vRPCCommands) {
+        if (command.threadSafe)
+            threadSafeCommands.insert(command.name);
+    }
+
+    for (const auto &name : threadSafeCommands)
+        BOOST_CHECK_MESSAGE(auditedCommands.count(name), "thread safe command " + name + " is not audited");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
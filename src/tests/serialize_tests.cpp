@@ -160,4 +160,31 @@ BOOST_AUTO_TEST_CASE(insert_delete)
     BOOST_CHECK_EQUAL(ss.size(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(span_and_inline_streams)
+{
+    CDataStream ss(SER_DISK, 0);
+    ss << string("key") << (uint32_t)7 << VARINT(300);
+
+    // the inline stream encodes the same bytes, also once spilled to the heap
+    CInlineDataStream<4> ssInline(SER_DISK, 0);
+    ssInline << string("key") << (uint32_t)7 << VARINT(300);
+    BOOST_CHECK_EQUAL(ssInline.str(), ss.str());
+    ssInline.clear();
+    BOOST_CHECK(ssInline.empty());
+    ssInline << (uint8_t)1;
+    BOOST_CHECK_EQUAL(ssInline.size(), 1);
+
+    string raw = ss.str();
+    CDataSpanStream ssSpan(raw.data(), raw.data() + raw.size(), SER_DISK, 0);
+    string str;
+    uint32_t n = 0;
+    uint32_t varint = 0;
+    ssSpan >> str >> n >> VARINT(varint);
+    BOOST_CHECK_EQUAL(str, "key");
+    BOOST_CHECK_EQUAL(n, 7);
+    BOOST_CHECK_EQUAL(varint, 300);
+    BOOST_CHECK(ssSpan.empty());
+    BOOST_CHECK_THROW(ssSpan >> n, std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "net.h"
+#include "tx/txserializer.h"
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(tx_tests)
+
+static std::shared_ptr<CLuaContractInvokeTx> MakeContractTx(const string &arguments) {
+    auto spTx          = std::make_shared<CLuaContractInvokeTx>();
+    spTx->txUid        = CRegID(10, 1);
+    spTx->app_uid      = CRegID(20, 1);
+    spTx->valid_height = 100;
+    spTx->llFees       = 100000;
+    spTx->arguments    = arguments;
+    return spTx;
+}
+
+static CDataStream SerializeTx(const std::shared_ptr<CBaseTx> &spTx) {
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << spTx;
+    return ss;
+}
+
+BOOST_AUTO_TEST_CASE(tx_size_test)
+{
+    // the size of a tx built locally follows its fields
+    auto spTx = MakeContractTx("args");
+    BOOST_CHECK_EQUAL(spTx->GetTxSize(), spTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+    uint32_t unsignedSize = spTx->GetTxSize();
+    spTx->signature.assign(70, 1);
+    BOOST_CHECK_EQUAL(spTx->GetTxSize(), unsignedSize + 70);
+    BOOST_CHECK_EQUAL(SerializeTx(spTx).size(), spTx->GetTxSize() + 1);
+
+    // as the price median tx of the miner, whose prices are filled after it was ranked
+    CBlockPriceMedianTx medianTx(100);
+    uint32_t emptySize = medianTx.GetTxSize();
+    medianTx.median_prices[PriceCoinPair(SYMB::WICC, SYMB::USD)] = 100000;
+    BOOST_CHECK(medianTx.GetTxSize() > emptySize);
+    BOOST_CHECK_EQUAL(medianTx.GetTxSize(), medianTx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+
+    // the size of a deserialized tx is measured once, and shared by its copies and the threads reading it
+    CDataStream ss = SerializeTx(spTx);
+    std::shared_ptr<CBaseTx> spReadTx;
+    ss >> spReadTx;
+    BOOST_CHECK_EQUAL(spReadTx->serializedSize, spTx->GetTxSize());
+    BOOST_CHECK_EQUAL(spReadTx->GetTxSize(), spTx->GetTxSize());
+    BOOST_CHECK_EQUAL(spReadTx->GetNewInstance()->GetTxSize(), spTx->GetTxSize());
+
+    vector<uint32_t> sizes(4, 0);
+    vector<std::thread> threads;
+    for (size_t i = 0; i < sizes.size(); i++)
+        threads.emplace_back([&, i]() { sizes[i] = spReadTx->GetTxSize(); });
+    for (auto &t : threads)
+        t.join();
+    for (uint32_t size : sizes)
+        BOOST_CHECK_EQUAL(size, spTx->GetTxSize());
+
+    // and measured again once it is changed, as by submittxraw
+    auto *pReadTx = (CLuaContractInvokeTx *)spReadTx.get();
+    pReadTx->signature.assign(72, 2);
+    pReadTx->ClearTxSize();
+    BOOST_CHECK_EQUAL(spReadTx->GetTxSize(), unsignedSize + 72);
+}
+
+BOOST_AUTO_TEST_CASE(raw_tx_relay_test)
+{
+    auto spTx = MakeContractTx("args");
+    spTx->signature.assign(70, 1);
+
+    // the message holds the tx and more data after it
+    CDataStream vRecv = SerializeTx(spTx);
+    string txBytes(vRecv.begin(), vRecv.end());
+    vRecv << string("trailing");
+
+    std::shared_ptr<CBaseTx> spReadTx;
+    UnserializeReceivedTx(vRecv, spReadTx);
+    BOOST_REQUIRE(spReadTx->rawTx != nullptr);
+    BOOST_CHECK(string(spReadTx->rawTx->begin(), spReadTx->rawTx->end()) == txBytes);
+    BOOST_CHECK_EQUAL(spReadTx->GetTxSize() + 1, txBytes.size());
+
+    // the tx is relayed byte-identical to the bytes received, not serialized again
+    auto *pReadTx = (CLuaContractInvokeTx *)spReadTx.get();
+    pReadTx->arguments = "changed";
+    uint256 txid = spReadTx->GetHash();
+    RelayTransaction(spReadTx.get(), txid);
+    {
+        LOCK(cs_mapRelay);
+        auto it = mapRelay.find(CInv(MSG_TX, txid));
+        BOOST_REQUIRE(it != mapRelay.end());
+        BOOST_CHECK(string(it->second.begin(), it->second.end()) == txBytes);
+        mapRelay.erase(it);
+    }
+
+    // a tx built locally is serialized to be relayed
+    RelayTransaction(spTx.get(), spTx->GetHash());
+    {
+        LOCK(cs_mapRelay);
+        auto it = mapRelay.find(CInv(MSG_TX, spTx->GetHash()));
+        BOOST_REQUIRE(it != mapRelay.end());
+        BOOST_CHECK(string(it->second.begin(), it->second.end()) == txBytes);
+        mapRelay.erase(it);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
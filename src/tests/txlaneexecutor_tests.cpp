@@ -0,0 +1,175 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "persistence/blockundo.h"
+#include "tx/contracttx.h"
+#include "tx/txlaneexecutor.h"
+
+using namespace std;
+
+// reads the keyid of regid read_index and writes a keyid derived from it to regid write_index
+struct CLaneTestOp {
+    uint16_t user;
+    uint16_t app;
+    uint16_t read_index;
+    uint16_t write_index;
+};
+
+struct FTxLaneExecutorTests {
+    FTxLaneExecutorTests() {
+        BOOST_TEST_MESSAGE( "setup FTxLaneExecutorTests" );
+        root_dir = "/tmp/coind_unit_test";
+        if (boost::filesystem::exists(root_dir))
+            BOOST_CHECK(boost::filesystem::is_directory(root_dir));
+        else
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "txlaneexecutor_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+
+        const bool isWipe = true;
+        pAccountDb        = make_shared<CDBAccess>(db_dir, DBNameType::ACCOUNT, false, isWipe);
+        pAccountDbCache   = make_shared<CAccountDBCache>(pAccountDb.get());
+        for (uint16_t index = 1; index <= MAX_INDEX; index++)
+            BOOST_CHECK(pAccountDbCache->regId2KeyIdCache.SetData(RegIdKey(index), KeyId(index)));
+
+        blockIndex.height = 100;
+        blockIndex.nTime  = 1000;
+        StartContractLaneExecutor(threadGroup, 2);
+    }
+    ~FTxLaneExecutorTests() {
+        BOOST_TEST_MESSAGE( "teardown FTxLaneExecutorTests" );
+        threadGroup.interrupt_all();
+        threadGroup.join_all();
+        pAccountDbCache.reset();
+        pAccountDb.reset();
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    static const uint16_t MAX_INDEX = 8;
+
+    static CRegIDKey RegIdKey(uint16_t index) { return CRegIDKey(CRegID(10, index)); }
+
+    static CKeyID KeyId(uint8_t n) { return CKeyID(uint160(vector<uint8_t>(20, n))); }
+
+    static CKeyID GetKeyId(CCacheWrapper &cw, uint16_t index) {
+        CKeyID keyId;
+        cw.accountCache.regId2KeyIdCache.GetData(RegIdKey(index), keyId);
+        return keyId;
+    }
+
+    void MakeBlock(const vector<CLaneTestOp> &opsIn) {
+        ops = opsIn;
+        block.vptx.clear();
+        block.vptx.push_back(make_shared<CLuaContractInvokeTx>());  // stands for the reward tx
+        for (size_t i = 0; i < ops.size(); i++) {
+            auto spTx          = make_shared<CLuaContractInvokeTx>();
+            spTx->txUid        = CRegID(10, ops[i].user);
+            spTx->app_uid      = CRegID(20, ops[i].app);
+            spTx->valid_height = blockIndex.height;
+            spTx->llFees       = i + 1;
+            block.vptx.push_back(spTx);
+        }
+    }
+
+    // the execution of the tx depends on the state written by the txs before it
+    bool ExecuteTx(CBaseTx &tx, CTxExecuteContext &context) {
+        const CLaneTestOp &op = ops[context.index - 1];
+        CKeyID keyId          = GetKeyId(*context.pCw, op.read_index);
+        uint8_t n             = *keyId.begin() + context.index;
+        return context.pCw->accountCache.regId2KeyIdCache.SetData(RegIdKey(op.write_index), KeyId(n));
+    }
+
+    // connects the txs of the block as ConnectBlock does, serially if the lanes are not used
+    void ConnectTxs(CCacheWrapper &cw, CBlockUndo &blockUndo, bool useLanes, bool &executedInLanes) {
+        int32_t endIndex = block.vptx.size();
+        vector<CTxUndo> laneTxUndos;
+        executedInLanes  = useLanes && ExecuteContractTxLanes(block, 1, endIndex, &blockIndex, cw, laneTxUndos,
+            [this](CBaseTx &tx, CTxExecuteContext &context) { return ExecuteTx(tx, context); });
+        if (executedInLanes) {
+            blockUndo.vtxundo = laneTxUndos;
+            return;
+        }
+
+        for (int32_t index = 1; index < endIndex; index++) {
+            CTxUndoOpLogger opLogger(cw, block.vptx[index]->GetHash(), blockUndo);
+            CValidationState state;
+            CTxExecuteContext context(blockIndex.height, index, block.GetFuelRate(), blockIndex.nTime,
+                                      blockIndex.nTime, &cw, &state);
+            BOOST_CHECK(ExecuteTx(*block.vptx[index], context));
+        }
+    }
+
+    // the state and the undo of the block equal those of the serial execution
+    void CheckLanesEqualSerial(bool expectLanes) {
+        CCacheWrapper serialCW;
+        serialCW.accountCache.SetBaseViewPtr(pAccountDbCache.get());
+        CBlockUndo serialUndo;
+        bool executedInLanes = false;
+        ConnectTxs(serialCW, serialUndo, false, executedInLanes);
+
+        CCacheWrapper laneCW;
+        laneCW.accountCache.SetBaseViewPtr(pAccountDbCache.get());
+        CBlockUndo laneUndo;
+        ConnectTxs(laneCW, laneUndo, true, executedInLanes);
+        BOOST_CHECK_EQUAL(executedInLanes, expectLanes);
+
+        for (uint16_t index = 1; index <= MAX_INDEX; index++)
+            BOOST_CHECK(GetKeyId(laneCW, index) == GetKeyId(serialCW, index));
+
+        CDataStream ssSerial(SER_DISK, CLIENT_VERSION);
+        CDataStream ssLane(SER_DISK, CLIENT_VERSION);
+        ssSerial << serialUndo;
+        ssLane << laneUndo;
+        BOOST_CHECK(ssLane.str() == ssSerial.str());
+        BOOST_CHECK_EQUAL(laneUndo.vtxundo.size(), ops.size());
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+    shared_ptr<CDBAccess> pAccountDb;
+    shared_ptr<CAccountDBCache> pAccountDbCache;
+    boost::thread_group threadGroup;
+    CBlockIndex blockIndex;
+    CBlock block;
+    vector<CLaneTestOp> ops;
+};
+
+BOOST_FIXTURE_TEST_SUITE(txlaneexecutor_tests, FTxLaneExecutorTests)
+
+BOOST_AUTO_TEST_CASE(independent_lanes_test)
+{
+    // lane of app 1: txs 1 and 3, tx 3 reads the write of tx 1; lane of app 2: txs 2 and 4
+    MakeBlock({{1, 1, 1, 1}, {2, 2, 2, 2}, {3, 1, 1, 3}, {4, 2, 5, 4}, {5, 2, 2, 6}});
+    CheckLanesEqualSerial(true);
+}
+
+BOOST_AUTO_TEST_CASE(conflicting_lanes_test)
+{
+    // tx 4 of the lane of app 2 reads regid 1 written by tx 1 of the lane of app 1
+    MakeBlock({{1, 1, 1, 1}, {2, 2, 2, 2}, {3, 1, 1, 3}, {4, 2, 1, 4}, {5, 2, 2, 6}});
+    CheckLanesEqualSerial(false);
+
+    // and the lanes are dropped too if both of them write the same regid
+    MakeBlock({{1, 1, 1, 7}, {2, 2, 2, 2}, {3, 1, 3, 3}, {4, 2, 4, 7}});
+    CheckLanesEqualSerial(false);
+
+    // the block cache is unchanged by the dropped lanes
+    CCacheWrapper cw;
+    cw.accountCache.SetBaseViewPtr(pAccountDbCache.get());
+    vector<CTxUndo> txUndos;
+    BOOST_CHECK(!ExecuteContractTxLanes(block, 1, block.vptx.size(), &blockIndex, cw, txUndos,
+        [this](CBaseTx &tx, CTxExecuteContext &context) { return ExecuteTx(tx, context); }));
+    for (uint16_t index = 1; index <= MAX_INDEX; index++)
+        BOOST_CHECK(GetKeyId(cw, index) == KeyId(index));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,309 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "tx/contracttx.h"
+#include "tx/txmempool.h"
+#include "txmempooltestaccess.h"
+
+using namespace std;
+
+// the entries are of the same size, so that they are ranked by their fees
+static CTxMemPoolEntry MakeEntry(uint16_t user, uint64_t fees) {
+    CLuaContractInvokeTx tx;
+    tx.txUid        = CRegID(10, user);
+    tx.app_uid      = CRegID(20, 1);
+    tx.valid_height = 100;
+    tx.llFees       = fees;
+    return CTxMemPoolEntry(&tx, 0, 100);
+}
+
+static uint256 AddEntry(CTxMemPool &pool, const CTxMemPoolEntry &entry, const string &sender) {
+    uint256 txid = entry.GetTransaction()->GetHash();
+    CTxMemPoolTestAccess::AddEntry(pool, txid, entry, sender);
+    return txid;
+}
+
+struct FTxMemPoolTests {
+    FTxMemPoolTests() {
+        BOOST_TEST_MESSAGE( "setup FTxMemPoolTests" );
+        root_dir = "/tmp/coind_unit_test";
+        if (boost::filesystem::exists(root_dir))
+            BOOST_CHECK(boost::filesystem::is_directory(root_dir));
+        else
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "txmempool_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+
+        const bool isWipe = true;
+        pAccountDb        = make_shared<CDBAccess>(db_dir, DBNameType::ACCOUNT, false, isWipe);
+        pAccountDbCache   = make_shared<CAccountDBCache>(pAccountDb.get());
+        for (uint16_t user = 1; user <= 6; user++)
+            BOOST_CHECK(pAccountDbCache->regId2KeyIdCache.SetData(RegIdKey(user), KeyId(user)));
+
+        // the mempool cache over the chain state, which the txs are executed on
+        pool.cw = make_shared<CCacheWrapper>();
+        pool.cw->accountCache.SetBaseViewPtr(pAccountDbCache.get());
+    }
+    ~FTxMemPoolTests() {
+        BOOST_TEST_MESSAGE( "teardown FTxMemPoolTests" );
+        pool.cw.reset();
+        pAccountDbCache.reset();
+        pAccountDb.reset();
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    static CRegIDKey RegIdKey(uint16_t user) { return CRegIDKey(CRegID(10, user)); }
+
+    static CKeyID KeyId(uint8_t n) { return CKeyID(uint160(vector<uint8_t>(20, n))); }
+
+    static CKeyID GetKeyId(CCacheWrapper &cw, uint16_t user) {
+        CKeyID keyId;
+        cw.accountCache.regId2KeyIdCache.GetData(RegIdKey(user), keyId);
+        return keyId;
+    }
+
+    // executes a tx of the user which reads the keys of readUsers and writes the key of the user, recording
+    // its commit as CTxMemPool::ExecuteTxInMemPool does
+    static void ExecuteTx(CCacheWrapper &txCW, CTxMemPoolCommit &commit, uint16_t user,
+                          const vector<uint16_t> &readUsers) {
+        commit.dbOpLogMap.SetReadObserver(&commit);
+        txCW.SetDbOpLogMap(&commit.dbOpLogMap);
+        for (uint16_t readUser : readUsers)
+            GetKeyId(txCW, readUser);
+        BOOST_CHECK(txCW.accountCache.regId2KeyIdCache.SetData(RegIdKey(user), KeyId(100 + user)));
+        txCW.SetDbOpLogMap(nullptr);
+        commit.dbOpLogMap.SetReadObserver(nullptr);
+    }
+
+    // executes the tx and admits it as CTxMemPool::AddUnchecked does
+    uint256 AddTx(uint16_t user, uint64_t fees, const vector<uint16_t> &readUsers = {}) {
+        CTxMemPoolEntry entry = MakeEntry(user, fees);
+        uint256 txid          = entry.GetTransaction()->GetHash();
+        CCacheWrapper txCW(pool.cw.get());
+        CTxMemPoolCommit commit;
+        ExecuteTx(txCW, commit, user, readUsers);
+        CTxMemPoolTestAccess::AddCommittedEntry(pool, txid, entry, strprintf("%u", user), txCW, commit);
+        return txid;
+    }
+
+    // the keys read by a tx of the user
+    CDbOpKeySet GetReadKeys(uint16_t user, const vector<uint16_t> &readUsers) {
+        CCacheWrapper txCW(pool.cw.get());
+        CTxMemPoolCommit commit;
+        ExecuteTx(txCW, commit, user, readUsers);
+        return commit.keys;
+    }
+
+    bool SelectEvictions(const CTxMemPoolEntry &entry, vector<uint256> &evictTxids, CValidationState &state,
+                         const CDbOpKeySet &readKeys = CDbOpKeySet()) {
+        return CTxMemPoolTestAccess::SelectEvictions(pool, entry.GetTransaction()->GetHash(), entry, readKeys,
+                                                     evictTxids, state);
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+    shared_ptr<CDBAccess> pAccountDb;
+    shared_ptr<CAccountDBCache> pAccountDbCache;
+    CTxMemPool pool;
+};
+
+BOOST_FIXTURE_TEST_SUITE(txmempool_tests, FTxMemPoolTests)
+
+BOOST_AUTO_TEST_CASE(eviction_test)
+{
+    LOCK(pool.cs);
+
+    vector<uint256> txids;
+    for (uint16_t i = 1; i <= 5; i++)
+        txids.push_back(AddTx(i, i * 1000));
+    pool.SetLimits(pool.GetUsage(), 0);
+
+    // a tx ranked above them all evicts the lowest ones down to the headroom below the budget
+    vector<uint256> evictTxids;
+    CTxMemPoolEntry entry = MakeEntry(6, 6000);
+    CValidationState state;
+    BOOST_CHECK(SelectEvictions(entry, evictTxids, state));
+    BOOST_CHECK(evictTxids == vector<uint256>({txids[0], txids[1]}));
+
+    // only the entries ranked below the tx are evicted for it
+    entry = MakeEntry(6, 1500);
+    BOOST_CHECK(SelectEvictions(entry, evictTxids, state));
+    BOOST_CHECK(evictTxids == vector<uint256>({txids[0]}));
+
+    // and the tx is not admitted if it is ranked below all of them
+    entry = MakeEntry(6, 500);
+    BOOST_CHECK(!SelectEvictions(entry, evictTxids, state));
+    BOOST_CHECK(evictTxids.empty());
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "mempool-full");
+
+    // nor if evicting all the entries below it is not enough, it is ranked by the fee net of its fuel fee
+    entry = MakeEntry(6, 1500);
+    entry.SetFuelFee(1000);
+    CValidationState fuelState;
+    BOOST_CHECK(!SelectEvictions(entry, evictTxids, fuelState));
+    BOOST_CHECK_EQUAL(fuelState.GetRejectReason(), "mempool-full");
+
+    // nothing is evicted within the budget
+    pool.SetLimits(pool.GetUsage() + entry.GetUsage(), 0);
+    BOOST_CHECK(SelectEvictions(entry, evictTxids, state));
+    BOOST_CHECK(evictTxids.empty());
+
+    pool.SetLimits(0, 0);
+    BOOST_CHECK(SelectEvictions(entry, evictTxids, state));
+    BOOST_CHECK(evictTxids.empty());
+
+    // the entries whose tx was not committed have no writes to undo, they are not evicted
+    CTxMemPool uncommittedPool;
+    {
+        LOCK(uncommittedPool.cs);
+        uncommittedPool.cw = pool.cw;
+        AddEntry(uncommittedPool, MakeEntry(1, 1000), "1");
+        uncommittedPool.SetLimits(uncommittedPool.GetUsage(), 0);
+        entry = MakeEntry(6, 6000);
+        CValidationState fullState;
+        BOOST_CHECK(!CTxMemPoolTestAccess::SelectEvictions(uncommittedPool, entry.GetTransaction()->GetHash(),
+                                                           entry, CDbOpKeySet(), evictTxids, fullState));
+        BOOST_CHECK_EQUAL(fullState.GetRejectReason(), "mempool-full");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dependent_eviction_test)
+{
+    LOCK(pool.cs);
+
+    // the second and the third read the key written by the first
+    uint256 txid1 = AddTx(1, 2000);
+    uint256 txid2 = AddTx(2, 1000, {1});
+    uint256 txid3 = AddTx(3, 3000, {1});
+    uint256 txid4 = AddTx(4, 4000);
+    BOOST_CHECK_EQUAL(pool.GetCommitSequence(), 4);
+    pool.SetLimits(pool.GetUsage(), 0);
+
+    // the first is not evicted while the third, committed after it, read its write
+    vector<uint256> evictTxids;
+    CTxMemPoolEntry entry = MakeEntry(6, 6000);
+    CValidationState state;
+    BOOST_CHECK(SelectEvictions(entry, evictTxids, state));
+    BOOST_CHECK(evictTxids == vector<uint256>({txid2, txid3}));
+
+    // nor is an entry whose write was read by the tx to admit
+    BOOST_CHECK(SelectEvictions(entry, evictTxids, state, GetReadKeys(6, {3})));
+    BOOST_CHECK(evictTxids == vector<uint256>({txid2, txid4}));
+
+    // and the tx is rejected if the entries it may evict are not enough
+    BOOST_CHECK(!SelectEvictions(entry, evictTxids, state, GetReadKeys(6, {2, 3, 4})));
+    BOOST_CHECK(evictTxids.empty());
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "mempool-full");
+
+    // the evicted txs are undone in the mempool cache, the writes of the others are kept
+    CTxMemPoolTestAccess::EvictEntries(pool, {txid2, txid3});
+    BOOST_CHECK_EQUAL(pool.Size(), 2);
+    BOOST_CHECK(!pool.Exists(txid2) && !pool.Exists(txid3));
+    BOOST_CHECK(GetKeyId(*pool.cw, 1) == KeyId(101));
+    BOOST_CHECK(GetKeyId(*pool.cw, 2) == KeyId(2));
+    BOOST_CHECK(GetKeyId(*pool.cw, 3) == KeyId(3));
+    BOOST_CHECK(GetKeyId(*pool.cw, 4) == KeyId(104));
+    // as writes of the cache, which the pre-executions must see
+    BOOST_CHECK_EQUAL(pool.GetCommitSequence(), 6);
+
+    // the first is evicted once none of the txs which read its write is left
+    pool.SetLimits(pool.GetUsage(), 0);
+    BOOST_CHECK(SelectEvictions(entry, evictTxids, state));
+    BOOST_CHECK(evictTxids == vector<uint256>({txid1, txid4}));
+    CTxMemPoolTestAccess::EvictEntries(pool, evictTxids);
+    BOOST_CHECK_EQUAL(pool.Size(), 0);
+    BOOST_CHECK(GetKeyId(*pool.cw, 1) == KeyId(1));
+    BOOST_CHECK(GetKeyId(*pool.cw, 4) == KeyId(4));
+}
+
+BOOST_AUTO_TEST_CASE(chained_eviction_test)
+{
+    LOCK(pool.cs);
+
+    // the second reads the key written by the first, both are evicted together
+    uint256 txid1 = AddTx(1, 2000);
+    uint256 txid2 = AddTx(2, 1000, {1});
+    AddTx(3, 3000);
+    pool.SetLimits(pool.GetUsage(), 0);
+
+    vector<uint256> evictTxids;
+    CTxMemPoolEntry entry = MakeEntry(6, 6000);
+    CValidationState state;
+    BOOST_CHECK(SelectEvictions(entry, evictTxids, state));
+    BOOST_CHECK(evictTxids == vector<uint256>({txid2, txid1}));
+
+    // and undone from the last committed
+    CTxMemPoolTestAccess::EvictEntries(pool, evictTxids);
+    BOOST_CHECK_EQUAL(pool.Size(), 1);
+    BOOST_CHECK(GetKeyId(*pool.cw, 1) == KeyId(1));
+    BOOST_CHECK(GetKeyId(*pool.cw, 2) == KeyId(2));
+    BOOST_CHECK(GetKeyId(*pool.cw, 3) == KeyId(103));
+}
+
+BOOST_AUTO_TEST_CASE(sender_limit_test)
+{
+    LOCK(pool.cs);
+
+    // unlimited by default
+    for (uint16_t i = 1; i <= 5; i++)
+        AddEntry(pool, MakeEntry(1, i * 1000), "a");
+    CValidationState state;
+    BOOST_CHECK(CTxMemPoolTestAccess::CheckSenderLimit(pool, uint256S("01"), "a", state));
+
+    pool.SetLimits(0, 5);
+    BOOST_CHECK(!CTxMemPoolTestAccess::CheckSenderLimit(pool, uint256S("01"), "a", state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "too-many-sender-txs");
+    BOOST_CHECK(CTxMemPoolTestAccess::CheckSenderLimit(pool, uint256S("01"), "b", state));
+
+    // the quota is freed by the removed txs
+    pool.Remove(MakeEntry(1, 1000).GetTransaction()->GetHash());
+    BOOST_CHECK(CTxMemPoolTestAccess::CheckSenderLimit(pool, uint256S("01"), "a", state));
+}
+
+BOOST_AUTO_TEST_CASE(remove_confirmed_test)
+{
+    LOCK(pool.cs);
+
+    vector<uint256> txids;
+    for (uint16_t i = 1; i <= 3; i++)
+        txids.push_back(AddEntry(pool, MakeEntry(i, i * 1000), "a"));
+    uint64_t usage = pool.GetUsage();
+    BOOST_CHECK_EQUAL(usage, MakeEntry(1, 1000).GetUsage() * 3);
+
+    pool.RemoveConfirmed(txids[1]);
+    BOOST_CHECK_EQUAL(pool.Size(), 2);
+    BOOST_CHECK(!pool.Exists(txids[1]));
+    BOOST_CHECK_EQUAL(pool.GetUsage(), usage - MakeEntry(2, 2000).GetUsage());
+
+    // the rank index holds the remaining entries, from the lowest
+    vector<uint256> rankTxids;
+    for (const auto &rank : pool.GetRankIndex())
+        rankTxids.push_back(rank.txid);
+    BOOST_CHECK(rankTxids == vector<uint256>({txids[0], txids[2]}));
+
+    // the sender quota is freed too
+    pool.SetLimits(0, 2);
+    CValidationState state;
+    BOOST_CHECK(CTxMemPoolTestAccess::CheckSenderLimit(pool, uint256S("01"), "a", state));
+
+    // a tx not in the mempool is ignored
+    pool.RemoveConfirmed(txids[1]);
+    BOOST_CHECK_EQUAL(pool.Size(), 2);
+
+    pool.RemoveConfirmed(txids[0]);
+    pool.RemoveConfirmed(txids[2]);
+    BOOST_CHECK_EQUAL(pool.Size(), 0);
+    BOOST_CHECK_EQUAL(pool.GetUsage(), 0);
+    BOOST_CHECK(pool.GetRankIndex().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
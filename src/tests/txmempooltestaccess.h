@@ -0,0 +1,40 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TESTS_TXMEMPOOLTESTACCESS_H
+#define TESTS_TXMEMPOOLTESTACCESS_H
+
+#include "tx/txmempool.h"
+
+// the steps of CTxMemPool::AddUnchecked exercised by the unit tests apart, the callers must hold pool.cs
+class CTxMemPoolTestAccess {
+public:
+    // indexes an entry without executing its tx, so it has no writes to undo and is never evicted
+    static void AddEntry(CTxMemPool &pool, const uint256 &txid, const CTxMemPoolEntry &entry, const string &sender) {
+        pool.AddEntry(txid, entry, sender);
+    }
+
+    // commits the tx executed in txCW with the commit recorded on it, and indexes its entry
+    static void AddCommittedEntry(CTxMemPool &pool, const uint256 &txid, const CTxMemPoolEntry &entry,
+                                  const string &sender, CCacheWrapper &txCW, CTxMemPoolCommit &commit) {
+        pool.CommitTx(txid, txCW, commit);
+        pool.AddEntry(txid, entry, sender);
+    }
+
+    static bool CheckSenderLimit(CTxMemPool &pool, const uint256 &txid, const string &sender,
+                                 CValidationState &state) {
+        return pool.CheckSenderLimit(txid, sender, state);
+    }
+
+    static bool SelectEvictions(CTxMemPool &pool, const uint256 &txid, const CTxMemPoolEntry &entry,
+                                const CDbOpKeySet &readKeys, vector<uint256> &evictTxids, CValidationState &state) {
+        return pool.SelectEvictions(txid, entry, readKeys, evictTxids, state);
+    }
+
+    static void EvictEntries(CTxMemPool &pool, const vector<uint256> &evictTxids) {
+        pool.EvictEntries(evictTxids);
+    }
+};
+
+#endif  // TESTS_TXMEMPOOLTESTACCESS_H
@@ -0,0 +1,191 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "tx/contracttx.h"
+#include "tx/txmempool.h"
+#include "tx/txpreexecutor.h"
+
+using namespace std;
+
+struct FTxPreExecutorTests {
+    FTxPreExecutorTests() {
+        BOOST_TEST_MESSAGE( "setup FTxPreExecutorTests" );
+        root_dir = "/tmp/coind_unit_test";
+        if (boost::filesystem::exists(root_dir))
+            BOOST_CHECK(boost::filesystem::is_directory(root_dir));
+        else
+            BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(root_dir));
+
+        db_dir = root_dir / "txpreexecutor_tests";
+        BOOST_CHECK_MESSAGE(!boost::filesystem::exists(db_dir), "must remove dir " + db_dir.string() + " first");
+
+        BOOST_CHECK_NO_THROW(boost::filesystem::create_directory(db_dir));
+
+        const bool isWipe = true;
+        pAccountDb        = make_shared<CDBAccess>(db_dir, DBNameType::ACCOUNT, false, isWipe);
+        pAccountDbCache   = make_shared<CAccountDBCache>(pAccountDb.get());
+        for (uint16_t index = 1; index <= 4; index++)
+            BOOST_CHECK(pAccountDbCache->regId2KeyIdCache.SetData(RegIdKey(index), KeyId(index)));
+
+        // the mempool cache over the chain state, which the pre-executions read
+        pool.cw = make_shared<CCacheWrapper>();
+        pool.cw->accountCache.SetBaseViewPtr(pAccountDbCache.get());
+        pool.SetPreExecutionEnabled(true);
+    }
+    ~FTxPreExecutorTests() {
+        BOOST_TEST_MESSAGE( "teardown FTxPreExecutorTests" );
+        pool.cw.reset();
+        pAccountDbCache.reset();
+        pAccountDb.reset();
+        BOOST_CHECK_NO_THROW(boost::filesystem::remove_all(db_dir));
+    }
+
+    static CRegIDKey RegIdKey(uint16_t index) { return CRegIDKey(CRegID(10, index)); }
+
+    static CKeyID KeyId(uint8_t n) { return CKeyID(uint160(vector<uint8_t>(20, n))); }
+
+    static CKeyID GetKeyId(CCacheWrapper &cw, uint16_t index) {
+        CKeyID keyId;
+        cw.accountCache.regId2KeyIdCache.GetData(RegIdKey(index), keyId);
+        return keyId;
+    }
+
+    // starts a pre-execution as CTxPreExecution::Execute does, the test executes the tx in its cache
+    shared_ptr<CTxPreExecution> BeginPreExecution() {
+        auto spPreExecution = make_shared<CTxPreExecution>(pool);
+        {
+            LOCK(pool.cs);
+            spPreExecution->startSequence = pool.GetCommitSequence();
+            spPreExecution->spBaseCW      = pool.cw;
+        }
+        spPreExecution->spCW = make_shared<CCacheWrapper>(spPreExecution->spBaseCW.get());
+        spPreExecution->dbOpLogMap.SetReadObserver(spPreExecution.get());
+        spPreExecution->spCW->SetDbOpLogMap(&spPreExecution->dbOpLogMap);
+        spPreExecution->spTx = make_shared<CLuaContractInvokeTx>();
+        return spPreExecution;
+    }
+
+    static void EndPreExecution(CTxPreExecution &preExecution, bool result) {
+        preExecution.dbOpLogMap.SetReadObserver(nullptr);
+        preExecution.executed = true;
+        preExecution.result   = result;
+    }
+
+    // commits the pre-execution as CTxMemPool::CheckTxInMemPool does
+    bool Commit(CTxPreExecution &preExecution, CBaseTx &tx) {
+        LOCK(pool.cs);
+        if (!pool.AcceptPreExecution(preExecution, tx))
+            return false;
+
+        if (preExecution.result)
+            pool.CommitCache(*preExecution.spCW, preExecution.dbOpLogMap);
+        return true;
+    }
+
+    boost::filesystem::path root_dir;
+    boost::filesystem::path db_dir;
+    shared_ptr<CDBAccess> pAccountDb;
+    shared_ptr<CAccountDBCache> pAccountDbCache;
+    CTxMemPool pool;
+};
+
+BOOST_FIXTURE_TEST_SUITE(txpreexecutor_tests, FTxPreExecutorTests)
+
+BOOST_AUTO_TEST_CASE(commit_pre_execution_test)
+{
+    auto spPreExecution = BeginPreExecution();
+    BOOST_CHECK(GetKeyId(*spPreExecution->spCW, 1) == KeyId(1));
+    BOOST_CHECK(spPreExecution->spCW->accountCache.regId2KeyIdCache.SetData(RegIdKey(2), KeyId(12)));
+    spPreExecution->spTx->fuel      = 1200;
+    spPreExecution->spTx->nFuelRate = 100;
+    EndPreExecution(*spPreExecution, true);
+    BOOST_CHECK(!spPreExecution->readKeys.empty());
+
+    // nothing is written to the mempool cache before the commit
+    BOOST_CHECK(GetKeyId(*pool.cw, 2) == KeyId(2));
+
+    CLuaContractInvokeTx tx;
+    BOOST_CHECK(Commit(*spPreExecution, tx));
+    BOOST_CHECK(GetKeyId(*pool.cw, 2) == KeyId(12));
+    BOOST_CHECK_EQUAL(pool.GetCommitSequence(), 1);
+
+    // the tx in the mempool holds the fuel of the execution, so that it is ranked by its net fee
+    BOOST_CHECK_EQUAL(tx.fuel, 1200);
+    BOOST_CHECK_EQUAL(tx.nFuelRate, 100);
+}
+
+BOOST_AUTO_TEST_CASE(conflicting_pre_execution_test)
+{
+    // all of them are executed against the same state
+    auto spPreExecution1 = BeginPreExecution();
+    auto spPreExecution2 = BeginPreExecution();
+    auto spPreExecution3 = BeginPreExecution();
+
+    BOOST_CHECK(spPreExecution1->spCW->accountCache.regId2KeyIdCache.SetData(RegIdKey(1), KeyId(11)));
+    EndPreExecution(*spPreExecution1, true);
+
+    // reads regid 1 written by the first one
+    BOOST_CHECK(GetKeyId(*spPreExecution2->spCW, 1) == KeyId(1));
+    BOOST_CHECK(spPreExecution2->spCW->accountCache.regId2KeyIdCache.SetData(RegIdKey(3), KeyId(13)));
+    EndPreExecution(*spPreExecution2, true);
+
+    // reads none of the keys written by the others
+    BOOST_CHECK(GetKeyId(*spPreExecution3->spCW, 2) == KeyId(2));
+    BOOST_CHECK(spPreExecution3->spCW->accountCache.regId2KeyIdCache.SetData(RegIdKey(4), KeyId(14)));
+    EndPreExecution(*spPreExecution3, true);
+
+    CLuaContractInvokeTx tx1, tx2, tx3;
+    BOOST_CHECK(Commit(*spPreExecution1, tx1));
+    BOOST_CHECK(!Commit(*spPreExecution2, tx2));
+    BOOST_CHECK(Commit(*spPreExecution3, tx3));
+    BOOST_CHECK_EQUAL(pool.GetCommitSequence(), 2);
+
+    // the conflicting one is left to be executed again serially
+    BOOST_CHECK(GetKeyId(*pool.cw, 1) == KeyId(11));
+    BOOST_CHECK(GetKeyId(*pool.cw, 3) == KeyId(3));
+    BOOST_CHECK(GetKeyId(*pool.cw, 4) == KeyId(14));
+
+    // and so is one executed against a replaced mempool cache
+    auto spPreExecution4 = BeginPreExecution();
+    EndPreExecution(*spPreExecution4, true);
+    auto spOldCW = pool.cw;
+    pool.cw      = make_shared<CCacheWrapper>(spOldCW.get());
+    CLuaContractInvokeTx tx4;
+    BOOST_CHECK(!Commit(*spPreExecution4, tx4));
+    pool.cw = spOldCW;
+
+    // and one finished after the pre-execution got disabled
+    auto spPreExecution5 = BeginPreExecution();
+    EndPreExecution(*spPreExecution5, true);
+    pool.SetPreExecutionEnabled(false);
+    CLuaContractInvokeTx tx5;
+    BOOST_CHECK(!Commit(*spPreExecution5, tx5));
+}
+
+BOOST_AUTO_TEST_CASE(failed_pre_execution_test)
+{
+    auto spPreExecution = BeginPreExecution();
+    BOOST_CHECK(spPreExecution->spCW->accountCache.regId2KeyIdCache.SetData(RegIdKey(2), KeyId(12)));
+    spPreExecution->spTx->fuel = 1200;
+    spPreExecution->state.DoS(100, false, REJECT_INVALID, "run-script-error");
+    EndPreExecution(*spPreExecution, false);
+
+    // the failure is the result of the tx, which is rejected without being executed again
+    CLuaContractInvokeTx tx;
+    BOOST_CHECK(Commit(*spPreExecution, tx));
+    BOOST_CHECK(!spPreExecution->result);
+    BOOST_CHECK_EQUAL(spPreExecution->state.GetRejectReason(), "run-script-error");
+
+    // with none of its writes committed
+    BOOST_CHECK(GetKeyId(*pool.cw, 2) == KeyId(2));
+    BOOST_CHECK_EQUAL(pool.GetCommitSequence(), 0);
+    BOOST_CHECK_EQUAL(tx.fuel, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,194 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include "persistence/blockundo.h"
+#include "wallet/wallet.h"
+
+using namespace std;
+
+BOOST_AUTO_TEST_SUITE(walletsync_tests)
+
+static CWalletSyncTask BlockTask() {
+    CWalletSyncTask task;
+    task.spBlock   = std::make_shared<CBlock>();
+    task.connected = true;
+    return task;
+}
+
+static CWalletSyncTask EraseTask(const uint256 &txid) {
+    CWalletSyncTask task;
+    task.erasedTxid = txid;
+    return task;
+}
+
+BOOST_AUTO_TEST_CASE(push_never_blocks_test)
+{
+    CWalletSyncQueue queue(2);
+
+    // the tasks are pushed under cs_main, beyond the limit too
+    for (int32_t i = 0; i < 5; i++)
+        queue.Push(BlockTask());
+    queue.Push(EraseTask(uint256S("01")));
+    BOOST_CHECK_EQUAL(queue.GetBlockCount(), 5);
+
+    // and also after the queue is interrupted
+    queue.Interrupt();
+    queue.Push(BlockTask());
+    BOOST_CHECK_EQUAL(queue.GetBlockCount(), 6);
+    BOOST_CHECK(!queue.WaitForSpace());
+
+    // the tasks are popped in order
+    CWalletSyncTask task;
+    for (int32_t i = 0; i < 5; i++)
+        BOOST_CHECK(queue.Pop(task, std::chrono::milliseconds(0)) && task.spBlock);
+    BOOST_CHECK(queue.Pop(task, std::chrono::milliseconds(0)) && !task.spBlock && task.erasedTxid == uint256S("01"));
+    BOOST_CHECK(queue.Pop(task, std::chrono::milliseconds(0)) && task.spBlock);
+    BOOST_CHECK(!queue.Pop(task, std::chrono::milliseconds(0)));
+    BOOST_CHECK(queue.Empty());
+}
+
+BOOST_AUTO_TEST_CASE(wait_for_space_test)
+{
+    CWalletSyncQueue queue(2);
+
+    // the erased txs are not limited
+    queue.Push(BlockTask());
+    for (int32_t i = 0; i < 10; i++)
+        queue.Push(EraseTask(uint256S("01")));
+    BOOST_CHECK(queue.WaitForSpace());
+
+    queue.Push(BlockTask());
+    queue.Push(BlockTask());
+    BOOST_CHECK_EQUAL(queue.GetBlockCount(), 3);
+
+    // the producer waits until the sync thread has applied the blocks beyond the limit
+    std::atomic<bool> done(false);
+    bool ret = false;
+    std::thread producer([&]() {
+        ret  = queue.WaitForSpace();
+        done = true;
+    });
+
+    CWalletSyncTask task;
+    BOOST_CHECK(queue.Pop(task, std::chrono::milliseconds(0)) && task.spBlock);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK(!done);
+
+    while (queue.GetBlockCount() >= 2)
+        BOOST_CHECK(queue.Pop(task, std::chrono::milliseconds(0)));
+
+    producer.join();
+    BOOST_CHECK(done && ret);
+}
+
+BOOST_AUTO_TEST_CASE(interrupt_wait_test)
+{
+    CWalletSyncQueue queue(1);
+    queue.Push(BlockTask());
+    queue.Push(BlockTask());
+
+    // the sync thread is gone at shutdown, the waiting producer must not deadlock
+    bool ret = true;
+    std::thread producer([&]() { ret = queue.WaitForSpace(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    queue.Interrupt();
+    producer.join();
+    BOOST_CHECK(!ret);
+
+    // the queued blocks are still flushed
+    CWalletSyncTask task;
+    BOOST_CHECK(queue.Pop(task, std::chrono::milliseconds(0)));
+    BOOST_CHECK(queue.Pop(task, std::chrono::milliseconds(0)));
+    BOOST_CHECK(queue.Empty());
+}
+
+static CKeyID KeyId(uint8_t n) { return CKeyID(uint160(vector<uint8_t>(20, n))); }
+
+static CAccount MakeAccount(uint8_t n, uint64_t wicc, uint64_t wusd) {
+    CAccount account(KeyId(n));
+    account.tokens[SYMB::WICC].free_amount = wicc;
+    account.tokens[SYMB::WUSD].free_amount = wusd;
+    return account;
+}
+
+BOOST_AUTO_TEST_CASE(block_account_key_ids_test)
+{
+    // the account of key 3 is written by a contract of tx 2, which does not involve it
+    CBlockUndo blockUndo;
+    for (uint8_t i = 1; i <= 2; i++) {
+        CTxUndo txUndo(uint256S(strprintf("%x", i)));
+        CDbOpLog opLog;
+        opLog.Set(KeyId(i), MakeAccount(i, 100, 0));
+        txUndo.dbOpLogMap.AddOpLog(dbk::KEYID_ACCOUNT, opLog);
+        opLog.Set(CRegIDKey(CRegID(10, i)), KeyId(i + 10));
+        txUndo.dbOpLogMap.AddOpLog(dbk::REGID_KEYID, opLog);
+        blockUndo.vtxundo.push_back(txUndo);
+    }
+    CDbOpLog opLog;
+    opLog.Set(KeyId(3), CAccount());
+    blockUndo.vtxundo.back().dbOpLogMap.AddOpLog(dbk::KEYID_ACCOUNT, opLog);
+
+    set<CKeyID> keyIds;
+    blockUndo.GetAccountKeyIds(keyIds);
+    BOOST_CHECK(keyIds == set<CKeyID>({KeyId(1), KeyId(2), KeyId(3)}));
+
+    keyIds.clear();
+    GetAccountKeyIds(blockUndo.vtxundo[0].dbOpLogMap, keyIds);
+    BOOST_CHECK(keyIds == set<CKeyID>({KeyId(1)}));
+
+    keyIds.clear();
+    CBlockUndo().GetAccountKeyIds(keyIds);
+    BOOST_CHECK(keyIds.empty());
+}
+
+BOOST_AUTO_TEST_CASE(wallet_balance_cache_test)
+{
+    CWalletBalanceCache balanceCache;
+    uint64_t amount = 0;
+    BOOST_CHECK(!balanceCache.GetTotal(SYMB::WICC, amount));
+    BOOST_CHECK(balanceCache.NeedReconcile(1000));
+
+    // the refreshes are ignored until reconciled
+    balanceCache.SetBalances(KeyId(1), MakeAccount(1, 100, 0));
+    BOOST_CHECK(!balanceCache.GetTotal(SYMB::WICC, amount));
+
+    map<CKeyID, map<TokenSymbol, uint64_t>> keyBalances;
+    keyBalances[KeyId(1)][SYMB::WICC] = 100;
+    keyBalances[KeyId(2)][SYMB::WICC] = 50;
+    keyBalances[KeyId(2)][SYMB::WUSD] = 7;
+    balanceCache.Reset(std::move(keyBalances), 1000, balanceCache.GetGeneration());
+    BOOST_CHECK(balanceCache.GetTotal(SYMB::WICC, amount) && amount == 150);
+    BOOST_CHECK(balanceCache.GetTotal(SYMB::WUSD, amount) && amount == 7);
+    BOOST_CHECK(!balanceCache.NeedReconcile(1000 + WALLET_BALANCE_RECONCILE_SECONDS - 1));
+    BOOST_CHECK(balanceCache.NeedReconcile(1000 + WALLET_BALANCE_RECONCILE_SECONDS));
+
+    // the written accounts replace the balances of their keys in the totals
+    balanceCache.SetBalances(KeyId(2), MakeAccount(2, 20, 0));
+    balanceCache.SetBalances(KeyId(3), MakeAccount(3, 5, 1));
+    BOOST_CHECK(balanceCache.GetTotal(SYMB::WICC, amount) && amount == 125);
+    BOOST_CHECK(balanceCache.GetTotal(SYMB::WUSD, amount) && amount == 1);
+    BOOST_CHECK(balanceCache.GetTotal(SYMB::WGRT, amount) && amount == 0);
+
+    // the balances read before an invalidation are not applied
+    uint64_t generation = balanceCache.GetGeneration();
+    balanceCache.Invalidate();
+    BOOST_CHECK(!balanceCache.GetTotal(SYMB::WICC, amount));
+    keyBalances.clear();
+    keyBalances[KeyId(1)][SYMB::WICC] = 1;
+    balanceCache.Reset(std::move(keyBalances), 2000, generation);
+    BOOST_CHECK(!balanceCache.GetTotal(SYMB::WICC, amount));
+
+    keyBalances.clear();
+    keyBalances[KeyId(1)][SYMB::WICC] = 1;
+    balanceCache.Reset(std::move(keyBalances), 2000, balanceCache.GetGeneration());
+    BOOST_CHECK(balanceCache.GetTotal(SYMB::WICC, amount) && amount == 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
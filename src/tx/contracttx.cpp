@@ -191,6 +191,7 @@ bool CLuaContractInvokeTx::ExecuteTx(CTxExecuteContext &context) {
     luaContext.sp_app_account    = spAppAccount;
     luaContext.p_contract        = &contractStore;
     luaContext.p_arguments       = &arguments;
+    luaContext.p_tip_index       = context.pTipIndex;
 
     int64_t llTime = GetTimeMillis();
     string errMsg;
@@ -400,6 +401,7 @@ bool CUniversalContractInvokeTx::ExecuteTx(CTxExecuteContext &context) {
     luaContext.sp_app_account    = spAppAccount;
     luaContext.p_contract        = &contractStore;
     luaContext.p_arguments       = &arguments;
+    luaContext.p_tip_index       = context.pTipIndex;
 
     int64_t llTime = GetTimeMillis();
     string errMsg;
@@ -523,6 +523,60 @@ namespace dex {
 
     #define DEAL_ITEM_TITLE ERROR_TITLE(tx.GetTxTypeName() + strprintf(", i[%d]", idx))
 
+////////////////////////////////////////////////////////////////////////////////
+// class CDealOrderBatch
+    CDealOrderBatch::OrderState* CDealOrderBatch::GetOrder(const uint256 &orderId) {
+        auto it = order_map.find(orderId);
+        if (it == order_map.end()) {
+            OrderState orderState;
+            if (!context.pCw->dexCache.GetActiveOrder(orderId, orderState.order))
+                return nullptr;
+            it = order_map.emplace(orderId, orderState).first;
+        }
+        return it->second.fulfilled ? nullptr : &it->second;
+    }
+
+    void CDealOrderBatch::SetOrder(const uint256 &orderId, const CDEXOrderDetail &order, bool fulfilled) {
+        OrderState &orderState = order_map[orderId];
+        if (!orderState.modified)
+            modified_order_ids.push_back(orderId);
+        orderState.order     = order;
+        orderState.fulfilled = fulfilled;
+        orderState.modified  = true;
+    }
+
+    bool CDealOrderBatch::GetOperator(const DexID &dexId, DexOperatorDetail &operatorDetail, const string &title) {
+        auto it = operator_map.find(dexId);
+        if (it == operator_map.end()) {
+            if (!GetDexOperator(context, dexId, operatorDetail, title))
+                return false;
+            operator_map.emplace(dexId, operatorDetail);
+        } else {
+            operatorDetail = it->second;
+        }
+        return true;
+    }
+
+    bool CDealOrderBatch::Flush() {
+        CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
+
+        for (const auto &orderId : modified_order_ids) {
+            const OrderState &orderState = order_map[orderId];
+            if (orderState.fulfilled) {
+                if (!cw.dexCache.EraseActiveOrder(orderId, orderState.order))
+                    return state.DoS(100, ERRORMSG("%s, finish the active order failed! order_id=%s",
+                        ERROR_TITLE(tx.GetTxTypeName()), orderId.ToString()),
+                        REJECT_INVALID, "write-dexdb-failed");
+            } else {
+                if (!cw.dexCache.UpdateActiveOrder(orderId, orderState.order))
+                    return state.DoS(100, ERRORMSG("%s, update the active order failed! order_id=%s",
+                        ERROR_TITLE(tx.GetTxTypeName()), orderId.ToString()),
+                        REJECT_INVALID, "write-dexdb-failed");
+            }
+        }
+        return true;
+    }
+
 ////////////////////////////////////////////////////////////////////////////////
 // class CDealItemExecuter
     class CDealItemExecuter {
@@ -536,6 +590,7 @@ namespace dex {
         CTxExecuteContext &context;
         shared_ptr<CAccount> &pTxAccount;
         vector<CReceipt> &receipts;
+        CDealOrderBatch &batch;
 
         // found data
         CDEXOrderDetail buyOrder;
@@ -552,9 +607,9 @@ namespace dex {
 
         CDealItemExecuter(DealItem &dealItemIn, uint32_t idxIn, CDEXSettleTx &txIn,
                           CTxExecuteContext &contextIn, shared_ptr<CAccount> &pTxAccountIn,
-                          vector<CReceipt> &receiptsIn)
+                          vector<CReceipt> &receiptsIn, CDealOrderBatch &batchIn)
             : dealItem(dealItemIn), idx(idxIn), tx(txIn), context(contextIn),
-              pTxAccount(pTxAccountIn), receipts(receiptsIn) {}
+              pTxAccount(pTxAccountIn), receipts(receiptsIn), batch(batchIn) {}
 
         bool Execute();
 
@@ -582,7 +637,7 @@ namespace dex {
     };
 
     bool CDealItemExecuter::Execute() {
-        CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
+        CValidationState &state = *context.pState;
 
         //1.1 get and check buyDealOrder and sellDealOrder
         if (!GetDealOrder(dealItem.buyOrderId, ORDER_BUY, buyOrder)) return false;
@@ -598,12 +653,12 @@ namespace dex {
         if (!spSellOrderAccount) return false;
 
         // 1.3 get operator info
-        if (!GetDexOperator(context, buyOrder.dex_id, buyOperatorDetail, DEAL_ITEM_TITLE)) return false;
+        if (!batch.GetOperator(buyOrder.dex_id, buyOperatorDetail, DEAL_ITEM_TITLE)) return false;
 
         spBuyOpAccount = tx.GetAccount(context, buyOperatorDetail.fee_receiver_regid, "buy_operator");
         if (!spBuyOpAccount) return false;
 
-        if (!GetDexOperator(context, sellOrder.dex_id, sellOperatorDetail, DEAL_ITEM_TITLE)) return false;
+        if (!batch.GetOperator(sellOrder.dex_id, sellOperatorDetail, DEAL_ITEM_TITLE)) return false;
 
         spSellOpAccount = tx.GetAccount(context, sellOperatorDetail.fee_receiver_regid, "sell_operator");
         if (!spSellOpAccount) return false;
@@ -809,34 +864,11 @@ namespace dex {
                     assert(buyOrder.coin_amount == buyOrder.total_deal_coin_amount);
                 }
             }
-            // erase active order
-            if (!cw.dexCache.EraseActiveOrder(dealItem.buyOrderId, buyOrder)) {
-                return state.DoS(100, ERRORMSG("%s, finish the active buy order failed! deal_info={%s}",
-                    DEAL_ITEM_TITLE, dealItem.ToString()),
-                    REJECT_INVALID, "write-dexdb-failed");
-            }
-        } else {
-            if (!cw.dexCache.UpdateActiveOrder(dealItem.buyOrderId, buyOrder)) {
-                return state.DoS(100, ERRORMSG("%s, update active buy order failed! deal_info={%s}",
-                    DEAL_ITEM_TITLE, dealItem.ToString()),
-                    REJECT_INVALID, "write-dexdb-failed");
-            }
         }
+        // the fulfilled orders are erased and others are updated when the batch is flushed
+        batch.SetOrder(dealItem.buyOrderId, buyOrder, buyResidualAmount == 0);
+        batch.SetOrder(dealItem.sellOrderId, sellOrder, sellResidualAmount == 0);
 
-        if (sellResidualAmount == 0) { // sell order fulfilled
-            // erase active order
-            if (!cw.dexCache.EraseActiveOrder(dealItem.sellOrderId, sellOrder)) {
-                return state.DoS(100, ERRORMSG("%s, finish active sell order failed! deal_info={%s}",
-                    DEAL_ITEM_TITLE, dealItem.ToString()),
-                    REJECT_INVALID, "write-dexdb-failed");
-            }
-        } else {
-            if (!cw.dexCache.UpdateActiveOrder(dealItem.sellOrderId, sellOrder)) {
-                return state.DoS(100, ERRORMSG("%s, update active sell order failed! deal_info={%s}",
-                    DEAL_ITEM_TITLE, dealItem.ToString()),
-                    REJECT_INVALID, "write-dexdb-failed");
-            }
-        }
         return true;
     }
 
@@ -901,10 +933,12 @@ namespace dex {
 
     bool CDealItemExecuter::GetDealOrder(const uint256 &orderId, const OrderSide orderSide,
                                          CDEXOrderDetail &dealOrder) {
-        if (!context.pCw->dexCache.GetActiveOrder(orderId, dealOrder))
+        auto pOrderState = batch.GetOrder(orderId);
+        if (pOrderState == nullptr)
             return context.pState->DoS(100, ERRORMSG("%s, get active order failed! orderId=%s", DEAL_ITEM_TITLE,
                 orderId.ToString()), REJECT_INVALID,
                 strprintf("get-active-order-failed, i=%d, order_id=%s", idx, orderId.ToString()));
+        dealOrder = pOrderState->order;
 
         if (dealOrder.order_side != orderSide)
             return context.pState->DoS(100, ERRORMSG("%s, expected order_side=%s but got order_side=%s! orderId=%s",
@@ -1089,14 +1123,15 @@ namespace dex {
 
     bool CDEXSettleTx::ExecuteTx(CTxExecuteContext &context) {
 
+        CDealOrderBatch batch(*this, context);
         for (size_t idx = 0; idx < dealItems.size(); idx++) {
-            CDealItemExecuter dealItemExec(dealItems[idx], idx, *this, context, sp_tx_account, receipts);
+            CDealItemExecuter dealItemExec(dealItems[idx], idx, *this, context, sp_tx_account, receipts, batch);
             if (!dealItemExec.Execute()) {
                 return false;
             }
         }
 
-        return true;
+        return batch.Flush();
     }
 
 } // namespace dex
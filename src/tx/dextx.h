@@ -545,6 +545,35 @@ namespace dex {
         virtual bool ExecuteTx(CTxExecuteContext &context);
     };
 
+    // working set of all deal items of a settle tx. Each deal order and dex operator is loaded once, the deal
+    // items are applied to the in-memory copies one by one, and each modified order is written back to dexCache
+    // once after the last deal item. The accounts are loaded once through the account map of the tx.
+    class CDealOrderBatch {
+    public:
+        struct OrderState {
+            CDEXOrderDetail order;
+            bool fulfilled = false; //!< order is fulfilled and will be erased from the active orders
+            bool modified  = false; //!< order has been dealt and need to be written back
+        };
+
+        CDEXSettleTx &tx;
+        CTxExecuteContext &context;
+        map<uint256, OrderState> order_map;
+        vector<uint256> modified_order_ids;     //!< in order of first modification, to write deterministically
+        map<DexID, DexOperatorDetail> operator_map;
+
+        CDealOrderBatch(CDEXSettleTx &txIn, CTxExecuteContext &contextIn): tx(txIn), context(contextIn) {}
+
+        // return nullptr if the order is not active, including fulfilled by the previous deal items
+        OrderState* GetOrder(const uint256 &orderId);
+
+        void SetOrder(const uint256 &orderId, const CDEXOrderDetail &order, bool fulfilled);
+
+        bool GetOperator(const DexID &dexId, DexOperatorDetail &operatorDetail, const string &title);
+
+        bool Flush();
+    };
+
 } // namespace dex
 
 #endif  // TX_DEX_H
\ No newline at end of file
@@ -39,6 +39,7 @@ static const unordered_map<TxExecuteContextType, string> kTxExecuteContextTypeNa
     { TxExecuteContextType::PRODUCE_BLOCK,      "PRODUCE_BLOCK"    },
 };
 
+class CBlockIndex;
 class CCacheWrapper;
 class CValidationState;
 
@@ -100,6 +101,8 @@ public:
     CCacheWrapper*                pCw;
     CValidationState*             pState;
     TxExecuteContextType          context_type;
+    // tip of the active chain captured by an execution not holding cs_main, chainActive is read if nullptr
+    const CBlockIndex*            pTipIndex = nullptr;
 
     CTxExecuteContext()
         : height(0),
@@ -144,6 +147,8 @@ public:
     uint64_t fuel = 0;
     int32_t nFuelRate = 0;
     mutable TxID sigHash;
+    uint32_t serializedSize = 0;                //!< measured when the tx is deserialized, see GetTxSize()
+    std::shared_ptr<const CDataStream> rawTx;   //!< bytes of the tx as received from a peer, relayed as they are
     map< CKeyID, std::shared_ptr<CAccount> > account_map;
     std::shared_ptr<CAccount> sp_tx_account = nullptr;
 
@@ -185,9 +190,18 @@ public:
 
     virtual uint32_t GetSerializeSize(int32_t nType, int32_t nVersion) const { return 0; }
 
+    // Serialized size of the tx without the type prefix, which is the same for the network and the disk.
+    // It is measured once when the tx is deserialized, before the tx is shared with other threads, and
+    // measured on every call for the txs built locally, whose fields may still be changed.
+    uint32_t GetTxSize() const {
+        return serializedSize != 0 ? serializedSize : GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+    }
+    // must be called if the fields of a deserialized tx are changed, e.g. by signing it
+    void ClearTxSize() { serializedSize = 0; }
+
     virtual uint64_t GetFuelFee(CCacheWrapper &cw, int32_t height, uint32_t nFuelRate);
     virtual double GetPriority() const {
-        return TRANSACTION_PRIORITY_CEILING / GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+        return TRANSACTION_PRIORITY_CEILING / GetTxSize();
     }
     virtual void SerializeForHash(CHashWriter &hw) const = 0;
     virtual std::shared_ptr<CBaseTx> GetNewInstance() const           = 0;
@@ -0,0 +1,267 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txlaneexecutor.h"
+
+#include "commons/messagequeue.h"
+#include "tx/contracttx.h"
+
+#include <condition_variable>
+#include <mutex>
+
+using namespace std;
+
+/**
+ * Txs of a block executed in block order on a private child cache of the block cache. The reads which
+ * miss the child cache are served from the block cache under the lock shared by all lanes of the block.
+ */
+class CContractTxLane : public CDBReadObserver {
+public:
+    CContractTxLane(CBlock &blockIn, CBlockIndex *pIndexIn, CCacheWrapper &cwIn, CCriticalSection &csBaseIn,
+                    const ContractTxExecFunc &execFuncIn)
+        : block(blockIn), pIndex(pIndexIn), cw(cwIn), csBase(csBaseIn), execFunc(execFuncIn) {}
+
+    void Execute();
+
+    void BeginBaseRead(dbk::PrefixType prefixType, const string &key) override {
+        ENTER_CRITICAL_SECTION(csBase);
+        readKeys.emplace(prefixType, key);
+    }
+
+    void EndBaseRead() override { LEAVE_CRITICAL_SECTION(csBase); }
+
+public:
+    vector<int32_t> txIndexes;  // in block order
+    vector<CTxUndo> txUndos;
+    bool executed = false;      // all txs succeeded
+    std::shared_ptr<CCacheWrapper> spCW;
+    CDbOpKeySet readKeys;
+    CDbOpKeySet writeKeys;
+
+private:
+    CBlock &block;
+    CBlockIndex *pIndex;
+    CCacheWrapper &cw;
+    CCriticalSection &csBase;
+    const ContractTxExecFunc &execFunc;
+};
+
+void CContractTxLane::Execute() {
+    spCW = std::make_shared<CCacheWrapper>(&cw);
+    uint32_t prevBlockTime = pIndex->pprev != nullptr ? pIndex->pprev->GetBlockTime() : pIndex->GetBlockTime();
+
+    for (int32_t index : txIndexes) {
+        std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[index];
+
+        CTxUndo txUndo(pBaseTx->GetHash());
+        txUndo.dbOpLogMap.SetReadObserver(this);
+        spCW->SetDbOpLogMap(&txUndo.dbOpLogMap);
+
+        CValidationState state;
+        CTxExecuteContext context(pIndex->height, index, block.GetFuelRate(), pIndex->nTime, prevBlockTime,
+                                  spCW.get(), &state);
+        bool ok = execFunc(*pBaseTx, context);
+
+        spCW->SetDbOpLogMap(nullptr);
+        txUndo.dbOpLogMap.SetReadObserver(nullptr);
+        // the failure is reported by the serial execution
+        if (!ok)
+            return;
+
+        for (const auto &item : txUndo.dbOpLogMap.GetMap()) {
+            for (const auto &dbOpLog : item.second)
+                writeKeys.emplace(item.first, dbOpLog.GetKey());
+        }
+        txUndos.push_back(std::move(txUndo));
+    }
+
+    executed = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// lane threads
+
+struct CContractLaneBatch {
+    std::mutex mtx;
+    std::condition_variable cond;
+    int32_t pending = 0;
+
+    void Done() {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (--pending == 0)
+            cond.notify_all();
+    }
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cond.wait(lock, [this] { return pending == 0; });
+    }
+};
+
+struct CContractLaneTask {
+    CContractTxLane *pLane      = nullptr;
+    CContractLaneBatch *pBatch  = nullptr;
+
+    void Run() {
+        try {
+            pLane->Execute();
+        } catch (std::exception &e) {
+            LogPrint(BCLog::ERROR, "execute contract lane failed: %s\n", e.what());
+        }
+        pBatch->Done();
+    }
+};
+
+static std::unique_ptr<MsgQueue<CContractLaneTask>> laneQueue;
+
+static void ThreadContractLane() {
+    CContractLaneTask task;
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        if (laneQueue->Pop(&task))
+            task.Run();
+    }
+}
+
+void StartContractLaneExecutor(boost::thread_group &threadGroup, int32_t threads) {
+    if (threads <= 0)
+        return;
+
+    laneQueue.reset(new MsgQueue<CContractLaneTask>());
+
+    for (int32_t i = 0; i < threads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "contractlane", &ThreadContractLane));
+
+    LogPrint(BCLog::INFO, "started %d threads to execute contract lanes\n", threads);
+}
+
+bool IsContractLaneExecutorStarted() { return laneQueue != nullptr; }
+
+bool CheckAndExecuteContractTx(CBaseTx &tx, CTxExecuteContext &context) { return tx.CheckAndExecuteTx(context); }
+
+////////////////////////////////////////////////////////////////////////////////
+// lane scheduling
+
+static int32_t FindLaneRoot(vector<int32_t> &parents, int32_t i) {
+    while (parents[i] != i)
+        i = parents[i] = parents[parents[i]];
+    return i;
+}
+
+// Partitions the txs into lanes so that the txs invoking the same contract or involving the same account
+// are in the same lane. Returns false if the involved accounts of a tx are unknown.
+static bool PartitionContractTxs(CBlock &block, int32_t beginIndex, int32_t endIndex, CCacheWrapper &cw,
+                                 vector<vector<int32_t>> &lanes) {
+    int32_t count = endIndex - beginIndex;
+    vector<int32_t> parents(count);
+    for (int32_t i = 0; i < count; i++)
+        parents[i] = i;
+
+    map<string, int32_t> keyOwners;  // lane key -> first tx
+    for (int32_t i = 0; i < count; i++) {
+        auto pTx = dynamic_cast<CLuaContractInvokeTx *>(block.vptx[beginIndex + i].get());
+        if (pTx == nullptr)
+            return false;
+
+        set<CKeyID> keyIds;
+        if (!pTx->GetInvolvedKeyIds(cw, keyIds))
+            return false;
+
+        vector<string> laneKeys = {"contract:" + pTx->app_uid.ToString()};
+        for (const auto &keyId : keyIds)
+            laneKeys.push_back("account:" + keyId.ToString());
+
+        for (const auto &laneKey : laneKeys) {
+            auto ret = keyOwners.emplace(laneKey, i);
+            if (!ret.second)
+                parents[FindLaneRoot(parents, i)] = FindLaneRoot(parents, ret.first->second);
+        }
+    }
+
+    map<int32_t, size_t> laneOfRoot;
+    for (int32_t i = 0; i < count; i++) {
+        auto ret = laneOfRoot.emplace(FindLaneRoot(parents, i), lanes.size());
+        if (ret.second)
+            lanes.emplace_back();
+        lanes[ret.first->second].push_back(beginIndex + i);
+    }
+    return true;
+}
+
+// The lanes collide if a lane wrote a key which another lane read or wrote
+static bool IsLanesCollided(const vector<std::unique_ptr<CContractTxLane>> &lanes) {
+    map<CDbOpKey, size_t> writers;
+    for (size_t i = 0; i < lanes.size(); i++) {
+        for (const auto &key : lanes[i]->writeKeys) {
+            if (!writers.emplace(key, i).second)
+                return true;
+        }
+    }
+
+    for (size_t i = 0; i < lanes.size(); i++) {
+        for (const auto &key : lanes[i]->readKeys) {
+            auto it = writers.find(key);
+            if (it != writers.end() && it->second != i)
+                return true;
+        }
+    }
+    return false;
+}
+
+bool ExecuteContractTxLanes(CBlock &block, int32_t beginIndex, int32_t endIndex, CBlockIndex *pIndex,
+                            CCacheWrapper &cw, vector<CTxUndo> &txUndos, const ContractTxExecFunc &execFunc) {
+    if (!laneQueue || endIndex - beginIndex < MIN_CONTRACT_LANE_TXS)
+        return false;
+
+    vector<vector<int32_t>> laneTxIndexes;
+    if (!PartitionContractTxs(block, beginIndex, endIndex, cw, laneTxIndexes) || laneTxIndexes.size() < 2)
+        return false;
+
+    int64_t start = GetTimeMicros();
+    CCriticalSection csBase;
+    vector<std::unique_ptr<CContractTxLane>> lanes;
+    for (auto &txIndexes : laneTxIndexes) {
+        lanes.emplace_back(new CContractTxLane(block, pIndex, cw, csBase, execFunc));
+        lanes.back()->txIndexes = std::move(txIndexes);
+    }
+
+    CContractLaneBatch batch;
+    batch.pending = lanes.size();
+    for (auto &lane : lanes)
+        laneQueue->Push(CContractLaneTask{lane.get(), &batch});
+
+    // help the lane threads, which also makes sure that the batch completes when they were interrupted
+    CContractLaneTask task;
+    while (laneQueue->Pop(&task, std::chrono::milliseconds(0)))
+        task.Run();
+
+    batch.Wait();
+
+    for (const auto &lane : lanes) {
+        if (!lane->executed)
+            return false;
+    }
+
+    if (IsLanesCollided(lanes)) {
+        LogPrint(BCLog::DEBUG, "[%d] contract lanes of txs [%d, %d) collided, execute serially\n", pIndex->height,
+                 beginIndex, endIndex);
+        return false;
+    }
+
+    map<int32_t, CTxUndo *> undoOfTx;
+    for (auto &lane : lanes) {
+        lane->spCW->Flush();
+        for (size_t i = 0; i < lane->txIndexes.size(); i++)
+            undoOfTx[lane->txIndexes[i]] = &lane->txUndos[i];
+    }
+
+    txUndos.clear();
+    for (auto &item : undoOfTx)
+        txUndos.push_back(std::move(*item.second));
+
+    LogPrint(BCLog::DEBUG, "[%d] executed contract txs [%d, %d) in %d lanes, %d us\n", pIndex->height, beginIndex,
+             endIndex, lanes.size(), GetTimeMicros() - start);
+    return true;
+}
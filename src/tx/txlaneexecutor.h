@@ -0,0 +1,43 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TX_TXLANEEXECUTOR_H
+#define TX_TXLANEEXECUTOR_H
+
+#include "main.h"
+#include "persistence/blockundo.h"
+#include "tx/txmempool.h"
+
+#include <functional>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+// min number of consecutive lua contract txs of a block which are worth to be executed in lanes
+static const int32_t MIN_CONTRACT_LANE_TXS = 4;
+
+// Starts the threads executing the contract lanes of the connected blocks, see -contractlanethreads
+void StartContractLaneExecutor(boost::thread_group &threadGroup, int32_t threads);
+
+bool IsContractLaneExecutorStarted();
+
+// Executes a tx of a block in the context, the same as the serial execution of ConnectBlock
+typedef std::function<bool(CBaseTx &tx, CTxExecuteContext &context)> ContractTxExecFunc;
+
+bool CheckAndExecuteContractTx(CBaseTx &tx, CTxExecuteContext &context);
+
+/**
+ * Executes the consecutive lua contract txs block.vptx[beginIndex, endIndex) in parallel lanes.
+ * The txs are partitioned statically into lanes by the invoked contract and the involved accounts of
+ * the txs, the txs of a lane are executed in block order on a child cache of cw. The base reads of the
+ * lanes are serialized and recorded, the lanes are merged into cw in lane order only if all txs
+ * succeeded and no lane wrote a key which another lane read or wrote, the result equals the serial
+ * execution then. txUndos receives the undo of every tx in block order.
+ * Returns false if the txs must be executed serially instead, cw is unchanged then.
+ */
+bool ExecuteContractTxLanes(CBlock &block, int32_t beginIndex, int32_t endIndex, CBlockIndex *pIndex,
+                            CCacheWrapper &cw, vector<CTxUndo> &txUndos,
+                            const ContractTxExecFunc &execFunc = CheckAndExecuteContractTx);
+
+#endif  // TX_TXLANEEXECUTOR_H
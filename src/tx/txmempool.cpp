@@ -5,16 +5,19 @@
 
 #include "txmempool.h"
 #include "commons/uint256.h"
+#include "config/scoin.h"
 #include "main.h"
 #include "persistence/txdb.h"
 #include "tx/tx.h"
 #include "miner/miner.h"
+#include "tx/txpreexecutor.h"
 
 using namespace std;
 
 CTxMemPoolEntry::CTxMemPoolEntry() {
     nTxSize   = 0;
     dPriority = 0.0;
+    feePerKb  = 0.0;
 
     nTime   = 0;
     height = 0;
@@ -23,34 +26,69 @@ CTxMemPoolEntry::CTxMemPoolEntry() {
 CTxMemPoolEntry::CTxMemPoolEntry(CBaseTx *pBaseTx, int64_t time, uint32_t height) : nTime(time), height(height) {
     pTx       = pBaseTx->GetNewInstance();
     nFees     = pTx->GetFees();
-    nTxSize   = ::GetSerializeSize(*pTx, SER_NETWORK, PROTOCOL_VERSION);
+    nTxSize   = pTx->GetTxSize();
     dPriority = pTx->GetPriority();
+    feePerKb  = nTxSize > 0 ? double(nFees.second) / nTxSize * 1000.0 : 0.0;
+}
+
+void CTxMemPoolEntry::SetFuelFee(uint64_t fuelFee) {
+    feePerKb = nTxSize > 0 ? (double(nFees.second) - double(fuelFee)) / nTxSize * 1000.0 : 0.0;
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry &other) {
-    this->pTx       = other.pTx->GetNewInstance();
+    // the tx is already a private copy of the entry, it is shared by the copies of the entry
+    this->pTx       = other.pTx;
     this->nFees     = other.nFees;
     this->nTxSize   = other.nTxSize;
     this->dPriority = other.dPriority;
+    this->feePerKb  = other.feePerKb;
 
     this->nTime  = other.nTime;
     this->height = other.height;
 }
 
+CTxMemPoolRank::CTxMemPoolRank(double priority, double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn)
+    : tier(GetTier(priority)),
+      feePerKb(feePerKbIn),
+      txid(baseTxIn->GetHash()),
+      baseTx(baseTxIn) {}
+
+CTxMemPoolRank::CTxMemPoolRank(const CTxMemPoolEntry &entry, const uint256 &txidIn)
+    : tier(GetTier(entry.GetPriority())),
+      feePerKb(entry.GetFeePerKb()),
+      txid(txidIn),
+      baseTx(entry.GetTransaction()) {}
+
+int64_t CTxMemPoolRank::GetTier(double priority) {
+    return priority > TRANSACTION_PRIORITY_CEILING ? int64_t(priority / TRANSACTION_PRIORITY_CEILING) : 0;
+}
+
 CTxMemPool::CTxMemPool() {
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
     fSanityCheck         = false;
+    fPreExecutionEnabled = false;
+    commitSequence       = 0;
+    maxUsage             = DEFAULT_MAX_MEMPOOL_SIZE << 20;
+    maxSenderTxs         = DEFAULT_MEMPOOL_SENDER_LIMIT;
+    totalUsage           = 0;
+}
+
+void CTxMemPool::SetLimits(uint64_t maxUsageIn, uint32_t maxSenderTxsIn) {
+    LOCK(cs);
+    maxUsage     = maxUsageIn;
+    maxSenderTxs = maxSenderTxsIn;
 }
 
 void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive) {
     // Remove transaction from memory pool
     LOCK(cs);
     uint256 txid = pBaseTx->GetHash();
-    if (memPoolTxs.count(txid)) {
-        removed.push_front(std::shared_ptr<CBaseTx>(memPoolTxs[txid].GetTransaction()));
-        memPoolTxs.erase(txid);
+    auto it      = memPoolTxs.find(txid);
+    if (it != memPoolTxs.end()) {
+        removed.push_front(std::shared_ptr<CBaseTx>(it->second.GetTransaction()));
+        EraseEntry(it);
         EraseTransactionFromWallet(txid);
     }
 }
@@ -59,25 +97,187 @@ void CTxMemPool::Remove(const uint256 &txid) {
     LOCK(cs);
     auto it = memPoolTxs.find(txid);
     if (it != memPoolTxs.end()) {
-        memPoolTxs.erase(it);
+        EraseEntry(it);
         EraseTransactionFromWallet(txid);
     }
 }
 
-bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state) {
+void CTxMemPool::RemoveConfirmed(const uint256 &txid) {
+    LOCK(cs);
+    auto it = memPoolTxs.find(txid);
+    if (it != memPoolTxs.end())
+        EraseEntry(it);
+}
+
+bool CTxMemPool::AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state,
+                              CTxPreExecution *pPreExecution) {
     // Add to memory pool without checking anything.
     // Used by main.cpp AcceptToMemoryPool(), which DOES
     // all the appropriate checks.
     LOCK(cs);
     {
-        if (!CheckTxInMemPool(txid, entry, state))
+        string sender = GetSender(entry.GetTransaction().get());
+        if (!CheckSenderLimit(txid, sender, state))
             return false;
 
-        memPoolTxs.insert(make_pair(txid, entry));
+        // executed on a child cache, which is committed to the mempool cache only once the tx is admitted
+        std::shared_ptr<CCacheWrapper> spTxCW;
+        CTxMemPoolCommit commit;
+        if (!ExecuteTxInMemPool(txid, entry, state, true, pPreExecution, spTxCW, commit))
+            return false;
+
+        // ranked by the fee net of the fuel burned by the execution, as the miner packs them
+        CTxMemPoolEntry rankedEntry(entry);
+        CBlockIndex *pTip = chainActive.Tip();
+        uint32_t fuelRate = GetElementForBurn(pTip);
+        rankedEntry.SetFuelFee(rankedEntry.GetTransaction()->GetFuelFee(*spTxCW, pTip->height + 1, fuelRate));
+
+        // the tx read none of the keys written by the evicted txs, so its execution holds once they are undone
+        vector<uint256> evictTxids;
+        if (!SelectEvictions(txid, rankedEntry, commit.keys, evictTxids, state))
+            return false;
+
+        EvictEntries(evictTxids);
+        CommitTx(txid, *spTxCW, commit);
+        AddEntry(txid, rankedEntry, sender);
     }
     return true;
 }
 
+bool CTxMemPool::CheckSenderLimit(const uint256 &txid, const string &sender, CValidationState &state) const {
+    if (maxSenderTxs == 0)
+        return true;
+
+    auto it = senderTxCounts.find(sender);
+    if (it != senderTxCounts.end() && it->second >= maxSenderTxs)
+        return state.DoS(0, ERRORMSG("CheckSenderLimit() : txid: %s, sender %s has %u txs in mempool already",
+                         txid.GetHex(), sender, it->second), REJECT_NONSTANDARD, "too-many-sender-txs");
+
+    return true;
+}
+
+bool CTxMemPool::SelectEvictions(const uint256 &txid, const CTxMemPoolEntry &entry, const CDbOpKeySet &readKeys,
+                                 vector<uint256> &evictTxids, CValidationState &state) const {
+    evictTxids.clear();
+    uint64_t usage = totalUsage + entry.GetUsage();
+    if (maxUsage == 0 || usage <= maxUsage)
+        return true;
+
+    // only the entries ranked below the tx are evicted for it, down to the headroom below the budget
+    CTxMemPoolRank rank(entry, txid);
+    uint64_t targetUsage = maxUsage - maxUsage / 100 * MEMPOOL_EVICTION_HEADROOM;
+    if (cw) {
+        UndoDataFuncMap undoDataFuncMap = cw->GetUndoDataFuncMap();
+        set<uint64_t> evictSequences;
+        for (auto it = rankIndex.begin(); it != rankIndex.end() && usage > targetUsage && *it < rank; ++it) {
+            if (!IsEvictable(it->txid, readKeys, evictSequences, undoDataFuncMap))
+                continue;
+
+            evictTxids.push_back(it->txid);
+            evictSequences.insert(txCommits.at(it->txid).sequence);
+            usage -= memPoolTxs.at(it->txid).GetUsage();
+        }
+    }
+
+    if (usage > maxUsage) {
+        evictTxids.clear();
+        return state.DoS(0, ERRORMSG("SelectEvictions() : txid: %s, mempool full", txid.GetHex()),
+                         REJECT_INSUFFICIENTFEE, "mempool-full");
+    }
+
+    return true;
+}
+
+bool CTxMemPool::IsEvictable(const uint256 &txid, const CDbOpKeySet &readKeys, const set<uint64_t> &evictSequences,
+                             const UndoDataFuncMap &undoDataFuncMap) const {
+    // an entry indexed without its commit can not be undone, nor can a price feed tx, the price points it
+    // wrote to the memory cache have no undo logs
+    auto commitIt = txCommits.find(txid);
+    if (commitIt == txCommits.end() || memPoolTxs.at(txid).GetTransaction()->IsPriceFeedTx())
+        return false;
+
+    const CTxMemPoolCommit &commit = commitIt->second;
+    for (const auto &item : commit.dbOpLogMap.GetMap()) {
+        if (!undoDataFuncMap[item.first])
+            return false;
+
+        for (const auto &dbOpLog : item.second) {
+            CDbOpKey key(item.first, dbOpLog.GetKey());
+            if (readKeys.count(key))
+                return false;
+
+            const set<uint64_t> &sequences = keyCommitSequences.at(key);
+            for (auto it = sequences.rbegin(); it != sequences.rend() && *it > commit.sequence; ++it) {
+                if (!evictSequences.count(*it))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+void CTxMemPool::EvictEntries(const vector<uint256> &evictTxids) {
+    if (evictTxids.empty())
+        return;
+
+    // the later commits are undone first, each restores the values the commit before it left
+    vector<pair<uint64_t, uint256>> evictCommits;
+    for (const auto &evictTxid : evictTxids)
+        evictCommits.emplace_back(txCommits.at(evictTxid).sequence, evictTxid);
+    sort(evictCommits.rbegin(), evictCommits.rend());
+
+    UndoDataFuncMap undoDataFuncMap = cw->GetUndoDataFuncMap();
+    for (const auto &evictCommit : evictCommits) {
+        const uint256 &evictTxid = evictCommit.second;
+        LogPrint(BCLog::DEBUG, "evict txid=%s from mempool, usage=%llu, max=%llu\n", evictTxid.GetHex(),
+                 totalUsage, maxUsage);
+
+        const CDBOpLogMap &dbOpLogMap = txCommits.at(evictTxid).dbOpLogMap;
+        for (const auto &item : dbOpLogMap.GetMap())
+            undoDataFuncMap[item.first](item.second);
+        // the undo writes the keys again, which the pre-executions may have read
+        AddWriteKeys(dbOpLogMap);
+
+        EraseEntry(memPoolTxs.find(evictTxid));
+        EraseTransactionFromWallet(evictTxid);
+    }
+}
+
+void CTxMemPool::AddEntry(const uint256 &txid, const CTxMemPoolEntry &entry, const string &sender) {
+    if (!memPoolTxs.emplace(txid, entry).second)
+        return;
+
+    rankIndex.emplace(entry, txid);
+    totalUsage += entry.GetUsage();
+    txSenders[txid] = sender;
+    senderTxCounts[sender]++;
+}
+
+map<uint256, CTxMemPoolEntry>::iterator CTxMemPool::EraseEntry(map<uint256, CTxMemPoolEntry>::iterator it) {
+    rankIndex.erase(CTxMemPoolRank(it->second, it->first));
+    totalUsage -= it->second.GetUsage();
+
+    auto senderIt = txSenders.find(it->first);
+    if (senderIt != txSenders.end()) {
+        auto countIt = senderTxCounts.find(senderIt->second);
+        if (countIt != senderTxCounts.end() && --countIt->second == 0)
+            senderTxCounts.erase(countIt);
+        txSenders.erase(senderIt);
+    }
+
+    EraseCommit(it->first);
+    return memPoolTxs.erase(it);
+}
+
+string CTxMemPool::GetSender(const CBaseTx *pBaseTx) const {
+    // resolved to the key id, so that the regid and the pubkey of an account share its quota
+    CKeyID keyId;
+    if (cw && cw->accountCache.GetKeyId(pBaseTx->txUid, keyId))
+        return keyId.ToString();
+
+    return pBaseTx->txUid.ToString();
+}
+
 void CTxMemPool::QueryHash(vector<uint256> &txids) {
     LOCK(cs);
 
@@ -89,7 +289,19 @@ void CTxMemPool::QueryHash(vector<uint256> &txids) {
 }
 
 bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state,
-                                  bool bRehearsalExecute) {
+                                  bool bRehearsalExecute, CTxPreExecution *pPreExecution) {
+    std::shared_ptr<CCacheWrapper> spTxCW;
+    CTxMemPoolCommit commit;
+    if (!ExecuteTxInMemPool(txid, memPoolEntry, state, bRehearsalExecute, pPreExecution, spTxCW, commit))
+        return false;
+
+    CommitTx(txid, *spTxCW, commit);
+    return true;
+}
+
+bool CTxMemPool::ExecuteTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &memPoolEntry, CValidationState &state,
+                                    bool bRehearsalExecute, CTxPreExecution *pPreExecution,
+                                    std::shared_ptr<CCacheWrapper> &spTxCW, CTxMemPoolCommit &commit) {
     CBlockIndex *pTip =  chainActive.Tip();
     if (pTip == nullptr)
         throw runtime_error("CheckTxInMemPool:: ChainActive.Tip() is null");
@@ -106,13 +318,30 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
         return state.Invalid(ERRORMSG("CheckTxInMemPool() : txid: %s has been confirmed", txid.GetHex()), REJECT_INVALID,
                              "tx-duplicate-confirmed");
 
-    auto spCW = std::make_shared<CCacheWrapper>(cw.get());
+    if (pPreExecution != nullptr && AcceptPreExecution(*pPreExecution, *memPoolEntry.GetTransaction())) {
+        if (!pPreExecution->result) {
+            state = pPreExecution->state;
+            pCdMan->pLogCache->SetExecuteFail(newHeight, txid, state.GetRejectCode(), state.GetRejectReason());
+            return false;
+        }
+
+        pPreExecution->spCW->SetDbOpLogMap(nullptr);
+        spTxCW = pPreExecution->spCW;
+        std::swap(commit.dbOpLogMap, pPreExecution->dbOpLogMap);
+        commit.keys.swap(pPreExecution->readKeys);
+        return true;
+    }
+
+    // the undo logs and the read keys of the execution make the tx evictable
+    spTxCW = std::make_shared<CCacheWrapper>(cw.get());
+    commit.dbOpLogMap.SetReadObserver(&commit);
+    spTxCW->SetDbOpLogMap(&commit.dbOpLogMap);
 
     if (bRehearsalExecute) { //always true so far
         uint32_t fuelRate  = GetElementForBurn(pTip);
         uint32_t blockTime = pTip->GetBlockTime();
         uint32_t prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
-        CTxExecuteContext context(newHeight, 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state,
+        CTxExecuteContext context(newHeight, 0, fuelRate, blockTime, prevBlockTime, spTxCW.get(), &state,
                                 TxExecuteContextType::VALIDATE_MEMPOOL);
 
         if (!memPoolEntry.GetTransaction()->ExecuteFullTx(context)) { //rehearsal only within cache env
@@ -122,24 +351,52 @@ bool CTxMemPool::CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &me
         }
     }
 
-    spCW->Flush();
-
+    spTxCW->SetDbOpLogMap(nullptr);
+    commit.dbOpLogMap.SetReadObserver(nullptr);
     return true;
 }
 
+void CTxMemPool::CommitTx(const uint256 &txid, CCacheWrapper &txCW, CTxMemPoolCommit &commit) {
+    CommitCache(txCW, commit.dbOpLogMap);
+
+    commit.sequence = commitSequence;
+    for (const auto &item : commit.dbOpLogMap.GetMap()) {
+        for (const auto &dbOpLog : item.second)
+            commit.keys.emplace(item.first, dbOpLog.GetKey());
+    }
+    for (const auto &key : commit.keys)
+        keyCommitSequences[key].insert(commit.sequence);
+    txCommits[txid] = std::move(commit);
+}
+
+void CTxMemPool::EraseCommit(const uint256 &txid) {
+    auto it = txCommits.find(txid);
+    if (it == txCommits.end())
+        return;
+
+    for (const auto &key : it->second.keys) {
+        auto sequencesIt = keyCommitSequences.find(key);
+        sequencesIt->second.erase(it->second.sequence);
+        if (sequencesIt->second.empty())
+            keyCommitSequences.erase(sequencesIt);
+    }
+    txCommits.erase(it);
+}
+
 void CTxMemPool::SetMemPoolCache() {
-    cw.reset(new CCacheWrapper(pCdMan));
+    LOCK(cs);
+    ResetCache();
 }
 
 void CTxMemPool::ReScanMemPoolTx() {
-    cw.reset(new CCacheWrapper(pCdMan));
-
     LOCK(cs);
+    ResetCache();
+
     CValidationState state;
     for (map<uint256, CTxMemPoolEntry>::iterator iterTx = memPoolTxs.begin(); iterTx != memPoolTxs.end();) {
         if (!CheckTxInMemPool(iterTx->first, iterTx->second, state, true)) {
             uint256 txid = iterTx->first;
-            iterTx       = memPoolTxs.erase(iterTx++);
+            iterTx       = EraseEntry(iterTx);
             EraseTransactionFromWallet(txid);
             continue;
         }
@@ -151,7 +408,82 @@ void CTxMemPool::Clear() {
     LOCK(cs);
 
     memPoolTxs.clear();
+    rankIndex.clear();
+    txSenders.clear();
+    senderTxCounts.clear();
+    totalUsage = 0;
+    ResetCache();
+}
+
+void CTxMemPool::ResetCache() {
+    // the pre-executions against the previous cache become invalid along with its tracked keys
     cw.reset(new CCacheWrapper(pCdMan));
+    recentWriteKeys.clear();
+    txCommits.clear();
+    keyCommitSequences.clear();
+}
+
+void CTxMemPool::SetPreExecutionEnabled(bool fEnabled) {
+    LOCK(cs);
+    fPreExecutionEnabled = fEnabled;
+    recentWriteKeys.clear();
+}
+
+bool CTxMemPool::AcceptPreExecution(CTxPreExecution &preExecution, CBaseTx &tx) {
+    if (!IsPreExecutionValid(preExecution))
+        return false;
+
+    if (preExecution.result) {
+        // the fuel burned by the execution is part of the fee the tx is ranked and packed by
+        tx.fuel      = preExecution.spTx->fuel;
+        tx.nFuelRate = preExecution.spTx->nFuelRate;
+    }
+    return true;
+}
+
+void CTxMemPool::CommitCache(CCacheWrapper &txCW, const CDBOpLogMap &dbOpLogMap) {
+    txCW.Flush();
+    AddWriteKeys(dbOpLogMap);
+}
+
+bool CTxMemPool::IsPreExecutionValid(const CTxPreExecution &preExecution) const {
+    if (!fPreExecutionEnabled || !preExecution.executed || preExecution.spBaseCW != cw)
+        return false;
+
+    if (preExecution.startSequence == commitSequence)
+        return true;
+
+    // the keys written by some of the txs committed since then are not tracked any more
+    if (recentWriteKeys.empty() || recentWriteKeys.front().first > preExecution.startSequence + 1)
+        return false;
+
+    for (auto it = recentWriteKeys.rbegin(); it != recentWriteKeys.rend() && it->first > preExecution.startSequence; it++) {
+        for (const auto &key : it->second) {
+            if (preExecution.readKeys.count(key)) {
+                LogPrint(BCLog::DEBUG, "pre-execution of txid=%s conflicts with the tx committed at sequence %llu\n",
+                         preExecution.txid.GetHex(), it->first);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void CTxMemPool::AddWriteKeys(const CDBOpLogMap &dbOpLogMap) {
+    ++commitSequence;
+    if (!fPreExecutionEnabled)
+        return;
+
+    CDbOpKeySet writeKeys;
+    for (const auto &item : dbOpLogMap.GetMap()) {
+        for (const auto &dbOpLog : item.second)
+            writeKeys.emplace(item.first, dbOpLog.GetKey());
+    }
+
+    recentWriteKeys.emplace_back(commitSequence, std::move(writeKeys));
+    if (recentWriteKeys.size() > MAX_TRACKED_MEMPOOL_COMMITS)
+        recentWriteKeys.pop_front();
 }
 
 uint64_t CTxMemPool::Size() {
@@ -159,6 +491,11 @@ uint64_t CTxMemPool::Size() {
     return memPoolTxs.size();
 }
 
+uint64_t CTxMemPool::GetUsage() {
+    LOCK(cs);
+    return totalUsage;
+}
+
 bool CTxMemPool::Exists(const uint256 txid) {
     LOCK(cs);
     return ((memPoolTxs.count(txid) != 0));
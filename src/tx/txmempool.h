@@ -11,16 +11,37 @@
 #include "persistence/cachewrapper.h"
 #include "sync.h"
 
+#include <atomic>
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
+#include <set>
 
 using namespace std;
 
 class CValidationState;
 class CBaseTx;
+class CTxPreExecution;
 class uint256;
 
+// prefix type and serialized key of a cache entry, as in CDbOpLog
+typedef std::pair<dbk::PrefixType, string> CDbOpKey;
+typedef std::set<CDbOpKey> CDbOpKeySet;
+
+// commits of the mempool cache whose written keys are kept to validate pre-executions
+static const uint32_t MAX_TRACKED_MEMPOOL_COMMITS = 1000;
+
+// default memory budget of the mempool txs in megabytes, see -maxmempool
+static const uint64_t DEFAULT_MAX_MEMPOOL_SIZE = 300;
+// default max txs of a sender in the mempool, 0 for unlimited, see -mempoolsenderlimit
+static const uint32_t DEFAULT_MEMPOOL_SENDER_LIMIT = 0;
+// percent of the memory budget freed below it by an eviction, so that a full mempool does not evict for
+// each tx admitted to it
+static const uint32_t MEMPOOL_EVICTION_HEADROOM = 10;
+// estimated memory of an entry besides the serialized tx: the tx object, the map and index nodes
+static const uint32_t MEMPOOL_ENTRY_OVERHEAD = 512;
+
 /*
  * CTxMemPool stores these:
  */
@@ -30,6 +51,7 @@ private:
     std::pair<TokenSymbol, uint64_t> nFees;  // Cached to avoid expensive parent-transaction lookups
     uint32_t nTxSize;                     // Cached to avoid recomputing tx size
     double dPriority;                     // Cached to avoid recomputing priority
+    double feePerKb;                      // fees per KB of the tx net of its fuel fee once executed
 
     int64_t nTime;     // Local time when entering the mempool
     uint32_t height;  // Chain height when entering the mempool
@@ -44,11 +66,56 @@ public:
     inline std::pair<TokenSymbol, uint64_t> GetFees() const { return nFees; }
     inline uint32_t GetTxSize() const { return nTxSize; }
     inline double GetPriority() const { return dPriority; }
+    inline double GetFeePerKb() const { return feePerKb; }
+    void SetFuelFee(uint64_t fuelFee);
+    inline uint64_t GetUsage() const { return nTxSize + MEMPOOL_ENTRY_OVERHEAD; }
 
     inline int64_t GetTime() const { return nTime; }
     inline uint32_t GetHeight() const { return height; }
 };
 
+/**
+ * Rank of a tx as the miner packs them: by priority tier, then by fee per KB net of the fuel fee, and by
+ * txid to be unique. The priorities up to TRANSACTION_PRIORITY_CEILING are of tier 0, so the zero fee CDP
+ * interest settlement tx is packed after the user txs, and the special txs (price feed, price median, ...)
+ * are ranked above them by the multiple of the ceiling of their priorities. The mempool keeps its
+ * entries by rank, the miner packs them from the highest and they are evicted from the lowest when the
+ * mempool is over its memory budget.
+ */
+struct CTxMemPoolRank {
+    int64_t tier;
+    double feePerKb;
+    uint256 txid;
+    std::shared_ptr<CBaseTx> baseTx;
+
+    CTxMemPoolRank(double priority, double feePerKbIn, const std::shared_ptr<CBaseTx> &baseTxIn);
+    CTxMemPoolRank(const CTxMemPoolEntry &entry, const uint256 &txidIn);
+
+    static int64_t GetTier(double priority);
+
+    bool operator<(const CTxMemPoolRank &other) const {
+        if (tier != other.tier)
+            return tier < other.tier;
+        if (feePerKb != other.feePerKb)
+            return feePerKb < other.feePerKb;
+        return txid < other.txid;
+    }
+};
+
+/**
+ * Execution of a tx committed to the mempool cache: the undo logs of its writes and the keys it read from
+ * the mempool cache or wrote, which are recorded while it executes. A tx whose written keys no tx
+ * committed after it has read is evicted by undoing its logs in the cache.
+ */
+struct CTxMemPoolCommit : public CDBReadObserver {
+    uint64_t sequence = 0;      // commit sequence of the tx, see CTxMemPool::GetCommitSequence()
+    CDBOpLogMap dbOpLogMap;
+    CDbOpKeySet keys;
+
+    void BeginBaseRead(dbk::PrefixType prefixType, const string &key) override { keys.emplace(prefixType, key); }
+    void EndBaseRead() override {}
+};
+
 /*
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -70,22 +137,89 @@ public:
 
 public:
     void SetSanityCheck(bool fSanityCheckIn) { fSanityCheck = fSanityCheckIn; }
-    bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state);
+    // Memory budget of the txs in bytes and max txs of a sender, see -maxmempool and -mempoolsenderlimit
+    void SetLimits(uint64_t maxUsageIn, uint32_t maxSenderTxsIn);
+    bool AddUnchecked(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state,
+                      CTxPreExecution *pPreExecution = nullptr);
     void Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &removed, bool fRecursive = false);
     void Remove(const uint256 &txid);
+    // Removes a tx confirmed by a connected block, the wallet is synced with the block
+    void RemoveConfirmed(const uint256 &txid);
     void QueryHash(vector<uint256> &txids);
     bool CheckTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state,
-                          bool bRehearsalExecute = true);
+                          bool bRehearsalExecute = true, CTxPreExecution *pPreExecution = nullptr);
     void SetMemPoolCache();
     void ReScanMemPoolTx();
     void Clear();
 
     uint64_t Size();
+    uint64_t GetUsage();
+    // Entries by rank, the highest last, must hold cs
+    const set<CTxMemPoolRank>& GetRankIndex() const { return rankIndex; }
     bool Exists(const uint256 txid);
     std::shared_ptr<CBaseTx> Lookup(const uint256 txid) const;
 
+    // Pre-executed txs can only be committed while the keys written to the cache are tracked
+    void SetPreExecutionEnabled(bool fEnabled);
+    bool IsPreExecutionEnabled() const { return fPreExecutionEnabled; }
+
+    // Takes the result of the pre-execution of the tx if nothing it read has been written since, the fuel of
+    // the execution is copied to the tx, otherwise returns false and the tx must be executed again, must hold cs
+    bool AcceptPreExecution(CTxPreExecution &preExecution, CBaseTx &tx);
+    // Flushes the cache of an executed tx to the mempool cache and tracks the keys it wrote, must hold cs
+    void CommitCache(CCacheWrapper &txCW, const CDBOpLogMap &dbOpLogMap);
+
+    // Sequence number of the last change committed to the cache, a tx or the undo of an evicted one, must hold cs
+    uint64_t GetCommitSequence() const { return commitSequence; }
+
+private:
+    friend class CTxMemPoolTestAccess;  // see tests/txmempooltestaccess.h
+
+    // Checks the sender of the tx is within its quota of mempool txs
+    bool CheckSenderLimit(const uint256 &txid, const string &sender, CValidationState &state) const;
+    /**
+     * Selects the lowest ranked entries to evict for the ranked entry to fit in the memory budget, returns
+     * false if the entry is not admitted. Only the entries whose writes can be undone in the mempool cache
+     * are evicted: none of the keys they wrote was read by the tx, of readKeys, nor by a tx committed
+     * after them which is not evicted as well.
+     */
+    bool SelectEvictions(const uint256 &txid, const CTxMemPoolEntry &entry, const CDbOpKeySet &readKeys,
+                         vector<uint256> &evictTxids, CValidationState &state) const;
+    bool IsEvictable(const uint256 &txid, const CDbOpKeySet &readKeys, const set<uint64_t> &evictSequences,
+                     const UndoDataFuncMap &undoDataFuncMap) const;
+    // Undoes the writes of the selected entries in the mempool cache, from the last committed, and removes them
+    void EvictEntries(const vector<uint256> &evictTxids);
+    // Indexes an entry whose tx has been committed to the mempool cache
+    void AddEntry(const uint256 &txid, const CTxMemPoolEntry &entry, const string &sender);
+
+    map<uint256, CTxMemPoolEntry>::iterator EraseEntry(map<uint256, CTxMemPoolEntry>::iterator it);
+    string GetSender(const CBaseTx *pBaseTx) const;
+    bool ExecuteTxInMemPool(const uint256 &txid, const CTxMemPoolEntry &entry, CValidationState &state,
+                            bool bRehearsalExecute, CTxPreExecution *pPreExecution,
+                            std::shared_ptr<CCacheWrapper> &spTxCW, CTxMemPoolCommit &commit);
+    // Commits the cache of an executed tx and keeps its commit to evict it
+    void CommitTx(const uint256 &txid, CCacheWrapper &txCW, CTxMemPoolCommit &commit);
+    void EraseCommit(const uint256 &txid);
+
+    bool IsPreExecutionValid(const CTxPreExecution &preExecution) const;
+    void AddWriteKeys(const CDBOpLogMap &dbOpLogMap);
+    void ResetCache();
+
 private:
     bool fSanityCheck; // Normally false, true if -checkmempool or -regtest
+
+    std::atomic<bool> fPreExecutionEnabled;
+    uint64_t commitSequence;
+    std::deque<std::pair<uint64_t, CDbOpKeySet>> recentWriteKeys; // commit sequence -> keys written by the tx
+    map<uint256, CTxMemPoolCommit> txCommits;               // txid -> commit of the tx in the mempool cache
+    map<CDbOpKey, set<uint64_t>> keyCommitSequences;        // key -> sequences of the commits which read or wrote it
+
+    uint64_t maxUsage;
+    uint32_t maxSenderTxs;
+    uint64_t totalUsage;                    // usage of the entries of memPoolTxs
+    set<CTxMemPoolRank> rankIndex;          // entries of memPoolTxs by rank
+    map<uint256, string> txSenders;         // txid -> sender
+    map<string, uint32_t> senderTxCounts;   // sender -> txs in the mempool
 };
 
 
@@ -0,0 +1,125 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txpreexecutor.h"
+
+#include "commons/messagequeue.h"
+#include "miner/miner.h"
+
+using namespace std;
+
+void CTxPreExecution::Execute(const CBaseTx *pBaseTx) {
+    CBlockIndex *pTip;
+    HeightType newHeight;
+    uint32_t fuelRate, blockTime, prevBlockTime;
+    {
+        LOCK2(cs_main, pool.cs);
+        pTip = chainActive.Tip();
+        if (pTip == nullptr)
+            return;
+
+        newHeight     = pTip->height + 1;
+        fuelRate      = GetElementForBurn(pTip);
+        blockTime     = pTip->GetBlockTime();
+        prevBlockTime = pTip->pprev != nullptr ? pTip->pprev->GetBlockTime() : pTip->GetBlockTime();
+
+        startSequence = pool.GetCommitSequence();
+        spBaseCW      = pool.cw;
+    }
+
+    txid = pBaseTx->GetHash();
+    spCW = std::make_shared<CCacheWrapper>(spBaseCW.get());
+    dbOpLogMap.SetReadObserver(this);
+    spCW->SetDbOpLogMap(&dbOpLogMap);
+
+    // the execution changes the in-memory data of the tx
+    spTx = pBaseTx->GetNewInstance();
+    CTxExecuteContext context(newHeight, 0, fuelRate, blockTime, prevBlockTime, spCW.get(), &state,
+                              TxExecuteContextType::VALIDATE_MEMPOOL);
+    // the block indexes are never freed, the captured tip can be read without holding cs_main
+    context.pTipIndex = pTip;
+    try {
+        result   = spTx->ExecuteFullTx(context);
+        executed = true;
+    } catch (std::exception &e) {
+        LogPrint(BCLog::ERROR, "pre-execution of txid=%s failed: %s\n", txid.GetHex(), e.what());
+    }
+
+    // the cache is flushed to the mempool cache when committed, which must not be observed
+    dbOpLogMap.SetReadObserver(nullptr);
+}
+
+void CTxPreExecution::BeginBaseRead(dbk::PrefixType prefixType, const string &key) {
+    ENTER_CRITICAL_SECTION(cs_main);
+    ENTER_CRITICAL_SECTION(pool.cs);
+    readKeys.emplace(prefixType, key);
+}
+
+void CTxPreExecution::EndBaseRead() {
+    LEAVE_CRITICAL_SECTION(pool.cs);
+    LEAVE_CRITICAL_SECTION(cs_main);
+}
+
+std::shared_ptr<CTxPreExecution> PreExecuteTx(CTxMemPool &pool, const CBaseTx *pBaseTx) {
+    if (!pool.IsPreExecutionEnabled() || pBaseTx->nTxType != LCONTRACT_INVOKE_TX)
+        return nullptr;
+
+    auto spPreExecution = std::make_shared<CTxPreExecution>(pool);
+    spPreExecution->Execute(pBaseTx);
+    return spPreExecution;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// pre-execution threads
+
+struct CTxPreExecutionTask {
+    std::shared_ptr<CBaseTx> pBaseTx;
+    TxPreExecutedCallback callback;
+};
+
+static std::unique_ptr<MsgQueue<CTxPreExecutionTask>> preExecutionQueue;
+
+static void ThreadTxPreExecute() {
+    CTxPreExecutionTask task;
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        if (!preExecutionQueue->Pop(&task))
+            continue;
+
+        try {
+            auto spPreExecution = PreExecuteTx(mempool, task.pBaseTx.get());
+            task.callback(task.pBaseTx, spPreExecution.get());
+        } catch (std::exception &e) {
+            LogPrint(BCLog::ERROR, "accept pre-executed txid=%s failed: %s\n", task.pBaseTx->GetHash().GetHex(),
+                     e.what());
+        }
+        task = CTxPreExecutionTask();
+    }
+}
+
+void StartTxPreExecutor(boost::thread_group &threadGroup, int32_t threads) {
+    if (threads <= 0)
+        return;
+
+    preExecutionQueue.reset(new MsgQueue<CTxPreExecutionTask>(MAX_PRE_EXECUTION_QUEUE_SIZE));
+    mempool.SetPreExecutionEnabled(true);
+
+    for (int32_t i = 0; i < threads; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "preexec", &ThreadTxPreExecute));
+
+    LogPrint(BCLog::INFO, "started %d threads to pre-execute contract txs\n", threads);
+}
+
+bool PushTxPreExecution(std::shared_ptr<CBaseTx> pBaseTx, TxPreExecutedCallback callback) {
+    if (!preExecutionQueue || pBaseTx->nTxType != LCONTRACT_INVOKE_TX)
+        return false;
+
+    // only the message handler thread pushes, the queue can not become full in between
+    if (preExecutionQueue->Full())
+        return false;
+
+    preExecutionQueue->Push(CTxPreExecutionTask{pBaseTx, callback});
+    return true;
+}
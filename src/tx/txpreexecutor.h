@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TX_TXPREEXECUTOR_H
+#define TX_TXPREEXECUTOR_H
+
+#include "main.h"
+#include "tx/txmempool.h"
+
+#include <functional>
+#include <memory>
+
+#include <boost/thread.hpp>
+
+// max contract txs of peers waiting for a pre-execution thread
+static const uint32_t MAX_PRE_EXECUTION_QUEUE_SIZE = 10000;
+
+/**
+ * Speculative execution of a tx against the mempool cache, done without holding cs_main so that
+ * contract txs can be executed in parallel before being accepted to the mempool serially.
+ * The reads which miss the private cache of the execution are served from the mempool cache under
+ * cs_main and mempool.cs and their keys are recorded. The result is committed by
+ * CTxMemPool::CheckTxInMemPool as long as no tx committed to the mempool since the execution started
+ * has written any of these keys, otherwise the tx is executed again serially.
+ */
+class CTxPreExecution : public CDBReadObserver {
+public:
+    CTxPreExecution(CTxMemPool &poolIn) : pool(poolIn) {}
+
+    // caller must not hold mempool.cs
+    void Execute(const CBaseTx *pBaseTx);
+
+    void BeginBaseRead(dbk::PrefixType prefixType, const string &key) override;
+    void EndBaseRead() override;
+
+public:
+    uint256 txid;
+    bool executed = false;  // false if the execution threw, the tx is executed serially then
+    bool result   = false;
+    CValidationState state;
+
+    uint64_t startSequence = 0;               // commit sequence of the mempool when the execution started
+    std::shared_ptr<CCacheWrapper> spBaseCW;  // mempool cache which was read
+    std::shared_ptr<CCacheWrapper> spCW;      // private cache holding the writes of the tx
+    std::shared_ptr<CBaseTx> spTx;            // executed instance of the tx, holding the fuel it burned
+    CDBOpLogMap dbOpLogMap;
+    CDbOpKeySet readKeys;
+
+private:
+    CTxMemPool &pool;
+};
+
+// Pre-executes the tx if it is a contract tx and pre-execution is enabled, otherwise returns nullptr
+std::shared_ptr<CTxPreExecution> PreExecuteTx(CTxMemPool &pool, const CBaseTx *pBaseTx);
+
+typedef std::function<void(std::shared_ptr<CBaseTx> pBaseTx, CTxPreExecution *pPreExecution)> TxPreExecutedCallback;
+
+// Starts the threads pre-executing the contract txs relayed by peers, see -mempoolpreexecthreads
+void StartTxPreExecutor(boost::thread_group &threadGroup, int32_t threads);
+
+/**
+ * Queues a contract tx to be pre-executed by the pre-execution threads, which then call the callback
+ * with the result to accept the tx. Returns false if the tx is not pre-executed or the queue is full,
+ * the caller accepts the tx itself then.
+ */
+bool PushTxPreExecution(std::shared_ptr<CBaseTx> pBaseTx, TxPreExecutedCallback callback);
+
+#endif  // TX_TXPREEXECUTOR_H
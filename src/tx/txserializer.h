@@ -332,6 +332,15 @@ void CBaseTx::UnserializePtr(Stream& is, std::shared_ptr<CBaseTx> &pBaseTx, int
                                 __FUNCTION__, pBaseTx->nTxType, GetTxType(pBaseTx->nTxType)));
     }
     pBaseTx->nTxType = TxType(nTxType);
+    pBaseTx->serializedSize = pBaseTx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+}
+
+// Unserializes a tx received from a peer, its bytes are kept in rawTx to relay them as received
+inline void UnserializeReceivedTx(CDataStream &is, std::shared_ptr<CBaseTx> &pBaseTx) {
+    auto spRawTx = std::make_shared<CDataStream>(is.begin(), is.end(), is.GetType(), is.GetVersion());
+    is >> pBaseTx;
+    spRawTx->resize(spRawTx->size() - is.size());
+    pBaseTx->rawTx = spRawTx;
 }
 
 #endif //TX_SERIALIZER_H
@@ -18,6 +18,7 @@
 #include "wasm/types/name.hpp"
 #include "wasm/abi_def.hpp"
 #include "wasm/abi_serializer.hpp"
+#include "wasm/abi_serializer_cache.hpp"
 #include "wasm/wasm_variant_trace.hpp"
 #include "wasm/exception/exceptions.hpp"
 #include "wasm/modules/wasm_native_dispatch.hpp"
@@ -59,13 +60,13 @@ void CUniversalTx::validate_contracts(CTxExecuteContext& context) {
         auto contract = wasm::name(inline_trx.contract);
         if (is_native_contract(contract.value)) continue;
 
-        CUniversalContractStore contract_store;
-        CHAIN_ASSERT( database.contractCache.GetContract(CRegID(contract.value), contract_store),
+        CUniversalContractMeta contract_meta;
+        CHAIN_ASSERT( database.contractCache.GetContractMeta(CRegID(contract.value), contract_meta),
                       wasm_chain::contract_exception,
                       "cannot get contract with regid '%s'",
                       contract.to_string() )
 
-        CHAIN_ASSERT( contract_store.code.size() > 0 && contract_store.abi.size() > 0,
+        CHAIN_ASSERT( contract_meta.code_size > 0 && contract_meta.abi_size > 0,
                       wasm_chain::contract_exception,
                       "contract '%s' abi or code  does not exist",
                       contract.to_string() )
@@ -402,6 +403,22 @@ static bool get_contract_abi(CContractDBCache &contractCache, uint64_t contractI
     return true;
 }
 
+static wasm::abi_serializer_cache::abi_serializer_ptr get_contract_abi_serializer(CContractDBCache &contractCache,
+                                                                                  uint64_t contractId) {
+    auto &abiCache = wasm::abi_serializer_cache::instance();
+    auto loader    = [&](vector<char> &abi) { return get_contract_abi(contractCache, contractId, abi); };
+
+    // the abi of a native contract never changes
+    if (is_native_contract(contractId))
+        return abiCache.get(contractId, uint256(), loader);
+
+    CUniversalContractMeta contractMeta;
+    if (!contractCache.GetContractMeta(CRegID(contractId), contractMeta) || contractMeta.abi_size == 0)
+        return nullptr;
+
+    return abiCache.get(contractId, contractMeta.abi_hash, loader);
+}
+
 Object CUniversalTx::ToJson(CCacheWrapper &cw) const {
 
     if (inline_transactions.size() == 0) return Object{};
@@ -425,15 +442,15 @@ Object CUniversalTx::ToJson(CCacheWrapper &cw) const {
         Value inline_tx_item;
         to_variant(item, inline_tx_item);
         auto &obj = inline_tx_item.get_obj();
-        vector<char>  abi;
-        if (get_contract_abi(cw.contractCache, item.contract, abi)) {
-            try {
-                json_spirit::Value value = wasm::abi_serializer::unpack(
-                    abi, wasm::name(item.action).to_string(), item.data, max_serialization_time);
+        try {
+            auto abis = get_contract_abi_serializer(cw.contractCache, item.contract);
+            if (abis) {
+                json_spirit::Value value =
+                    abis->unpack_action(wasm::name(item.action).to_string(), item.data, max_serialization_time);
                 obj.push_back(Pair("data_detail", value));
-            } catch(wasm_chain::exception &e){
-                ERRORMSG("unpack contract=%s data error: %s", CRegID(item.contract).ToString(), e.to_detail_string());
             }
+        } catch(wasm_chain::exception &e){
+            ERRORMSG("unpack contract=%s data error: %s", CRegID(item.contract).ToString(), e.to_detail_string());
         }
         inline_transactions_arr.push_back(inline_tx_item);
     }
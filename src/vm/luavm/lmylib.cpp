@@ -1214,6 +1214,12 @@ int32_t ExGetTxConfirmHeightFunc(lua_State *L) {
 }
 
 
+// the tip of the active chain, as captured by an execution not holding cs_main
+static const CBlockIndex *GetTipIndex(CLuaVMRunEnv *pVmRunEnv) {
+    const CBlockIndex *pTipIndex = pVmRunEnv->GetContext().p_tip_index;
+    return pTipIndex != nullptr ? pTipIndex : chainActive.Tip();
+}
+
 /**
  *bool GetBlockHash(const uint32_t height,void * const pBlochHash)
  * 这个函数式从中间层传了一个参数过来:
@@ -1236,12 +1242,13 @@ int32_t ExGetBlockHashFunc(lua_State *L) {
         return RetFalse("ExGetBlockHashFunc para err2");
     }
 
-    if (chainActive.Height() < height) {  //获取比当前高度高的数据是不可以的
+    const CBlockIndex *pTipIndex = GetTipIndex(pVmRunEnv);
+    if (pTipIndex == nullptr || pTipIndex->height < height) {  //获取比当前高度高的数据是不可以的
         return RetFalse("ExGetBlockHashFunc para err3");
     }
 
-    CBlockIndex *pIndex = chainActive[height];
-    uint256 blockHash   = pIndex->GetBlockHash();
+    const CBlockIndex *pIndex = pTipIndex->GetAncestor(height);
+    uint256 blockHash         = pIndex->GetBlockHash();
 
     //  LogPrint(BCLog::LUAVM,"ExGetBlockHashFunc:%s",HexStr(blockHash).c_str());
     CDataStream tep(SER_DISK, CLIENT_VERSION);
@@ -1354,11 +1361,10 @@ int32_t ExWriteDataDBFunc(lua_State *L) {
 
     const CRegID contractRegId = pVmRunEnv->GetContractRegID();
     bool flag = true;
-    CContractDBCache* scriptDB = pVmRunEnv->GetScriptDB();
     string oldValue;
-    // TODO: get old data when set data ??
-    scriptDB->GetContractData(contractRegId, key, oldValue);
-    if (!scriptDB->SetContractData(contractRegId, key, value)) {
+    // the old value is needed for the fuel of the store
+    pVmRunEnv->GetContractData(contractRegId, key, oldValue);
+    if (!pVmRunEnv->SetContractData(contractRegId, key, value)) {
         LogPrint(BCLog::LUAVM, "ExWriteDataDBFunc SetContractData failed, key:%s!\n",HexStr(key));
         lua_BurnStoreUnchanged(L, key.size(), value.size(), BURN_VER_R2);
         flag = false;
@@ -1392,14 +1398,13 @@ int32_t ExDeleteDataDBFunc(lua_State *L) {
     }
 
     CRegID contractRegId       = pVmRunEnv->GetContractRegID();
-    CContractDBCache *scriptDB = pVmRunEnv->GetScriptDB();
 
     bool flag = true;
     string oldValue;
-    // TODO: get old data when set data ??
-    scriptDB->GetContractData(contractRegId, key, oldValue);
+    // the old value is needed for the fuel of the store
+    pVmRunEnv->GetContractData(contractRegId, key, oldValue);
 
-    if (!scriptDB->EraseContractData(contractRegId, key)) {
+    if (!pVmRunEnv->EraseContractData(contractRegId, key)) {
         LogPrint(BCLog::LUAVM, "ExDeleteDataDBFunc EraseContractData railed, key:%s!\n", HexStr(*retdata.at(0)));
         lua_BurnStoreUnchanged(L, key.size(), oldValue.size(), BURN_VER_R2);
         flag = false;
@@ -1435,9 +1440,8 @@ int32_t ExReadDataDBFunc(lua_State *L) {
     CRegID scriptRegId = pVmRunEnv->GetContractRegID();
 
     string value;
-    CContractDBCache* scriptDB = pVmRunEnv->GetScriptDB();
     int32_t len = 0;
-    if (!scriptDB->GetContractData(scriptRegId, key, value)) {
+    if (!pVmRunEnv->GetContractData(scriptRegId, key, value)) {
         len = 0;
         lua_BurnStoreUnchanged(L, key.size(), 0, BURN_VER_R2);
     } else {
@@ -1487,11 +1491,10 @@ int32_t ExModifyDataDBFunc(lua_State *L) {
     }
 
     CRegID contractRegId = pVmRunEnv->GetContractRegID();
-    CContractDBCache* scriptDB = pVmRunEnv->GetScriptDB();
     string oldValue;
     bool flag = false;
-    if (scriptDB->GetContractData(contractRegId, key, oldValue)) {
-        if (scriptDB->SetContractData(contractRegId, key, newValue)) {
+    if (pVmRunEnv->GetContractData(contractRegId, key, oldValue)) {
+        if (pVmRunEnv->SetContractData(contractRegId, key, newValue)) {
             lua_BurnStoreSet(L, key.size(),  oldValue.size(), newValue.size(), BURN_VER_R2);
             flag = true;
         } else {
@@ -1646,13 +1649,12 @@ int32_t ExGetContractDataFunc(lua_State *L) {
     if (nullptr == pVmRunEnv)
         return RetFalse("pVmRunEnv is nullptr");
 
-    CContractDBCache *scriptDB = pVmRunEnv->GetScriptDB();
     CRegID contractRegId(*retdata.at(0));
     string key((*retdata.at(1)).begin(), (*retdata.at(1)).end());
     string value;
 
     int32_t len = 0;
-    if (contractRegId.IsEmpty() || !scriptDB->GetContractData(contractRegId, key, value)) {
+    if (contractRegId.IsEmpty() || !pVmRunEnv->GetContractData(contractRegId, key, value)) {
         len = 0;
         lua_BurnStoreUnchanged(L, key.size(), 0, BURN_VER_R2);
     } else {
@@ -2053,7 +2055,8 @@ int32_t ExTransferContractAsset(lua_State *L) {
         return RetFalse(string(__FUNCTION__) + "para  err3 !");
     }
 
-    temp.get()->AutoMergeFreezeToFree(chainActive.Height());
+    const CBlockIndex *pTipIndex = GetTipIndex(pVmRunEnv);
+    temp.get()->AutoMergeFreezeToFree(pTipIndex != nullptr ? pTipIndex->height : -1);
 
     uint64_t nMoney = temp.get()->GetBcoins();
 
@@ -152,7 +152,9 @@ LUA_API int lua_StartBurner(lua_State *L, void* pContext, unsigned long long fue
     L->burnerState.fuelStore        = 0;
     L->burnerState.fuelAccount      = 0;
     L->burnerState.fuelFunction     = 0;
+    L->burnerState.instructions     = 0;
     L->burnerState.tracer           = NULL;
+    L->burnerState.caller           = NULL;
     return 1;
 }
 
@@ -177,6 +179,9 @@ LUA_API int lua_BurnMemory(lua_State *L, void *block, size_t osize, size_t nsize
 }
 
 LUA_API int lua_BurnStep(lua_State *L, unsigned long long step, int version) {
+    if (IsBurnerStarted(L)) {
+        L->burnerState.instructions += step;
+    }
     if (IsBurnerRuning(L) && version <= L->burnerState.version) {
         L->burnerState.fuel += step;
         L->burnerState.fuelStep += step;
@@ -337,4 +342,10 @@ LUA_API lua_burner_trace_cb lua_SetBurnerTracer(lua_State *L, lua_burner_trace_c
     lua_burner_trace_cb oldTracer = L->burnerState.tracer;
     L->burnerState.tracer = tracer;
     return oldTracer;
-}
\ No newline at end of file
+}
+
+LUA_API lua_burner_call_cb lua_SetBurnerCaller(lua_State *L, lua_burner_call_cb caller) {
+    lua_burner_call_cb oldCaller = L->burnerState.caller;
+    L->burnerState.caller = caller;
+    return oldCaller;
+}
@@ -10,6 +10,8 @@
 #include "fuel.h"
 
 typedef void (*lua_burner_trace_cb) (lua_State *L, const char* caption, const char* format, ...);
+/** called before (isReturn == 0) and after (isReturn != 0) a C function is called, must not use the lua state */
+typedef void (*lua_burner_call_cb) (lua_State *L, lua_CFunction f, int isReturn);
 
 struct lua_burner_state {
     void*               pContext;           /** context pointer */
@@ -26,8 +28,10 @@ struct lua_burner_state {
     unsigned long long  fuelAccount;        /** total fuel of account operation (transfer output) */
     unsigned long long  fuelFunction;       /** total fuel of extended functions except store operation
                                                 and account operation(transfer output) functions */
+    unsigned long long  instructions;       /** executed instructions of all versions, for profiling */
 
     lua_burner_trace_cb tracer;             /** trace the burning */
+    lua_burner_call_cb  caller;             /** observe the calls of C functions, for profiling */
 };
 
 typedef struct lua_burner_state lua_burner_state;
@@ -101,4 +105,9 @@ LUA_API unsigned long long lua_GetMemoryFuel(lua_State *L);
  */
 LUA_API lua_burner_trace_cb lua_SetBurnerTracer(lua_State *L, lua_burner_trace_cb tracer);
 
+/**
+ * set the callback observing the calls of C functions, rerurn the old one
+ */
+LUA_API lua_burner_call_cb lua_SetBurnerCaller(lua_State *L, lua_burner_call_cb caller);
+
 #endif // L_BURNER_H
\ No newline at end of file
@@ -334,7 +334,11 @@ int luaD_precall (lua_State *L, StkId func, int nresults) {
       if (L->hookmask & LUA_MASKCALL)
         luaD_hook(L, LUA_HOOKCALL, -1);
       lua_unlock(L);
+      if (L->burnerState.caller != NULL)
+        L->burnerState.caller(L, f, 0);
       n = (*f)(L);  /* do the actual call */
+      if (L->burnerState.caller != NULL)
+        L->burnerState.caller(L, f, 1);
       lua_lock(L);
       api_checknelems(L, n);
       luaD_poscall(L, L->top - n, n);
@@ -221,6 +221,49 @@ static void ReportBurnState(lua_State *L, CLuaVMRunEnv *pVmRunEnv) {
     );
 }
 
+static void FillRunProfile(lua_State *L, CLuaVMRunProfile *pRunProfile) {
+    lua_burner_state *burnerState = lua_GetBurnerState(L);
+    if (pRunProfile == nullptr || burnerState == nullptr)
+        return;
+
+    CLuaVMContractProfile &profile = pRunProfile->profile;
+    profile.instructions = burnerState->instructions;
+    profile.fuel         = lua_GetBurnedFuel(L);
+    profile.fuelStep     = burnerState->fuelStep;
+    profile.fuelOperator = burnerState->fuelOperator;
+    profile.fuelStore    = burnerState->fuelStore;
+    profile.fuelAccount  = burnerState->fuelAccount;
+    profile.fuelFunction = burnerState->fuelFunction;
+    profile.fuelMemory   = lua_GetMemoryFuel(L);
+}
+
+static void ProfileMylibCall(lua_State *L, lua_CFunction f, int isReturn) {
+    CLuaVMRunEnv *pVmRunEnv = (CLuaVMRunEnv *)lua_GetBurnerState(L)->pContext;
+    CLuaVMRunProfile *pRunProfile = pVmRunEnv->GetRunProfile();
+    if (pRunProfile == nullptr)
+        return;
+
+    // called from the lua vm, must not throw
+    try {
+        if (isReturn)
+            pRunProfile->EndCall((const void *)f);
+        else
+            pRunProfile->BeginCall((const void *)f);
+    } catch (...) {
+    }
+}
+
+// Collects the names of the functions of the mylib table on the top of the stack. Only reads the table,
+// nothing is allocated by the lua state while the burner is running.
+static void CollectMylibFuncs(lua_State *L, CLuaVMRunProfile *pRunProfile) {
+    lua_pushnil(L);
+    while (lua_next(L, -2) != 0) {
+        if (lua_type(L, -2) == LUA_TSTRING && lua_iscfunction(L, -1))
+            pRunProfile->funcNames[(const void *)lua_tocfunction(L, -1)] = lua_tostring(L, -2);
+        lua_pop(L, 1);
+    }
+}
+
 static std::string GetLuaError(lua_State *L, int status, std::string prefix) {
     std::string ret;
     if (status != LUA_OK) {
@@ -283,6 +326,12 @@ tuple<uint64_t, string> CLuaVM::Run(uint64_t fuelLimit, CLuaVMRunEnv *pVmRunEnv)
     // 3.注册自定义模块
     luaL_requiref(lua_state, "mylib", GetLuaMylib(pVmRunEnv->GetContext().height), 1);
 
+    CLuaVMRunProfile *pRunProfile = pVmRunEnv->GetRunProfile();
+    if (pRunProfile != nullptr) {
+        CollectMylibFuncs(lua_state, pRunProfile);
+        lua_SetBurnerCaller(lua_state, ProfileMylibCall);
+    }
+
     // 4.往lua脚本传递合约内容
     lua_newtable(lua_state);  //新建一个表,压入栈顶
     lua_pushnumber(lua_state, -1);
@@ -312,6 +361,7 @@ tuple<uint64_t, string> CLuaVM::Run(uint64_t fuelLimit, CLuaVMRunEnv *pVmRunEnv)
 
     if (luaStatus != LUA_OK) {
         LogPrint(BCLog::LUAVM, "%s\n", strError);
+        FillRunProfile(lua_state, pRunProfile);
         ReportBurnState(lua_state, pVmRunEnv);
         return std::make_tuple(-1, strError);
     }
@@ -330,6 +380,7 @@ tuple<uint64_t, string> CLuaVM::Run(uint64_t fuelLimit, CLuaVMRunEnv *pVmRunEnv)
     lua_pop(lua_state, 1);
 
     uint64_t burnedFuel = lua_GetBurnedFuel(lua_state);
+    FillRunProfile(lua_state, pRunProfile);
     ReportBurnState(lua_state, pVmRunEnv);
     if (burnedFuel > fuelLimit) {
         return std::make_tuple(-1, string("CLuaVM::Run burned-out\n"));
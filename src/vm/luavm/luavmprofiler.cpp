@@ -0,0 +1,173 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "luavmprofiler.h"
+
+#include "commons/util/util.h"
+
+#include <algorithm>
+#include <vector>
+
+void CLuaVMContractProfile::Add(const CLuaVMContractProfile &other) {
+    executions   += other.executions;
+    failures     += other.failures;
+    micros       += other.micros;
+    instructions += other.instructions;
+    fuel         += other.fuel;
+    fuelStep     += other.fuelStep;
+    fuelOperator += other.fuelOperator;
+    fuelStore    += other.fuelStore;
+    fuelAccount  += other.fuelAccount;
+    fuelFunction += other.fuelFunction;
+    fuelMemory   += other.fuelMemory;
+    readBytes    += other.readBytes;
+    writeBytes   += other.writeBytes;
+
+    for (const auto &item : other.funcs)
+        funcs[item.first].Add(item.second);
+}
+
+uint64_t CLuaVMContractProfile::GetSortValue(const string &orderBy) const {
+    if (orderBy == "fuel")          return fuel;
+    if (orderBy == "instructions")  return instructions;
+    if (orderBy == "executions")    return executions;
+    if (orderBy == "readbytes")     return readBytes;
+    if (orderBy == "writebytes")    return writeBytes;
+
+    return micros;
+}
+
+Object CLuaVMContractProfile::ToJson() const {
+    Object fuelObj;
+    fuelObj.push_back(Pair("total",         fuel));
+    fuelObj.push_back(Pair("step",          fuelStep));
+    fuelObj.push_back(Pair("operator",      fuelOperator));
+    fuelObj.push_back(Pair("store",         fuelStore));
+    fuelObj.push_back(Pair("account",       fuelAccount));
+    fuelObj.push_back(Pair("function",      fuelFunction));
+    fuelObj.push_back(Pair("memory",        fuelMemory));
+
+    Object funcsObj;
+    for (const auto &item : funcs) {
+        Object funcObj;
+        funcObj.push_back(Pair("calls",     item.second.calls));
+        funcObj.push_back(Pair("time_us",   item.second.micros));
+        funcsObj.push_back(Pair(item.first, funcObj));
+    }
+
+    Object obj;
+    obj.push_back(Pair("executions",        executions));
+    obj.push_back(Pair("failures",          failures));
+    obj.push_back(Pair("time_us",           micros));
+    obj.push_back(Pair("avg_time_us",       executions > 0 ? micros / (int64_t)executions : 0));
+    obj.push_back(Pair("instructions",      instructions));
+    obj.push_back(Pair("fuel",              fuelObj));
+    obj.push_back(Pair("read_bytes",        readBytes));
+    obj.push_back(Pair("write_bytes",       writeBytes));
+    obj.push_back(Pair("mylib_calls",       funcsObj));
+    return obj;
+}
+
+void CLuaVMRunProfile::BeginCall(const void *func) {
+    auto it = funcNames.find(func);
+    if (it == funcNames.end())
+        return;
+
+    profile.funcs[it->second].calls++;
+    callStack.emplace_back(func, GetTimeMicros());
+}
+
+void CLuaVMRunProfile::EndCall(const void *func) {
+    auto it = funcNames.find(func);
+    if (it == funcNames.end())
+        return;
+
+    // the calls above the returning one raised lua errors and never returned
+    while (!callStack.empty()) {
+        auto call = callStack.back();
+        callStack.pop_back();
+        if (call.first == func) {
+            profile.funcs[it->second].micros += GetTimeMicros() - call.second;
+            break;
+        }
+    }
+}
+
+CLuaVMProfiler& CLuaVMProfiler::Instance() {
+    static CLuaVMProfiler profiler;
+    return profiler;
+}
+
+void CLuaVMProfiler::Reset() {
+    LOCK(cs_profiler);
+    windowStart = 0;
+    currentWindow.clear();
+    previousWindow.clear();
+}
+
+void CLuaVMProfiler::RotateWindow(int64_t now) {
+    if (windowStart == 0) {
+        windowStart = now;
+        return;
+    }
+
+    if (now - windowStart < LUA_VM_PROFILE_WINDOW_SECONDS)
+        return;
+
+    if (now - windowStart < 2 * LUA_VM_PROFILE_WINDOW_SECONDS)
+        previousWindow.swap(currentWindow);
+    else
+        previousWindow.clear();  // no executions recorded in the last full window
+
+    currentWindow.clear();
+    windowStart = now;
+}
+
+void CLuaVMProfiler::Record(const CRegID &contractRegId, const CLuaVMContractProfile &profile) {
+    LOCK(cs_profiler);
+    RotateWindow(GetTime());
+    currentWindow[contractRegId].Add(profile);
+}
+
+Array CLuaVMProfiler::GetTopContracts(size_t count, const string &orderBy) {
+    map<CRegID, CLuaVMContractProfile> profiles;
+    int64_t windowSeconds;
+    {
+        LOCK(cs_profiler);
+        int64_t now = GetTime();
+        RotateWindow(now);
+
+        profiles = previousWindow;
+        for (const auto &item : currentWindow)
+            profiles[item.first].Add(item.second);
+
+        windowSeconds = (previousWindow.empty() ? 0 : LUA_VM_PROFILE_WINDOW_SECONDS) + (now - windowStart);
+    }
+
+    vector<pair<uint64_t, const pair<const CRegID, CLuaVMContractProfile> *>> sorted;
+    sorted.reserve(profiles.size());
+    for (const auto &item : profiles)
+        sorted.emplace_back(item.second.GetSortValue(orderBy), &item);
+
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const decltype(sorted)::value_type &a, const decltype(sorted)::value_type &b) {
+                         return a.first > b.first;
+                     });
+
+    Array arr;
+    for (size_t i = 0; i < sorted.size() && i < count; i++) {
+        Object obj;
+        obj.push_back(Pair("contract_regid",    sorted[i].second->first.ToString()));
+        obj.push_back(Pair("window_seconds",    windowSeconds));
+        for (const auto &pair : sorted[i].second->second.ToJson())
+            obj.push_back(pair);
+        arr.push_back(obj);
+    }
+    return arr;
+}
+
+bool CLuaVMProfiler::IsValidOrderBy(const string &orderBy) {
+    return orderBy == "time" || orderBy == "fuel" || orderBy == "instructions" || orderBy == "executions" ||
+           orderBy == "readbytes" || orderBy == "writebytes";
+}
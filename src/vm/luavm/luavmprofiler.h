@@ -0,0 +1,104 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef LUA_VM_PROFILER_H
+#define LUA_VM_PROFILER_H
+
+#include "entities/id.h"
+#include "sync.h"
+
+#include "commons/json/json_spirit_value.h"
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace json_spirit;
+
+// the profile covers the executions of the current window and of the previous one
+static const int64_t LUA_VM_PROFILE_WINDOW_SECONDS = 600;
+
+struct CLuaVMFuncProfile {
+    uint64_t calls  = 0;
+    int64_t  micros = 0;    // wall time of the calls
+
+    void Add(const CLuaVMFuncProfile &other) {
+        calls  += other.calls;
+        micros += other.micros;
+    }
+};
+
+/**
+ * Costs of the executions of a contract: wall time, executed instructions, burned fuel by kind,
+ * calls of the mylib functions and bytes of contract data read from and written to the cache.
+ */
+struct CLuaVMContractProfile {
+    uint64_t executions    = 0;
+    uint64_t failures      = 0;
+    int64_t  micros        = 0;
+    uint64_t instructions  = 0;
+    uint64_t fuel          = 0;     // burned fuel after refund
+    uint64_t fuelStep      = 0;
+    uint64_t fuelOperator  = 0;
+    uint64_t fuelStore     = 0;
+    uint64_t fuelAccount   = 0;
+    uint64_t fuelFunction  = 0;
+    uint64_t fuelMemory    = 0;
+    uint64_t readBytes     = 0;
+    uint64_t writeBytes    = 0;
+    map<string, CLuaVMFuncProfile> funcs;   // mylib function name -> calls
+
+    void Add(const CLuaVMContractProfile &other);
+    uint64_t GetSortValue(const string &orderBy) const;
+    Object ToJson() const;
+};
+
+/**
+ * Profile of a single contract execution. The calls of the mylib functions are observed through the
+ * call hook of the lua burner, which runs outside of the lua allocator so that profiling can not change
+ * the burned fuel. The time of a call which raises a lua error is not recorded.
+ */
+struct CLuaVMRunProfile {
+    CLuaVMContractProfile profile;
+    map<const void *, string> funcNames;    // mylib C function -> name
+    vector<pair<const void *, int64_t>> callStack;
+
+    void BeginCall(const void *func);
+    void EndCall(const void *func);
+};
+
+/**
+ * Runtime toggleable profiler of the lua contract executions, aggregated per contract over a rolling
+ * window. Executions are recorded in all contexts, including mempool admission and block production.
+ */
+class CLuaVMProfiler {
+public:
+    static CLuaVMProfiler& Instance();
+
+    bool IsEnabled() const { return enabled; }
+    void SetEnabled(bool enabledIn) { enabled = enabledIn; }
+    void Reset();
+
+    void Record(const CRegID &contractRegId, const CLuaVMContractProfile &profile);
+
+    // top contracts ordered by one of time, fuel, instructions, executions, readbytes or writebytes
+    Array GetTopContracts(size_t count, const string &orderBy);
+
+    static bool IsValidOrderBy(const string &orderBy);
+
+private:
+    CLuaVMProfiler() : enabled(false), windowStart(0) {}
+
+    void RotateWindow(int64_t now);
+
+    std::atomic<bool> enabled;
+    CCriticalSection cs_profiler;
+    int64_t windowStart;
+    map<CRegID, CLuaVMContractProfile> currentWindow;
+    map<CRegID, CLuaVMContractProfile> previousWindow;
+};
+
+#endif  // LUA_VM_PROFILER_H
@@ -38,9 +38,21 @@ bool CLuaVMRunEnv::ExecuteContract(CLuaVMContext *pContextIn, uint64_t& fuel, st
     LogPrint(BCLog::LUAVM, "prepare to execute tx. txid=%s, fuelLimit=%llu\n",
                             p_context->p_base_tx->GetHash().GetHex(), p_context->fuel_limit);
 
+    pRunProfile.reset(CLuaVMProfiler::Instance().IsEnabled() ? new CLuaVMRunProfile() : nullptr);
+    int64_t startTime = pRunProfile ? GetTimeMicros() : 0;
+
     tuple<uint64_t, string> ret = pLua.get()->Run(p_context->fuel_limit, this);
+    FlushContractData();
 
     int64_t fuelRet = std::get<0>(ret);
+    if (pRunProfile) {
+        CLuaVMContractProfile &profile = pRunProfile->profile;
+        profile.executions = 1;
+        profile.failures   = (fuelRet == 0 || fuelRet == -1) ? 1 : 0;
+        profile.micros     = GetTimeMicros() - startTime;
+        CLuaVMProfiler::Instance().Record(GetContractRegID(), profile);
+    }
+
     if (0 == fuelRet) {
         errMsg = "VmScript run Failed";
         return false;
@@ -404,6 +416,70 @@ CCacheWrapper* CLuaVMRunEnv::GetCw() {
 
 CContractDBCache* CLuaVMRunEnv::GetScriptDB() { return &p_context->p_cw->contractCache; }
 
+CLuaVMRunEnv::ContractDataItem &CLuaVMRunEnv::GetContractDataItem(const CRegID &contractRegId, const string &key) {
+    auto ret = contractDataWorkingSet.emplace(std::make_pair(contractRegId, key), ContractDataItem());
+    if (ret.second) {
+        p_context->p_cw->contractCache.GetContractData(contractRegId, key, ret.first->second.value);
+        if (pRunProfile)
+            pRunProfile->profile.readBytes += key.size() + ret.first->second.value.size();
+    }
+
+    return ret.first->second;
+}
+
+bool CLuaVMRunEnv::GetContractData(const CRegID &contractRegId, const string &key, string &value) {
+    if (!useDataWorkingSet)
+        return p_context->p_cw->contractCache.GetContractData(contractRegId, key, value);
+
+    const auto &item = GetContractDataItem(contractRegId, key);
+    if (item.value.empty())
+        return false;
+
+    value = item.value;
+    return true;
+}
+
+bool CLuaVMRunEnv::SetContractData(const CRegID &contractRegId, const string &key, const string &value) {
+    if (!useDataWorkingSet)
+        return p_context->p_cw->contractCache.SetContractData(contractRegId, key, value);
+
+    auto &item = GetContractDataItem(contractRegId, key);
+    item.value = value;
+    item.dirty = true;
+    return true;
+}
+
+bool CLuaVMRunEnv::EraseContractData(const CRegID &contractRegId, const string &key) {
+    if (!useDataWorkingSet)
+        return p_context->p_cw->contractCache.EraseContractData(contractRegId, key);
+
+    auto &item = GetContractDataItem(contractRegId, key);
+    if (!item.value.empty()) {
+        item.value.clear();
+        item.dirty = true;
+    }
+    return true;
+}
+
+void CLuaVMRunEnv::FlushContractData() {
+    auto &contractCache = p_context->p_cw->contractCache;
+    for (const auto &item : contractDataWorkingSet) {
+        if (!item.second.dirty)
+            continue;
+
+        const CRegID &contractRegId = item.first.first;
+        const string &key           = item.first.second;
+        if (pRunProfile)
+            pRunProfile->profile.writeBytes += key.size() + item.second.value.size();
+
+        if (item.second.value.empty())
+            contractCache.EraseContractData(contractRegId, key);
+        else
+            contractCache.SetContractData(contractRegId, key, item.second.value);
+    }
+    contractDataWorkingSet.clear();
+}
+
 CAccountDBCache* CLuaVMRunEnv::GetAccountCache() { return &p_context->p_cw->accountCache; }
 
 
@@ -7,6 +7,7 @@
 #define LUA_VM_RUNENV_H
 
 #include "luavm.h"
+#include "luavmprofiler.h"
 #include "appaccount.h"
 #include "commons/serialize.h"
 #include "entities/account.h"
@@ -22,6 +23,7 @@
 
 using namespace std;
 class CVmOperate;
+class CBlockIndex;
 struct lua_State;
 
 class CLuaVMContext {
@@ -38,6 +40,7 @@ public:
     shared_ptr<CAccount> sp_app_account        = nullptr;
     CUniversalContractStore* p_contract = nullptr;
     string* p_arguments            = nullptr;
+    const CBlockIndex* p_tip_index = nullptr;  // see CTxExecuteContext::pTipIndex
 };
 
 struct AssetTransfer {
@@ -70,9 +73,24 @@ private:
     bool isCheckAccount;  // check account balance
 
     map<vector<uint8_t>, vector<CAppFundOperate>> mapAppFundOperate;  // vector<unsigned char > 存的是accountId
+
+    struct ContractDataItem {
+        string value;           // empty if not existed or erased
+        bool dirty  = false;    // changed by the contract, to be flushed
+    };
+    // working set of the contract data read and written in this execution, the writes are flushed
+    // to the contract cache once when the contract returns, so repeated reads and writes of the same
+    // key do not walk the cache chain again and only the net change is recorded in the undo oplogs
+    map<pair<CRegID, string>, ContractDataItem> contractDataWorkingSet;
+    bool useDataWorkingSet = true;  // false to read and write the contract cache directly, as the reference
+
+    std::unique_ptr<CLuaVMRunProfile> pRunProfile;  // nullptr unless the lua vm profiler is enabled
 private:
     bool Init();
 
+    ContractDataItem &GetContractDataItem(const CRegID &contractRegId, const string &key);
+    void FlushContractData();
+
     bool CheckOperateAccountLimit();
     bool CheckOperate();
     /**
@@ -134,6 +152,13 @@ public:
     int32_t GetBurnVersion();
     uint256 GetCurTxHash();
     bool InsertOutputData(const vector<CVmOperate>& source);
+
+    // contract data access of the running contract, served from the working set of this execution
+    bool GetContractData(const CRegID &contractRegId, const string &key, string &value);
+    bool SetContractData(const CRegID &contractRegId, const string &key, const string &value);
+    bool EraseContractData(const CRegID &contractRegId, const string &key);
+    // must be set before the contract is executed, the working set gives the same fuel and data
+    void SetContractDataWorkingSet(bool enabled) { useDataWorkingSet = enabled; }
     /**
      * transfer account asset
      * @param transfers: transfer info vector
@@ -147,6 +172,7 @@ public:
     void SetCheckAccount(bool bCheckAccount);
 
     CLuaVMContext &GetContext() const { assert(p_context != nullptr); return *p_context; }
+    CLuaVMRunProfile *GetRunProfile() const { return pRunProfile.get(); }
 };
 
 #endif  // LUA_VM_RUNENV_H
@@ -74,6 +74,8 @@ namespace wasm {
     void abi_serializer::add_specialized_unpack_pack( const string &name,
                                                       std::pair <abi_serializer::unpack_function, abi_serializer::pack_function> unpack_pack ) {
         built_in_types[name] = std::move(unpack_pack);
+        if (!type_ids.empty())
+            compile_types();
     }
 
     void abi_serializer::configure_built_in_types() {
@@ -158,6 +160,70 @@ namespace wasm {
                       "Duplicate table definition detected");
 
         validate(ctx);
+        compile_types();
+    }
+
+    void abi_serializer::compile_types() {
+        compiled_types.clear();
+        type_ids.clear();
+
+        for (const auto &t : typedefs)
+            compile_type(t.first);
+        for (const auto &s : structs)
+            compile_type(s.first);
+        for (const auto &a : actions)
+            compile_type(a.second);
+        for (const auto &t : tables)
+            compile_type(t.second);
+    }
+
+    abi_serializer::type_id abi_serializer::compile_type( const type_name &type ) {
+        auto itr = type_ids.find(type);
+        if (itr != type_ids.end()) return itr->second;
+
+        compiled_type ct;
+        ct.name    = resolve_type(type);
+        auto ftype = fundamental_type(ct.name);
+        auto btype = built_in_types.find(ftype);
+
+        // reserve the id first, the struct fields may refer to the type itself
+        type_id id = compiled_types.size();
+        compiled_types.emplace_back();
+        type_ids[type] = id;
+
+        if (btype != built_in_types.end()) {
+            ct.kind        = type_kind::BUILT_IN;
+            ct.built_in    = btype->second;
+            ct.is_array    = is_array(ct.name);
+            ct.is_optional = is_optional(ct.name);
+        } else if (is_array(ct.name)) {
+            ct.kind    = type_kind::ARRAY;
+            ct.element = compile_type(ftype);
+        } else if (is_optional(ct.name)) {
+            ct.kind    = type_kind::OPTIONAL;
+            ct.element = compile_type(ftype);
+        } else {
+            auto s_itr = structs.find(ct.name);
+            if (s_itr == structs.end()) {
+                // unknown type, left to the uncompiled path to report
+                compiled_types.pop_back();
+                type_ids.erase(type);
+                return invalid_type_id;
+            }
+
+            const auto &st = s_itr->second;
+            ct.kind        = type_kind::STRUCT;
+            ct.base_name   = st.base;
+            if (st.base != type_name())
+                ct.base = compile_type(resolve_type(st.base));
+
+            ct.fields.reserve(st.fields.size());
+            for (const auto &field : st.fields)
+                ct.fields.emplace_back(field.name, compile_type(_remove_bin_extension(field.type)));
+        }
+
+        compiled_types[id] = std::move(ct);
+        return id;
     }
 
     bool abi_serializer::is_builtin_type( const type_name &type ) const {
@@ -348,13 +414,96 @@ namespace wasm {
         return var;
     }
 
+    json_spirit::Value abi_serializer::_binary_to_variant(type_id id,
+                                                          wasm::datastream<const char *> &ds,
+                                                          wasm::abi_traverse_context &ctx) const {
+        ctx.check_deadline();
+        ctx.recursion_depth++;
+
+        CHAIN_ASSERT( id < compiled_types.size(), wasm_chain::unpack_exception, "Unable to unpack unknown type from stream")
+
+        const auto &ct = compiled_types[id];
+        switch (ct.kind) {
+            case type_kind::BUILT_IN: {
+                try {
+                    return ct.built_in.first(ds, ct.is_array, ct.is_optional);
+                }CHAIN_RETHROW_EXCEPTIONS(wasm_chain::unpack_exception, "Unable to unpack type '%s' ", ct.name)
+            }
+            case type_kind::ARRAY: {
+                wasm::unsigned_int size;
+                try {
+                    ds >> size;
+                }CHAIN_RETHROW_EXCEPTIONS(wasm_chain::unpack_exception, "Unable to unpack size of array '%s' ", ct.name)
+
+                CHAIN_ASSERT( size < max_abi_array_size,
+                              wasm_chain::array_size_exceeds_exception,
+                              "Array size %u must be smaller than max %d", size.value,
+                              max_abi_array_size);
+
+                json_spirit::Array vars;
+                for (decltype(size.value) i = 0; i < size; ++i) {
+                    auto v = _binary_to_variant(ct.element, ds, ctx);
+                    CHAIN_ASSERT( !v.is_null(), wasm_chain::unpack_exception, "Invalid packed array '%s'", ct.name);
+                    vars.emplace_back(std::move(v));
+                }
+                return json_spirit::Value(std::move(vars));
+            }
+            case type_kind::OPTIONAL: {
+                char flag;
+                try {
+                    ds >> flag;
+                }CHAIN_RETHROW_EXCEPTIONS( wasm_chain::unpack_exception,
+                                           "Unable to unpack presence flag of optional '%s' ", ct.name)
+                return flag ? _binary_to_variant(ct.element, ds, ctx) : json_spirit::Value();
+            }
+            case type_kind::STRUCT: {
+                json_spirit::Object obj;
+                if (ct.base_name != type_name()) {
+                    json_spirit::Value base = _binary_to_variant(ct.base, ds, ctx);
+                    if (base.type() == json_spirit::obj_type) {
+                        obj = base.get_obj();
+                    } else {
+                        //fixme:base in array or single value
+                        json_spirit::Config::add(obj, ct.base_name, base);
+                    }
+                }
+
+                for (const auto &field : ct.fields) {
+                    auto v = _binary_to_variant(field.second, ds, ctx);
+                    if(!v.is_null()){
+                        json_spirit::Config::add(obj, field.first, v);
+                    }
+                }
+                return json_spirit::Value(std::move(obj));
+            }
+        }
+
+        CHAIN_THROW(wasm_chain::unpack_exception, "Unable to unpack '%s' from stream", ct.name);
+        json_spirit::Value var;
+        return var;
+    }
+
     json_spirit::Value abi_serializer::binary_to_variant( const type_name &type, const bytes &binary,
                                                           microseconds max_serialization_time ) const {
         wasm::datastream<const char *> ds(binary.data(), binary.size());
         wasm::abi_traverse_context ctx(max_serialization_time);
+
+        auto itr = type_ids.find(type);
+        if (itr != type_ids.end())
+            return _binary_to_variant(itr->second, ds, ctx);
+
         return _binary_to_variant(type, ds, ctx);
     }
 
+    json_spirit::Value abi_serializer::unpack_action( const string &action, const bytes &data,
+                                                      microseconds max_serialization_time ) const {
+        string action_type = get_action_type(action);
+        if(action_type == string()){
+            action_type = action;
+        }
+        return binary_to_variant(action_type, data, max_serialization_time);
+    }
+
    json_spirit::Value abi_serializer::get_field_variant( const type_name &s, const json_spirit::Value &v, field_name field, bool is_optional ) const {
         if (v.type() == json_spirit::obj_type) {
             auto o = v.get_obj();
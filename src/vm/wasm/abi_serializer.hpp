@@ -5,6 +5,7 @@
 #include <functional>
 #include <utility>
 #include <chrono>
+#include <limits>
 
 #include "commons/json/json_spirit.h"
 #include "commons/json/json_spirit_reader_template.h"
@@ -56,6 +57,8 @@ namespace wasm {
 
         json_spirit::Value
         binary_to_variant( const type_name &type, const bytes &binary, microseconds max_serialization_time ) const;
+        json_spirit::Value
+        unpack_action( const string &action, const bytes &data, microseconds max_serialization_time ) const;
         bytes variant_to_binary( const type_name &type, const json_spirit::Value &var,
                                  microseconds max_serialization_time ) const;
         void variant_to_binary( const type_name &type, const json_spirit::Value &var, wasm::datastream<char *> &ds,
@@ -126,13 +129,7 @@ namespace wasm {
             try {
                 wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi);
                 wasm::abi_serializer abis(def, max_serialization_time);
-
-                string action_type = abis.get_action_type(action);
-                if(action_type == string()){
-                    action_type = action;
-                }
-                data_v = abis.binary_to_variant(action_type, data, max_serialization_time);
-
+                data_v = abis.unpack_action(action, data, max_serialization_time);
             }
             CHAIN_CAPTURE_AND_RETHROW("abi_serializer unpack error in action '%s' params '%s'", action, to_hex(data))
 
@@ -169,9 +166,38 @@ namespace wasm {
         map <uint64_t, string> error_messages;
         map <type_name, pair<unpack_function, pack_function>> built_in_types;
 
+        /**
+         *  The types of the abi compiled into a graph indexed by integer ids when the abi is set,
+         *  so that unpacking does not resolve typedefs and parse the array/optional suffixes
+         *  of the type names again for every value.
+         */
+        using type_id = uint32_t;
+        static constexpr type_id invalid_type_id = std::numeric_limits<type_id>::max();
+
+        enum class type_kind : uint8_t { BUILT_IN, ARRAY, OPTIONAL, STRUCT };
+
+        struct compiled_type {
+            type_kind kind     = type_kind::BUILT_IN;
+            type_name name;                                  //!< resolved type name
+            pair<unpack_function, pack_function> built_in;   //!< built-in only
+            bool is_array      = false;                      //!< built-in only
+            bool is_optional   = false;                      //!< built-in only
+            type_id element    = invalid_type_id;            //!< array and optional only
+            type_name base_name;                             //!< struct only
+            type_id base       = invalid_type_id;            //!< struct only
+            vector<pair<field_name, type_id>> fields;        //!< struct only
+        };
+
+        vector<compiled_type> compiled_types;
+        map <type_name, type_id> type_ids;
+
         void configure_built_in_types();
+        void compile_types();
+        type_id compile_type( const type_name &type );
         json_spirit::Value _binary_to_variant( const type_name &type, wasm::datastream<const char *> &ds,
                                                wasm::abi_traverse_context &ctx ) const;
+        json_spirit::Value _binary_to_variant( type_id id, wasm::datastream<const char *> &ds,
+                                               wasm::abi_traverse_context &ctx ) const;
 
         bytes _variant_to_binary( const type_name &type, const json_spirit::Value &var,
                             wasm::abi_traverse_context &ctx ) const;
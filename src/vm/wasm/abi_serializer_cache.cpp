@@ -0,0 +1,39 @@
+#include "wasm/abi_serializer_cache.hpp"
+#include "wasm/wasm_constants.hpp"
+
+namespace wasm {
+
+    abi_serializer_cache& abi_serializer_cache::instance() {
+        static abi_serializer_cache cache;
+        return cache;
+    }
+
+    abi_serializer_cache::abi_serializer_ptr abi_serializer_cache::get( const uint64_t &contract,
+                                                                        const uint256 &abi_version,
+                                                                        const abi_loader &loader ) {
+        auto key = std::make_pair(contract, abi_version);
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            auto itr = serializers.find(key);
+            if (itr != serializers.end()) return itr->second;
+        }
+
+        std::vector<char> abi;
+        if (!loader(abi) || abi.empty()) return nullptr;
+
+        wasm::abi_def def = wasm::unpack<wasm::abi_def>(abi);
+        auto abis         = std::make_shared<const abi_serializer>(def, max_serialization_time);
+
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        // the older versions of the contract are not needed any more
+        auto itr = serializers.lower_bound(std::make_pair(contract, uint256()));
+        while (itr != serializers.end() && itr->first.first == contract)
+            itr = serializers.erase(itr);
+
+        if (serializers.size() >= max_cached_abi_serializers)
+            serializers.clear();
+
+        serializers.emplace(key, abis);
+        return abis;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "commons/uint256.h"
+#include "wasm/abi_serializer.hpp"
+
+namespace wasm {
+
+    static const uint32_t max_cached_abi_serializers = 1024;
+
+    /**
+     *  Compiled abi_serializer instances keyed by contract and abi version (the hash of the abi,
+     *  zero for native contracts), shared by the threads which render the action data of txs.
+     *  The abi is only loaded and parsed when the version of the contract is not cached yet.
+     */
+    class abi_serializer_cache {
+    public:
+        using abi_serializer_ptr = std::shared_ptr<const abi_serializer>;
+        using abi_loader         = std::function<bool(std::vector<char>&)>;
+
+        static abi_serializer_cache& instance();
+
+        // nullptr if the abi can not be loaded, throws if it can not be parsed
+        abi_serializer_ptr get( const uint64_t &contract, const uint256 &abi_version, const abi_loader &loader );
+
+    private:
+        abi_serializer_cache() {}
+
+        std::mutex cache_mutex;
+        std::map<std::pair<uint64_t, uint256>, abi_serializer_ptr> serializers;
+    };
+}
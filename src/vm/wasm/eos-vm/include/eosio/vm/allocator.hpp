@@ -434,6 +434,26 @@ namespace eosio { namespace vm {
          }
          page = -1;
       }
+      // Return to the freshly constructed state without remapping, only the touched pages are
+      // handed back to the kernel and read as zero on their next access.
+      // Returns the number of wasm pages discarded.
+      uint32_t discard() {
+         std::size_t syspagesize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+         uint32_t    discarded   = 0;
+         if (page > 0) {
+            discarded = page;
+            int err   = madvise(raw, page_size * page, MADV_DONTNEED);
+            if (err != 0)
+               memset(raw, '\0', page_size * page);
+            err = mprotect(raw, page_size * page, PROT_NONE);
+            EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
+         } else if (page == -1) {
+            int err = mprotect(raw - syspagesize, syspagesize, PROT_READ);
+            EOS_VM_ASSERT(err == 0, wasm_bad_alloc, "mprotect failed");
+         }
+         page = 0;
+         return discarded;
+      }
       template <typename T>
       inline T* get_base_ptr() const {
          return reinterpret_cast<T*>(raw);
@@ -0,0 +1,249 @@
+// In-process benchmark of wasm_interface::execute over the fixture contracts of test_api.
+//
+// The contracts run against the mocked wasm_context and in-memory contract store of test_api, so the
+// numbers measure the runtime, the instantiation and the intrinsics rather than the chain state.
+// The runtime is fixed once per process, run the bench once per runtime to compare them:
+//
+//   ./bench --runtime=interpreter --iterations=1000 --json > bench_interpreter.json
+//   ./bench --runtime=jit         --iterations=1000 --json > bench_jit.json
+
+#include "tester.hpp"
+
+#include <name.hpp>
+#include <asset.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+using namespace wasm;
+using std::chrono::steady_clock;
+
+// heap allocations of the process, the allocations of a scenario are counted around its apply loop
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new( size_t size ) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete( void *p ) noexcept { std::free(p); }
+void operator delete( void *p, size_t ) noexcept { std::free(p); }
+
+struct bench_options {
+    string   runtime    = "jit";
+    uint32_t iterations = 1000;
+    string   fixtures   = "../test_api";
+    bool     json       = false;
+};
+
+struct bench_result {
+    string   scenario;
+    string   intrinsics;
+    uint32_t ops         = 0;
+    double   ops_per_sec = 0;
+    int64_t  p50_us      = 0;
+    int64_t  p99_us      = 0;
+    int64_t  max_us      = 0;
+    double   allocs_per_op = 0;
+};
+
+// the console output of the contracts is printed by the mocked context, it is dropped while benchmarking
+class console_mute {
+public:
+    console_mute() : old_buf(std::cout.rdbuf(null_stream.rdbuf())) {}
+    ~console_mute() { std::cout.rdbuf(old_buf); }
+
+private:
+    std::ostringstream null_stream;
+    std::streambuf    *old_buf;
+};
+
+static bench_result run_scenario( const string &scenario, const string &intrinsics, uint32_t iterations,
+                                  const std::function<void(uint32_t)> &setup,
+                                  const std::function<void(uint32_t)> &apply ) {
+    vector<int64_t> latencies;
+    latencies.reserve(iterations);
+
+    uint64_t allocs = 0;
+    auto     start  = steady_clock::now();
+    {
+        console_mute mute;
+        for (uint32_t i = 0; i < iterations; i++) {
+            if (setup) setup(i);
+
+            uint64_t allocs_before = allocations.load(std::memory_order_relaxed);
+            auto     op_start      = steady_clock::now();
+            apply(i);
+            latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - op_start).count());
+            allocs += allocations.load(std::memory_order_relaxed) - allocs_before;
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    bench_result result;
+    result.scenario      = scenario;
+    result.intrinsics    = intrinsics;
+    result.ops           = iterations;
+    result.ops_per_sec   = elapsed > 0 ? iterations * 1000000.0 / elapsed : 0;
+    result.p50_us        = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+    result.p99_us        = latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    result.max_us        = latencies.empty() ? 0 : latencies.back();
+    result.allocs_per_op = iterations > 0 ? (double)allocs / iterations : 0;
+    return result;
+}
+
+// distinct token symbol code for every op, 'A'..'Z' digits
+static string bench_symbol_code( uint32_t i ) {
+    string code;
+    do {
+        code.push_back('A' + i % 26);
+        i /= 26;
+    } while (i > 0);
+    return code;
+}
+
+static vector<bench_result> run_benchmarks( const bench_options &options ) {
+    vector<bench_result> results;
+    const uint32_t n = options.iterations;
+
+    // test_api fixture: runtime, instantiation and action data intrinsics
+    validating_tester api;
+    set_code(api, N(testapi), options.fixtures + "/wasm/test_api.wasm");
+
+    results.push_back(run_scenario("instantiate", "module parse+instantiate, types_size", n,
+        []( uint32_t ) { wasm_code_cache_free(); },
+        [&]( uint32_t ) { CALL_TEST_FUNCTION(api, "test_types", "types_size", {}); }));
+
+    results.push_back(run_scenario("apply_empty", "types_size", n, nullptr,
+        [&]( uint32_t ) { CALL_TEST_FUNCTION(api, "test_types", "types_size", {}); }));
+
+    dummy_action dummy13 = {'a', 0x123456789ABCDEF0, 0x7FFFFFFF};
+    vector<char> dummy13_data = wasm::pack(dummy13);
+    results.push_back(run_scenario("read_action_data", "action_data_size, read_action_data", n, nullptr,
+        [&]( uint32_t ) { CALL_TEST_FUNCTION(api, "test_action", "read_action_normal", dummy13_data); }));
+
+    results.push_back(run_scenario("print", "prints", n, nullptr,
+        [&]( uint32_t ) { CALL_TEST_FUNCTION(api, "test_print", "test_prints", {}); }));
+
+    results.push_back(run_scenario("print_numbers", "printi, printui, printi128, printn", n, nullptr,
+        [&]( uint32_t ) {
+            CALL_TEST_FUNCTION(api, "test_print", "test_printi", {});
+            CALL_TEST_FUNCTION(api, "test_print", "test_printui", {});
+            CALL_TEST_FUNCTION(api, "test_print", "test_printi128", {});
+            CALL_TEST_FUNCTION(api, "test_print", "test_printn", {});
+        }));
+
+    // token fixture: contract data and notification intrinsics
+    validating_tester token;
+    set_code(token, N(testapi), options.fixtures + "/token.wasm");
+
+    name issuer = name("walker");
+    name holder = name("xiaoyu");
+    results.push_back(run_scenario("set_data", "get_data (miss), set_data", n, nullptr,
+        [&]( uint32_t i ) {
+            asset maximum_supply = asset{1000000000, symbol(bench_symbol_code(i), 4)};
+            vector<char> data    = wasm::pack(std::tuple(issuer, maximum_supply));
+            CALL_TEST_FUNCTION_ACTION(token, N(create), data);
+        }));
+
+    symbol btc = symbol("BTC", 4);
+    vector<char> create_data = wasm::pack(std::tuple(issuer, asset{1000000000000000, btc}));
+    CALL_TEST_FUNCTION_ACTION(token, N(create), create_data);
+
+    vector<char> issue_data = wasm::pack(std::tuple(issuer, asset{10000, btc}, string("issue")));
+    results.push_back(run_scenario("get_set_data", "get_data, set_data", n, nullptr,
+        [&]( uint32_t ) { CALL_TEST_FUNCTION_ACTION(token, N(issue), issue_data); }));
+
+    vector<char> transfer_data = wasm::pack(std::tuple(issuer, holder, asset{1, btc}, string("transfer")));
+    results.push_back(run_scenario("transfer_notify", "get_data, set_data, require_recipient", n, nullptr,
+        [&]( uint32_t ) { CALL_TEST_FUNCTION_ACTION(token, N(transfer), transfer_data); }));
+
+    return results;
+}
+
+static void print_json( const bench_options &options, const vector<bench_result> &results ) {
+    std::cout << "{\n"
+              << "  \"runtime\": \"" << options.runtime << "\",\n"
+              << "  \"iterations\": " << options.iterations << ",\n"
+              << "  \"scenarios\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        std::cout << "    {\"scenario\": \"" << r.scenario << "\", \"intrinsics\": \"" << r.intrinsics << "\""
+                  << ", \"ops\": " << r.ops
+                  << ", \"ops_per_sec\": " << std::fixed << std::setprecision(1) << r.ops_per_sec
+                  << ", \"p50_us\": " << r.p50_us
+                  << ", \"p99_us\": " << r.p99_us
+                  << ", \"max_us\": " << r.max_us
+                  << ", \"allocs_per_op\": " << std::setprecision(1) << r.allocs_per_op << "}"
+                  << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    std::cout << "  ]\n}" << std::endl;
+}
+
+static void print_table( const bench_options &options, const vector<bench_result> &results ) {
+    std::cout << "runtime: " << options.runtime << ", iterations: " << options.iterations << "\n\n"
+              << std::left << std::setw(18) << "scenario" << std::right
+              << std::setw(12) << "ops/s" << std::setw(10) << "p50(us)" << std::setw(10) << "p99(us)"
+              << std::setw(10) << "max(us)" << std::setw(12) << "allocs/op" << "  intrinsics\n";
+    for (const auto &r : results) {
+        std::cout << std::left << std::setw(18) << r.scenario << std::right << std::fixed
+                  << std::setw(12) << std::setprecision(1) << r.ops_per_sec
+                  << std::setw(10) << r.p50_us << std::setw(10) << r.p99_us << std::setw(10) << r.max_us
+                  << std::setw(12) << std::setprecision(1) << r.allocs_per_op << "  " << r.intrinsics << "\n";
+    }
+}
+
+static bool parse_options( int argc, char **argv, bench_options &options ) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--runtime=", 0) == 0)
+            options.runtime = arg.substr(strlen("--runtime="));
+        else if (arg.rfind("--iterations=", 0) == 0)
+            options.iterations = std::stoul(arg.substr(strlen("--iterations=")));
+        else if (arg.rfind("--fixtures=", 0) == 0)
+            options.fixtures = arg.substr(strlen("--fixtures="));
+        else if (arg == "--json")
+            options.json = true;
+        else
+            return false;
+    }
+    return options.runtime == "interpreter" || options.runtime == "jit";
+}
+
+int main( int argc, char **argv ) {
+    bench_options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--runtime=interpreter|jit] [--iterations=n] [--fixtures=dir] [--json]" << std::endl;
+        return 1;
+    }
+
+    // the first initialization wins, the mocked context initializes the jit runtime otherwise
+    wasm_interface wasmif;
+    wasmif.initialize(options.runtime == "jit" ? vm_type::eos_vm_jit : vm_type::eos_vm);
+
+    vector<bench_result> results;
+    try {
+        results = run_benchmarks(options);
+    } catch (wasm_chain::exception &e) {
+        std::cerr << e.to_detail_string() << std::endl;
+        return 1;
+    }
+
+    if (options.json)
+        print_json(options, results);
+    else
+        print_table(options, results);
+
+    return 0;
+}
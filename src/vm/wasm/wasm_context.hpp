@@ -12,7 +12,7 @@
 #include "wasm/wasm_interface.hpp"
 #include "wasm/datastream.hpp"
 #include "wasm/wasm_trace.hpp"
-#include "eosio/vm/allocator.hpp"
+#include "wasm/wasm_memory_pool.hpp"
 #include "persistence/cachewrapper.h"
 #include "entities/receipt.h"
 #include "wasm/exception/exceptions.hpp"
@@ -33,16 +33,11 @@ namespace wasm {
             reset_console();
         };
 
-        ~wasm_context() {
-            wasm_alloc.free();
-        };
-
     public:
         void initialize();
         void execute(inline_transaction_trace &trace);
         void execute_one(inline_transaction_trace &trace);
         bool has_permission_from_inline_transaction(const permission &p);
-        bool get_code(const uint64_t& contract, std::vector <uint8_t> &code);
         uint64_t get_runcost();
 
 // Console methods:
@@ -76,8 +71,7 @@ namespace wasm {
         bool        get_system_asset_price(uint64_t base, uint64_t quote, std::vector<char>& price);
 
         bool set_data( const uint64_t& contract, const string& k, const string& v ) {
-            CUniversalContractStore contractStore;
-            CHAIN_ASSERT( database.contractCache.GetContract(CRegID(contract), contractStore),
+            CHAIN_ASSERT( database.contractCache.HasContract(CRegID(contract)),
                           contract_exception,
                           "contract '%s' does not exist",
                           wasm::regid(contract).to_string())
@@ -86,8 +80,7 @@ namespace wasm {
         }
 
         bool get_data( const uint64_t& contract, const string& k, string &v ) {
-            CUniversalContractStore contractStore;
-            CHAIN_ASSERT( database.contractCache.GetContract(CRegID(contract), contractStore),
+            CHAIN_ASSERT( database.contractCache.HasContract(CRegID(contract)),
                           contract_exception,
                           "contract '%s' does not exist",
                           wasm::regid(contract).to_string())
@@ -96,8 +89,7 @@ namespace wasm {
         }
 
         bool erase_data( const uint64_t& contract, const string& k ) {
-            CUniversalContractStore contractStore;
-            CHAIN_ASSERT( database.contractCache.GetContract(CRegID(contract), contractStore),
+            CHAIN_ASSERT( database.contractCache.HasContract(CRegID(contract)),
                           contract_exception,
                           "contract '%s' does not exist",
                           wasm::regid(contract).to_string())
@@ -116,9 +108,9 @@ namespace wasm {
             _pending_console_output << val;
         }
 
-        vm::wasm_allocator* get_wasm_allocator() { return &wasm_alloc; }
+        vm::wasm_allocator* get_wasm_allocator() { return wasm_alloc.get(); }
         bool                is_memory_in_wasm_allocator ( const uint64_t& p ) {
-            return wasm_alloc.is_in_range(reinterpret_cast<const char*>(p));
+            return wasm_alloc->is_in_range(reinterpret_cast<const char*>(p));
         }
         std::chrono::milliseconds get_max_transaction_duration() { return control_trx.get_max_transaction_duration(); }
         void                      update_storage_usage( const uint64_t& account, const int64_t& size_in_bytes);
@@ -136,7 +128,7 @@ namespace wasm {
         vector<inline_transaction>  inline_transactions;
 
         wasm::wasm_interface        wasmif;
-        vm::wasm_allocator          wasm_alloc;
+        pooled_wasm_allocator       wasm_alloc;
         uint64_t                    _receiver;
 
     private:
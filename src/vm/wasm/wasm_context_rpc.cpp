@@ -80,27 +80,16 @@ namespace wasm {
         inline_transactions.push_back(t);
     }
 
-    bool wasm_context_rpc::get_code(const uint64_t& contract, std::vector <uint8_t> &code) {
-        CUniversalContractStore contract_store;
-        if (!database.contractCache.GetContract(CRegID(contract), contract_store))
-            return false;
-
-        code = vector <uint8_t>(contract_store.code.begin(), contract_store.code.end());
-        return true;
-    }
-
     uint64_t wasm_context_rpc::get_runcost() {
         return trx.GetSerializeSize(SER_DISK, CLIENT_VERSION) * store_fuel_fee_per_byte;
     }
 
     uint64_t wasm_context_rpc::get_maintainer(const uint64_t& contract) {
-        CRegID   maintainer;
-        CUniversalContractStore contract_store;
-        if (!database.contractCache.GetContract(CRegID(contract), contract_store))
+        CUniversalContractMeta contract_meta;
+        if (!database.contractCache.GetContractMeta(CRegID(contract), contract_meta))
             return false;
 
-        maintainer = contract_store.maintainer;
-        return maintainer.GetIntValue();
+        return contract_meta.maintainer.GetIntValue();
     }
 
     void wasm_context_rpc::initialize() {
@@ -160,9 +149,15 @@ namespace wasm {
                     "can not getstate from native action ")
                 }
         
-                vector <uint8_t> code;
-                if (get_code(_receiver, code) && code.size() > 0) {
-                    wasmif.execute(code, this);
+                CUniversalContractMeta contract_meta;
+                if (database.contractCache.GetContractMeta(CRegID(_receiver), contract_meta) &&
+                    contract_meta.code_size > 0) {
+                    auto code_loader = [&]() {
+                        CContractCodeCache::CodePtr code;
+                        database.contractCache.GetContractCode(CRegID(_receiver), contract_meta, code);
+                        return code;
+                    };
+                    wasmif.execute(_receiver, contract_meta.code_hash, code_loader, this);
                 }
         }  catch (wasm_chain::exception &e) {
             string console_output = (_pending_console_output.str().size() == 0) ?
@@ -11,7 +11,7 @@
 #include "wasm/wasm_interface.hpp"
 #include "wasm/datastream.hpp"
 #include "wasm/wasm_trace.hpp"
-#include "eosio/vm/allocator.hpp"
+#include "wasm/wasm_memory_pool.hpp"
 #include "persistence/cachewrapper.h"
 #include "wasm/exception/exceptions.hpp"
 #include "wasm/wasm_control_rpc.hpp"
@@ -31,16 +31,11 @@ namespace wasm {
             reset_console();
         };
 
-        ~wasm_context_rpc() {
-            wasm_alloc.free();
-        };
-
     public:
         void initialize();
         void execute(inline_transaction_trace &trace);
         void execute_one(inline_transaction_trace &trace);
         bool has_permission_from_inline_transaction(const permission &p);
-        bool get_code(const uint64_t& contract, std::vector <uint8_t> &code);
         uint64_t get_runcost();
 
 // Console methods:
@@ -78,8 +73,7 @@ namespace wasm {
         bool        get_system_asset_price(uint64_t base, uint64_t quote, std::vector<char>& price);
 
         bool set_data( const uint64_t& contract, const string& k, const string& v ) {
-            CUniversalContractStore contractStore;
-            CHAIN_ASSERT( database.contractCache.GetContract(CRegID(contract), contractStore),
+            CHAIN_ASSERT( database.contractCache.HasContract(CRegID(contract)),
                           contract_exception,
                           "contract '%s' does not exist",
                           wasm::regid(contract).to_string())
@@ -88,8 +82,7 @@ namespace wasm {
         }
 
         bool get_data( const uint64_t& contract, const string& k, string &v ) {
-            CUniversalContractStore contractStore;
-            CHAIN_ASSERT( database.contractCache.GetContract(CRegID(contract), contractStore),
+            CHAIN_ASSERT( database.contractCache.HasContract(CRegID(contract)),
                           contract_exception,
                           "contract '%s' does not exist",
                           wasm::regid(contract).to_string())
@@ -98,8 +91,7 @@ namespace wasm {
         }
 
         bool erase_data( const uint64_t& contract, const string& k ) {
-            CUniversalContractStore contractStore;
-            CHAIN_ASSERT( database.contractCache.GetContract(CRegID(contract), contractStore),
+            CHAIN_ASSERT( database.contractCache.HasContract(CRegID(contract)),
                           contract_exception,
                           "contract '%s' does not exist",
                           wasm::regid(contract).to_string())
@@ -117,9 +109,9 @@ namespace wasm {
             _pending_console_output << val;
         }
 
-        vm::wasm_allocator* get_wasm_allocator() { return &wasm_alloc; }
+        vm::wasm_allocator* get_wasm_allocator() { return wasm_alloc.get(); }
         bool                is_memory_in_wasm_allocator ( const uint64_t& p ) {
-            return wasm_alloc.is_in_range(reinterpret_cast<const char*>(p));
+            return wasm_alloc->is_in_range(reinterpret_cast<const char*>(p));
         }
         std::chrono::milliseconds get_max_transaction_duration() { 
             return std::chrono::milliseconds(wasm::max_wasm_execute_time_infinite);
@@ -137,7 +129,7 @@ namespace wasm {
         vector<inline_transaction>  inline_transactions;
 
         wasm::wasm_interface        wasmif;
-        vm::wasm_allocator          wasm_alloc;
+        pooled_wasm_allocator       wasm_alloc;
         uint64_t                    _receiver;
 
     private:
@@ -37,8 +37,11 @@ namespace wasm {
     using backend_validate_t = backend<wasm::wasm_context_interface, vm::interpreter>;
     using rhf_t              = eosio::vm::registered_host_functions<wasm_context_interface>;
 
-    std::optional<std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>>& get_wasm_instantiation_cache(){
-        static std::optional<std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>> wasm_instantiation_cache;
+    // (contract, code hash) -> instantiated module
+    using instantiation_cache_t = std::map <std::pair<uint64_t, code_version_t>, std::shared_ptr<wasm_instantiated_module_interface>>;
+
+    std::optional<instantiation_cache_t>& get_wasm_instantiation_cache(){
+        static std::optional<instantiation_cache_t> wasm_instantiation_cache;
         return wasm_instantiation_cache;
     }
 
@@ -55,18 +58,26 @@ namespace wasm {
         get_runtime_interface()->immediately_exit_currently_running_module();
     }
 
-    std::shared_ptr <wasm_instantiated_module_interface> get_instantiated_backend(const vector <uint8_t> &code) {
+    std::shared_ptr <wasm_instantiated_module_interface> get_instantiated_backend(const uint64_t& contract,
+                                                                                  const code_version_t& code_id,
+                                                                                  const std::function<std::shared_ptr<const string>()>& code_loader) {
 
         try {
             if (!get_wasm_instantiation_cache().has_value()){
-                 get_wasm_instantiation_cache() = std::map <code_version_t, std::shared_ptr<wasm_instantiated_module_interface>>{};
+                 get_wasm_instantiation_cache() = instantiation_cache_t{};
             }
 
-            auto code_id = Hash(code.begin(), code.end());
-            auto it = get_wasm_instantiation_cache()->find(code_id);
+            auto key = std::make_pair(contract, code_id);
+            auto it = get_wasm_instantiation_cache()->find(key);
             if (it == get_wasm_instantiation_cache()->end()) {
-                get_wasm_instantiation_cache().value()[code_id] = get_runtime_interface()->instantiate_module((const char*)code.data(), code.size());
-                return get_wasm_instantiation_cache().value()[code_id];
+                auto code = code_loader();
+                CHAIN_ASSERT( code && code->size() > 0,
+                              wasm_chain::code_parse_exception,
+                              "code of contract '%s' is empty",
+                              wasm::regid(contract).to_string() )
+
+                get_wasm_instantiation_cache().value()[key] = get_runtime_interface()->instantiate_module(code->data(), code->size());
+                return get_wasm_instantiation_cache().value()[key];
             }
             return it->second;
         } catch (...) {
@@ -77,8 +88,19 @@ namespace wasm {
 
     void wasm_interface::execute(const vector <uint8_t> &code, wasm_context_interface *pWasmContext) {
 
+        auto code_id = Hash(code.begin(), code.end());
+        execute(0, code_id,
+                [&code]() { return std::make_shared<const string>(code.begin(), code.end()); },
+                pWasmContext);
+
+    }
+
+    void wasm_interface::execute(const uint64_t& contract, const uint256& code_hash,
+                                 const std::function<std::shared_ptr<const string>()>& code_loader,
+                                 wasm_context_interface *pWasmContext) {
+
         pWasmContext->pause_billing_timer();
-        auto pInstantiated_module = get_instantiated_backend(code);
+        auto pInstantiated_module = get_instantiated_backend(contract, code_hash, code_loader);
         pWasmContext->resume_billing_timer();
 
         //system_clock::time_point start = system_clock::now();
@@ -2,6 +2,9 @@
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <functional>
+#include "commons/uint256.h"
 #include "wasm/wasm_context_interface.hpp"
 #include "wasm/wasm_runtime.hpp"
 
@@ -24,6 +27,10 @@ namespace wasm {
     public:
         void initialize(vm_type vm);
         void execute(const vector <uint8_t>& code, wasm_context_interface *pWasmContext);
+        // resolve the module by (contract, code_hash), code_loader is only called if it is not instantiated yet
+        void execute(const uint64_t& contract, const uint256& code_hash,
+                     const std::function<std::shared_ptr<const string>()>& code_loader,
+                     wasm_context_interface *pWasmContext);
         void validate(const vector <uint8_t>& code);
         void exit();
 
@@ -0,0 +1,78 @@
+#include "wasm/wasm_memory_pool.hpp"
+
+#include <atomic>
+#include <sys/resource.h>
+
+namespace wasm {
+
+    namespace {
+        std::atomic<uint64_t> acquired_count(0);
+        std::atomic<uint64_t> pool_hit_count(0);
+        std::atomic<uint64_t> mapped_count(0);
+        std::atomic<uint64_t> unmapped_count(0);
+        std::atomic<uint64_t> discarded_page_count(0);
+        std::atomic<uint64_t> page_fault_count(0);
+
+        uint64_t thread_page_faults() {
+#ifdef RUSAGE_THREAD
+            struct rusage usage;
+            if (getrusage(RUSAGE_THREAD, &usage) == 0)
+                return usage.ru_minflt;
+#endif
+            return 0;
+        }
+    }
+
+    wasm_memory_pool& wasm_memory_pool::get() {
+        static thread_local wasm_memory_pool pool;
+        return pool;
+    }
+
+    std::unique_ptr<eosio::vm::wasm_allocator> wasm_memory_pool::acquire() {
+        // count the faults of the outermost context only, the nested ones are within its span
+        if (in_use++ == 0)
+            page_faults_before = thread_page_faults();
+
+        acquired_count++;
+        if (!idle.empty()) {
+            auto alloc = std::move(idle.back());
+            idle.pop_back();
+            pool_hit_count++;
+            return alloc;
+        }
+
+        mapped_count++;
+        return std::make_unique<eosio::vm::wasm_allocator>();
+    }
+
+    void wasm_memory_pool::release(std::unique_ptr<eosio::vm::wasm_allocator> alloc) {
+        if (alloc) {
+            if (idle.size() < max_pooled_wasm_allocators) {
+                discarded_page_count += alloc->discard();
+                idle.push_back(std::move(alloc));
+            } else {
+                alloc->free();
+                unmapped_count++;
+            }
+        }
+
+        if (in_use > 0 && --in_use == 0)
+            page_fault_count += thread_page_faults() - page_faults_before;
+    }
+
+    wasm_memory_pool_stats wasm_memory_pool::get_stats() {
+        wasm_memory_pool_stats stats;
+        stats.acquired        = acquired_count;
+        stats.pool_hits       = pool_hit_count;
+        stats.mapped          = mapped_count;
+        stats.unmapped        = unmapped_count;
+        stats.discarded_pages = discarded_page_count;
+        stats.page_faults     = page_fault_count;
+        return stats;
+    }
+
+    wasm_memory_pool::~wasm_memory_pool() {
+        for (auto &alloc : idle)
+            alloc->free();
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "eosio/vm/allocator.hpp"
+
+namespace wasm {
+
+    // max idle linear memories kept per thread, one per level of inline transaction plus notifications
+    static const uint32_t max_pooled_wasm_allocators = 16;
+
+    struct wasm_memory_pool_stats {
+        uint64_t acquired        = 0;   //!< linear memories handed out
+        uint64_t pool_hits       = 0;   //!< handed out from the pool without mapping
+        uint64_t mapped          = 0;   //!< newly mapped because the pool was empty
+        uint64_t unmapped        = 0;   //!< unmapped because the pool was full
+        uint64_t discarded_pages = 0;   //!< touched wasm pages reset on release
+        uint64_t page_faults     = 0;   //!< minor page faults of the thread while executing in pooled memory
+    };
+
+    /**
+     * Thread-local pool of pre-reserved wasm linear memories.
+     * Each wasm context of a transaction, including the ones of inline transactions and notifications,
+     * takes a linear memory from the pool of its thread and gives it back when done. The released memory
+     * only has its touched pages reset instead of unmapping and mapping the whole reservation again.
+     */
+    class wasm_memory_pool {
+    public:
+        static wasm_memory_pool& get();
+
+        std::unique_ptr<eosio::vm::wasm_allocator> acquire();
+        void release(std::unique_ptr<eosio::vm::wasm_allocator> alloc);
+
+        // aggregated over all threads
+        static wasm_memory_pool_stats get_stats();
+
+        ~wasm_memory_pool();
+
+    private:
+        wasm_memory_pool() {}
+
+        std::vector<std::unique_ptr<eosio::vm::wasm_allocator>> idle;
+        uint32_t  in_use             = 0;
+        uint64_t  page_faults_before = 0;
+    };
+
+    // linear memory of one wasm context, borrowed from the pool of the current thread
+    class pooled_wasm_allocator {
+    public:
+        pooled_wasm_allocator() : alloc(wasm_memory_pool::get().acquire()) {}
+        ~pooled_wasm_allocator() { wasm_memory_pool::get().release(std::move(alloc)); }
+
+        pooled_wasm_allocator(const pooled_wasm_allocator&) = delete;
+        pooled_wasm_allocator& operator=(const pooled_wasm_allocator&) = delete;
+
+        eosio::vm::wasm_allocator* get() const { return alloc.get(); }
+        eosio::vm::wasm_allocator* operator->() const { return alloc.get(); }
+
+    private:
+        std::unique_ptr<eosio::vm::wasm_allocator> alloc;
+    };
+}
@@ -158,5 +158,21 @@ namespace wasm { namespace rpc{
         > curl --user myusername -d '{"jsonrpc": "1.0", "id":"curltest", "method":"wasm_abidefjson2bin", "params":{"____comment": "This file was generated with wasm-abigen. DO NOT EDIT ",...}}' -H 'Content-Type: application/json;' http://127.0.0.1:8332
     )=====";
 
+    const char *get_memory_stats_wasm_rpc_help_message = R"=====(
+        wasm_getmemorystats
+        get the stats of the pooled wasm linear memories since the node started
+        Result:
+        "acquired":          (numeric) linear memories handed out to wasm contexts
+        "pool_hits":         (numeric) linear memories reused from the pool
+        "mapped":            (numeric) linear memories newly mapped
+        "unmapped":          (numeric) linear memories unmapped because the pool was full
+        "discarded_pages":   (numeric) touched wasm pages reset when memories were released
+        "page_faults":       (numeric) minor page faults while executing in pooled memories
+        Examples:
+        > ./coind wasm_getmemorystats
+        As json rpc call
+        > curl --user myusername -d '{"jsonrpc": "1.0", "id":"curltest", "method":"wasm_getmemorystats", "params":[]}' -H 'Content-Type: application/json;' http://127.0.0.1:8332
+    )=====";
+
 } // rpc
 } // wasm
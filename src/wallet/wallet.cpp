@@ -19,9 +19,12 @@
 #include "commons/json/json_spirit_value.h"
 #include "commons/json/json_spirit_writer_template.h"
 #include "net.h"
+#include "commons/messagequeue.h"
+#include "persistence/cachewrapper.h"
 #include "persistence/accountdb.h"
 #include "persistence/contractdb.h"
 #include "../logging.h"
+#include "tx/txpreexecutor.h"
 #include "tx/txserializer.h"
 
 using namespace json_spirit;
@@ -110,80 +113,302 @@ void CWallet::SetBestChain(const CBlockLocator &loc) {
     bestBlock = loc;
 }
 
-void CWallet::SyncTransaction(const uint256 &hash, CBaseTx *pTx, const CBlock *pBlock) {
+////////////////////////////////////////////////////////////////////////////////
+// wallet sync thread
+
+void CWalletSyncQueue::Push(CWalletSyncTask &&task) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (task.spBlock)
+        blockCount++;
+    tasks.push_back(std::move(task));
+    popCond.notify_one();
+}
+
+bool CWalletSyncQueue::Pop(CWalletSyncTask &task, const std::chrono::milliseconds &timeout) {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (tasks.empty() && !popCond.wait_for(lock, timeout, [this] { return !tasks.empty(); }))
+        return false;
+
+    task = std::move(tasks.front());
+    tasks.pop_front();
+    if (task.spBlock && --blockCount < maxBlocks)
+        spaceCond.notify_all();
+    return true;
+}
+
+bool CWalletSyncQueue::WaitForSpace() {
+    std::unique_lock<std::mutex> lock(mtx);
+    spaceCond.wait(lock, [this] { return interrupted || blockCount < maxBlocks; });
+    return !interrupted;
+}
+
+void CWalletSyncQueue::Interrupt() {
+    std::unique_lock<std::mutex> lock(mtx);
+    interrupted = true;
+    spaceCond.notify_all();
+}
+
+bool CWalletSyncQueue::Empty() {
+    std::unique_lock<std::mutex> lock(mtx);
+    return tasks.empty();
+}
+
+uint32_t CWalletSyncQueue::GetBlockCount() {
+    std::unique_lock<std::mutex> lock(mtx);
+    return blockCount;
+}
+
+// replaced under cs_main only
+static std::shared_ptr<CWalletSyncQueue> walletSyncQueue;
+
+static void GetBlockInvolvedKeyIds(const CBlock &block, CCacheWrapper &cw, vector<set<CKeyID>> &txKeyIds) {
+    txKeyIds.assign(block.vptx.size(), set<CKeyID>());
+    for (size_t i = 0; i < block.vptx.size(); i++) {
+        if (!block.vptx[i]->GetInvolvedKeyIds(cw, txKeyIds[i]))
+            txKeyIds[i].clear();
+    }
+}
+
+static void ThreadWalletSync(CWallet *pWallet, std::shared_ptr<CWalletSyncQueue> spQueue) {
+    RenameThread("coin-walletsync");
+
+    CWalletSyncTask task;
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            if (!spQueue->Pop(task, POP_DEFAULT_TIMEOUT))
+                continue;
+
+            try {
+                pWallet->SyncBlock(task);
+            } catch (std::exception &e) {
+                LogPrint(BCLog::ERROR, "wallet sync of block %s failed: %s\n",
+                         task.spBlock ? task.spBlock->GetHash().GetHex() : "", e.what());
+            }
+            task = CWalletSyncTask();
+        }
+    } catch (...) {
+        // nothing drains the queue any more until it is flushed, the block processing must not wait for it
+        spQueue->Interrupt();
+        throw;
+    }
+}
+
+void StartWalletSync(boost::thread_group &threadGroup, CWallet *pWallet) {
+    // the blocks are queued under cs_main, the ones connected before are already applied
+    LOCK(cs_main);
+    walletSyncQueue = std::make_shared<CWalletSyncQueue>(MAX_WALLET_SYNC_QUEUE_BLOCKS);
+    threadGroup.create_thread(boost::bind(&ThreadWalletSync, pWallet, walletSyncQueue));
+}
+
+void FlushWalletSync(CWallet *pWallet) {
+    std::shared_ptr<CWalletSyncQueue> spQueue;
+    {
+        LOCK(cs_main);
+        spQueue = walletSyncQueue;
+    }
+    if (!spQueue)
+        return;
+
+    spQueue->Interrupt();
+
+    // applied without cs_main, the queue is dropped once no block has been queued meanwhile
+    CWalletSyncTask task;
+    while (true) {
+        while (spQueue->Pop(task, std::chrono::milliseconds(0))) {
+            pWallet->SyncBlock(task);
+            task = CWalletSyncTask();
+        }
+
+        LOCK(cs_main);
+        if (spQueue->Empty()) {
+            walletSyncQueue.reset();
+            return;
+        }
+    }
+}
+
+void CWallet::WaitForSync() {
+    std::shared_ptr<CWalletSyncQueue> spQueue;
+    {
+        LOCK(cs_main);
+        spQueue = walletSyncQueue;
+    }
+    if (spQueue)
+        spQueue->WaitForSpace();
+}
+
+void CWallet::SyncTransaction(const uint256 &hash, CBaseTx *pTx, const CBlock *pBlock,
+                              const set<CKeyID> *pAccountKeyIds) {
     assert(pTx != nullptr || pBlock != nullptr);
 
     if (hash.IsNull() && pTx == nullptr) {  // this is block Sync
-        uint256 blockhash         = pBlock->GetHash();
-        auto GenesisBlockProgress = [&]() {};
-
-        auto ConnectBlockProgress = [&]() {
-            CWalletAccountTxDb acctTxDb(this, blockhash, pBlock->GetHeight());
-            for (const auto &sptx : pBlock->vptx) {
-                uint256 txid = sptx->GetHash();
-                // confirm the tx is mine
-                if (IsMine(sptx.get())) {
-                    acctTxDb.AddTx(txid, sptx.get());
-                }
-                if (unconfirmedTx.count(txid) > 0) {
-                    CWalletDB(strWalletFile).EraseUnconfirmedTx(txid);
-                    unconfirmedTx.erase(txid);
+        LOCK(cs_main);
+        uint256 blockhash = pBlock->GetHash();
+        if (SysCfg().GetGenesisBlockHash() == blockhash)
+            return;
+
+        CWalletSyncTask task;
+        task.spBlock   = std::make_shared<CBlock>(*pBlock);
+        task.connected = mapBlockIndex.count(blockhash) && chainActive.Contains(mapBlockIndex[blockhash]);
+        if (pAccountKeyIds != nullptr) {
+            task.accountKeyIds    = *pAccountKeyIds;
+            task.hasAccountKeyIds = true;
+        }
+
+        // the sync thread finds the involved key ids on the frozen state of the new tip, without it
+        // (e.g. during initial download) they are found here while the chain state is still the tip's
+        auto spSnapshot = pCdMan->GetReadSnapshot();
+        if (walletSyncQueue && spSnapshot && chainActive.Tip() != nullptr &&
+            spSnapshot->GetBlockHash() == chainActive.Tip()->GetBlockHash()) {
+            task.spSnapshot = spSnapshot;
+            walletSyncQueue->Push(std::move(task));
+            return;
+        }
+
+        CCacheWrapper cw(pCdMan);
+        GetBlockInvolvedKeyIds(*pBlock, cw, task.txKeyIds);
+        if (walletSyncQueue)
+            walletSyncQueue->Push(std::move(task));
+        else
+            SyncBlock(task, &cw);
+    }
+}
+
+void CWallet::SyncBlock(CWalletSyncTask &task, CCacheWrapper *pTipCW) {
+    if (!task.spBlock) {
+        EraseUnconfirmedTx(task.erasedTxid);
+        return;
+    }
+
+    const CBlock &block = *task.spBlock;
+    vector<bool> txMine(block.vptx.size(), false);
+    set<CKeyID> refreshKeyIds;  // wallet keys whose accounts the block wrote
+    auto FindMineKeyIds = [&]() {
+        // the key store is locked once for the whole block
+        LOCK(cs_KeyStore);
+        for (size_t i = 0; i < task.txKeyIds.size(); i++) {
+            for (const auto &keyId : task.txKeyIds[i]) {
+                if (HasKey(keyId)) {
+                    txMine[i] = true;
+                    if (!task.hasAccountKeyIds)
+                        refreshKeyIds.insert(keyId);
                 }
             }
-            if (acctTxDb.GetTxSize() > 0) {          // write to disk
-                mapInBlockTx[blockhash] = acctTxDb;  // add to map
-                acctTxDb.WriteToDisk();
-            }
-        };
+        }
+        for (const auto &keyId : task.accountKeyIds) {
+            if (HasKey(keyId))
+                refreshKeyIds.insert(keyId);
+        }
+    };
+    auto RefreshBalances = [&](CCacheWrapper &cw) {
+        for (const auto &keyId : refreshKeyIds) {
+            CAccount account;
+            cw.accountCache.GetAccount(keyId, account);
+            balanceCache.SetBalances(keyId, account);
+        }
+    };
 
-        auto DisConnectBlockProgress = [&]() {
-            for (const auto &sptx : pBlock->vptx) {
-                if (sptx->IsBlockRewardTx()) {
-                    continue;
-                }
-                if (IsMine(sptx.get())) {
-                    unconfirmedTx[sptx.get()->GetHash()] = sptx.get()->GetNewInstance();
-                    CWalletDB(strWalletFile).WriteUnconfirmedTx(sptx.get()->GetHash(), unconfirmedTx[sptx.get()->GetHash()]);
-                }
+    bool fReconcile = false;
+    if (task.spSnapshot) {
+        // the balances are refreshed on the same frozen state
+        CDBSnapshotScope snapshotScope(task.spSnapshot->snapshotSet);
+        CCacheWrapper cw;
+        cw.BindDbs(pCdMan);
+        GetBlockInvolvedKeyIds(block, cw, task.txKeyIds);
+        FindMineKeyIds();
+        RefreshBalances(cw);
+        fReconcile = balanceCache.NeedReconcile(GetTime());
+    } else if (pTipCW != nullptr) {
+        FindMineKeyIds();
+        RefreshBalances(*pTipCW);
+    } else {
+        FindMineKeyIds();
+        // the state of the block is gone, the balances are reconciled when read or on a later block
+        if (!refreshKeyIds.empty())
+            balanceCache.Invalidate();
+    }
+
+    ApplyBlockTxs(task, txMine);
+
+    // all keys are read again periodically on the state of the block, once the block is applied
+    if (fReconcile) {
+        CDBSnapshotScope snapshotScope(task.spSnapshot->snapshotSet);
+        CCacheWrapper cw;
+        cw.BindDbs(pCdMan);
+        ReconcileBalances(cw);
+    }
+}
+
+void CWallet::ApplyBlockTxs(const CWalletSyncTask &task, const vector<bool> &txMine) {
+    const CBlock &block = *task.spBlock;
+    uint256 blockhash   = block.GetHash();
+    LOCK(cs_wallet);
+    // the writes of the block are committed to the wallet db at once
+    CWalletDB walletdb(strWalletFile);
+    bool fTxn = walletdb.TxnBegin();
+
+    if (task.connected) {
+        CWalletAccountTxDb acctTxDb(this, blockhash, block.GetHeight());
+        for (size_t i = 0; i < block.vptx.size(); i++) {
+            const auto &sptx = block.vptx[i];
+            uint256 txid     = sptx->GetHash();
+            if (txMine[i]) {
+                acctTxDb.AddTx(txid, sptx.get());
             }
-            if (mapInBlockTx.count(blockhash)) {
-                CWalletDB(strWalletFile).EraseBlockTx(blockhash);
-                mapInBlockTx.erase(blockhash);
+            if (unconfirmedTx.count(txid) > 0) {
+                walletdb.EraseUnconfirmedTx(txid);
+                unconfirmedTx.erase(txid);
+            }
+        }
+        if (acctTxDb.GetTxSize() > 0) {          // write to disk
+            mapInBlockTx[blockhash] = acctTxDb;  // add to map
+            walletdb.WriteBlockTx(blockhash, acctTxDb);
+        }
+    } else {
+        for (size_t i = 0; i < block.vptx.size(); i++) {
+            const auto &sptx = block.vptx[i];
+            if (sptx->IsBlockRewardTx()) {
+                continue;
             }
-        };
-
-        auto IsConnect = [&]() {  // Connect or disconnect
-            return mapBlockIndex.count(blockhash) && chainActive.Contains(mapBlockIndex[blockhash]);
-        };
-
-        {
-            LOCK2(cs_main, cs_wallet);
-            // GenesisBlock progress
-            if (SysCfg().GetGenesisBlockHash() == blockhash) {
-                GenesisBlockProgress();
-            } else if (IsConnect()) {
-                // connect block
-                ConnectBlockProgress();
-            } else {
-                // disconnect block
-                DisConnectBlockProgress();
+            if (txMine[i]) {
+                uint256 txid        = sptx->GetHash();
+                unconfirmedTx[txid] = sptx->GetNewInstance();
+                walletdb.WriteUnconfirmedTx(txid, unconfirmedTx[txid]);
             }
         }
+        if (mapInBlockTx.count(blockhash)) {
+            walletdb.EraseBlockTx(blockhash);
+            mapInBlockTx.erase(blockhash);
+        }
     }
+
+    if (fTxn && !walletdb.TxnCommit())
+        LogPrint(BCLog::ERROR, "commit wallet sync of block %s failed\n", blockhash.GetHex());
 }
 
 void CWallet::EraseTransaction(const uint256 &hash) {
     if (!fFileBacked)
         return;
-    {
-        LOCK(cs_wallet);
-        if (unconfirmedTx.count(hash)) {
-            unconfirmedTx.erase(hash);
-            CWalletDB(strWalletFile).EraseUnconfirmedTx(hash);
-        }
+
+    // erased in order with the queued blocks, which may confirm the tx again
+    if (walletSyncQueue) {
+        CWalletSyncTask task;
+        task.erasedTxid = hash;
+        walletSyncQueue->Push(std::move(task));
+        return;
     }
 
-    return;
+    EraseUnconfirmedTx(hash);
+}
+
+void CWallet::EraseUnconfirmedTx(const uint256 &hash) {
+    LOCK(cs_wallet);
+    if (unconfirmedTx.count(hash)) {
+        unconfirmedTx.erase(hash);
+        CWalletDB(strWalletFile).EraseUnconfirmedTx(hash);
+    }
 }
 
 void CWallet::ResendWalletTransactions() {
@@ -209,6 +434,9 @@ void CWallet::ResendWalletTransactions() {
 
 //// Call after CreateTransaction unless you want to abort
 bool CWallet::CommitTx(CBaseTx *pTx, string &retMsg) {
+    // execute contract txs before taking cs_main, so that concurrent submissions are executed in parallel
+    auto spPreExecution = PreExecuteTx(mempool, pTx);
+
     LOCK2(cs_main, cs_wallet);
     LogPrint(BCLog::RPCCMD, "CommitTx() : %s\n", pTx->ToString(*pCdMan->pAccountCache));
 
@@ -217,7 +445,7 @@ bool CWallet::CommitTx(CBaseTx *pTx, string &retMsg) {
 
     {
         CValidationState state;
-        if (!::AcceptToMemoryPool(mempool, state, pTx, true)) {
+        if (!::AcceptToMemoryPool(mempool, state, pTx, true, false, spPreExecution.get())) {
             // This must not fail. The transaction has already been signed and recorded.
             retMsg = state.GetRejectReason();
             LogPrint(BCLog::RPCCMD, "CommitTx() : invalid transaction %s\n", retMsg);
@@ -253,20 +481,116 @@ DBErrors CWallet::LoadWallet(bool fFirstRunRet) {
 
 uint64_t CWallet::GetFreeCoins(TokenSymbol coinCymbol, bool isConfirmed) const {
     uint64_t ret = 0;
+    if (isConfirmed) {
+        if (balanceCache.GetTotal(coinCymbol, ret))
+            return ret;
+
+        // reconciled on the tip under cs_main while invalid, e.g. during initial download
+        LOCK(cs_main);
+        CCacheWrapper cw(pCdMan);
+        auto totals = ReconcileBalances(cw);
+        auto it     = totals.find(coinCymbol);
+        return it != totals.end() ? it->second : 0;
+    }
+
     {
         LOCK2(cs_main, cs_wallet);
         set<CKeyID> setKeyId;
         GetKeys(setKeyId);
         for (auto &keyId : setKeyId) {
-            if (!isConfirmed)
-                ret += mempool.cw->accountCache.GetAccountFreeAmount(keyId, coinCymbol);
-            else
-                ret += pCdMan->pAccountCache->GetAccountFreeAmount(keyId, coinCymbol);
+            ret += mempool.cw->accountCache.GetAccountFreeAmount(keyId, coinCymbol);
         }
     }
     return ret;
 }
 
+map<TokenSymbol, uint64_t> CWallet::ReconcileBalances(CCacheWrapper &cw) const {
+    int64_t now         = GetTime();
+    uint64_t generation = balanceCache.GetGeneration();
+    set<CKeyID> setKeyId;
+    GetKeys(setKeyId);
+
+    map<CKeyID, map<TokenSymbol, uint64_t>> keyBalances;
+    map<TokenSymbol, uint64_t> totals;
+    for (const auto &keyId : setKeyId) {
+        CAccount account;
+        cw.accountCache.GetAccount(keyId, account);
+
+        auto &balances = keyBalances[keyId];
+        for (const auto &item : account.tokens) {
+            balances[item.first] = item.second.free_amount;
+            totals[item.first] += item.second.free_amount;
+        }
+    }
+
+    balanceCache.Reset(std::move(keyBalances), now, generation);
+    return totals;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CWalletBalanceCache
+
+bool CWalletBalanceCache::GetTotal(const TokenSymbol &symbol, uint64_t &amount) const {
+    LOCK(cs_balances);
+    if (!valid)
+        return false;
+
+    auto it = totals.find(symbol);
+    amount  = it != totals.end() ? it->second : 0;
+    return true;
+}
+
+bool CWalletBalanceCache::NeedReconcile(int64_t now) const {
+    LOCK(cs_balances);
+    return !valid || now - reconcileTime >= WALLET_BALANCE_RECONCILE_SECONDS;
+}
+
+void CWalletBalanceCache::SetBalances(const CKeyID &keyId, const CAccount &account) {
+    LOCK(cs_balances);
+    if (!valid)
+        return;
+
+    auto &balances = keyBalances[keyId];
+    for (const auto &item : balances)
+        totals[item.first] -= item.second;
+
+    balances.clear();
+    for (const auto &item : account.tokens) {
+        balances[item.first] = item.second.free_amount;
+        totals[item.first] += item.second.free_amount;
+    }
+}
+
+uint64_t CWalletBalanceCache::GetGeneration() const {
+    LOCK(cs_balances);
+    return generation;
+}
+
+void CWalletBalanceCache::Reset(map<CKeyID, map<TokenSymbol, uint64_t>> &&keyBalancesIn, int64_t now,
+                                uint64_t generationIn) {
+    LOCK(cs_balances);
+    // invalidated since the balances were read, e.g. a key was added
+    if (generationIn != generation)
+        return;
+
+    keyBalances = std::move(keyBalancesIn);
+    totals.clear();
+    for (const auto &keyItem : keyBalances) {
+        for (const auto &item : keyItem.second)
+            totals[item.first] += item.second;
+    }
+    valid         = true;
+    reconcileTime = now;
+}
+
+void CWalletBalanceCache::Invalidate() {
+    LOCK(cs_balances);
+    valid = false;
+    generation++;
+    keyBalances.clear();
+    totals.clear();
+}
+
 bool CWallet::EncryptWallet(const SecureString &strWalletPassphrase) {
     if (IsEncrypted())
         return false;
@@ -501,6 +825,7 @@ bool CWallet::CleanAll() {
             CWalletDB(strWalletFile).EraseKeyStoreValue(item.first);
         });
         mapKeys.clear();
+        balanceCache.Invalidate();
     } else {
         return ERRORMSG("wallet is encrypted hence clear data forbidden!");
     }
@@ -566,7 +891,11 @@ bool CWallet::AddKey(const CKeyID &KeyId, const CKeyCombi &keyCombi) {
     if (!CWalletDB(strWalletFile).WriteKeyStoreValue(KeyId, keyCombi, nWalletVersion))
         return false;
 
-    return CCryptoKeyStore::AddKeyCombi(KeyId, keyCombi);
+    if (!CCryptoKeyStore::AddKeyCombi(KeyId, keyCombi))
+        return false;
+
+    balanceCache.Invalidate();
+    return true;
 }
 
 bool CWallet::AddKey(const CKey &key) {
@@ -583,6 +912,7 @@ bool CWallet::RemoveKey(const CKey &key) {
     if (!IsEncrypted()) { //unencrypted or unlocked
         CWalletDB(strWalletFile).EraseKeyStoreValue(keyId);
         mapKeys.erase(keyId);
+        balanceCache.Invalidate();
     } else {
         return ERRORMSG("wallet is being locked hence no key removal!");
     }
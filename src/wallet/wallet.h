@@ -29,11 +29,98 @@
 #include "tx/delegatetx.h"
 #include "tx/accountregtx.h"
 
+#include <boost/thread.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
 enum WalletFeature {
     FEATURE_BASE        = 0,      // initialize version
     FEATURE_WALLETCRYPT = 10000,  // wallet encryption
 };
 
+class CCacheSnapshot;
+
+// all keys of the wallet balance cache are read again from the chain state at this interval
+static const int64_t WALLET_BALANCE_RECONCILE_SECONDS = 600;
+// max blocks queued to the wallet sync thread before the block processing waits for it
+static const uint32_t MAX_WALLET_SYNC_QUEUE_BLOCKS = 8;
+
+/**
+ * Confirmed free amounts of the wallet keys by key id and symbol, with their totals by symbol, so that
+ * the balance of the wallet is read without cs_main nor a scan of the accounts. The wallet sync refreshes
+ * the keys whose accounts a block wrote, as found in the undo data of the block, from the state of the
+ * block, and the sync thread reconciles all keys periodically as a safety net.
+ * The cache is invalid until reconciled, e.g. after a key is added to the wallet.
+ */
+class CWalletBalanceCache {
+public:
+    // returns false if the cache is invalid
+    bool GetTotal(const TokenSymbol &symbol, uint64_t &amount) const;
+    bool NeedReconcile(int64_t now) const;
+    // incremented when invalidated, the balances read before are not applied by Reset()
+    uint64_t GetGeneration() const;
+
+    // ignored if the cache is invalid, the key is reconciled then
+    void SetBalances(const CKeyID &keyId, const CAccount &account);
+    void Reset(map<CKeyID, map<TokenSymbol, uint64_t>> &&keyBalancesIn, int64_t now, uint64_t generationIn);
+    void Invalidate();
+
+private:
+    mutable CCriticalSection cs_balances;
+    bool valid            = false;
+    uint64_t generation   = 0;
+    int64_t reconcileTime = 0;
+    map<CKeyID, map<TokenSymbol, uint64_t>> keyBalances;
+    map<TokenSymbol, uint64_t> totals;
+};
+
+/**
+ * Block connected to or disconnected from the active chain, or a tx to erase if spBlock is null, which
+ * the wallet sync thread applies to the wallet in the order of the chain updates. The key ids involved
+ * in the txs of the block are found on the frozen chain state of the new tip if spSnapshot is set,
+ * otherwise they are found when the block is queued.
+ */
+struct CWalletSyncTask {
+    std::shared_ptr<const CBlock> spBlock;
+    bool connected = false;
+    std::shared_ptr<CCacheSnapshot> spSnapshot;
+    vector<set<CKeyID>> txKeyIds;   // involved key ids by tx index of the block
+    // key ids of the accounts written by the block, a contract may move the funds of an account not
+    // involved in its tx, whose balance is refreshed then
+    set<CKeyID> accountKeyIds;
+    bool hasAccountKeyIds = false;
+    uint256 erasedTxid;
+};
+
+/**
+ * Queue of the wallet sync tasks. The tasks are pushed under cs_main, which never blocks, the blocks
+ * beyond the limit are throttled by WaitForSpace, which is called after cs_main is released.
+ */
+class CWalletSyncQueue {
+public:
+    CWalletSyncQueue(uint32_t maxBlocksIn) : maxBlocks(maxBlocksIn) {}
+
+    void Push(CWalletSyncTask &&task);
+    bool Pop(CWalletSyncTask &task, const std::chrono::milliseconds &timeout);
+    // Waits until fewer blocks than the limit are queued, returns false at once after Interrupt
+    bool WaitForSpace();
+    // Stops the waits for space for good, e.g. when the sync thread is gone
+    void Interrupt();
+    bool Empty();
+    uint32_t GetBlockCount();
+
+private:
+    std::mutex mtx;
+    std::condition_variable popCond;
+    std::condition_variable spaceCond;
+    std::deque<CWalletSyncTask> tasks;
+    uint32_t maxBlocks;
+    uint32_t blockCount = 0;  // tasks of blocks, the erased txs are not limited
+    bool interrupted    = false;
+};
+
 /** A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
  */
@@ -58,6 +145,7 @@ public:
     map<uint256, CWalletAccountTxDb> mapInBlockTx;
     map<uint256, std::shared_ptr<CBaseTx> > unconfirmedTx;
     mutable CCriticalSection cs_wallet;
+    mutable CWalletBalanceCache balanceCache;
 
     typedef std::map<uint32_t, CMasterKey> MasterKeyMap;
     MasterKeyMap mapMasterKeys;
@@ -113,8 +201,12 @@ public:
 
     bool LoadMinVersion(int32_t nVersion);
 
-    void SyncTransaction(const uint256 &hash, CBaseTx *pTx, const CBlock* pblock);
+    void SyncTransaction(const uint256 &hash, CBaseTx *pTx, const CBlock* pblock, const set<CKeyID> *pAccountKeyIds);
     void EraseTransaction(const uint256 &hash);
+    // Applies a queued block or erased tx to the wallet, without cs_main by the sync thread, or inline under
+    // cs_main with the chain state of the block in pTipCW when there is no sync thread
+    void SyncBlock(CWalletSyncTask &task, CCacheWrapper *pTipCW = nullptr);
+    void WaitForSync();
     void ResendWalletTransactions();
 
     bool IsMine(CBaseTx*pTx)const;
@@ -137,8 +229,23 @@ public:
     static CWallet* GetInstance();
 
     bool CommitTx(CBaseTx *pTx, string &retMsg); //retMsg is TxID when successful
+
+private:
+    void EraseUnconfirmedTx(const uint256 &hash);
+    // Writes the txs of the block which involve the wallet keys to the wallet db
+    void ApplyBlockTxs(const CWalletSyncTask &task, const vector<bool> &txMine);
+    // Reads the confirmed free amounts of all keys from the chain state of cw into the balance cache,
+    // returns their totals by symbol
+    map<TokenSymbol, uint64_t> ReconcileBalances(CCacheWrapper &cw) const;
 };
 
+// Starts the thread applying the connected and disconnected blocks to the wallet, see -walletsyncthread
+void StartWalletSync(boost::thread_group &threadGroup, CWallet *pWallet);
+
+// Applies the blocks still queued to the wallet without cs_main and stops queueing, the sync thread must
+// have stopped
+void FlushWalletSync(CWallet *pWallet);
+
 /** Private key that includes an expiration date in case it never gets used. */
 class CWalletKey {
 public: